@@ -0,0 +1,249 @@
+/*
+* ClockModel.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Sensor to host clock model (see ClockModel.h).
+*/
+
+#include "ClockModel.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLOCKMODEL_NOMINAL_SLOPE	1000.0		// ns per us
+#define CLOCKMODEL_REJECT_SIGMAS	3.0			// Minima further from the line are not used
+#define CLOCKMODEL_MIN_SPREAD_NS	20000.0		// Robust deviation is at least this (only clearly delayed minima are rejected)
+
+// Delay of a sample relative to the nominal clock rate - only used to compare samples of one bucket
+static double ClockModel_Delay(const ClockModel *model, const ClockSample *sample)
+{
+	return (double)(sample->hostNs - model->originHostNs) -
+		CLOCKMODEL_NOMINAL_SLOPE * (double)(sample->sensorUs - model->originSensorUs);
+}
+
+static int ClockModel_CompareDoubles(const void *a, const void *b)
+{
+	double valueA = *(const double *)a;
+	double valueB = *(const double *)b;
+
+	return (valueA < valueB) ? -1 : (valueA > valueB) ? 1 : 0;
+}
+
+// Least squares line through the points with use[i] set. Returns number of points used.
+static uint32_t ClockModel_LeastSquares(const double *x, const double *y, const int *use, uint32_t count,
+	double *slope, double *intercept)
+{
+	double meanX = 0.0;
+	double meanY = 0.0;
+	double sxx = 0.0;
+	double sxy = 0.0;
+	uint32_t used = 0;
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (use[i])
+		{
+			meanX += x[i];
+			meanY += y[i];
+			used++;
+		}
+	}
+	if (used == 0)
+	{
+		return 0;
+	}
+	meanX /= used;
+	meanY /= used;
+	for (i = 0; i < count; i++)
+	{
+		if (use[i])
+		{
+			sxx += (x[i] - meanX) * (x[i] - meanX);
+			sxy += (x[i] - meanX) * (y[i] - meanY);
+		}
+	}
+
+	// A single point (or all at one time) gives no slope - assume the nominal rate
+	*slope = (used > 1 && sxx > 0.0) ? sxy / sxx : CLOCKMODEL_NOMINAL_SLOPE;
+	*intercept = meanY - *slope * meanX;
+	return used;
+}
+
+// Fit line through the bucket minima (and the bucket being filled, at start)
+static void ClockModel_Fit(ClockModel *model)
+{
+	double x[CLOCKMODEL_BUCKETS + 1];
+	double y[CLOCKMODEL_BUCKETS + 1];
+	double residuals[CLOCKMODEL_BUCKETS + 1];
+	double sorted[CLOCKMODEL_BUCKETS + 1];
+	int use[CLOCKMODEL_BUCKETS + 1];
+	uint32_t count = 0;
+	uint32_t used;
+	double slope;
+	double intercept;
+	double median;
+	double spread;
+	double sumSquares = 0.0;
+	uint32_t i;
+
+	for (i = 0; i < model->bucketCount; i++)
+	{
+		const ClockSample *sample = &model->buckets[(model->bucketNext + CLOCKMODEL_BUCKETS - model->bucketCount + i) % CLOCKMODEL_BUCKETS];
+		x[count] = (double)(sample->sensorUs - model->originSensorUs);
+		y[count] = (double)(sample->hostNs - model->originHostNs);
+		use[count++] = 1;
+	}
+	if (model->bucketCount < 2)
+	{
+		x[count] = (double)(model->current.sensorUs - model->originSensorUs);
+		y[count] = (double)(model->current.hostNs - model->originHostNs);
+		use[count++] = 1;
+	}
+
+	ClockModel_LeastSquares(x, y, use, count, &slope, &intercept);
+
+	// Reject minima far from the first line (median absolute deviation), and refit
+	if (count >= 3)
+	{
+		for (i = 0; i < count; i++)
+		{
+			residuals[i] = y[i] - (intercept + slope * x[i]);
+			sorted[i] = residuals[i];
+		}
+		qsort(sorted, count, sizeof(double), ClockModel_CompareDoubles);
+		median = sorted[count / 2];
+		for (i = 0; i < count; i++)
+		{
+			sorted[i] = fabs(residuals[i] - median);
+		}
+		qsort(sorted, count, sizeof(double), ClockModel_CompareDoubles);
+		spread = 1.4826 * sorted[count / 2];
+		if (spread < CLOCKMODEL_MIN_SPREAD_NS)
+		{
+			spread = CLOCKMODEL_MIN_SPREAD_NS;
+		}
+		for (i = 0; i < count; i++)
+		{
+			use[i] = fabs(residuals[i] - median) <= CLOCKMODEL_REJECT_SIGMAS * spread;
+		}
+	}
+	if ((used = ClockModel_LeastSquares(x, y, use, count, &slope, &intercept)) == 0)
+	{
+		return;
+	}
+	for (i = 0; i < count; i++)
+	{
+		if (use[i])
+		{
+			double residual = y[i] - (intercept + slope * x[i]);
+			sumSquares += residual * residual;
+		}
+	}
+
+	model->slope = slope;
+	model->interceptNs = intercept;
+	model->residualNs = sqrt(sumSquares / used);
+	model->wallOffsetNs = (int64_t)(GoLog_RealtimeNs() - GoLog_MonotonicNs());
+	GoLogAtomic_Store32(&model->fitPoints, used);
+	GoLogAtomic_Store64(&model->fits, model->fits + 1);
+}
+
+void ClockModel_Init(ClockModel *model)
+{
+	memset(model, 0, sizeof(*model));
+	model->slope = CLOCKMODEL_NOMINAL_SLOPE;
+}
+
+void ClockModel_Update(ClockModel *model, uint64_t sensorUs, uint64_t hostNs)
+{
+	ClockSample sample;
+	uint64_t bucket = sensorUs / CLOCKMODEL_BUCKET_US;
+
+	sample.sensorUs = sensorUs;
+	sample.hostNs = hostNs;
+	GoLogAtomic_Store64(&model->samples, model->samples + 1);
+
+	if (!model->started || sensorUs < model->lastSensorUs)
+	{
+		// First surface, or sensor restarted - the old model does not apply to the new time stamps
+		if (model->started)
+		{
+			uint64_t restarts = model->restarts + 1;
+			ClockModel_Init(model);
+			GoLogAtomic_Store64(&model->restarts, restarts);
+		}
+		model->started = 1;
+		model->originSensorUs = sensorUs;
+		model->originHostNs = hostNs;
+		model->lastSensorUs = sensorUs;
+		model->current = sample;
+		model->currentBucket = bucket;
+		ClockModel_Fit(model);
+		return;
+	}
+	model->lastSensorUs = sensorUs;
+
+	if (bucket != model->currentBucket)
+	{
+		// Bucket finished - keep its minimum, and refit
+		model->buckets[model->bucketNext] = model->current;
+		model->bucketNext = (model->bucketNext + 1) % CLOCKMODEL_BUCKETS;
+		if (model->bucketCount < CLOCKMODEL_BUCKETS)
+		{
+			model->bucketCount++;
+		}
+		model->current = sample;
+		model->currentBucket = bucket;
+		ClockModel_Fit(model);
+	}
+	else if (ClockModel_Delay(model, &sample) < ClockModel_Delay(model, &model->current))
+	{
+		model->current = sample;
+
+		// Until the first bucket is complete the offset comes from the smallest delay so far
+		if (model->bucketCount == 0)
+		{
+			ClockModel_Fit(model);
+		}
+	}
+}
+
+uint64_t ClockModel_HostNs(const ClockModel *model, uint64_t sensorUs)
+{
+	double relativeUs;
+
+	if (!model->started)
+	{
+		return 0;
+	}
+	relativeUs = (sensorUs >= model->originSensorUs) ? (double)(sensorUs - model->originSensorUs) :
+		-(double)(model->originSensorUs - sensorUs);
+	return model->originHostNs + (uint64_t)(int64_t)llround(model->interceptNs + model->slope * relativeUs);
+}
+
+uint64_t ClockModel_WallNs(const ClockModel *model, uint64_t sensorUs)
+{
+	if (!model->started)
+	{
+		return 0;
+	}
+	return ClockModel_HostNs(model, sensorUs) + (uint64_t)model->wallOffsetNs;
+}
+
+double ClockModel_DriftPpm(const ClockModel *model)
+{
+	if (model->fitPoints < 2)
+	{
+		return 0.0;
+	}
+	return (CLOCKMODEL_NOMINAL_SLOPE / model->slope - 1.0) * 1.0e6;
+}
+
+void ClockModel_Print(FILE *fptr, const ClockModel *model)
+{
+	fprintf(fptr, "Clock model: sensor clock %+.2f ppm vs host, fit residual %.1f us over %u s, %llu fits, %llu restarts\n",
+		ClockModel_DriftPpm(model), model->residualNs / 1000.0, model->fitPoints,
+		(unsigned long long)model->fits, (unsigned long long)model->restarts);
+}
@@ -0,0 +1,91 @@
+/*
+* ClockModel.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Mapping of sensor time stamps to host time, so that surfaces can be
+* correlated with data from other cameras on the host clock.
+*
+* The sensor time stamp (us) is taken at acquisition, but the host only sees
+* the surface when the data callback runs, after a variable network and SDK
+* delay. The delay is never negative, so the receptions with the smallest
+* delay lie on a line below all others: the sensor clock mapped to the host
+* clock. The model keeps the sample with the smallest delay in each second of
+* sensor time, for the last CLOCKMODEL_BUCKETS seconds, and fits a line
+* (host monotonic ns vs. sensor us) through these minima by least squares.
+* Minima more than 3 robust standard deviations (from the median absolute
+* deviation) from the line are rejected and the line is refitted, so that
+* seconds where every surface was delayed (e.g. a stalled receive thread) do
+* not bias the fit. The slope tracks the drift between the two oscillators.
+*
+* The host time of a time stamp is then the time the surface would have been
+* received with the smallest delay seen. The constant part of that delay
+* (transfer of one surface) is not known and is not subtracted.
+*
+* Updating uses the monotonic time already taken by the callback, and a new
+* fit is made once per second of sensor time; mapping a time stamp is a few
+* arithmetic operations. The offset from the monotonic clock to the wall
+* clock is read once per fit.
+*
+* The model is updated by the data callback only; other threads may read the
+* values for reports at any time.
+*/
+
+#ifndef CLOCK_MODEL_H
+#define CLOCK_MODEL_H
+
+#include "GoLogPlatform.h"
+#include <stdio.h>
+
+#define CLOCKMODEL_BUCKETS			64			// Seconds of sensor time used in the fit
+#define CLOCKMODEL_BUCKET_US		1000000		// Sensor time covered by one bucket
+
+typedef struct
+{
+	uint64_t sensorUs;
+	uint64_t hostNs;
+}ClockSample;
+
+typedef struct
+{
+	int started;
+	uint64_t originSensorUs;			// Model times are relative to the first sample
+	uint64_t originHostNs;
+	uint64_t lastSensorUs;
+
+	// Sample with the smallest delay in each bucket (ring buffer, oldest first)
+	ClockSample buckets[CLOCKMODEL_BUCKETS];
+	uint32_t bucketCount;
+	uint32_t bucketNext;
+	ClockSample current;				// Smallest delay in the bucket being filled
+	uint64_t currentBucket;				// Bucket number (sensor time / CLOCKMODEL_BUCKET_US)
+
+	// Current model: hostNs = originHostNs + interceptNs + slope * (sensorUs - originSensorUs)
+	volatile double slope;				// Host ns per sensor us (1000 if the clocks run at the same rate)
+	volatile double interceptNs;
+	volatile double residualNs;			// RMS distance of the fitted minima from the line
+	volatile int64_t wallOffsetNs;		// Wall clock - monotonic clock
+	volatile uint32_t fitPoints;		// Minima used in the last fit (0 = no fit yet)
+	volatile uint64_t samples;
+	volatile uint64_t fits;
+	volatile uint64_t restarts;			// Time stamp went backwards (sensor restarted) - model was reset
+}ClockModel;
+
+void ClockModel_Init(ClockModel *model);
+
+// Add a received surface: sensor time stamp (us) and host monotonic time when it was received (ns)
+void ClockModel_Update(ClockModel *model, uint64_t sensorUs, uint64_t hostNs);
+
+// Host monotonic time (ns) of a sensor time stamp. 0 if no surface has been seen.
+uint64_t ClockModel_HostNs(const ClockModel *model, uint64_t sensorUs);
+
+// Host wall clock time (ns since 1970-01-01 UTC) of a sensor time stamp. 0 if no surface has been seen.
+uint64_t ClockModel_WallNs(const ClockModel *model, uint64_t sensorUs);
+
+// Sensor clock rate relative to the host clock, in parts per million (0 until fitted)
+double ClockModel_DriftPpm(const ClockModel *model);
+
+// Print one line summary of the model
+void ClockModel_Print(FILE *fptr, const ClockModel *model);
+
+#endif // CLOCK_MODEL_H
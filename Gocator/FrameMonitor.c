@@ -0,0 +1,98 @@
+/*
+* FrameMonitor.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Frame gap detection from stamp frame indices and time stamps (see FrameMonitor.h).
+*/
+
+#include "FrameMonitor.h"
+#include <string.h>
+
+#define FRAMEMONITOR_LATE_FACTOR	1.5		// Interval longer than this times the expected interval is late
+
+void FrameMonitor_Init(FrameMonitor *monitor, double frameRate)
+{
+	memset(monitor, 0, sizeof(*monitor));
+	monitor->frameRate = frameRate;
+}
+
+uint32_t FrameMonitor_Surface(FrameMonitor *monitor, uint64_t frameIndex, uint64_t timeStamp)
+{
+	uint64_t frameDelta;
+	uint64_t lost = 0;
+
+	GoLogAtomic_Store64(&monitor->surfaces, monitor->surfaces + 1);
+	if (!monitor->started || frameIndex <= monitor->lastFrameIndex)
+	{
+		// First surface, or sensor restarted - start a new sequence
+		if (monitor->started)
+		{
+			GoLogAtomic_Store64(&monitor->restarts, monitor->restarts + 1);
+		}
+		monitor->started = 1;
+		monitor->previousLost = monitor->lostSurfaces;
+		monitor->sequenceSurfaces = 1;
+		monitor->firstFrameIndex = frameIndex;
+		monitor->firstTimeStamp = timeStamp;
+		monitor->lastFrameIndex = frameIndex;
+		monitor->lastTimeStamp = timeStamp;
+		return 0;
+	}
+
+	frameDelta = frameIndex - monitor->lastFrameIndex;
+	monitor->sequenceSurfaces++;
+	if (monitor->frameStep == 0 || frameDelta < monitor->frameStep)
+	{
+		GoLogAtomic_Store64(&monitor->frameStep, frameDelta);
+	}
+
+	// Total lost = surfaces expected over the whole frame index span - surfaces received
+	GoLogAtomic_Store64(&monitor->lostSurfaces, monitor->previousLost +
+		(frameIndex - monitor->firstFrameIndex + monitor->frameStep / 2) / monitor->frameStep + 1 - monitor->sequenceSurfaces);
+
+	// Surfaces missing between this and the previous one
+	lost = (frameDelta + monitor->frameStep / 2) / monitor->frameStep - 1;
+	if (lost > 0)
+	{
+		GoLogAtomic_Store64(&monitor->gaps, monitor->gaps + 1);
+		if (lost > monitor->largestGap)
+		{
+			GoLogAtomic_Store64(&monitor->largestGap, lost);
+		}
+	}
+
+	// Time since previous surface compared with the configured frame rate
+	if (monitor->frameRate > 0.0 && timeStamp > monitor->lastTimeStamp &&
+		(double)(timeStamp - monitor->lastTimeStamp) > FRAMEMONITOR_LATE_FACTOR * 1.0e6 * frameDelta / monitor->frameRate)
+	{
+		GoLogAtomic_Store64(&monitor->lateSurfaces, monitor->lateSurfaces + 1);
+	}
+
+	monitor->lastFrameIndex = frameIndex;
+	monitor->lastTimeStamp = timeStamp;
+	return (lost > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (uint32_t)lost;
+}
+
+double FrameMonitor_SensorFrameRate(const FrameMonitor *monitor)
+{
+	if (!monitor->started || monitor->lastTimeStamp <= monitor->firstTimeStamp)
+	{
+		return 0.0;
+	}
+	return (monitor->lastFrameIndex - monitor->firstFrameIndex) * 1.0e6 / (monitor->lastTimeStamp - monitor->firstTimeStamp);
+}
+
+void FrameMonitor_Print(FILE *fptr, const FrameMonitor *monitor, uint64_t captured)
+{
+	uint64_t sent = monitor->surfaces + monitor->lostSurfaces;
+
+	fprintf(fptr, "Sensor: %llu surfaces sent, %llu received, %llu lost before callback in %llu gaps (largest %llu), "
+		"%llu late, %llu restarts\n",
+		(unsigned long long)sent, (unsigned long long)monitor->surfaces, (unsigned long long)monitor->lostSurfaces,
+		(unsigned long long)monitor->gaps, (unsigned long long)monitor->largestGap,
+		(unsigned long long)monitor->lateSurfaces, (unsigned long long)monitor->restarts);
+	fprintf(fptr, "Sensor frame rate %.2f Hz (configured %.2f Hz), %llu frames per surface; %llu of %llu surfaces written (%.2f %%)\n",
+		FrameMonitor_SensorFrameRate(monitor), monitor->frameRate, (unsigned long long)monitor->frameStep,
+		(unsigned long long)captured, (unsigned long long)sent, sent > 0 ? 100.0 * captured / sent : 0.0);
+}
@@ -0,0 +1,65 @@
+/*
+* FrameMonitor.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Detection of surfaces lost before they reach the data callback
+* (in the sensor, on the network or in the SDK), from the frame index and
+* time stamp in the stamp message sent with every surface.
+*
+* Consecutive surfaces are normally a fixed number of sensor frames apart
+* (one frame per profile; a surface is built from many profiles). This
+* nominal step is taken as the smallest positive frame index difference seen
+* so far. A larger difference is a gap, and round(difference / step) - 1
+* surfaces are lost. If a gap occurs before the first nominal step has been
+* seen, the step is overestimated and the loss returned for that surface is
+* too small; the total (lostSurfaces) is recomputed from the whole frame index
+* span whenever the step changes, so it is correct in the end.
+*
+* The time stamps are checked against the frame rate configured in the
+* sensor: an interval more than 50 % longer than the frame index difference
+* at the configured rate is counted as late (sensor not keeping up, e.g.
+* exposure or processing limited). The frame rate actually achieved by the
+* sensor is measured from the first and last stamp.
+*
+* The monitor is updated by the data callback only; other threads may read
+* the counters at any time.
+*/
+
+#ifndef FRAME_MONITOR_H
+#define FRAME_MONITOR_H
+
+#include "GoLogPlatform.h"
+#include <stdio.h>
+
+typedef struct
+{
+	double frameRate;					// Configured sensor frame rate (Hz)
+	int started;
+	uint64_t firstFrameIndex;
+	uint64_t firstTimeStamp;			// us
+	uint64_t lastFrameIndex;
+	uint64_t lastTimeStamp;				// us
+	uint64_t sequenceSurfaces;			// Surfaces since first (or restart)
+	uint64_t previousLost;				// Surfaces lost in sequences before last restart
+	volatile uint64_t frameStep;		// Nominal frames per surface (0 until two surfaces seen)
+	volatile uint64_t surfaces;			// Surfaces received by the callback
+	volatile uint64_t lostSurfaces;		// Surfaces missing in frame index sequence
+	volatile uint64_t gaps;				// Number of frame index gaps
+	volatile uint64_t largestGap;		// Most surfaces lost in one gap
+	volatile uint64_t lateSurfaces;		// Intervals longer than expected from frame rate
+	volatile uint64_t restarts;			// Frame index went backwards (sensor restarted)
+}FrameMonitor;
+
+void FrameMonitor_Init(FrameMonitor *monitor, double frameRate);
+
+// Register a received surface. Returns the number of surfaces lost since the previous one.
+uint32_t FrameMonitor_Surface(FrameMonitor *monitor, uint64_t frameIndex, uint64_t timeStamp);
+
+// Frame rate achieved by the sensor, from frame indices and time stamps (0 if unknown)
+double FrameMonitor_SensorFrameRate(const FrameMonitor *monitor);
+
+// Print one line summary. captured is the number of surfaces actually written.
+void FrameMonitor_Print(FILE *fptr, const FrameMonitor *monitor, uint64_t captured);
+
+#endif // FRAME_MONITOR_H
@@ -0,0 +1,840 @@
+/*
+* GoLogPlatform.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Win32 / POSIX implementation of the logger portability layer.
+*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE							// O_DIRECT
+#endif
+
+#include "GoLogPlatform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if !defined(_WIN32)
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#endif
+
+#define GOLOG_HUGE_PAGE_SIZE	(2 * 1024 * 1024)		// Linux default huge page size
+#define GOLOG_MAX_WRITE			(1u << 30)				// Largest single write call
+#if defined(IOV_MAX) && IOV_MAX < 1024
+#define GOLOG_MAX_IOVECS		IOV_MAX					// Pieces per writev call
+#else
+#define GOLOG_MAX_IOVECS		1024
+#endif
+
+// File name list being built by GoLog_ListFiles
+typedef struct
+{
+	char **names;
+	int count;
+	int capacity;
+}GoLogFileList;
+
+static int GoLogFileList_Add(GoLogFileList *list, const char *name, const char *suffix)
+{
+	size_t nameLength = strlen(name);
+	size_t suffixLength = strlen(suffix);
+	char *copy;
+
+	if (nameLength < suffixLength || strcmp(name + nameLength - suffixLength, suffix) != 0)
+	{
+		return 0;
+	}
+
+	if (list->count == list->capacity)
+	{
+		int capacity = list->capacity ? 2 * list->capacity : 256;
+		char **names = realloc(list->names, capacity * sizeof(char *));
+		if (names == NULL)
+		{
+			return -1;
+		}
+		list->names = names;
+		list->capacity = capacity;
+	}
+
+	if ((copy = malloc(nameLength + 1)) == NULL)
+	{
+		return -1;
+	}
+	memcpy(copy, name, nameLength + 1);
+	list->names[list->count++] = copy;
+	return 0;
+}
+
+static int GoLogFileList_Compare(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static int GoLogFileList_Finish(GoLogFileList *list, char ***names)
+{
+	qsort(list->names, list->count, sizeof(char *), GoLogFileList_Compare);
+	*names = list->names;
+	return list->count;
+}
+
+void GoLog_FreeFileList(char **names, int count)
+{
+	int i;
+	for (i = 0; i < count; i++)
+	{
+		free(names[i]);
+	}
+	free(names);
+}
+
+// Thread start parameters - freed by the thread trampoline
+typedef struct
+{
+	GoLogThreadFunc func;
+	void *arg;
+}GoLogThreadStart;
+
+#if defined(_WIN32)
+
+static DWORD WINAPI GoLogThread_Trampoline(LPVOID param)
+{
+	GoLogThreadStart start = *(GoLogThreadStart *)param;
+	free(param);
+	start.func(start.arg);
+	return 0;
+}
+
+int GoLogThread_Start(GoLogThread *thread, GoLogThreadFunc func, void *arg)
+{
+	GoLogThreadStart *start = malloc(sizeof(GoLogThreadStart));
+	if (start == NULL)
+	{
+		return -1;
+	}
+	start->func = func;
+	start->arg = arg;
+
+	if ((*thread = CreateThread(NULL, 0, GoLogThread_Trampoline, start, 0, NULL)) == NULL)
+	{
+		free(start);
+		return -1;
+	}
+	return 0;
+}
+
+void GoLogThread_Join(GoLogThread thread)
+{
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+int GoLogThread_SetAffinity(GoLogThread thread, int cpu)
+{
+	if (cpu < 0 || cpu >= (int)(8 * sizeof(DWORD_PTR)))
+	{
+		return -1;
+	}
+	return SetThreadAffinityMask(thread, (DWORD_PTR)1 << cpu) != 0 ? 0 : -1;
+}
+
+int GoLog_CpuCount(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+}
+
+int GoLogSemaphore_Init(GoLogSemaphore *semaphore)
+{
+	semaphore->handle = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL);
+	return (semaphore->handle != NULL) ? 0 : -1;
+}
+
+void GoLogSemaphore_Destroy(GoLogSemaphore *semaphore)
+{
+	CloseHandle(semaphore->handle);
+}
+
+void GoLogSemaphore_Post(GoLogSemaphore *semaphore, uint32_t count)
+{
+	ReleaseSemaphore(semaphore->handle, (LONG)count, NULL);
+}
+
+void GoLogSemaphore_Wait(GoLogSemaphore *semaphore)
+{
+	WaitForSingleObject(semaphore->handle, INFINITE);
+}
+
+void GoLog_SleepMs(uint32_t milliseconds)
+{
+	Sleep(milliseconds);
+}
+
+void GoLog_SleepUs(uint32_t microseconds)
+{
+	Sleep((microseconds + 999) / 1000);
+}
+
+uint64_t GoLog_MonotonicNs(void)
+{
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ull +
+		(uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ull / (uint64_t)frequency.QuadPart;
+}
+
+uint64_t GoLog_RealtimeNs(void)
+{
+	FILETIME fileTime;
+	ULARGE_INTEGER ticks;
+
+	// 100 ns ticks since 1601-01-01
+	GetSystemTimePreciseAsFileTime(&fileTime);
+	ticks.LowPart = fileTime.dwLowDateTime;
+	ticks.HighPart = fileTime.dwHighDateTime;
+	return (ticks.QuadPart - 116444736000000000ull) * 100;
+}
+
+void GoLog_WallTime(GoLogWallTime *wallTime)
+{
+	SYSTEMTIME str_t;
+	GetSystemTime(&str_t);
+	wallTime->year = str_t.wYear;
+	wallTime->month = str_t.wMonth;
+	wallTime->day = str_t.wDay;
+	wallTime->hour = str_t.wHour;
+	wallTime->minute = str_t.wMinute;
+	wallTime->second = str_t.wSecond;
+	wallTime->millisecond = str_t.wMilliseconds;
+}
+
+int GoLog_ListFiles(const char *folder, const char *suffix, char ***names)
+{
+	GoLogFileList list = { NULL, 0, 0 };
+	WIN32_FIND_DATAA findData;
+	HANDLE find;
+	char pattern[1024];
+
+	snprintf(pattern, sizeof pattern, "%s\\*", folder);
+	if ((find = FindFirstFileA(pattern, &findData)) == INVALID_HANDLE_VALUE)
+	{
+		return (GetLastError() == ERROR_FILE_NOT_FOUND) ? GoLogFileList_Finish(&list, names) : -1;
+	}
+	do
+	{
+		if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+			GoLogFileList_Add(&list, findData.cFileName, suffix) != 0)
+		{
+			FindClose(find);
+			GoLog_FreeFileList(list.names, list.count);
+			return -1;
+		}
+	} while (FindNextFileA(find, &findData));
+	FindClose(find);
+	return GoLogFileList_Finish(&list, names);
+}
+
+int GoLog_ListFolders(const char *folder, char ***names)
+{
+	GoLogFileList list = { NULL, 0, 0 };
+	WIN32_FIND_DATAA findData;
+	HANDLE find;
+	char pattern[1024];
+
+	snprintf(pattern, sizeof pattern, "%s\\*", folder);
+	if ((find = FindFirstFileA(pattern, &findData)) == INVALID_HANDLE_VALUE)
+	{
+		return (GetLastError() == ERROR_FILE_NOT_FOUND) ? GoLogFileList_Finish(&list, names) : -1;
+	}
+	do
+	{
+		if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && strcmp(findData.cFileName, ".") != 0 &&
+			strcmp(findData.cFileName, "..") != 0 && GoLogFileList_Add(&list, findData.cFileName, "") != 0)
+		{
+			FindClose(find);
+			GoLog_FreeFileList(list.names, list.count);
+			return -1;
+		}
+	} while (FindNextFileA(find, &findData));
+	FindClose(find);
+	return GoLogFileList_Finish(&list, names);
+}
+
+int GoLog_MakeFolder(const char *path)
+{
+	return (CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS) ? 0 : -1;
+}
+
+int GoLog_MapFile(GoLogMappedFile *map, const char *path)
+{
+	LARGE_INTEGER size;
+
+	memset(map, 0, sizeof(*map));
+	map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (map->file == INVALID_HANDLE_VALUE)
+	{
+		return -1;
+	}
+	if (!GetFileSizeEx(map->file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(map->file);
+		return -1;
+	}
+	map->size = (uint64_t)size.QuadPart;
+
+	if ((map->mapping = CreateFileMappingA(map->file, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL ||
+		(map->data = MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0)) == NULL)
+	{
+		if (map->mapping != NULL)
+		{
+			CloseHandle(map->mapping);
+		}
+		CloseHandle(map->file);
+		return -1;
+	}
+	return 0;
+}
+
+void GoLog_UnmapFile(GoLogMappedFile *map)
+{
+	if (map->data != NULL)
+	{
+		UnmapViewOfFile(map->data);
+		CloseHandle(map->mapping);
+		CloseHandle(map->file);
+		map->data = NULL;
+	}
+}
+
+int GoLog_ReadAhead(const char *path)
+{
+#if _WIN32_WINNT >= 0x0602
+	GoLogMappedFile map;
+	WIN32_MEMORY_RANGE_ENTRY range;
+	int result;
+
+	// Pages prefetched into a view stay in the file cache after it is unmapped
+	if (GoLog_MapFile(&map, path) != 0)
+	{
+		return -1;
+	}
+	range.VirtualAddress = (PVOID)map.data;
+	range.NumberOfBytes = (SIZE_T)map.size;
+	result = PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0) ? 0 : -1;
+	GoLog_UnmapFile(&map);
+	return result;
+#else
+	(void)path;
+	return -1;
+#endif
+}
+
+void *GoLog_AllocPages(size_t *size, int *hugePages)
+{
+	SIZE_T largePage = GetLargePageMinimum();
+	void *memory = NULL;
+
+	// Large pages require the "Lock pages in memory" privilege (SeLockMemoryPrivilege)
+	if (*hugePages && largePage > 0)
+	{
+		size_t largeSize = (*size + largePage - 1) / largePage * largePage;
+		memory = VirtualAlloc(NULL, largeSize, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (memory != NULL)
+		{
+			*size = largeSize;
+			return memory;					// Large pages are always resident
+		}
+	}
+	*hugePages = 0;
+
+	if ((memory = VirtualAlloc(NULL, *size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE)) == NULL)
+	{
+		return NULL;
+	}
+	memset(memory, 0, *size);				// Pre-fault
+	return memory;
+}
+
+void GoLog_FreePages(void *memory, size_t size)
+{
+	if (memory != NULL)
+	{
+		VirtualFree(memory, 0, MEM_RELEASE);
+	}
+}
+
+int GoLog_CreateFile(GoLogFile *file, const char *path, int direct)
+{
+	file->direct = direct;
+	file->file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+		direct ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (direct && file->file == INVALID_HANDLE_VALUE && GetLastError() == ERROR_INVALID_PARAMETER)
+	{
+		file->direct = 0;
+		file->file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	}
+	return (file->file == INVALID_HANDLE_VALUE) ? -1 : 0;
+}
+
+int GoLog_WriteFile(GoLogFile *file, const void *buffer, size_t size)
+{
+	const uint8_t *bytes = buffer;
+	DWORD written;
+
+	while (size > 0)
+	{
+		DWORD chunk = (DWORD)(size < GOLOG_MAX_WRITE ? size : GOLOG_MAX_WRITE);
+		if (!WriteFile(file->file, bytes, chunk, &written, NULL) || written == 0)
+		{
+			return -1;
+		}
+		bytes += written;
+		size -= written;
+	}
+	return 0;
+}
+
+// WriteFileGather only works on unbuffered files and page sized pieces - write one piece at a time
+int GoLog_WriteFileVectors(GoLogFile *file, const GoLogIoVec *vectors, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (GoLog_WriteFile(file, vectors[i].data, vectors[i].size) != 0)
+		{
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int GoLog_CloseFile(GoLogFile *file)
+{
+	return CloseHandle(file->file) ? 0 : -1;
+}
+
+#else
+
+static void *GoLogThread_Trampoline(void *param)
+{
+	GoLogThreadStart start = *(GoLogThreadStart *)param;
+	free(param);
+	start.func(start.arg);
+	return NULL;
+}
+
+int GoLogThread_Start(GoLogThread *thread, GoLogThreadFunc func, void *arg)
+{
+	GoLogThreadStart *start = malloc(sizeof(GoLogThreadStart));
+	if (start == NULL)
+	{
+		return -1;
+	}
+	start->func = func;
+	start->arg = arg;
+
+	if (pthread_create(thread, NULL, GoLogThread_Trampoline, start) != 0)
+	{
+		free(start);
+		return -1;
+	}
+	return 0;
+}
+
+void GoLogThread_Join(GoLogThread thread)
+{
+	pthread_join(thread, NULL);
+}
+
+int GoLogThread_SetAffinity(GoLogThread thread, int cpu)
+{
+#if defined(__linux__)
+	cpu_set_t cpus;
+
+	if (cpu < 0 || cpu >= CPU_SETSIZE)
+	{
+		return -1;
+	}
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+	return pthread_setaffinity_np(thread, sizeof(cpus), &cpus) == 0 ? 0 : -1;
+#else
+	(void)thread;
+	(void)cpu;
+	return -1;
+#endif
+}
+
+int GoLog_CpuCount(void)
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0) ? (int)count : 1;
+}
+
+int GoLogSemaphore_Init(GoLogSemaphore *semaphore)
+{
+	semaphore->count = 0;
+	if (pthread_mutex_init(&semaphore->mutex, NULL) != 0)
+	{
+		return -1;
+	}
+	if (pthread_cond_init(&semaphore->condition, NULL) != 0)
+	{
+		pthread_mutex_destroy(&semaphore->mutex);
+		return -1;
+	}
+	return 0;
+}
+
+void GoLogSemaphore_Destroy(GoLogSemaphore *semaphore)
+{
+	pthread_cond_destroy(&semaphore->condition);
+	pthread_mutex_destroy(&semaphore->mutex);
+}
+
+void GoLogSemaphore_Post(GoLogSemaphore *semaphore, uint32_t count)
+{
+	pthread_mutex_lock(&semaphore->mutex);
+	semaphore->count += count;
+	if (count == 1)
+	{
+		pthread_cond_signal(&semaphore->condition);
+	}
+	else
+	{
+		pthread_cond_broadcast(&semaphore->condition);
+	}
+	pthread_mutex_unlock(&semaphore->mutex);
+}
+
+void GoLogSemaphore_Wait(GoLogSemaphore *semaphore)
+{
+	pthread_mutex_lock(&semaphore->mutex);
+	while (semaphore->count == 0)
+	{
+		pthread_cond_wait(&semaphore->condition, &semaphore->mutex);
+	}
+	semaphore->count--;
+	pthread_mutex_unlock(&semaphore->mutex);
+}
+
+void GoLog_SleepMs(uint32_t milliseconds)
+{
+	struct timespec ts;
+	ts.tv_sec = milliseconds / 1000;
+	ts.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+	nanosleep(&ts, NULL);
+}
+
+void GoLog_SleepUs(uint32_t microseconds)
+{
+	struct timespec ts;
+	ts.tv_sec = microseconds / 1000000;
+	ts.tv_nsec = (long)(microseconds % 1000000) * 1000L;
+	nanosleep(&ts, NULL);
+}
+
+uint64_t GoLog_MonotonicNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t GoLog_RealtimeNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void GoLog_WallTime(GoLogWallTime *wallTime)
+{
+	struct timeval tv;
+	struct tm tm_t;
+	time_t seconds;
+
+	gettimeofday(&tv, NULL);
+	seconds = tv.tv_sec;
+	gmtime_r(&seconds, &tm_t);
+	wallTime->year = tm_t.tm_year + 1900;
+	wallTime->month = tm_t.tm_mon + 1;
+	wallTime->day = tm_t.tm_mday;
+	wallTime->hour = tm_t.tm_hour;
+	wallTime->minute = tm_t.tm_min;
+	wallTime->second = tm_t.tm_sec;
+	wallTime->millisecond = (int)(tv.tv_usec / 1000);
+}
+
+int GoLog_ListFiles(const char *folder, const char *suffix, char ***names)
+{
+	GoLogFileList list = { NULL, 0, 0 };
+	struct dirent *entry;
+	DIR *dir;
+
+	if ((dir = opendir(folder)) == NULL)
+	{
+		return -1;
+	}
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (GoLogFileList_Add(&list, entry->d_name, suffix) != 0)
+		{
+			closedir(dir);
+			GoLog_FreeFileList(list.names, list.count);
+			return -1;
+		}
+	}
+	closedir(dir);
+	return GoLogFileList_Finish(&list, names);
+}
+
+int GoLog_ListFolders(const char *folder, char ***names)
+{
+	GoLogFileList list = { NULL, 0, 0 };
+	struct dirent *entry;
+	struct stat info;
+	char path[PATH_MAX];
+	DIR *dir;
+
+	if ((dir = opendir(folder)) == NULL)
+	{
+		return -1;
+	}
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+		{
+			continue;
+		}
+		snprintf(path, sizeof path, "%s/%s", folder, entry->d_name);
+		if (stat(path, &info) == 0 && S_ISDIR(info.st_mode) && GoLogFileList_Add(&list, entry->d_name, "") != 0)
+		{
+			closedir(dir);
+			GoLog_FreeFileList(list.names, list.count);
+			return -1;
+		}
+	}
+	closedir(dir);
+	return GoLogFileList_Finish(&list, names);
+}
+
+int GoLog_MakeFolder(const char *path)
+{
+	return (mkdir(path, 0777) == 0 || errno == EEXIST) ? 0 : -1;
+}
+
+int GoLog_MapFile(GoLogMappedFile *map, const char *path)
+{
+	struct stat info;
+	void *data;
+	int fd;
+
+	memset(map, 0, sizeof(*map));
+	if ((fd = open(path, O_RDONLY)) < 0)
+	{
+		return -1;
+	}
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);								// Mapping stays valid after close
+	if (data == MAP_FAILED)
+	{
+		return -1;
+	}
+	madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+	map->data = data;
+	map->size = (uint64_t)info.st_size;
+	return 0;
+}
+
+void GoLog_UnmapFile(GoLogMappedFile *map)
+{
+	if (map->data != NULL)
+	{
+		munmap((void *)map->data, (size_t)map->size);
+		map->data = NULL;
+	}
+}
+
+int GoLog_ReadAhead(const char *path)
+{
+#if defined(POSIX_FADV_WILLNEED)
+	int result;
+	int fd;
+
+	// The reads are queued and the call returns; pages stay in the file cache after close
+	if ((fd = open(path, O_RDONLY)) < 0)
+	{
+		return -1;
+	}
+	result = (posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0) ? 0 : -1;
+	close(fd);
+	return result;
+#else
+	(void)path;
+	return -1;
+#endif
+}
+
+void *GoLog_AllocPages(size_t *size, int *hugePages)
+{
+	void *memory = MAP_FAILED;
+
+#if defined(MAP_HUGETLB)
+	// Explicit huge pages must have been reserved (vm.nr_hugepages)
+	if (*hugePages)
+	{
+		size_t hugeSize = (*size + GOLOG_HUGE_PAGE_SIZE - 1) & ~(size_t)(GOLOG_HUGE_PAGE_SIZE - 1);
+		memory = mmap(NULL, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED)
+		{
+			*size = hugeSize;
+		}
+	}
+#endif
+	if (memory == MAP_FAILED)
+	{
+		if ((memory = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+		{
+			return NULL;
+		}
+#if defined(MADV_HUGEPAGE)
+		if (*hugePages)
+		{
+			madvise(memory, *size, MADV_HUGEPAGE);		// Transparent huge pages, if enabled
+		}
+#endif
+		*hugePages = 0;
+	}
+	memset(memory, 0, *size);				// Pre-fault
+	return memory;
+}
+
+void GoLog_FreePages(void *memory, size_t size)
+{
+	if (memory != NULL)
+	{
+		munmap(memory, size);
+	}
+}
+
+int GoLog_CreateFile(GoLogFile *file, const char *path, int direct)
+{
+	file->direct = 0;
+	file->fd = -1;
+#if defined(O_DIRECT)
+	// EINVAL: file system without direct I/O (e.g. tmpfs)
+	if (direct)
+	{
+		file->direct = 1;
+		file->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0666);
+		if (file->fd >= 0 || errno != EINVAL)
+		{
+			return (file->fd < 0) ? -1 : 0;
+		}
+		file->direct = 0;
+	}
+#endif
+	file->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	return (file->fd < 0) ? -1 : 0;
+}
+
+int GoLog_WriteFile(GoLogFile *file, const void *buffer, size_t size)
+{
+	const uint8_t *bytes = buffer;
+	ssize_t written;
+
+	while (size > 0)
+	{
+		written = write(file->fd, bytes, size < GOLOG_MAX_WRITE ? size : GOLOG_MAX_WRITE);
+		if (written <= 0)
+		{
+			if (written < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+		bytes += written;
+		size -= (size_t)written;
+	}
+	return 0;
+}
+
+int GoLog_WriteFileVectors(GoLogFile *file, const GoLogIoVec *vectors, int count)
+{
+	struct iovec pieces[GOLOG_MAX_IOVECS];
+	size_t done = 0;						// Bytes of vectors[0] already written
+	ssize_t written;
+	int pieceCount;
+
+	while (count > 0)
+	{
+		// Skip empty and completed pieces
+		if (done == vectors[0].size)
+		{
+			vectors++;
+			count--;
+			done = 0;
+			continue;
+		}
+
+		for (pieceCount = 0; pieceCount < count && pieceCount < GOLOG_MAX_IOVECS; pieceCount++)
+		{
+			pieces[pieceCount].iov_base = (uint8_t *)vectors[pieceCount].data + (pieceCount == 0 ? done : 0);
+			pieces[pieceCount].iov_len = vectors[pieceCount].size - (pieceCount == 0 ? done : 0);
+		}
+		written = writev(file->fd, pieces, pieceCount);
+		if (written <= 0)
+		{
+			if (written < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+
+		// Partial write (large total or signal) - continue after the last byte written
+		while (count > 0 && (size_t)written >= vectors[0].size - done)
+		{
+			written -= (ssize_t)(vectors[0].size - done);
+			vectors++;
+			count--;
+			done = 0;
+		}
+		done += (size_t)written;
+	}
+	return 0;
+}
+
+int GoLog_CloseFile(GoLogFile *file)
+{
+	return close(file->fd);
+}
+
+#endif
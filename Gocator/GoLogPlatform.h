@@ -0,0 +1,240 @@
+/*
+* GoLogPlatform.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Small portability layer for the Gocator logger - threads,
+* semaphores, atomics, sleeping, wall clock time, directory listing, memory mapped files and
+* page allocation.
+* Win32 is used on Windows, POSIX elsewhere.
+* The modules in this folder use <stdint.h> types rather than the GoSdk k-types
+* so that they can also be compiled into offline tools without the SDK.
+*/
+
+#ifndef GOLOG_PLATFORM_H
+#define GOLOG_PLATFORM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <intrin.h>
+#else
+#include <pthread.h>
+#endif
+
+#define GOLOG_INLINE			static __inline
+#define GOLOG_CACHE_LINE		64
+
+// Threads
+#if defined(_WIN32)
+typedef HANDLE GoLogThread;
+#else
+typedef pthread_t GoLogThread;
+#endif
+
+typedef void (*GoLogThreadFunc)(void *arg);
+
+// Start a thread running func(arg). Returns 0 on success.
+int GoLogThread_Start(GoLogThread *thread, GoLogThreadFunc func, void *arg);
+
+// Wait for thread to finish
+void GoLogThread_Join(GoLogThread thread);
+
+// Run thread on the given CPU (logical processor) only. Returns 0 on success.
+int GoLogThread_SetAffinity(GoLogThread thread, int cpu);
+
+// Number of logical processors available to the process
+int GoLog_CpuCount(void);
+
+// Counting semaphore
+typedef struct
+{
+#if defined(_WIN32)
+	HANDLE handle;
+#else
+	pthread_mutex_t mutex;
+	pthread_cond_t condition;
+	uint32_t count;
+#endif
+}GoLogSemaphore;
+
+// Returns 0 on success
+int GoLogSemaphore_Init(GoLogSemaphore *semaphore);
+void GoLogSemaphore_Destroy(GoLogSemaphore *semaphore);
+
+// Add count to the semaphore, waking up to count waiting threads
+void GoLogSemaphore_Post(GoLogSemaphore *semaphore, uint32_t count);
+
+// Wait until the semaphore is non-zero, and decrement it
+void GoLogSemaphore_Wait(GoLogSemaphore *semaphore);
+
+// Sleep for (at least) the given number of milliseconds / microseconds
+void GoLog_SleepMs(uint32_t milliseconds);
+void GoLog_SleepUs(uint32_t microseconds);
+
+// Monotonic clock in nanoseconds (arbitrary origin)
+uint64_t GoLog_MonotonicNs(void);
+
+// Wall clock in nanoseconds since 1970-01-01 UTC (resolution depends on the OS, typically 100 ns or better)
+uint64_t GoLog_RealtimeNs(void);
+
+// Wall clock time (UTC), used for file names
+typedef struct
+{
+	int year;
+	int month;
+	int day;
+	int hour;
+	int minute;
+	int second;
+	int millisecond;
+}GoLogWallTime;
+
+void GoLog_WallTime(GoLogWallTime *wallTime);
+
+// List names of files in folder ending with suffix, sorted by name.
+// Returns number of names (free with GoLog_FreeFileList), or -1 if the folder cannot be read.
+int GoLog_ListFiles(const char *folder, const char *suffix, char ***names);
+void GoLog_FreeFileList(char **names, int count);
+
+// List names of the subfolders of folder (without "." and ".."), sorted by name.
+// Returns number of names (free with GoLog_FreeFileList), or -1 if the folder cannot be read.
+int GoLog_ListFolders(const char *folder, char ***names);
+
+// Create folder (parent must exist). Returns 0 on success or if it already exists.
+int GoLog_MakeFolder(const char *path);
+
+// Read-only memory mapping of a complete file
+typedef struct
+{
+	const uint8_t *data;
+	uint64_t size;
+#if defined(_WIN32)
+	HANDLE file;
+	HANDLE mapping;
+#endif
+}GoLogMappedFile;
+
+// Map file into memory. Returns 0 on success.
+int GoLog_MapFile(GoLogMappedFile *map, const char *path);
+void GoLog_UnmapFile(GoLogMappedFile *map);
+
+// Start reading a file into the OS file cache in the background (posix_fadvise WILLNEED /
+// PrefetchVirtualMemory), so that a later GoLog_MapFile finds it in memory. Only a hint: returns
+// 0 if the read was started, -1 if the file cannot be opened or the OS has no such hint.
+int GoLog_ReadAhead(const char *path);
+
+// Allocate *size bytes of zeroed, page aligned memory directly from the OS, with all pages
+// touched (pre-faulted). With hugePages, large pages are tried first (*size is then rounded up
+// to the large page size) and *hugePages is cleared if they could not be used.
+// Returns NULL on failure. Free with GoLog_FreePages using the returned *size.
+void *GoLog_AllocPages(size_t *size, int *hugePages);
+void GoLog_FreePages(void *memory, size_t size);
+
+// File output without C runtime buffering - each write goes straight to the OS.
+// With direct set, the OS file cache is bypassed as well (O_DIRECT / FILE_FLAG_NO_BUFFERING);
+// buffer addresses, write sizes and file offsets must then be multiples of GOLOG_DIRECT_ALIGNMENT.
+#define GOLOG_DIRECT_ALIGNMENT		4096
+
+typedef struct
+{
+	int direct;							// Cleared if the file system does not support unbuffered output (normal file opened)
+#if defined(_WIN32)
+	HANDLE file;
+#else
+	int fd;
+#endif
+}GoLogFile;
+
+// One piece of a gathered write
+typedef struct
+{
+	const void *data;
+	size_t size;
+}GoLogIoVec;
+
+// Create or truncate file for writing. Returns 0 on success.
+int GoLog_CreateFile(GoLogFile *file, const char *path, int direct);
+
+// Write size bytes at the current position. Returns 0 on success.
+int GoLog_WriteFile(GoLogFile *file, const void *buffer, size_t size);
+
+// Write count pieces in order, with as few system calls as possible (writev on POSIX). Returns 0 on success.
+int GoLog_WriteFileVectors(GoLogFile *file, const GoLogIoVec *vectors, int count);
+
+// Returns 0 on success
+int GoLog_CloseFile(GoLogFile *file);
+
+// Atomics - loads have acquire semantics, stores have release semantics.
+// Only the operations needed by the logger are provided.
+#if defined(_MSC_VER)
+
+GOLOG_INLINE uint32_t GoLogAtomic_Load32(volatile uint32_t *p)
+{
+	return (uint32_t)_InterlockedOr((volatile long *)p, 0);
+}
+
+GOLOG_INLINE void GoLogAtomic_Store32(volatile uint32_t *p, uint32_t value)
+{
+	_InterlockedExchange((volatile long *)p, (long)value);
+}
+
+GOLOG_INLINE uint64_t GoLogAtomic_Load64(volatile uint64_t *p)
+{
+	return (uint64_t)_InterlockedOr64((volatile __int64 *)p, 0);
+}
+
+GOLOG_INLINE void GoLogAtomic_Store64(volatile uint64_t *p, uint64_t value)
+{
+	_InterlockedExchange64((volatile __int64 *)p, (__int64)value);
+}
+
+GOLOG_INLINE uint64_t GoLogAtomic_Add64(volatile uint64_t *p, uint64_t value)
+{
+	return (uint64_t)_InterlockedExchangeAdd64((volatile __int64 *)p, (__int64)value) + value;
+}
+
+// Set *p to desired if it is expected. Returns 1 if it was set.
+GOLOG_INLINE int GoLogAtomic_CompareExchange64(volatile uint64_t *p, uint64_t expected, uint64_t desired)
+{
+	return (uint64_t)_InterlockedCompareExchange64((volatile __int64 *)p, (__int64)desired, (__int64)expected) == expected;
+}
+
+#else
+
+GOLOG_INLINE uint32_t GoLogAtomic_Load32(volatile uint32_t *p)
+{
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+GOLOG_INLINE void GoLogAtomic_Store32(volatile uint32_t *p, uint32_t value)
+{
+	__atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+GOLOG_INLINE uint64_t GoLogAtomic_Load64(volatile uint64_t *p)
+{
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+GOLOG_INLINE void GoLogAtomic_Store64(volatile uint64_t *p, uint64_t value)
+{
+	__atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+GOLOG_INLINE uint64_t GoLogAtomic_Add64(volatile uint64_t *p, uint64_t value)
+{
+	return __atomic_add_fetch(p, value, __ATOMIC_ACQ_REL);
+}
+
+// Set *p to desired if it is expected. Returns 1 if it was set.
+GOLOG_INLINE int GoLogAtomic_CompareExchange64(volatile uint64_t *p, uint64_t expected, uint64_t desired)
+{
+	return __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+#endif
+
+#endif // GOLOG_PLATFORM_H
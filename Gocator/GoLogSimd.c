@@ -0,0 +1,99 @@
+/*
+* GoLogSimd.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: CPU feature detection for the SIMD surface kernels.
+*/
+
+#include "GoLogSimd.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if GOLOG_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static int simdDetected = 0;
+static GoLogSimdLevel simdCpuLevel = GOLOG_SIMD_SCALAR;
+static GoLogSimdLevel simdMaxLevel = GOLOG_SIMD_AVX2;
+static int simdCrc32c = 0;
+
+static GoLogSimdLevel GoLogSimd_Detect(void)
+{
+#if GOLOG_X86 && defined(_MSC_VER)
+	int info[4];
+	int level = GOLOG_SIMD_SSE2;
+
+	__cpuid(info, 1);
+	simdCrc32c = (info[2] >> 20) & 1;
+	__cpuid(info, 0);
+	if (info[0] >= 7)
+	{
+		int osxsave, avx;
+		__cpuid(info, 1);
+		osxsave = (info[2] >> 27) & 1;
+		avx = (info[2] >> 28) & 1;
+		__cpuidex(info, 7, 0);
+		// AVX2 also requires the OS to save YMM registers
+		if (osxsave && avx && ((info[1] >> 5) & 1) && (_xgetbv(0) & 6) == 6)
+		{
+			level = GOLOG_SIMD_AVX2;
+		}
+	}
+	return (GoLogSimdLevel)level;
+#elif GOLOG_X86
+	__builtin_cpu_init();
+	simdCrc32c = __builtin_cpu_supports("sse4.2");
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return GOLOG_SIMD_AVX2;
+	}
+	return __builtin_cpu_supports("sse2") ? GOLOG_SIMD_SSE2 : GOLOG_SIMD_SCALAR;
+#else
+	return GOLOG_SIMD_SCALAR;
+#endif
+}
+
+GoLogSimdLevel GoLogSimd_Level(void)
+{
+	if (!simdDetected)
+	{
+		const char *text = getenv("GOLOG_SIMD");
+
+		simdCpuLevel = GoLogSimd_Detect();
+		if (text != NULL)
+		{
+			if (strcmp(text, "scalar") == 0)
+			{
+				simdMaxLevel = GOLOG_SIMD_SCALAR;
+			}
+			else if (strcmp(text, "sse2") == 0 && simdMaxLevel > GOLOG_SIMD_SSE2)
+			{
+				simdMaxLevel = GOLOG_SIMD_SSE2;
+			}
+		}
+		simdDetected = 1;
+	}
+	return simdCpuLevel < simdMaxLevel ? simdCpuLevel : simdMaxLevel;
+}
+
+void GoLogSimd_SetMaxLevel(GoLogSimdLevel level)
+{
+	simdMaxLevel = level;
+}
+
+const char *GoLogSimd_Name(GoLogSimdLevel level)
+{
+	switch (level)
+	{
+		case GOLOG_SIMD_AVX2:	return "avx2";
+		case GOLOG_SIMD_SSE2:	return "sse2";
+		default:				return "scalar";
+	}
+}
+
+int GoLogSimd_HasCrc32c(void)
+{
+	return GoLogSimd_Level() > GOLOG_SIMD_SCALAR && simdCrc32c;
+}
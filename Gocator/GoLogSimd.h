@@ -0,0 +1,55 @@
+/*
+* GoLogSimd.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Runtime selection of SIMD code paths for the surface kernels.
+* Kernels are compiled for SSE2 and AVX2 on x86 (AVX2 functions are marked
+* with GOLOG_TARGET_AVX2 so that the rest of the program does not require
+* AVX2), and for plain C everywhere. GoLogSimd_Level returns the best level
+* supported by the CPU, optionally limited with GoLogSimd_SetMaxLevel or the
+* GOLOG_SIMD environment variable ("scalar", "sse2" or "avx2") - useful for
+* benchmarking and for checking the paths against each other.
+* The SSE4.2 CRC32 instruction is detected separately (GoLogSimd_HasCrc32c),
+* and is not used at the scalar level.
+*/
+
+#ifndef GOLOG_SIMD_H
+#define GOLOG_SIMD_H
+
+#include <stdint.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define GOLOG_X86				1
+#include <immintrin.h>
+#else
+#define GOLOG_X86				0
+#endif
+
+#if GOLOG_X86 && (defined(__GNUC__) || defined(__clang__))
+#define GOLOG_TARGET_AVX2		__attribute__((target("avx2")))
+#define GOLOG_TARGET_SSE42		__attribute__((target("sse4.2")))
+#else
+#define GOLOG_TARGET_AVX2
+#define GOLOG_TARGET_SSE42
+#endif
+
+typedef enum
+{
+	GOLOG_SIMD_SCALAR = 0,
+	GOLOG_SIMD_SSE2 = 1,
+	GOLOG_SIMD_AVX2 = 2
+}GoLogSimdLevel;
+
+// Best SIMD level supported by this CPU, limited by GoLogSimd_SetMaxLevel / GOLOG_SIMD
+GoLogSimdLevel GoLogSimd_Level(void);
+
+// Limit SIMD level used by kernels (call before the kernels are used)
+void GoLogSimd_SetMaxLevel(GoLogSimdLevel level);
+
+const char *GoLogSimd_Name(GoLogSimdLevel level);
+
+// Nonzero if the CPU has the SSE4.2 CRC32 instruction (CRC32C) and the SIMD level is not limited to scalar
+int GoLogSimd_HasCrc32c(void);
+
+#endif // GOLOG_SIMD_H
@@ -0,0 +1,197 @@
+/*
+* MeasurementLog.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Binary columnar measurement log (see MeasurementLog.h for the file format).
+*/
+
+#include "MeasurementLog.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MEASLOG_ENTRY_SIZE		(2 * sizeof(uint64_t) + 2 * sizeof(uint32_t) + sizeof(uint8_t))	// Bytes per entry, all columns
+
+static uint64_t MeasurementLog_BlockSize(uint32_t entryCount)
+{
+	uint64_t size = MEASLOGBLOCKHEADERSIZE + (uint64_t)entryCount * MEASLOG_ENTRY_SIZE;
+	return (size + 7) & ~(uint64_t)7;
+}
+
+int MeasurementLog_Open(MeasurementLog *log, const char *fileName)
+{
+	uint32_t blockCapacity = MEASLOGBLOCKCAPACITY;
+	uint32_t reserved[3] = { 0, 0, 0 };
+	int i;
+
+	memset(log, 0, sizeof(*log));
+	if (SpscQueue_Init(&log->fullBlocks, MEASLOGBLOCKS) != 0 || SpscQueue_Init(&log->freeBlocks, MEASLOGBLOCKS) != 0)
+	{
+		MeasurementLog_Close(log);
+		return -1;
+	}
+
+	// Columns of each block in one allocation, in file order (all 8-byte aligned for MEASLOGBLOCKCAPACITY entries)
+	for (i = 0; i < MEASLOGBLOCKS; i++)
+	{
+		MeasurementLogBuffer *buffer = &log->buffers[i];
+
+		if ((buffer->timeStamps = malloc(MEASLOGBLOCKCAPACITY * MEASLOG_ENTRY_SIZE)) == NULL)
+		{
+			MeasurementLog_Close(log);
+			return -1;
+		}
+		buffer->values = (double *)(buffer->timeStamps + MEASLOGBLOCKCAPACITY);
+		buffer->counts = (uint32_t *)(buffer->values + MEASLOGBLOCKCAPACITY);
+		buffer->ids = buffer->counts + MEASLOGBLOCKCAPACITY;
+		buffer->decisions = (uint8_t *)(buffer->ids + MEASLOGBLOCKCAPACITY);
+		if (i > 0)
+		{
+			SpscQueue_Push(&log->freeBlocks, buffer);
+		}
+	}
+	log->current = &log->buffers[0];
+
+	if ((log->fptr = fopen(fileName, "wb")) == NULL)
+	{
+		MeasurementLog_Close(log);
+		return -1;
+	}
+	fwrite(MEASLOGHEADERTEXT, 16, 1, log->fptr);
+	fwrite(&blockCapacity, sizeof(blockCapacity), 1, log->fptr);
+	if (fwrite(reserved, sizeof(reserved), 1, log->fptr) != 1)
+	{
+		MeasurementLog_Close(log);
+		return -1;
+	}
+	return 0;
+}
+
+void MeasurementLog_Add(MeasurementLog *log, uint32_t count, uint32_t id, double value, uint8_t decision, uint64_t timeStamp)
+{
+	MeasurementLogBuffer *buffer = log->current;
+	uint32_t i;
+
+	// All blocks were waiting to be written after the previous one was handed over
+	if (buffer == NULL && (buffer = log->current = SpscQueue_Pop(&log->freeBlocks)) == NULL)
+	{
+		log->dropped++;
+		return;
+	}
+
+	i = buffer->entryCount;
+	buffer->timeStamps[i] = timeStamp;
+	buffer->values[i] = value;
+	buffer->counts[i] = count;
+	buffer->ids[i] = id;
+	buffer->decisions[i] = decision;
+	if (++buffer->entryCount == MEASLOGBLOCKCAPACITY)
+	{
+		// The full queue has room for all blocks, so the push cannot fail
+		SpscQueue_Push(&log->fullBlocks, buffer);
+		log->current = SpscQueue_Pop(&log->freeBlocks);
+	}
+}
+
+// Write one block to file. Returns 0 on success.
+static int MeasurementLog_WriteBlock(MeasurementLog *log, MeasurementLogBuffer *buffer)
+{
+	uint32_t n = buffer->entryCount;
+	uint64_t reserved = 0;
+	uint64_t padding = 0;
+	size_t paddingSize;
+	size_t fwriteCount = 0;
+
+	if (n == 0)
+	{
+		return 0;
+	}
+	paddingSize = (size_t)(MeasurementLog_BlockSize(n) - MEASLOGBLOCKHEADERSIZE - (uint64_t)n * MEASLOG_ENTRY_SIZE);
+
+	fwriteCount += fwrite(MEASLOGBLOCKTAG, 4, 1, log->fptr);
+	fwriteCount += fwrite(&n, sizeof(n), 1, log->fptr);
+	fwriteCount += fwrite(&reserved, sizeof(reserved), 1, log->fptr);
+	fwriteCount += fwrite(buffer->timeStamps, sizeof(uint64_t) * n, 1, log->fptr);
+	fwriteCount += fwrite(buffer->values, sizeof(double) * n, 1, log->fptr);
+	fwriteCount += fwrite(buffer->counts, sizeof(uint32_t) * n, 1, log->fptr);
+	fwriteCount += fwrite(buffer->ids, sizeof(uint32_t) * n, 1, log->fptr);
+	fwriteCount += fwrite(buffer->decisions, sizeof(uint8_t) * n, 1, log->fptr);
+	if (paddingSize > 0)
+	{
+		fwriteCount += fwrite(&padding, paddingSize, 1, log->fptr);
+	}
+	buffer->entryCount = 0;
+
+	// Complete blocks reach the OS, so only the blocks not yet written are lost on a crash
+	if (fwriteCount != 8 + (paddingSize > 0) || fflush(log->fptr) != 0)
+	{
+		GoLogAtomic_Store64(&log->writeErrors, log->writeErrors + 1);
+		return -1;
+	}
+	GoLogAtomic_Store64(&log->written, log->written + n);
+	return 0;
+}
+
+int MeasurementLog_Write(MeasurementLog *log)
+{
+	MeasurementLogBuffer *buffer;
+	int result = 0;
+
+	while ((buffer = SpscQueue_Pop(&log->fullBlocks)) != NULL)
+	{
+		if (MeasurementLog_WriteBlock(log, buffer) != 0)
+		{
+			result = -1;
+		}
+		SpscQueue_Push(&log->freeBlocks, buffer);
+	}
+	return result;
+}
+
+void MeasurementLog_Close(MeasurementLog *log)
+{
+	int i;
+
+	if (log->fptr != NULL)
+	{
+		MeasurementLog_Write(log);
+		if (log->current != NULL)
+		{
+			MeasurementLog_WriteBlock(log, log->current);
+		}
+		fclose(log->fptr);
+		log->fptr = NULL;
+	}
+	for (i = 0; i < MEASLOGBLOCKS; i++)
+	{
+		free(log->buffers[i].timeStamps);
+		memset(&log->buffers[i], 0, sizeof(log->buffers[i]));
+	}
+	log->current = NULL;
+	SpscQueue_Destroy(&log->fullBlocks);
+	SpscQueue_Destroy(&log->freeBlocks);
+}
+
+uint64_t MeasurementLog_ParseBlock(const uint8_t *bytes, uint64_t size, MeasurementBlock *block)
+{
+	uint64_t blockSize;
+	uint32_t n;
+
+	if (size < MEASLOGBLOCKHEADERSIZE || memcmp(bytes, MEASLOGBLOCKTAG, 4) != 0)
+	{
+		return 0;
+	}
+	memcpy(&n, bytes + 4, sizeof(n));
+	if ((blockSize = MeasurementLog_BlockSize(n)) > size)
+	{
+		return 0;
+	}
+
+	block->entryCount = n;
+	block->timeStamps = (const uint64_t *)(bytes + MEASLOGBLOCKHEADERSIZE);
+	block->values = (const double *)(block->timeStamps + n);
+	block->counts = (const uint32_t *)(block->values + n);
+	block->ids = block->counts + n;
+	block->decisions = (const uint8_t *)(block->ids + n);
+	return blockSize;
+}
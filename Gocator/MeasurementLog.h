@@ -0,0 +1,108 @@
+/*
+* MeasurementLog.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Binary measurement log. Measurements from the data callback are
+* collected in memory, column by column, and written to file one block at a
+* time, instead of formatting every value as text on the receive thread.
+* Full blocks are handed to the writer thread (SurfaceWriter.h) through a
+* lock-free queue and written there, and written blocks come back through a
+* second queue to be filled again, so the data callback never waits for the
+* disk. If all MEASLOGBLOCKS blocks are waiting to be written, measurements
+* are dropped and counted until a block is free.
+* Tools/MeasurementToCsv converts a log to the semicolon separated text layout
+* written by earlier versions of the logger.
+*
+* Measurement log files have the following format:
+*
+* File header (32 bytes):
+* char[16]				headerText			"MHSKJELV MEA0001"
+* uint32				blockCapacity		Largest number of entries in a block
+* uint32				reserved
+* uint64				reserved
+*
+* Blocks (until end of file):
+* char[4]				blockTag			"MBLK"
+* uint32				entryCount
+* uint64				reserved
+* uint64				timeStamp[entryCount]		Sensor time stamp of the frame
+* float64				value[entryCount]			Measurement value
+* uint32				count[entryCount]			Number of the last surface received before the measurement
+* uint32				id[entryCount]				Measurement ID
+* uint8					decision[entryCount]		Measurement decision
+* uint8					padding						Zeros up to the next multiple of 8 bytes
+*
+* Blocks start on 8-byte boundaries within the file, so the timeStamp, value
+* and count columns are 8-byte aligned and the id column 4-byte aligned (the
+* columns can be read in place from a mapped file). A block is written when it
+* is full and when the log is closed, so at most one block is lost if the
+* logger is not stopped properly.
+*/
+
+#ifndef MEASUREMENT_LOG_H
+#define MEASUREMENT_LOG_H
+
+#include "SpscQueue.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#define MEASLOGFILENAMESUFFIX	"GocatorMeasurement.bin"
+#define MEASLOGHEADERTEXT		"MHSKJELV MEA0001"
+#define MEASLOGHEADERSIZE		32
+#define MEASLOGBLOCKTAG			"MBLK"
+#define MEASLOGBLOCKHEADERSIZE	16
+#define MEASLOGBLOCKCAPACITY	4096		// Entries per block
+#define MEASLOGBLOCKS			8			// Blocks in memory: one being filled, the others queued or free
+
+// Columns of one block in memory
+typedef struct
+{
+	uint32_t entryCount;
+	uint64_t *timeStamps;
+	double *values;
+	uint32_t *counts;
+	uint32_t *ids;
+	uint8_t *decisions;
+}MeasurementLogBuffer;
+
+typedef struct
+{
+	FILE *fptr;							// Only used by the writer thread
+	MeasurementLogBuffer buffers[MEASLOGBLOCKS];
+	MeasurementLogBuffer *current;		// Block being filled by the data callback (NULL = none free)
+	SpscQueue fullBlocks;				// Full blocks, data callback -> writer thread
+	SpscQueue freeBlocks;				// Written blocks, writer thread -> data callback
+	uint64_t dropped;					// Entries dropped because no block was free, by the data callback
+	volatile uint64_t written;			// Entries written to file, by the writer thread
+	volatile uint64_t writeErrors;		// Blocks that could not be written, by the writer thread
+}MeasurementLog;
+
+// One block of a log file, with columns pointing into the file data
+typedef struct
+{
+	uint32_t entryCount;
+	const uint64_t *timeStamps;
+	const double *values;
+	const uint32_t *counts;
+	const uint32_t *ids;
+	const uint8_t *decisions;
+}MeasurementBlock;
+
+// Create log file. Returns 0 on success.
+int MeasurementLog_Open(MeasurementLog *log, const char *fileName);
+
+// Producer: add one measurement; hands the current block to the writer thread when it is full
+void MeasurementLog_Add(MeasurementLog *log, uint32_t count, uint32_t id, double value, uint8_t decision, uint64_t timeStamp);
+
+// Consumer (writer thread): write the full blocks handed over so far. Returns 0 on success.
+int MeasurementLog_Write(MeasurementLog *log);
+
+// Write the remaining blocks, including the one being filled, and close file. Call after the writer thread has stopped.
+void MeasurementLog_Close(MeasurementLog *log);
+
+// Size of block starting at bytes (8-byte aligned), with size bytes available. Fills block.
+// Returns 0 if the bytes do not contain a complete block.
+uint64_t MeasurementLog_ParseBlock(const uint8_t *bytes, uint64_t size, MeasurementBlock *block);
+
+#endif // MEASUREMENT_LOG_H
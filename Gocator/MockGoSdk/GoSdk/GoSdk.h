@@ -0,0 +1,181 @@
+/*
+* GoSdk.h (mock)
+*
+* Licensed under The MIT License.
+*
+* Purpose: Stand-in for the subset of the LMI GoSdk API used by the Gocator logger,
+* so that the logger can be built, tested and benchmarked without a sensor
+* (and without the SDK, e.g. on Linux). Add the MockGoSdk folder to the include
+* path instead of the real SDK and link with MockGoSdk.c.
+*
+* GoSystem_Start starts a synthetic sensor thread that calls the registered
+* data handler at a fixed frame rate with a stamp message, a surface message and
+* a number of measurement messages per frame, for every sensor that has been
+* looked up with GoSystem_FindSensorByIpAddress. The synthetic sensor is
+* configured with environment variables:
+*
+*	GOMOCK_FRAME_RATE		Frames per second (default 10)
+*	GOMOCK_WIDTH			Surface width in points (default 1280)
+*	GOMOCK_LENGTH			Surface length in rows (default 1000)
+*	GOMOCK_MEASUREMENTS		Measurement messages per frame (default 2)
+*	GOMOCK_BUFFER			Frames the "SDK" buffers while the handler is busy
+*							before it starts dropping frames (default 8)
+*	GOMOCK_CLOCK_PPM		Sensor clock error in parts per million: time stamps run this much
+*							faster than the host clock (default 0)
+*
+* Like the real sensor, frames that cannot be delivered in time are lost; the
+* frame index in the stamp message skips accordingly. Number of frames
+* generated and lost is printed when the system is stopped.
+*
+* Only the functions used by the logger are provided, with the same names and
+* signatures as in GoSdk. Values use the same units as GoSdk (resolutions in nm,
+* offsets in um, timestamps in us).
+*/
+
+#ifndef GO_SDK_MOCK_H
+#define GO_SDK_MOCK_H
+
+#include <stddef.h>
+
+// kApi basic types
+typedef signed char			k8s;
+typedef unsigned char		k8u;
+typedef short				k16s;
+typedef unsigned short		k16u;
+typedef int					k32s;
+typedef unsigned int		k32u;
+typedef long long			k64s;
+typedef unsigned long long	k64u;
+typedef float				k32f;
+typedef double				k64f;
+typedef k32s				kBool;
+typedef k32s				kStatus;
+typedef unsigned char		kByte;
+typedef void *				kPointer;
+typedef void *				kObject;
+typedef kObject				kAssembly;
+typedef kObject				kAlloc;
+
+#define kNULL				(0)
+#define kTRUE				(1)
+#define kFALSE				(0)
+
+#define kOK					(1)
+#define kERROR				(0)
+#define kERROR_NOT_FOUND	(-1)
+#define kERROR_STATE		(-2)
+#define kERROR_PARAMETER	(-5)
+#define kERROR_MEMORY		(-6)
+
+#if defined(_WIN32)
+#define kCall				__stdcall
+#else
+#define kCall
+#endif
+
+typedef k32s kIpVersion;
+#define kIP_VERSION_4		(4)
+
+typedef struct kIpAddress
+{
+	kIpVersion version;
+	kByte address[16];
+}kIpAddress;
+
+kStatus kIpAddress_Parse(kIpAddress *address, const char *text);
+
+// GoSdk handle types
+typedef kObject GoSystem;
+typedef kObject GoSensor;
+typedef kObject GoSetup;
+typedef kObject GoDataSet;
+typedef kObject GoDataMsg;
+typedef kObject GoStampMsg;
+typedef kObject GoSurfaceMsg;
+typedef kObject GoMeasurementMsg;
+
+typedef k32s GoRole;
+#define GO_ROLE_MAIN		(0)
+#define GO_ROLE_BUDDY		(1)
+
+typedef k32s GoMode;
+#define GO_MODE_UNKNOWN		(-1)
+#define GO_MODE_VIDEO		(0)
+#define GO_MODE_RANGE		(1)
+#define GO_MODE_PROFILE		(2)
+#define GO_MODE_SURFACE		(3)
+
+typedef k32s GoDataMessageType;
+#define GO_DATA_MESSAGE_TYPE_UNKNOWN		(-1)
+#define GO_DATA_MESSAGE_TYPE_STAMP			(0)
+#define GO_DATA_MESSAGE_TYPE_SURFACE		(8)
+#define GO_DATA_MESSAGE_TYPE_MEASUREMENT	(10)
+
+typedef struct GoStamp
+{
+	k64u frameIndex;			// Frame index (counts from zero)
+	k64u timestamp;				// Timestamp in microseconds
+	k64s encoder;				// Current encoder value (ticks)
+	k64s encoderAtZ;			// Encoder value latched at z/index mark (ticks)
+	k64u status;				// Bit field containing various frame information
+	k32u id;					// Sensor serial number
+	k32u reserved[2];
+}GoStamp;
+
+typedef struct GoMeasurementData
+{
+	k64f value;					// Measurement value
+	k8u decision;				// Measurement decision
+	k8u decisionCode;			// Measurement decision code
+}GoMeasurementData;
+
+typedef kStatus (kCall *GoDataFx)(kPointer context, GoSystem system, GoDataSet data);
+
+// Library
+kStatus GoSdk_Construct(kAssembly *assembly);
+kStatus GoDestroy(kObject object);
+
+// System
+kStatus GoSystem_Construct(GoSystem *system, kAlloc allocator);
+kStatus GoSystem_FindSensorByIpAddress(GoSystem system, const kIpAddress *address, GoSensor *sensor);
+kStatus GoSystem_Connect(GoSystem system);
+kStatus GoSystem_Disconnect(GoSystem system);
+kStatus GoSystem_EnableData(GoSystem system, kBool enable);
+kStatus GoSystem_SetDataHandler(GoSystem system, GoDataFx function, kPointer receiver);
+kStatus GoSystem_Start(GoSystem system);
+kStatus GoSystem_Stop(GoSystem system);
+
+// Sensor and setup
+k32u GoSensor_Id(GoSensor sensor);
+GoSetup GoSensor_Setup(GoSensor sensor);
+GoRole GoSensor_Role(GoSensor sensor);
+kStatus GoSensor_Flush(GoSensor sensor);
+k64f GoSetup_FrameRate(GoSetup setup);
+k64f GoSetup_Exposure(GoSetup setup, GoRole role);
+GoMode GoSetup_ScanMode(GoSetup setup);
+kStatus GoSetup_SetScanMode(GoSetup setup, GoMode mode);
+
+// Data sets and messages
+k32u GoDataSet_SenderId(GoDataSet dataSet);
+k32u GoDataSet_Count(GoDataSet dataSet);
+GoDataMsg GoDataSet_At(GoDataSet dataSet, k32u index);
+GoDataMessageType GoDataMsg_Type(GoDataMsg message);
+
+k32u GoStampMsg_Count(GoStampMsg message);
+GoStamp *GoStampMsg_At(GoStampMsg message, k32u index);
+
+k32u GoSurfaceMsg_Width(GoSurfaceMsg message);
+k32u GoSurfaceMsg_Length(GoSurfaceMsg message);
+k32u GoSurfaceMsg_XResolution(GoSurfaceMsg message);
+k32u GoSurfaceMsg_YResolution(GoSurfaceMsg message);
+k32u GoSurfaceMsg_ZResolution(GoSurfaceMsg message);
+k32s GoSurfaceMsg_XOffset(GoSurfaceMsg message);
+k32s GoSurfaceMsg_YOffset(GoSurfaceMsg message);
+k32s GoSurfaceMsg_ZOffset(GoSurfaceMsg message);
+k16s *GoSurfaceMsg_RowAt(GoSurfaceMsg message, k32u rowIndex);
+
+k32u GoMeasurementMsg_Id(GoMeasurementMsg message);
+k32u GoMeasurementMsg_Count(GoMeasurementMsg message);
+GoMeasurementData *GoMeasurementMsg_At(GoMeasurementMsg message, k32u index);
+
+#endif // GO_SDK_MOCK_H
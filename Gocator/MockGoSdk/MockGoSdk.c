@@ -0,0 +1,557 @@
+/*
+* MockGoSdk.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Mock implementation of the GoSdk subset used by the Gocator logger,
+* with a synthetic sensor thread (see GoSdk/GoSdk.h).
+*
+* The synthetic surface (SyntheticSurface.h) is read from a strip that is
+* slightly longer than one surface.
+* Each frame starts a few rows further down the strip, so consecutive surfaces
+* look like an object moving on a conveyor without any per-frame generation cost.
+*/
+
+#include "GoSdk/GoSdk.h"
+#include "../GoLogPlatform.h"
+#include "../SyntheticSurface.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MOCK_MAX_SENSORS		16
+#define MOCK_MAX_MEASUREMENTS	16
+#define MOCK_STRIP_EXTRA_ROWS	256		// Extra rows in synthetic strip
+#define MOCK_STRIP_STEP			7		// Rows the strip moves per frame
+
+#define MOCK_X_RESOLUTION_NM	100000
+#define MOCK_Y_RESOLUTION_NM	100000
+#define MOCK_Z_RESOLUTION_NM	2000
+#define MOCK_X_OFFSET_UM		(-64000)
+#define MOCK_Y_OFFSET_UM		0
+#define MOCK_Z_OFFSET_UM		10000
+#define MOCK_EXPOSURE_US		500.0
+
+typedef enum
+{
+	MOCK_ASSEMBLY,
+	MOCK_SYSTEM,
+	MOCK_SENSOR,
+	MOCK_DATASET,
+	MOCK_STAMP_MSG,
+	MOCK_SURFACE_MSG,
+	MOCK_MEASUREMENT_MSG
+}MockType;
+
+typedef struct
+{
+	MockType type;
+}MockObject;
+
+struct MockSystem;
+
+typedef struct
+{
+	MockObject base;
+	struct MockSystem *system;
+	kIpAddress address;
+	k32u id;
+	GoMode scanMode;
+}MockSensor;
+
+typedef struct MockSystem
+{
+	MockObject base;
+	MockSensor sensors[MOCK_MAX_SENSORS];
+	k32u sensorCount;
+	kBool connected;
+	kBool dataEnabled;
+	GoDataFx handler;
+	kPointer receiver;
+
+	// Synthetic sensor configuration
+	k64f frameRate;
+	k32u width;
+	k32u length;
+	k32u measurementCount;
+	k32u bufferFrames;
+	k64f clockPpm;
+
+	// Synthetic sensor state
+	k16s *strip;						// width * (length + MOCK_STRIP_EXTRA_ROWS) samples
+	GoLogThread thread;
+	volatile uint32_t running;
+	k64u framesGenerated;
+	k64u framesLost;
+}MockSystem;
+
+typedef struct
+{
+	MockObject base;
+	GoStamp stamp;
+}MockStampMsg;
+
+typedef struct
+{
+	MockObject base;
+	k32u width;
+	k32u length;
+	const k16s *rows;
+}MockSurfaceMsg;
+
+typedef struct
+{
+	MockObject base;
+	k32u id;
+	GoMeasurementData data;
+}MockMeasurementMsg;
+
+typedef struct
+{
+	MockObject base;
+	k32u senderId;
+	k32u count;
+	MockObject *items[2 + MOCK_MAX_MEASUREMENTS];
+	MockStampMsg stamp;
+	MockSurfaceMsg surface;
+	MockMeasurementMsg measurements[MOCK_MAX_MEASUREMENTS];
+}MockDataSet;
+
+static k64f MockEnv(const char *name, k64f defaultValue)
+{
+	const char *text = getenv(name);
+	return (text != NULL && *text != '\0') ? atof(text) : defaultValue;
+}
+
+static void MockSystem_Emit(MockSystem *system, MockSensor *sensor, k64u frameIndex)
+{
+	MockDataSet *dataSet = calloc(1, sizeof(MockDataSet));
+	k32u startRow = (k32u)((frameIndex * MOCK_STRIP_STEP) % MOCK_STRIP_EXTRA_ROWS);
+	k32u i;
+
+	if (dataSet == NULL)
+	{
+		return;
+	}
+	dataSet->base.type = MOCK_DATASET;
+	dataSet->senderId = sensor->id;
+
+	dataSet->stamp.base.type = MOCK_STAMP_MSG;
+	dataSet->stamp.stamp.frameIndex = frameIndex;
+	dataSet->stamp.stamp.timestamp = (k64u)((k64f)frameIndex * 1000000.0 / system->frameRate * (1.0 + system->clockPpm * 1.0e-6));
+	dataSet->stamp.stamp.id = sensor->id;
+	dataSet->items[dataSet->count++] = &dataSet->stamp.base;
+
+	dataSet->surface.base.type = MOCK_SURFACE_MSG;
+	dataSet->surface.width = system->width;
+	dataSet->surface.length = system->length;
+	dataSet->surface.rows = system->strip + (size_t)startRow * system->width;
+	dataSet->items[dataSet->count++] = &dataSet->surface.base;
+
+	for (i = 0; i < system->measurementCount; i++)
+	{
+		MockMeasurementMsg *measurement = &dataSet->measurements[i];
+		measurement->base.type = MOCK_MEASUREMENT_MSG;
+		measurement->id = i + 1;
+		measurement->data.value = 10.0 * (i + 1) + (k64f)(frameIndex % 100) / 100.0;
+		measurement->data.decision = 1;
+		dataSet->items[dataSet->count++] = &measurement->base;
+	}
+
+	// Handler takes ownership of the data set
+	system->handler(system->receiver, system, dataSet);
+}
+
+// Synthetic sensor thread - emit frames on a fixed schedule, lose frames when the handler is too slow
+static void MockSystem_Thread(void *arg)
+{
+	MockSystem *system = arg;
+	k64f periodNs = 1.0e9 / system->frameRate;
+	k64u startNs = GoLog_MonotonicNs();
+	k64u frameIndex = 0;
+	k32u i;
+
+	while (GoLogAtomic_Load32(&system->running))
+	{
+		k64u deadlineNs = startNs + (k64u)(frameIndex * periodNs);
+		k64u nowNs = GoLog_MonotonicNs();
+		k64u overdue;
+
+		if (nowNs < deadlineNs)
+		{
+			k64u waitUs = (deadlineNs - nowNs) / 1000;
+			GoLog_SleepUs(waitUs > 10000 ? 10000 : (uint32_t)waitUs);
+			continue;
+		}
+
+		// Frames overdue by more than the SDK buffer are lost
+		overdue = (k64u)((nowNs - deadlineNs) / periodNs);
+		if (overdue > system->bufferFrames)
+		{
+			k64u lost = overdue - system->bufferFrames;
+			frameIndex += lost;
+			system->framesLost += lost * system->sensorCount;
+		}
+
+		for (i = 0; i < system->sensorCount; i++)
+		{
+			MockSystem_Emit(system, &system->sensors[i], frameIndex);
+			system->framesGenerated++;
+		}
+		frameIndex++;
+	}
+}
+
+kStatus kIpAddress_Parse(kIpAddress *address, const char *text)
+{
+	unsigned int a, b, c, d;
+
+	memset(address, 0, sizeof(*address));
+	if (sscanf(text, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255)
+	{
+		return kERROR_PARAMETER;
+	}
+	address->version = kIP_VERSION_4;
+	address->address[0] = (kByte)a;
+	address->address[1] = (kByte)b;
+	address->address[2] = (kByte)c;
+	address->address[3] = (kByte)d;
+	return kOK;
+}
+
+kStatus GoSdk_Construct(kAssembly *assembly)
+{
+	MockObject *object = calloc(1, sizeof(MockObject));
+	if (object == NULL)
+	{
+		return kERROR_MEMORY;
+	}
+	object->type = MOCK_ASSEMBLY;
+	*assembly = object;
+	return kOK;
+}
+
+kStatus GoDestroy(kObject object)
+{
+	MockObject *mock = object;
+
+	if (mock == kNULL)
+	{
+		return kOK;
+	}
+
+	switch (mock->type)
+	{
+		case MOCK_SYSTEM:
+		{
+			MockSystem *system = object;
+			if (system->running)
+			{
+				GoSystem_Stop(system);
+			}
+			free(system->strip);
+			free(system);
+		}
+		break;
+
+		case MOCK_ASSEMBLY:
+		case MOCK_DATASET:
+			free(object);
+			break;
+
+		default:		// Sensors and messages are owned by their system / data set
+			break;
+	}
+	return kOK;
+}
+
+kStatus GoSystem_Construct(GoSystem *system, kAlloc allocator)
+{
+	MockSystem *mock = calloc(1, sizeof(MockSystem));
+	(void)allocator;
+
+	if (mock == NULL)
+	{
+		return kERROR_MEMORY;
+	}
+	mock->base.type = MOCK_SYSTEM;
+	mock->frameRate = MockEnv("GOMOCK_FRAME_RATE", 10.0);
+	mock->width = (k32u)MockEnv("GOMOCK_WIDTH", 1280);
+	mock->length = (k32u)MockEnv("GOMOCK_LENGTH", 1000);
+	mock->measurementCount = (k32u)MockEnv("GOMOCK_MEASUREMENTS", 2);
+	mock->bufferFrames = (k32u)MockEnv("GOMOCK_BUFFER", 8);
+	mock->clockPpm = MockEnv("GOMOCK_CLOCK_PPM", 0.0);
+
+	if (mock->frameRate <= 0.0 || mock->width == 0 || mock->length == 0)
+	{
+		free(mock);
+		return kERROR_PARAMETER;
+	}
+	if (mock->measurementCount > MOCK_MAX_MEASUREMENTS)
+	{
+		mock->measurementCount = MOCK_MAX_MEASUREMENTS;
+	}
+
+	*system = mock;
+	return kOK;
+}
+
+kStatus GoSystem_FindSensorByIpAddress(GoSystem system, const kIpAddress *address, GoSensor *sensor)
+{
+	MockSystem *mock = system;
+	MockSensor *found;
+	k32u i;
+
+	for (i = 0; i < mock->sensorCount; i++)
+	{
+		if (memcmp(&mock->sensors[i].address, address, sizeof(kIpAddress)) == 0)
+		{
+			*sensor = &mock->sensors[i];
+			return kOK;
+		}
+	}
+
+	if (address->version != kIP_VERSION_4 || mock->sensorCount == MOCK_MAX_SENSORS)
+	{
+		return kERROR_NOT_FOUND;
+	}
+
+	// Every valid address has a sensor - serial number is derived from the address
+	found = &mock->sensors[mock->sensorCount++];
+	found->base.type = MOCK_SENSOR;
+	found->system = mock;
+	found->address = *address;
+	found->id = 10000 + 256 * address->address[2] + address->address[3];
+	found->scanMode = GO_MODE_PROFILE;
+	*sensor = found;
+	return kOK;
+}
+
+kStatus GoSystem_Connect(GoSystem system)
+{
+	((MockSystem *)system)->connected = kTRUE;
+	return kOK;
+}
+
+kStatus GoSystem_Disconnect(GoSystem system)
+{
+	((MockSystem *)system)->connected = kFALSE;
+	return kOK;
+}
+
+kStatus GoSystem_EnableData(GoSystem system, kBool enable)
+{
+	MockSystem *mock = system;
+	if (!mock->connected)
+	{
+		return kERROR_STATE;
+	}
+	mock->dataEnabled = enable;
+	return kOK;
+}
+
+kStatus GoSystem_SetDataHandler(GoSystem system, GoDataFx function, kPointer receiver)
+{
+	MockSystem *mock = system;
+	mock->handler = function;
+	mock->receiver = receiver;
+	return kOK;
+}
+
+kStatus GoSystem_Start(GoSystem system)
+{
+	MockSystem *mock = system;
+
+	if (!mock->connected || !mock->dataEnabled || mock->handler == NULL || mock->running)
+	{
+		return kERROR_STATE;
+	}
+
+	if (mock->strip == NULL)
+	{
+		if ((mock->strip = malloc((size_t)mock->width * (mock->length + MOCK_STRIP_EXTRA_ROWS) * sizeof(k16s))) == NULL)
+		{
+			return kERROR_MEMORY;
+		}
+		SyntheticSurface_Fill(mock->strip, mock->width, mock->length + MOCK_STRIP_EXTRA_ROWS, 0);
+	}
+
+	mock->framesGenerated = 0;
+	mock->framesLost = 0;
+	mock->running = 1;
+	if (GoLogThread_Start(&mock->thread, MockSystem_Thread, mock) != 0)
+	{
+		mock->running = 0;
+		return kERROR;
+	}
+	return kOK;
+}
+
+kStatus GoSystem_Stop(GoSystem system)
+{
+	MockSystem *mock = system;
+
+	if (!mock->running)
+	{
+		return kOK;
+	}
+	GoLogAtomic_Store32(&mock->running, 0);
+	GoLogThread_Join(mock->thread);
+
+	printf("Mock sensor: %llu frames generated, %llu frames lost (%.1f Hz, %u x %u)\n",
+		mock->framesGenerated, mock->framesLost, mock->frameRate, mock->width, mock->length);
+	return kOK;
+}
+
+k32u GoSensor_Id(GoSensor sensor)
+{
+	return ((MockSensor *)sensor)->id;
+}
+
+GoSetup GoSensor_Setup(GoSensor sensor)
+{
+	return sensor;		// Setup is stored in the sensor object
+}
+
+GoRole GoSensor_Role(GoSensor sensor)
+{
+	(void)sensor;
+	return GO_ROLE_MAIN;
+}
+
+kStatus GoSensor_Flush(GoSensor sensor)
+{
+	(void)sensor;
+	return kOK;
+}
+
+k64f GoSetup_FrameRate(GoSetup setup)
+{
+	return ((MockSensor *)setup)->system->frameRate;
+}
+
+k64f GoSetup_Exposure(GoSetup setup, GoRole role)
+{
+	(void)setup;
+	(void)role;
+	return MOCK_EXPOSURE_US;
+}
+
+GoMode GoSetup_ScanMode(GoSetup setup)
+{
+	return ((MockSensor *)setup)->scanMode;
+}
+
+kStatus GoSetup_SetScanMode(GoSetup setup, GoMode mode)
+{
+	((MockSensor *)setup)->scanMode = mode;
+	return kOK;
+}
+
+k32u GoDataSet_SenderId(GoDataSet dataSet)
+{
+	return ((MockDataSet *)dataSet)->senderId;
+}
+
+k32u GoDataSet_Count(GoDataSet dataSet)
+{
+	return ((MockDataSet *)dataSet)->count;
+}
+
+GoDataMsg GoDataSet_At(GoDataSet dataSet, k32u index)
+{
+	MockDataSet *mock = dataSet;
+	return (index < mock->count) ? mock->items[index] : kNULL;
+}
+
+GoDataMessageType GoDataMsg_Type(GoDataMsg message)
+{
+	switch (((MockObject *)message)->type)
+	{
+		case MOCK_STAMP_MSG:		return GO_DATA_MESSAGE_TYPE_STAMP;
+		case MOCK_SURFACE_MSG:		return GO_DATA_MESSAGE_TYPE_SURFACE;
+		case MOCK_MEASUREMENT_MSG:	return GO_DATA_MESSAGE_TYPE_MEASUREMENT;
+		default:					return GO_DATA_MESSAGE_TYPE_UNKNOWN;
+	}
+}
+
+k32u GoStampMsg_Count(GoStampMsg message)
+{
+	(void)message;
+	return 1;
+}
+
+GoStamp *GoStampMsg_At(GoStampMsg message, k32u index)
+{
+	(void)index;
+	return &((MockStampMsg *)message)->stamp;
+}
+
+k32u GoSurfaceMsg_Width(GoSurfaceMsg message)
+{
+	return ((MockSurfaceMsg *)message)->width;
+}
+
+k32u GoSurfaceMsg_Length(GoSurfaceMsg message)
+{
+	return ((MockSurfaceMsg *)message)->length;
+}
+
+k32u GoSurfaceMsg_XResolution(GoSurfaceMsg message)
+{
+	(void)message;
+	return MOCK_X_RESOLUTION_NM;
+}
+
+k32u GoSurfaceMsg_YResolution(GoSurfaceMsg message)
+{
+	(void)message;
+	return MOCK_Y_RESOLUTION_NM;
+}
+
+k32u GoSurfaceMsg_ZResolution(GoSurfaceMsg message)
+{
+	(void)message;
+	return MOCK_Z_RESOLUTION_NM;
+}
+
+k32s GoSurfaceMsg_XOffset(GoSurfaceMsg message)
+{
+	(void)message;
+	return MOCK_X_OFFSET_UM;
+}
+
+k32s GoSurfaceMsg_YOffset(GoSurfaceMsg message)
+{
+	(void)message;
+	return MOCK_Y_OFFSET_UM;
+}
+
+k32s GoSurfaceMsg_ZOffset(GoSurfaceMsg message)
+{
+	(void)message;
+	return MOCK_Z_OFFSET_UM;
+}
+
+k16s *GoSurfaceMsg_RowAt(GoSurfaceMsg message, k32u rowIndex)
+{
+	MockSurfaceMsg *mock = message;
+	return (k16s *)mock->rows + (size_t)rowIndex * mock->width;
+}
+
+k32u GoMeasurementMsg_Id(GoMeasurementMsg message)
+{
+	return ((MockMeasurementMsg *)message)->id;
+}
+
+k32u GoMeasurementMsg_Count(GoMeasurementMsg message)
+{
+	(void)message;
+	return 1;
+}
+
+GoMeasurementData *GoMeasurementMsg_At(GoMeasurementMsg message, k32u index)
+{
+	(void)index;
+	return &((MockMeasurementMsg *)message)->data;
+}
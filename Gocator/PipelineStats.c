@@ -0,0 +1,155 @@
+/*
+* PipelineStats.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Latency histograms of the capture pipeline (see PipelineStats.h).
+* Values below HISTOGRAM_SUBBUCKETS are counted exactly. Larger values with
+* highest set bit e are counted in bucket (e - 3) * 16 + (next 4 bits).
+*/
+
+#include "PipelineStats.h"
+
+static const char *stageNames[PIPELINE_STAGE_COUNT] =
+{
+	"callback",
+	"copy",
+	"queue",
+	"crop",
+	"pyramid",
+	"encode",
+	"checksum",
+	"write",
+	"total",
+};
+
+// Index of highest set bit (value > 0)
+static int LatencyHistogram_HighestBit(uint64_t value)
+{
+	int bit = 0;
+	int step;
+
+	for (step = 32; step > 0; step >>= 1)
+	{
+		if (value >> step)
+		{
+			value >>= step;
+			bit += step;
+		}
+	}
+	return bit;
+}
+
+static uint32_t LatencyHistogram_Index(uint64_t ns)
+{
+	int bit;
+
+	if (ns < HISTOGRAM_SUBBUCKETS)
+	{
+		return (uint32_t)ns;
+	}
+	bit = LatencyHistogram_HighestBit(ns);
+	return (uint32_t)(bit - HISTOGRAM_SUBBUCKET_BITS + 1) * HISTOGRAM_SUBBUCKETS +
+		(uint32_t)((ns >> (bit - HISTOGRAM_SUBBUCKET_BITS)) & (HISTOGRAM_SUBBUCKETS - 1));
+}
+
+// Largest value counted in bucket index
+static uint64_t LatencyHistogram_UpperEdge(uint32_t index)
+{
+	int shift;
+
+	if (index < HISTOGRAM_SUBBUCKETS)
+	{
+		return index;
+	}
+	shift = (int)(index / HISTOGRAM_SUBBUCKETS) - 1;
+	return ((uint64_t)(HISTOGRAM_SUBBUCKETS + index % HISTOGRAM_SUBBUCKETS + 1) << shift) - 1;
+}
+
+void LatencyHistogram_Record(LatencyHistogram *histogram, uint64_t ns)
+{
+	// Single writer - plain read-modify-write, published with a release store
+	uint32_t index = LatencyHistogram_Index(ns);
+	GoLogAtomic_Store64(&histogram->buckets[index], histogram->buckets[index] + 1);
+	GoLogAtomic_Store64(&histogram->sumNs, histogram->sumNs + ns);
+	if (ns > histogram->maxNs)
+	{
+		GoLogAtomic_Store64(&histogram->maxNs, ns);
+	}
+	GoLogAtomic_Store64(&histogram->count, histogram->count + 1);
+}
+
+uint64_t LatencyHistogram_Percentile(const LatencyHistogram *histogram, double fraction)
+{
+	uint64_t total = 0;
+	uint64_t target;
+	uint64_t seen = 0;
+	uint32_t index;
+
+	for (index = 0; index < HISTOGRAM_BUCKETS; index++)
+	{
+		total += histogram->buckets[index];
+	}
+	if (total == 0)
+	{
+		return 0;
+	}
+
+	target = (uint64_t)(fraction * (double)total + 0.5);
+	if (target < 1)
+	{
+		target = 1;
+	}
+	for (index = 0; index < HISTOGRAM_BUCKETS; index++)
+	{
+		seen += histogram->buckets[index];
+		if (seen >= target)
+		{
+			uint64_t edge = LatencyHistogram_UpperEdge(index);
+			return (histogram->maxNs > 0 && edge > histogram->maxNs) ? histogram->maxNs : edge;
+		}
+	}
+	return histogram->maxNs;
+}
+
+void LatencyHistogram_Subtract(LatencyHistogram *difference, const LatencyHistogram *current, const LatencyHistogram *previous)
+{
+	uint32_t index;
+
+	for (index = 0; index < HISTOGRAM_BUCKETS; index++)
+	{
+		difference->buckets[index] = current->buckets[index] - previous->buckets[index];
+	}
+	difference->count = current->count - previous->count;
+	difference->sumNs = current->sumNs - previous->sumNs;
+	difference->maxNs = 0;				// Not known for an interval - percentiles use bucket edges
+}
+
+const char *PipelineStats_StageName(PipelineStage stage)
+{
+	return (stage < PIPELINE_STAGE_COUNT) ? stageNames[stage] : "?";
+}
+
+void PipelineStats_Print(FILE *fptr, const PipelineStats *stats)
+{
+	int stage;
+
+	fprintf(fptr, "%-10s %10s %10s %10s %10s %10s %10s %10s\n", "stage [us]", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+	for (stage = 0; stage < PIPELINE_STAGE_COUNT; stage++)
+	{
+		const LatencyHistogram *histogram = &stats->stages[stage];
+		uint64_t count = histogram->count;
+
+		if (count == 0)
+		{
+			continue;
+		}
+		fprintf(fptr, "%-10s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", stageNames[stage],
+			(unsigned long long)count, histogram->sumNs / 1000.0 / count,
+			LatencyHistogram_Percentile(histogram, 0.5) / 1000.0,
+			LatencyHistogram_Percentile(histogram, 0.9) / 1000.0,
+			LatencyHistogram_Percentile(histogram, 0.99) / 1000.0,
+			LatencyHistogram_Percentile(histogram, 0.999) / 1000.0,
+			(histogram->maxNs > 0 ? histogram->maxNs : LatencyHistogram_Percentile(histogram, 1.0)) / 1000.0);
+	}
+}
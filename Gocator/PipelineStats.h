@@ -0,0 +1,77 @@
+/*
+* PipelineStats.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Lightweight latency instrumentation of the capture pipeline.
+*
+* Each stage has a log-linear (HDR style) histogram of latencies in
+* nanoseconds: 16 linear sub-buckets per power of two, so any percentile is
+* reported within about 6 %. Recording a value is a few integer operations and
+* two monotonic clock reads per stage, which is negligible compared to copying
+* or writing a surface of several megabytes.
+*
+* Every histogram has a single writing thread (the data callback for the
+* callback stages, the writer thread for the others). Other threads may read
+* it at any time; a report may then be off by the surfaces being recorded.
+*/
+
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include "GoLogPlatform.h"
+#include <stdio.h>
+
+#define HISTOGRAM_SUBBUCKET_BITS	4
+#define HISTOGRAM_SUBBUCKETS		(1 << HISTOGRAM_SUBBUCKET_BITS)
+#define HISTOGRAM_BUCKETS			((64 - HISTOGRAM_SUBBUCKET_BITS + 1) * HISTOGRAM_SUBBUCKETS)
+
+typedef enum
+{
+	PIPELINE_STAGE_CALLBACK,			// Data callback, datasets containing a surface
+	PIPELINE_STAGE_COPY,				// Getting a buffer and copying the surface in the callback
+	PIPELINE_STAGE_QUEUE,				// Waiting in the writer queue (submit to start of writing)
+	PIPELINE_STAGE_CROP,				// Cropping to the valid samples on the writer thread
+	PIPELINE_STAGE_PYRAMID,				// Overview levels on the writer thread
+	PIPELINE_STAGE_ENCODE,				// Compression on the writer thread
+	PIPELINE_STAGE_CHECKSUM,			// Payload checksums on the writer thread
+	PIPELINE_STAGE_WRITE,				// Sink write (file open, header, data, close / container append; submission only for io_uring)
+	PIPELINE_STAGE_TOTAL,				// Received in callback to written
+	PIPELINE_STAGE_COUNT
+}PipelineStage;
+
+typedef struct
+{
+	volatile uint64_t count;
+	volatile uint64_t sumNs;
+	volatile uint64_t maxNs;
+	volatile uint64_t buckets[HISTOGRAM_BUCKETS];
+}LatencyHistogram;
+
+typedef struct
+{
+	LatencyHistogram stages[PIPELINE_STAGE_COUNT];
+}PipelineStats;
+
+void LatencyHistogram_Record(LatencyHistogram *histogram, uint64_t ns);
+
+// Latency (upper edge of bucket) below which the given fraction (0 - 1) of values fall. 0 if empty.
+uint64_t LatencyHistogram_Percentile(const LatencyHistogram *histogram, double fraction);
+
+// difference = current - previous, for the values recorded between two copies
+void LatencyHistogram_Subtract(LatencyHistogram *difference, const LatencyHistogram *current, const LatencyHistogram *previous);
+
+GOLOG_INLINE void PipelineStats_Record(PipelineStats *stats, PipelineStage stage, uint64_t startNs, uint64_t endNs)
+{
+	if (stats != NULL)
+	{
+		LatencyHistogram_Record(&stats->stages[stage], endNs - startNs);
+	}
+}
+
+const char *PipelineStats_StageName(PipelineStage stage);
+
+// Print table of count, mean and percentiles (microseconds) for each stage
+void PipelineStats_Print(FILE *fptr, const PipelineStats *stats);
+
+#endif // PIPELINE_STATS_H
@@ -1,342 +1,834 @@
-/*
-* ReceiveProfileASync.c
-*
-* Based on "ReceiveAsync" and "ReceiveProfile" sample code from LMI
-* Modified in 2018 by Martin H. Skjelvareid
-*
-* Gocator 2000 Sample
-* Copyright (C) 2011 by LMI Technologies Inc.
-*
-* Licensed under The MIT License.
-* Redistributions of files must retain the above copyright notice.
-*
-* Purpose: Connect to Gocator system, receive profile data using a callback function,
-* and write data to file.
-*
-* Requirements: Ethernet output for the desired data must be enabled.
-*
-* Output files have the following format:
-* char[16]				headerText			(16 bytes)	(Last 4 characters indicate version number)
-* uint64				timeStamp			(8 bytes)
-* uint32				surfaceWidth		(4 bytes)
-* uint32				surfaceLength		(4 bytes)
-* float64				xOffset				(8 bytes)
-* float64				xResolution			(8 bytes)
-* float64				yOffset				(8 bytes)
-* float64				yResolution			(8 bytes)
-* float64				zOffset				(8 bytes)
-* float64				zResolution			(8 bytes)
-* float64				frameRate			(8 bytes)
-* float64				exposureTime		(8 bytes)
-* uint16				surface				(2*surfaceWidth*surfaceLength bytes)
-*
-* The surface is written row-by-row.
-* Note that the header text version number should be updated whenever changes are made.
-*
-* Gocator transmits range data as 16-bit signed integers.
-* To translate 16-bit range data to metric units, the calculation for each point is:
-*	X: XOffset + columnIndex * XResolution
-*	Y: YOffset + rowIndex * YResolution
-*	Z: ZOffset + height_map[rowIndex][columnIndex] * ZResolution
-*
-* Invalid data (outside surface) are given the value -2^15 = -32768
-*/
-
-#include <GoSdk/GoSdk.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <memory.h>
-#include <time.h>		// Added
-#include <Windows.h>	// Added
-
-#define RECEIVE_TIMEOUT			(20000000)
-#define INVALID_RANGE_16BIT		((signed short)0x8000)			// gocator transmits range data as 16-bit signed integers. 0x8000 signifies invalid range data.
-#define DOUBLE_MAX				((k64f)1.7976931348623157e+308)	// 64-bit double - largest positive value.
-#define INVALID_RANGE_DOUBLE	((k64f)-DOUBLE_MAX)				// floating point value to represent invalid range data.
-#define SENSOR_IP			    "192.168.1.10"
-
-#define NM_TO_MM(VALUE) (((k64f)(VALUE))/1000000.0)
-#define UM_TO_MM(VALUE) (((k64f)(VALUE))/1000.0)
-
-#define ROOTFOLDER          "D:\\GocatorDataOutput\\"
-#define DATAFILENAMESUFFIX  "GocatorSurface.bin"
-#define MEASFILENAMESUFFIX  "GocatorMeasurement.txt"
-#define HEADERTEXT			"MHSKJELV VER0001"
-#define HEADERTEXTSIZE		16
-
-// Define DataContext struct - used for passing data between main() and callback func.
-typedef struct
-{
-	k32u count;						// Variable for counting surfaces (uint32)
-	k64u timeStamp;					// Variable for keeping track of timestamp
-	k64f frameRate;
-	k64f exposureTime;
-	FILE * measFilePointer;
-}DataContext;
-
-// Declare data callback function
-kStatus kCall onData(void* ctx, void* sys, void* dataset);
-
-// Main function
-void main(int argc, char **argv)
-{
-	kAssembly api = kNULL;
-	GoSystem system = kNULL;
-	GoSensor sensor = kNULL;
-	kStatus status;
-	kIpAddress ipAddress;
-	GoSetup setup = kNULL;
-	DataContext contextPointer;
-	k32s scanMode;
-
-	SYSTEMTIME str_t;
-	char measurementFileName[1024];      // File name buffer
-
-	// Construct Gocator API Library
-	if ((status = GoSdk_Construct(&api)) != kOK)
-	{
-		printf("Error: GoSdk_Construct:%d\n", status);
-		return;
-	}
-
-	// Construct GoSystem object
-	if ((status = GoSystem_Construct(&system, kNULL)) != kOK)
-	{
-		printf("Error: GoSystem_Construct:%d\n", status);
-		return;
-	}
-
-	// Parse IP address into address data structure
-	kIpAddress_Parse(&ipAddress, SENSOR_IP);
-
-	// Obtain GoSensor object by sensor IP address
-	if ((status = GoSystem_FindSensorByIpAddress(system, &ipAddress, &sensor)) != kOK)
-	{
-		printf("Error: GoSystem_FindSensor:%d\n", status);
-		return;
-	}
-
-	// Create connection to GoSystem object
-	if ((status = GoSystem_Connect(system)) != kOK)
-	{
-		printf("Error: GoSystem_Connect:%d\n", status);
-		return;
-	}
-
-	// Enable sensor data channel
-	if ((status = GoSystem_EnableData(system, kTRUE)) != kOK)
-	{
-		printf("Error: GoSensor_EnableData:%d\n", status);
-		return;
-	}
-
-	// Set data handler to receive data asynchronously
-	if ((status = GoSystem_SetDataHandler(system, onData, &contextPointer)) != kOK)
-	{
-		printf("Error: GoSystem_SetDataHandler:%d\n", status);
-		return;
-	}
-
-	// Retrieve setup handle
-	if ((setup = GoSensor_Setup(sensor)) == kNULL)
-	{
-		printf("Error: GoSensor_Setup: Invalid Handle\n");
-	}
-
-	// Reset counter
-	contextPointer.count = 0;
-
-	// Get camera settings
-	contextPointer.frameRate = GoSetup_FrameRate(setup);
-	contextPointer.exposureTime = GoSetup_Exposure(setup, GoSensor_Role(sensor));
-
-
-	// Check that correct scan mode is used
-	if ((scanMode = GoSetup_ScanMode(setup)) != GO_MODE_SURFACE)
-	{
-		if ((status = GoSetup_SetScanMode(setup, GO_MODE_SURFACE)) != kOK)
-		{
-			printf("Error: GoSetup_SetScanMode:%d\n", status);
-			return;
-		}
-		printf("Note: Scan mode changed to \"surface\" mode. \n\n");
-	}
-
-	// Make changes visible in web browser (if any)
-	GoSensor_Flush(sensor);
-
-	// Open measurement output file (text)
-	GetSystemTime(&str_t);
-	snprintf(measurementFileName, sizeof measurementFileName,
-		"%s%04d-%02d-%02d_%02d%02d%02d_%s",
-		ROOTFOLDER,
-		str_t.wYear, str_t.wMonth, str_t.wDay, str_t.wHour, str_t.wMinute, str_t.wSecond,
-		MEASFILENAMESUFFIX);
-	printf("Measurement output file: %s\n\n", measurementFileName);
-
-	if ((contextPointer.measFilePointer = fopen(measurementFileName, "w")) == NULL) {
-		printf("Error opening file");
-		return;
-	}
-
-	// Make measurement file header
-	fprintf(contextPointer.measFilePointer, "Surface number; Measurement ID; Measurement value\r\n");
-
-	// Intro text
-	printf("******** Nofima Gocator logger ********\n\n");
-
-	// Wait  for user to start data logging
-	printf("Press ENTER key to start logging data. Press ENTER again to stop.\n");
-	getchar();
-	printf("Waiting for surface measurements from Gocator...\n\n");
-
-	// Start Gocator sensor
-	if ((status = GoSystem_Start(system)) != kOK)
-	{
-		printf("Error: GoSystem_Start:%d\n", status);
-		return;
-	}
-
-	// Callback function will be executed every time a surface is sent from the sensor
-
-	// Wait for ENTER to be pressed - stop logging
-	getchar();
-
-	// stop Gocator sensor
-	if ((status = GoSystem_Stop(system)) != kOK)
-	{
-		printf("Error: GoSystem_Stop:%d\n", status);
-		return;
-	}
-
-	// Close file pointer
-	fclose(contextPointer.measFilePointer);
-
-	// Destroy handles
-	GoDestroy(system);
-	GoDestroy(api);
-
-	printf("Logging stopped - %ld surfaces logged in total. Press ENTER key to close.\n", contextPointer.count);
-	getchar();
-	return;
-}
-
-
-// Data callback function
-kStatus kCall onData(void* ctx, void* sys, void* dataset)
-{
-	DataContext *context = ctx;
-	unsigned int i, j, k;
-	unsigned int fwriteStatus;
-	SYSTEMTIME str_t;			// Time variable
-	char filename[1024];		// File name buffer
-	char headerText[16];		// Header text char array
-	FILE * fptr;
-	GoMeasurementData *measurementData = kNULL;
-
-	// Loop through dataset and handle different message types
-	for (i = 0; i < GoDataSet_Count(dataset); ++i)
-	{
-		GoDataMsg dataObj = GoDataSet_At(dataset, i);
-		switch (GoDataMsg_Type(dataObj))
-		{
-			case GO_DATA_MESSAGE_TYPE_STAMP:
-			{
-				GoStampMsg stampMsg = dataObj;
-				for (j = 0; j < GoStampMsg_Count(stampMsg); ++j)
-				{
-					GoStamp *stamp = GoStampMsg_At(stampMsg, j);	// Get stamp pointer
-					context->timeStamp = stamp->timestamp;			// Copy timestamp to context
-				}
-			}
-			break;
-
-			case GO_DATA_MESSAGE_TYPE_SURFACE:
-			{
-				GoSurfaceMsg surfaceMsg = dataObj;
-				unsigned int rowIdx, colIdx;
-
-				// Get information on surface size and resolution
-				k32u surfaceWidth = GoSurfaceMsg_Width(surfaceMsg);
-				k32u surfaceLength = GoSurfaceMsg_Length(surfaceMsg);
-				double XResolution = NM_TO_MM(GoSurfaceMsg_XResolution(surfaceMsg));
-				double YResolution = NM_TO_MM(GoSurfaceMsg_YResolution(surfaceMsg));
-				double ZResolution = NM_TO_MM(GoSurfaceMsg_ZResolution(surfaceMsg));
-				double XOffset = UM_TO_MM(GoSurfaceMsg_XOffset(surfaceMsg));
-				double YOffset = UM_TO_MM(GoSurfaceMsg_YOffset(surfaceMsg));
-				double ZOffset = UM_TO_MM(GoSurfaceMsg_ZOffset(surfaceMsg));
-
-				double widthMm = surfaceWidth * XResolution;
-				double lengthMm = surfaceLength * YResolution;
-
-				// Increment counter
-				context->count++;
-
-				// Output information on received surface
-				printf("Surface %ld received. Dimensions: [%1.0f, %1.0f] mm \n", context->count, widthMm, lengthMm);
-
-				// Open binary output file
-				GetSystemTime(&str_t);
-				snprintf(filename, sizeof filename, "%s%04d-%02d-%02d_%02d%02d%02d_%04ld_%s",
-					ROOTFOLDER,
-					str_t.wYear, str_t.wMonth, str_t.wDay, str_t.wHour, str_t.wMinute, str_t.wSecond,
-					context->count, DATAFILENAMESUFFIX);
-
-				if ((fptr = fopen(filename, "wb")) == NULL) {
-					printf("Error opening file");
-					return;
-				}
-
-				// Write header information
-				fwrite(&HEADERTEXT, sizeof(HEADERTEXT)-1, 1, fptr);						// Note: Subtract 1 to avoid including null terminator
-				fwrite(&(context->timeStamp), sizeof(context->timeStamp), 1, fptr);
-				fwrite(&surfaceWidth, sizeof(surfaceWidth), 1, fptr);
-				fwrite(&surfaceLength, sizeof(surfaceLength), 1, fptr);
-				fwrite(&XOffset, sizeof(XOffset), 1, fptr);
-				fwrite(&XResolution, sizeof(XResolution), 1, fptr);
-				fwrite(&YOffset, sizeof(YOffset), 1, fptr);
-				fwrite(&YResolution, sizeof(YResolution), 1, fptr);
-				fwrite(&ZOffset, sizeof(XOffset), 1, fptr);
-				fwrite(&ZResolution, sizeof(XOffset), 1, fptr);
-				fwrite(&(context->frameRate), sizeof(context->frameRate), 1, fptr);
-				fwrite(&(context->exposureTime), sizeof(context->exposureTime), 1, fptr);
-
-				// Loop through each row of surface and write to file
-				for (rowIdx = 0; rowIdx < GoSurfaceMsg_Length(surfaceMsg); rowIdx++)
-				{
-					k16s *data = GoSurfaceMsg_RowAt(surfaceMsg, rowIdx);
-
-					// Write profile buffer to file
-					fwriteStatus = fwrite(data, surfaceWidth * sizeof(k16s), 1, fptr);
-					if (fwriteStatus != 1)
-					{
-						printf("WARNING: Error while writing surface to file\n");
-					}
-				}
-
-				// Close file
-				fclose(fptr);
-				printf("Surface written to file: %s\n\n", filename);
-			} // case
-			break;
-
-			case GO_DATA_MESSAGE_TYPE_MEASUREMENT:
-			{
-				GoMeasurementMsg measurementMsg = dataObj;
-				for (k = 0; k < GoMeasurementMsg_Count(measurementMsg); ++k)
-				{
-					measurementData = GoMeasurementMsg_At(measurementMsg, k);
-
-					// Write measurement data to text file
-					fprintf(context->measFilePointer, "%4.0u;%4.0u; %.2f\r\n", context->count, GoMeasurementMsg_Id(measurementMsg),measurementData->value);
-				}
-			}
-			break;
-		} // switch
-	} // for
-
-	// Clean up
-	GoDestroy(dataset);
-
-	return kOK;
-}
+/*
+* ReceiveProfileASync.c
+*
+* Based on "ReceiveAsync" and "ReceiveProfile" sample code from LMI
+* Modified in 2018 by Martin H. Skjelvareid
+*
+* Gocator 2000 Sample
+* Copyright (C) 2011 by LMI Technologies Inc.
+*
+* Licensed under The MIT License.
+* Redistributions of files must retain the above copyright notice.
+*
+* Purpose: Connect to Gocator system, receive profile data using a callback function,
+* and write data to file.
+*
+* Requirements: Ethernet output for the desired data must be enabled.
+*
+* Output files have the following format:
+* char[16]				headerText			(16 bytes)	(Last 4 characters indicate version number)
+* uint64				timeStamp			(8 bytes)
+* uint32				surfaceWidth		(4 bytes)
+* uint32				surfaceLength		(4 bytes)
+* float64				xOffset				(8 bytes)
+* float64				xResolution			(8 bytes)
+* float64				yOffset				(8 bytes)
+* float64				yResolution			(8 bytes)
+* float64				zOffset				(8 bytes)
+* float64				zResolution			(8 bytes)
+* float64				frameRate			(8 bytes)
+* float64				exposureTime		(8 bytes)
+* uint16				surface				(2*surfaceWidth*surfaceLength bytes)
+*
+* The surface is written row-by-row.
+* Note that the header text version number should be updated whenever changes are made.
+*
+* Version history:
+* VER0001		Header as above, raw surface.
+* VER0002		Header as above followed by
+*				uint32		codec			(4 bytes)	0 = raw, 1 = MED/Golomb-Rice (see SurfaceCodec.h)
+*				uint32		reserved		(4 bytes)
+*				uint64		payloadSize		(8 bytes)	Bytes of (coded) surface data that follow
+*				Written when the -compress option is used; surfaces that do not compress are still written as VER0001.
+* VER0003		VER0002 header followed by
+*				uint64		dataOffset		(8 bytes)	Offset of surface data from start of file (multiple of 4096)
+*				Zero padding up to dataOffset, then the (coded) surface data, zero padded to a multiple of 4096 bytes.
+*				Written with the -direct option (unbuffered I/O, which requires aligned writes). Readers should
+*				take the data from dataOffset and ignore the padding after payloadSize bytes.
+* VER0004		VER0003 header followed by
+*				uint32		cropColumn		(4 bytes)	Position of the surface within the full sensor surface
+*				uint32		cropRow			(4 bytes)
+*				uint32		fullWidth		(4 bytes)	Size of the full sensor surface
+*				uint32		fullLength		(4 bytes)
+*				Written with the -crop option: only the bounding box of the valid samples is stored
+*				(surfaceWidth x surfaceLength, possibly 0 x 0). xOffset and yOffset are those of the
+*				full surface. dataOffset is 136, or a multiple of 4096 with -direct.
+* VER0005		VER0004 header followed by
+*				uint32		tileWidth		(4 bytes)	Tile size of the tiled payload
+*				uint32		tileLength		(4 bytes)
+*				Written with the -tiles option (or -compress-threads): the payload is a tile table followed by tiles, each
+*				coded on its own (see SurfaceTiles.h), so that regions can be read without the rest
+*				of the surface. The crop fields are zero if the surface is not cropped.
+*				dataOffset is 144, or a multiple of 4096 with -direct.
+* VER0006		VER0005 header followed by
+*				uint32		chunkSize		(4 bytes)	Payload bytes per chunk checksum
+*				uint32		chunkCount		(4 bytes)	Number of chunks (payloadSize / chunkSize rounded up, at most 32)
+*				uint32		chunkCrc[32]	(128 bytes)	CRC32C of each chunk of the payload (unused entries zero)
+*				uint32		reserved		(4 bytes)
+*				uint32		headerCrc		(4 bytes)	CRC32C of the header bytes before it
+*				Written with the -checksum option (see SurfaceChecksum.h). The crop and tile fields are zero
+*				if the surface is not cropped or tiled. dataOffset is 288, or a multiple of 4096 with -direct.
+*
+* Gocator transmits range data as 16-bit signed integers.
+* To translate 16-bit range data to metric units, the calculation for each point is:
+*	X: XOffset + (cropColumn + columnIndex) * XResolution
+*	Y: YOffset + (cropRow + rowIndex) * YResolution
+*	Z: ZOffset + height_map[rowIndex][columnIndex] * ZResolution
+* (cropColumn and cropRow are 0 in files before VER0004)
+*
+* Invalid data (outside surface) are given the value -2^15 = -32768
+*
+* Surfaces are copied in the data callback and written to disk by a separate
+* writer thread (see SurfaceWriter.h), so that disk access never blocks the
+* GoSdk receive thread. Surfaces are dropped (and counted) if the writer falls
+* too far behind.
+*
+* With the -container option all surfaces of a session are instead appended to
+* one session file (see SurfaceContainer.h), optionally rotated by size or time.
+* With -pyramid, 2x, 4x and 8x downsampled overviews of each surface are stored
+* after it in the container (see SurfacePyramid.h), for quick previews.
+* With -crop, only the bounding box of the valid samples of each surface is
+* written (VER0004, see SurfaceCrop.h), and the bytes saved are reported.
+* With -tiles, surfaces are stored in square tiles (VER0005, see
+* SurfaceTiles.h), so that regions of interest can be read on their own.
+* With -compress-threads, the tiles of each surface are coded in parallel on
+* a work-stealing thread pool (see TaskPool.h); compressed surfaces without
+* -tiles are then coded in bands of full rows, also stored as VER0005.
+* With -checksum, CRC32C checksums of the header and of chunks of the surface
+* data are stored with each surface (VER0006, see SurfaceChecksum.h), and of
+* each overview level with -pyramid; use Tools/SurfaceVerify to check a
+* logged session.
+*
+* Measurements are written to a binary log (see MeasurementLog.h); use
+* Tools/MeasurementToCsv to convert it to the earlier semicolon separated text file.
+*
+* The latency of each pipeline stage (callback, copy, queue, encode, write) is
+* recorded in histograms (see PipelineStats.h). Throughput and latency
+* percentiles are written to a stats file at a fixed interval and summarized
+* when logging stops.
+*
+* Each written surface is added to a time stamp index (see SurfaceIndex.h), so
+* that the surface closest to a given time can be found without opening the
+* surface files; use Tools/SurfaceIndexQuery to search it. The sensor time
+* stamps are mapped to host monotonic and wall clock time by a model of the
+* sensor clock fitted while logging (see ClockModel.h), and these capture
+* times are stored in the index as well. The index also holds summary
+* statistics of each surface (valid fraction, minimum, maximum, mean and
+* standard deviation of the heights), summed while the callback copies the
+* rows (see SurfaceStats.h).
+*
+* Surfaces lost before the callback (sensor, network, SDK) are detected from
+* gaps in the stamp frame index (see FrameMonitor.h). The number of surfaces
+* lost before each written surface is stored in the session container index.
+*
+* Several sensors can be logged at once (-sensor, repeated). Each sensor has its
+* own pipeline: frame monitor, buffer pool, writer thread, measurement log and
+* stats file, in a subfolder named by the sensor serial number. Datasets are
+* routed to the pipeline of their sender. The writer threads can be pinned to
+* CPUs (-cpu); the data callbacks of all sensors run on the GoSdk receive thread.
+*/
+
+#include <GoSdk/GoSdk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+#include <time.h>		// Added
+#include "GoLogPlatform.h"
+#include "SurfaceFormat.h"
+#include "SurfaceWriter.h"
+#include "SurfaceCapture.h"
+#include "SurfaceContainer.h"
+#include "SurfaceUringSink.h"
+#include "SurfaceCodec.h"
+#include "MeasurementLog.h"
+#include "PipelineStats.h"
+#include "FrameMonitor.h"
+
+#define RECEIVE_TIMEOUT			(20000000)
+#define DOUBLE_MAX				((k64f)1.7976931348623157e+308)	// 64-bit double - largest positive value.
+#define INVALID_RANGE_DOUBLE	((k64f)-DOUBLE_MAX)				// floating point value to represent invalid range data.
+#define SENSOR_IP			    "192.168.1.10"		// Default sensor
+#define MAXSENSORS				8
+
+#define NM_TO_MM(VALUE) (((k64f)(VALUE))/1000000.0)
+#define UM_TO_MM(VALUE) (((k64f)(VALUE))/1000.0)
+
+#ifndef ROOTFOLDER
+#if defined(_WIN32)
+#define ROOTFOLDER          "D:\\GocatorDataOutput\\"
+#else
+#define ROOTFOLDER          "./GocatorDataOutput/"
+#endif
+#endif
+#if defined(_WIN32)
+#define PATHSEPARATOR       "\\"
+#else
+#define PATHSEPARATOR       "/"
+#endif
+#define SENSORFOLDERPREFIX  "Sensor"			// Subfolder per sensor when logging several: <ROOTFOLDER>Sensor<serial number>
+#define STATSFILENAMESUFFIX "GocatorStats.txt"
+#define STATSINTERVAL       10				// Default seconds between reports in stats file
+#define PYRAMIDLEVELS       3				// Overview levels stored with -pyramid (2x, 4x, 8x)
+#define MINTILESIZE         16				// Tile sizes accepted by -tiles
+#define MAXTILESIZE         4096
+#define MAXENCODETHREADS    64				// Threads accepted by -compress-threads
+
+// Define DataContext struct - used for passing data between main() and callback func.
+// There is one per sensor, each with its own buffer pool, writer thread and output files.
+typedef struct
+{
+	k32u sensorId;					// Sensor serial number (sender id of its datasets)
+	char folder[1024];				// Output folder of this sensor (with trailing separator)
+	FILE *statsFile;				// Throughput and latency reports
+	SurfaceIndexWriter index;		// Time stamp index of written surfaces
+	k64u timeStamp;					// Variable for keeping track of timestamp
+	k64u frameIndex;				// Frame index of last stamp
+	FrameMonitor frameMonitor;		// Frame index gap detection
+	ClockModel clockModel;			// Sensor time stamp to host time
+	k64f frameRate;
+	k64f exposureTime;
+	MeasurementLog measLog;			// Binary measurement log
+	PipelineStats pipelineStats;	// Stage latency histograms
+	SurfaceWriter writer;			// Background surface writer
+	SurfaceCapture capture;			// Hand-off of received surfaces to the writer, with the surface counter
+}DataContext;
+
+// All sensors - the data callback passes each dataset to the DataContext of its sender
+typedef struct
+{
+	DataContext sensors[MAXSENSORS];
+	k32u sensorCount;
+	k64u unknownDataSets;			// Datasets from sensors that are not logged
+}LoggerContext;
+
+// Logger options - set from command line
+typedef struct
+{
+	kBool container;								// Write one session container instead of one file per surface
+	kBool compress;									// Compress surfaces losslessly (VER0002)
+	kBool uring;									// Write surface files asynchronously with io_uring (Linux)
+	kBool direct;									// Write surface files with direct I/O, bypassing the file cache
+	kBool pyramid;									// Store downsampled overview levels with each surface (containers)
+	kBool crop;										// Write only the bounding box of the valid samples (VER0004)
+	k32u tileSize;									// Store surfaces in tileSize x tileSize tiles (VER0005, 0 = row by row)
+	k32u encodeThreads;								// Threads coding each surface, per sensor (0 = writer thread only)
+	kBool checksum;									// Store CRC32C checksums with each surface (VER0006)
+	SurfaceContainerOptions containerOptions;		// Container rotation limits
+	k32u poolBuffers;								// Preallocated surface buffers per sensor (0 = default)
+	kBool hugePages;								// Use huge pages for surface buffers
+	k32u statsInterval;								// Seconds between reports in stats file (0 = no periodic report)
+	char sensorIps[MAXSENSORS][32];					// Sensor IP addresses
+	k32u sensorCount;
+	k32s writerCpus[MAXSENSORS];					// CPU of the writer thread of each sensor (-1 = any)
+}LoggerOptions;
+
+// Declare data callback function
+kStatus kCall onData(void* ctx, void* sys, void* dataset);
+
+// Parse comma separated CPU numbers, one per sensor. Returns 0 on success.
+static int parseCpuList(const char *text, k32s *cpus)
+{
+	char *end;
+	k32u i;
+
+	for (i = 0; i < MAXSENSORS && *text != '\0'; i++)
+	{
+		cpus[i] = (k32s)strtol(text, &end, 10);
+		if (end == text || cpus[i] < 0 || (*end != ',' && *end != '\0'))
+		{
+			return -1;
+		}
+		text = (*end == ',') ? end + 1 : end;
+	}
+	return (*text == '\0') ? 0 : -1;
+}
+
+// Parse command line options. Returns 0 on success.
+static int parseOptions(int argc, char **argv, LoggerOptions *options)
+{
+	int i;
+
+	memset(options, 0, sizeof(*options));
+	options->statsInterval = STATSINTERVAL;
+	for (i = 0; i < MAXSENSORS; i++)
+	{
+		options->writerCpus[i] = -1;
+	}
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-sensor") == 0 && i + 1 < argc && options->sensorCount < MAXSENSORS)
+		{
+			snprintf(options->sensorIps[options->sensorCount++], sizeof options->sensorIps[0], "%s", argv[++i]);
+		}
+		else if (strcmp(argv[i], "-cpu") == 0 && i + 1 < argc && parseCpuList(argv[i + 1], options->writerCpus) == 0)
+		{
+			i++;
+		}
+		else if (strcmp(argv[i], "-container") == 0)
+		{
+			options->container = kTRUE;
+		}
+		else if (strcmp(argv[i], "-compress") == 0)
+		{
+			options->compress = kTRUE;
+		}
+		else if (strcmp(argv[i], "-uring") == 0)
+		{
+			options->uring = kTRUE;
+		}
+		else if (strcmp(argv[i], "-direct") == 0)
+		{
+			options->direct = kTRUE;
+		}
+		else if (strcmp(argv[i], "-pyramid") == 0)
+		{
+			options->pyramid = kTRUE;
+		}
+		else if (strcmp(argv[i], "-crop") == 0)
+		{
+			options->crop = kTRUE;
+		}
+		else if (strcmp(argv[i], "-tiles") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= MINTILESIZE && atoi(argv[i + 1]) <= MAXTILESIZE)
+		{
+			options->tileSize = (k32u)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-compress-threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 1 && atoi(argv[i + 1]) <= MAXENCODETHREADS)
+		{
+			options->encodeThreads = (k32u)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-checksum") == 0)
+		{
+			options->checksum = kTRUE;
+		}
+		else if (strcmp(argv[i], "-rotate-size") == 0 && i + 1 < argc)
+		{
+			options->containerOptions.rotateBytes = (k64u)(atof(argv[++i]) * 1024.0 * 1024.0);
+		}
+		else if (strcmp(argv[i], "-rotate-time") == 0 && i + 1 < argc)
+		{
+			options->containerOptions.rotateSeconds = (k32u)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-pool") == 0 && i + 1 < argc)
+		{
+			options->poolBuffers = (k32u)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-hugepages") == 0)
+		{
+			options->hugePages = kTRUE;
+		}
+		else if (strcmp(argv[i], "-stats") == 0 && i + 1 < argc)
+		{
+			options->statsInterval = (k32u)atoi(argv[++i]);
+		}
+		else
+		{
+			printf("Usage: %s [-sensor <IP address> ...] [-cpu <list>] [-container] [-rotate-size <MB>] [-rotate-time <seconds>] [-pyramid] [-crop] [-tiles <size>] [-compress] [-compress-threads <n>] [-checksum] [-uring] [-direct] [-pool <buffers>] [-hugepages] [-stats <seconds>]\n", argv[0]);
+			printf("  -sensor         Log this sensor (default %s). Repeat for up to %d sensors, each logged to its own subfolder\n", SENSOR_IP, MAXSENSORS);
+			printf("  -cpu            Comma separated CPU numbers for the writer threads, one per sensor (e.g. 2,3)\n");
+			printf("  -container      Append all surfaces to one session file instead of one file per surface\n");
+			printf("  -rotate-size    Start a new session file when the current one reaches this size\n");
+			printf("  -rotate-time    Start a new session file after this many seconds\n");
+			printf("  -pyramid        Store 2x, 4x and 8x downsampled overviews with each surface (with -container)\n");
+			printf("  -crop           Write only the bounding box of the valid samples of each surface (VER0004 files)\n");
+			printf("  -tiles          Store surfaces in size x size tiles (e.g. 256; %d to %d), for reading regions (VER0005 files)\n", MINTILESIZE, MAXTILESIZE);
+			printf("  -compress       Compress surfaces losslessly (VER0002 files)\n");
+			printf("  -compress-threads  Code each surface on n threads (1 to %d), in tiles or bands of rows (VER0005 files)\n", MAXENCODETHREADS);
+			printf("  -checksum       Store CRC32C checksums of header and surface data with each surface (VER0006 files)\n");
+			printf("  -uring          Write surface files asynchronously with io_uring (Linux; stdio if not available)\n");
+			printf("  -direct         Write surface files with direct I/O, bypassing the file cache (aligned VER0003 files)\n");
+			printf("  -pool           Number of preallocated surface buffers per sensor (limits memory use; default %d)\n", WRITERQUEUESIZE + 2);
+			printf("  -hugepages      Back surface buffers by huge pages if the OS allows it\n");
+			printf("  -stats          Seconds between throughput / latency reports in the stats file (default %d, 0 = off)\n", STATSINTERVAL);
+			return -1;
+		}
+	}
+	if (options->sensorCount == 0)
+	{
+		snprintf(options->sensorIps[options->sensorCount++], sizeof options->sensorIps[0], "%s", SENSOR_IP);
+	}
+	if (options->pyramid && !options->container)
+	{
+		printf("Note: -pyramid is only stored in session containers (-container), and is ignored.\n");
+		options->pyramid = kFALSE;
+	}
+	if (options->container && (options->direct || options->uring))
+	{
+		printf("Note: session containers (-container) are written with buffered stdio, and %s ignored.\n",
+			(options->direct && options->uring) ? "-direct and -uring are" : options->direct ? "-direct is" : "-uring is");
+		options->direct = kFALSE;
+		options->uring = kFALSE;
+	}
+	return 0;
+}
+
+// Set up one sensor and open its output: measurement log, stats file, surface sink and writer thread.
+// Returns 0 on success.
+static int openPipeline(DataContext *context, GoSensor sensor, const GoLogWallTime *str_t, const LoggerOptions *options, k32s writerCpu)
+{
+	kStatus status;
+	GoSetup setup = kNULL;
+	k32s scanMode;
+	SurfaceSink *sink;
+	SurfaceWriterOptions writerOptions;
+	k32u poolBuffers = options->poolBuffers;
+	char measurementFileName[1024];      // File name buffer
+	char statsFileName[1024];
+	char indexFileName[1024];
+
+	// Retrieve setup handle
+	if ((setup = GoSensor_Setup(sensor)) == kNULL)
+	{
+		printf("Error: GoSensor_Setup: Invalid Handle\n");
+	}
+
+	context->sensorId = GoSensor_Id(sensor);
+
+	// Get camera settings
+	context->frameRate = GoSetup_FrameRate(setup);
+	context->exposureTime = GoSetup_Exposure(setup, GoSensor_Role(sensor));
+	context->frameIndex = 0;
+	FrameMonitor_Init(&context->frameMonitor, context->frameRate);
+	ClockModel_Init(&context->clockModel);
+
+	// Reset counter
+	SurfaceCapture_Init(&context->capture, &context->writer, &context->frameMonitor, &context->clockModel,
+		&context->pipelineStats);
+
+
+	// Check that correct scan mode is used
+	if ((scanMode = GoSetup_ScanMode(setup)) != GO_MODE_SURFACE)
+	{
+		if ((status = GoSetup_SetScanMode(setup, GO_MODE_SURFACE)) != kOK)
+		{
+			printf("Error: GoSetup_SetScanMode:%d\n", status);
+			return -1;
+		}
+		printf("Note: Scan mode changed to \"surface\" mode. \n\n");
+	}
+
+	// Make changes visible in web browser (if any)
+	GoSensor_Flush(sensor);
+
+	// Open measurement output file (binary log)
+	snprintf(measurementFileName, sizeof measurementFileName,
+		"%s%04d-%02d-%02d_%02d%02d%02d_%s",
+		context->folder,
+		str_t->year, str_t->month, str_t->day, str_t->hour, str_t->minute, str_t->second,
+		MEASLOGFILENAMESUFFIX);
+	printf("Measurement output file: %s\n\n", measurementFileName);
+
+	if (MeasurementLog_Open(&context->measLog, measurementFileName) != 0) {
+		printf("Error opening file");
+		return -1;
+	}
+
+	// Open stats file (throughput and stage latencies)
+	snprintf(statsFileName, sizeof statsFileName,
+		"%s%04d-%02d-%02d_%02d%02d%02d_%s",
+		context->folder,
+		str_t->year, str_t->month, str_t->day, str_t->hour, str_t->minute, str_t->second,
+		STATSFILENAMESUFFIX);
+	if ((context->statsFile = fopen(statsFileName, "w")) == NULL) {
+		printf("Error opening file %s\n", statsFileName);
+		return -1;
+	}
+	memset(&context->pipelineStats, 0, sizeof(context->pipelineStats));
+
+	// Open time stamp index (see SurfaceIndex.h)
+	snprintf(indexFileName, sizeof indexFileName,
+		"%s%04d-%02d-%02d_%02d%02d%02d_%s",
+		context->folder,
+		str_t->year, str_t->month, str_t->day, str_t->hour, str_t->minute, str_t->second,
+		INDEXFILENAMESUFFIX);
+	if (SurfaceIndexWriter_Open(&context->index, indexFileName) != 0) {
+		return -1;
+	}
+
+	// Open surface output and start writer thread
+	if (options->container)
+	{
+		sink = SurfaceContainer_Open(context->folder, &options->containerOptions);
+	}
+	else if (options->direct)
+	{
+		sink = SurfaceFileSink_OpenDirect(context->folder);
+	}
+	else if (options->uring && (sink = SurfaceUringSink_Open(context->folder, URINGSINKDEPTH)) != NULL)
+	{
+		printf("Writing surface files with io_uring\n");
+
+		// Surfaces in flight in the kernel keep their buffers
+		if (poolBuffers == 0)
+		{
+			poolBuffers = WRITERQUEUESIZE + 2 + URINGSINKDEPTH;
+		}
+	}
+	else
+	{
+		sink = SurfaceFileSink_Open(context->folder);
+	}
+	if (sink == NULL)
+	{
+		printf("Error opening surface output\n");
+		return -1;
+	}
+
+	writerOptions.queueCapacity = WRITERQUEUESIZE;
+	writerOptions.codec = options->compress ? SURFACECODEC_MEDRICE : SURFACECODEC_RAW;
+	writerOptions.poolBuffers = poolBuffers;
+	writerOptions.hugePages = options->hugePages;
+	writerOptions.pipelineStats = &context->pipelineStats;
+	writerOptions.statsFile = context->statsFile;
+	writerOptions.statsIntervalSeconds = options->statsInterval;
+	writerOptions.frameMonitor = &context->frameMonitor;
+	writerOptions.clockModel = &context->clockModel;
+	writerOptions.writerCpu = writerCpu;
+	writerOptions.index = &context->index;
+	writerOptions.pyramidLevels = options->pyramid ? PYRAMIDLEVELS : 0;
+	writerOptions.crop = options->crop;
+	writerOptions.tileSize = options->tileSize;
+	writerOptions.encodeThreads = options->encodeThreads;
+	writerOptions.checksum = options->checksum;
+	writerOptions.measurementLog = &context->measLog;
+	if (SurfaceWriter_Start(&context->writer, sink, &writerOptions) != 0)
+	{
+		printf("Error: SurfaceWriter_Start\n");
+		sink->close(sink);
+		return -1;
+	}
+	return 0;
+}
+
+// Print the surface data removed by cropping in the whole session
+static void printCropSummary(FILE *fptr, const SurfaceWriterStats *writerStats)
+{
+	fprintf(fptr, "Cropping: %.1f MB of %.1f MB surface data removed (%.1f %%)\n", writerStats->croppedBytes / 1048576.0,
+		(writerStats->rawBytes + writerStats->croppedBytes) / 1048576.0,
+		100.0 * writerStats->croppedBytes / (writerStats->rawBytes + writerStats->croppedBytes));
+}
+
+// Write remaining surfaces and measurements of one sensor, and print its summary
+static void closePipeline(DataContext *context, kBool multipleSensors)
+{
+	SurfaceWriterStats writerStats;
+
+	if (multipleSensors)
+	{
+		printf("\nSensor %u (%s):\n", context->sensorId, context->folder);
+	}
+
+	// Write remaining surfaces and stop writer thread
+	SurfaceWriter_GetStats(&context->writer, &writerStats);
+	printf("Waiting for %u queued surfaces to be written...\n", writerStats.queueDepth);
+	SurfaceWriter_Stop(&context->writer);
+
+	// Write remaining measurements and close measurement log
+	MeasurementLog_Close(&context->measLog);
+
+	// Sort and close time stamp index
+	if (SurfaceIndexWriter_Close(&context->index) != 0)
+	{
+		printf("WARNING: Error while writing time stamp index\n");
+	}
+
+	SurfaceWriter_GetStats(&context->writer, &writerStats);
+	printf("Writer queue: capacity %u, high-water mark %u\n", writerStats.queueCapacity, writerStats.queueHighWater);
+	printf("Buffer pool: %u buffers, %.1f MB%s, exhausted %llu times, %llu reallocations\n", writerStats.poolBuffers,
+		writerStats.poolBytes / 1048576.0, writerStats.poolHugePages ? " (huge pages)" : "",
+		(unsigned long long)writerStats.poolExhausted, (unsigned long long)writerStats.poolRegrows);
+	printf("Surfaces written: %llu, dropped: %llu, write errors: %llu\n",
+		(unsigned long long)writerStats.written, (unsigned long long)writerStats.dropped, (unsigned long long)writerStats.writeErrors);
+	if (writerStats.payloadBytes > 0)
+	{
+		printf("Surface data: %.1f MB raw, %.1f MB written (ratio %.2f)\n", writerStats.rawBytes / 1048576.0,
+			writerStats.payloadBytes / 1048576.0, (double)writerStats.rawBytes / writerStats.payloadBytes);
+	}
+	if (writerStats.encodeTasks > 0)
+	{
+		printf("Parallel coding: %u threads, %llu tiles, %llu stolen (%.1f %%)\n", context->writer.options.encodeThreads,
+			(unsigned long long)writerStats.encodeTasks, (unsigned long long)writerStats.encodeSteals,
+			100.0 * writerStats.encodeSteals / writerStats.encodeTasks);
+	}
+	if (writerStats.croppedBytes > 0)
+	{
+		printCropSummary(stdout, &writerStats);
+	}
+	printf("Measurements written: %llu, dropped: %llu, write errors: %llu\n", (unsigned long long)context->measLog.written,
+		(unsigned long long)context->measLog.dropped, (unsigned long long)context->measLog.writeErrors);
+	printf("Time stamp index: %llu surfaces\n", (unsigned long long)context->index.entryCount);
+
+	// Latency summary of the whole session
+	printf("\n");
+	PipelineStats_Print(stdout, &context->pipelineStats);
+	FrameMonitor_Print(stdout, &context->frameMonitor, writerStats.written);
+	ClockModel_Print(stdout, &context->clockModel);
+	fprintf(context->statsFile, "\nSession summary:\n");
+	if (writerStats.croppedBytes > 0)
+	{
+		printCropSummary(context->statsFile, &writerStats);
+	}
+	FrameMonitor_Print(context->statsFile, &context->frameMonitor, writerStats.written);
+	ClockModel_Print(context->statsFile, &context->clockModel);
+	PipelineStats_Print(context->statsFile, &context->pipelineStats);
+	fclose(context->statsFile);
+}
+
+// Main function
+void main(int argc, char **argv)
+{
+	kAssembly api = kNULL;
+	GoSystem system = kNULL;
+	GoSensor sensors[MAXSENSORS];
+	kStatus status;
+	kIpAddress ipAddress;
+	LoggerContext *logger;
+	LoggerOptions options;
+	GoLogWallTime str_t;
+	k32u surfaceCount = 0;
+	k32u i;
+
+	// Read command line options
+	if (parseOptions(argc, argv, &options) != 0)
+	{
+		return;
+	}
+
+	// One pipeline per sensor - too large for the stack
+	if ((logger = calloc(1, sizeof(LoggerContext))) == NULL)
+	{
+		printf("Error: out of memory\n");
+		return;
+	}
+
+	// Construct Gocator API Library
+	if ((status = GoSdk_Construct(&api)) != kOK)
+	{
+		printf("Error: GoSdk_Construct:%d\n", status);
+		return;
+	}
+
+	// Construct GoSystem object
+	if ((status = GoSystem_Construct(&system, kNULL)) != kOK)
+	{
+		printf("Error: GoSystem_Construct:%d\n", status);
+		return;
+	}
+
+	for (i = 0; i < options.sensorCount; i++)
+	{
+		// Parse IP address into address data structure
+		if (kIpAddress_Parse(&ipAddress, options.sensorIps[i]) != kOK)
+		{
+			printf("Error: invalid IP address %s\n", options.sensorIps[i]);
+			return;
+		}
+
+		// Obtain GoSensor object by sensor IP address
+		if ((status = GoSystem_FindSensorByIpAddress(system, &ipAddress, &sensors[i])) != kOK)
+		{
+			printf("Error: GoSystem_FindSensor (%s):%d\n", options.sensorIps[i], status);
+			return;
+		}
+	}
+
+	// Create connection to GoSystem object
+	if ((status = GoSystem_Connect(system)) != kOK)
+	{
+		printf("Error: GoSystem_Connect:%d\n", status);
+		return;
+	}
+
+	// Enable sensor data channel
+	if ((status = GoSystem_EnableData(system, kTRUE)) != kOK)
+	{
+		printf("Error: GoSensor_EnableData:%d\n", status);
+		return;
+	}
+
+	// Set data handler to receive data asynchronously (all sensors)
+	if ((status = GoSystem_SetDataHandler(system, onData, logger)) != kOK)
+	{
+		printf("Error: GoSystem_SetDataHandler:%d\n", status);
+		return;
+	}
+
+	// Set up sensors and open output. A single sensor is logged directly to ROOTFOLDER, as before.
+	GoLog_WallTime(&str_t);
+	for (i = 0; i < options.sensorCount; i++)
+	{
+		DataContext *context = &logger->sensors[i];
+
+		if (options.sensorCount == 1)
+		{
+			snprintf(context->folder, sizeof context->folder, "%s", ROOTFOLDER);
+		}
+		else
+		{
+			snprintf(context->folder, sizeof context->folder, "%s%s%u%s", ROOTFOLDER, SENSORFOLDERPREFIX,
+				GoSensor_Id(sensors[i]), PATHSEPARATOR);
+			if (GoLog_MakeFolder(context->folder) != 0)
+			{
+				printf("Error creating folder %s\n", context->folder);
+				return;
+			}
+			printf("Sensor %s (serial number %u): output to %s\n", options.sensorIps[i], GoSensor_Id(sensors[i]), context->folder);
+		}
+		if (openPipeline(context, sensors[i], &str_t, &options, options.writerCpus[i]) != 0)
+		{
+			return;
+		}
+		logger->sensorCount++;
+	}
+
+	// Intro text
+	printf("******** Nofima Gocator logger ********\n\n");
+
+	// Wait  for user to start data logging
+	printf("Press ENTER key to start logging data. Press ENTER again to stop.\n");
+	getchar();
+	printf("Waiting for surface measurements from Gocator...\n\n");
+
+	// Start Gocator sensor
+	if ((status = GoSystem_Start(system)) != kOK)
+	{
+		printf("Error: GoSystem_Start:%d\n", status);
+		return;
+	}
+
+	// Callback function will be executed every time a surface is sent from the sensor
+
+	// Wait for ENTER to be pressed - stop logging
+	getchar();
+
+	// stop Gocator sensor
+	if ((status = GoSystem_Stop(system)) != kOK)
+	{
+		printf("Error: GoSystem_Stop:%d\n", status);
+		return;
+	}
+
+	// Write remaining data and print summary of each sensor
+	for (i = 0; i < logger->sensorCount; i++)
+	{
+		closePipeline(&logger->sensors[i], logger->sensorCount > 1);
+		surfaceCount += logger->sensors[i].capture.count;
+	}
+	if (logger->unknownDataSets > 0)
+	{
+		printf("Datasets from other sensors ignored: %llu\n", (unsigned long long)logger->unknownDataSets);
+	}
+
+	// Destroy handles
+	GoDestroy(system);
+	GoDestroy(api);
+	free(logger);
+
+	printf("Logging stopped - %u surfaces logged in total. Press ENTER key to close.\n", surfaceCount);
+	getchar();
+	return;
+}
+
+
+// Row of a surface message, for SurfaceCapture_Surface
+static const int16_t *surfaceRow(const void *source, uint32_t row)
+{
+	return GoSurfaceMsg_RowAt((GoSurfaceMsg)source, row);
+}
+
+// Data callback function
+kStatus kCall onData(void* ctx, void* sys, void* dataset)
+{
+	LoggerContext *logger = ctx;
+	DataContext *context = kNULL;
+	unsigned int i, j, k;
+	GoMeasurementData *measurementData = kNULL;
+	k64u callbackNs = GoLog_MonotonicNs();
+	kBool surfaceReceived = kFALSE;
+	k32u senderId = GoDataSet_SenderId(dataset);
+
+	// Find the pipeline of the sending sensor. A single sensor takes all data, as before.
+	for (i = 0; i < logger->sensorCount && context == kNULL; i++)
+	{
+		if (logger->sensors[i].sensorId == senderId || logger->sensorCount == 1)
+		{
+			context = &logger->sensors[i];
+		}
+	}
+	if (context == kNULL)
+	{
+		logger->unknownDataSets++;
+		GoDestroy(dataset);
+		return kOK;
+	}
+
+	// Loop through dataset and handle different message types
+	for (i = 0; i < GoDataSet_Count(dataset); ++i)
+	{
+		GoDataMsg dataObj = GoDataSet_At(dataset, i);
+		switch (GoDataMsg_Type(dataObj))
+		{
+			case GO_DATA_MESSAGE_TYPE_STAMP:
+			{
+				GoStampMsg stampMsg = dataObj;
+				for (j = 0; j < GoStampMsg_Count(stampMsg); ++j)
+				{
+					GoStamp *stamp = GoStampMsg_At(stampMsg, j);	// Get stamp pointer
+					context->timeStamp = stamp->timestamp;			// Copy timestamp to context
+					context->frameIndex = stamp->frameIndex;
+				}
+			}
+			break;
+
+			case GO_DATA_MESSAGE_TYPE_SURFACE:
+			{
+				GoSurfaceMsg surfaceMsg = dataObj;
+				SurfaceCaptureFrame frame;
+
+				// Stamp and header information, in mm
+				frame.timeStamp = context->timeStamp;
+				frame.frameIndex = context->frameIndex;
+				frame.surfaceWidth = GoSurfaceMsg_Width(surfaceMsg);
+				frame.surfaceLength = GoSurfaceMsg_Length(surfaceMsg);
+				frame.xResolution = NM_TO_MM(GoSurfaceMsg_XResolution(surfaceMsg));
+				frame.yResolution = NM_TO_MM(GoSurfaceMsg_YResolution(surfaceMsg));
+				frame.zResolution = NM_TO_MM(GoSurfaceMsg_ZResolution(surfaceMsg));
+				frame.xOffset = UM_TO_MM(GoSurfaceMsg_XOffset(surfaceMsg));
+				frame.yOffset = UM_TO_MM(GoSurfaceMsg_YOffset(surfaceMsg));
+				frame.zOffset = UM_TO_MM(GoSurfaceMsg_ZOffset(surfaceMsg));
+				frame.frameRate = context->frameRate;
+				frame.exposureTime = context->exposureTime;
+				frame.rowAt = surfaceRow;
+				frame.source = surfaceMsg;
+
+				// Copy the surface and hand it over to the writer thread (dropped if the writer is too far behind)
+				SurfaceCapture_Surface(&context->capture, &frame, callbackNs, 0);
+				surfaceReceived = kTRUE;
+			} // case
+			break;
+
+			case GO_DATA_MESSAGE_TYPE_MEASUREMENT:
+			{
+				GoMeasurementMsg measurementMsg = dataObj;
+				for (k = 0; k < GoMeasurementMsg_Count(measurementMsg); ++k)
+				{
+					measurementData = GoMeasurementMsg_At(measurementMsg, k);
+
+					// Add measurement to binary log (written in blocks)
+					MeasurementLog_Add(&context->measLog, context->capture.count, GoMeasurementMsg_Id(measurementMsg),
+						measurementData->value, measurementData->decision, context->timeStamp);
+				}
+			}
+			break;
+		} // switch
+	} // for
+
+	// Clean up
+	GoDestroy(dataset);
+
+	if (surfaceReceived)
+	{
+		PipelineStats_Record(&context->pipelineStats, PIPELINE_STAGE_CALLBACK, callbackNs, GoLog_MonotonicNs());
+	}
+	return kOK;
+}
@@ -0,0 +1,84 @@
+/*
+* SpscQueue.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Lock-free single-producer / single-consumer ring of pointers.
+* head and tail are free-running 32-bit counters; depth is tail - head, which
+* stays correct across wrap-around as long as capacity <= 2^31.
+*/
+
+#include "SpscQueue.h"
+#include <stdlib.h>
+#include <string.h>
+
+int SpscQueue_Init(SpscQueue *queue, uint32_t minCapacity)
+{
+	uint32_t capacity = 2;
+
+	memset(queue, 0, sizeof(*queue));
+	while (capacity < minCapacity && capacity < 0x80000000u)
+	{
+		capacity <<= 1;
+	}
+
+	if ((queue->slots = calloc(capacity, sizeof(void *))) == NULL)
+	{
+		return -1;
+	}
+	queue->capacity = capacity;
+	queue->mask = capacity - 1;
+	return 0;
+}
+
+void SpscQueue_Destroy(SpscQueue *queue)
+{
+	free(queue->slots);
+	queue->slots = NULL;
+}
+
+int SpscQueue_Push(SpscQueue *queue, void *item)
+{
+	uint32_t tail = queue->tail;						// Only the producer writes tail
+	uint32_t head = GoLogAtomic_Load32(&queue->head);
+	uint32_t depth = tail - head;
+
+	if (depth >= queue->capacity)
+	{
+		GoLogAtomic_Store64(&queue->rejected, queue->rejected + 1);
+		return 0;
+	}
+
+	queue->slots[tail & queue->mask] = item;
+	GoLogAtomic_Store32(&queue->tail, tail + 1);		// Publish slot to consumer
+
+	GoLogAtomic_Store64(&queue->pushed, queue->pushed + 1);
+	if (depth + 1 > queue->highWater)
+	{
+		GoLogAtomic_Store32(&queue->highWater, depth + 1);
+	}
+	return 1;
+}
+
+void *SpscQueue_Pop(SpscQueue *queue)
+{
+	uint32_t head = queue->head;						// Only the consumer writes head
+	uint32_t tail = GoLogAtomic_Load32(&queue->tail);
+	void *item;
+
+	if (head == tail)
+	{
+		return NULL;
+	}
+
+	item = queue->slots[head & queue->mask];
+	GoLogAtomic_Store32(&queue->head, head + 1);		// Hand slot back to producer
+	return item;
+}
+
+uint32_t SpscQueue_Depth(SpscQueue *queue)
+{
+	uint32_t head = GoLogAtomic_Load32(&queue->head);
+	uint32_t tail = GoLogAtomic_Load32(&queue->tail);
+	return tail - head;
+}
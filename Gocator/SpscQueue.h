@@ -0,0 +1,51 @@
+/*
+* SpscQueue.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Lock-free single-producer / single-consumer ring of pointers.
+* Used to hand surfaces from the GoSdk data callback to the writer thread
+* without ever blocking the callback.
+*
+* Exactly one thread may call SpscQueue_Push and exactly one (other) thread may
+* call SpscQueue_Pop. The statistics functions may be called from any thread.
+*/
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include "GoLogPlatform.h"
+
+typedef struct
+{
+	// Consumer side
+	volatile uint32_t head;				// Index of next slot to pop (free-running)
+	char headPad[GOLOG_CACHE_LINE - sizeof(uint32_t)];
+
+	// Producer side
+	volatile uint32_t tail;				// Index of next slot to push (free-running)
+	volatile uint32_t highWater;		// Largest depth observed after a push
+	volatile uint64_t pushed;			// Number of successful pushes
+	volatile uint64_t rejected;			// Number of pushes refused because the queue was full
+	char tailPad[GOLOG_CACHE_LINE - 2 * sizeof(uint32_t) - 2 * sizeof(uint64_t)];
+
+	// Shared, read-only after construction
+	uint32_t capacity;					// Number of slots (power of two)
+	uint32_t mask;						// capacity - 1
+	void **slots;
+}SpscQueue;
+
+// Allocate queue with at least minCapacity slots (rounded up to power of two). Returns 0 on success.
+int SpscQueue_Init(SpscQueue *queue, uint32_t minCapacity);
+void SpscQueue_Destroy(SpscQueue *queue);
+
+// Producer: append item. Returns 1 on success, 0 if the queue is full (item is not taken).
+int SpscQueue_Push(SpscQueue *queue, void *item);
+
+// Consumer: remove oldest item. Returns NULL if the queue is empty.
+void *SpscQueue_Pop(SpscQueue *queue);
+
+// Number of items currently in the queue (approximate when called from a third thread)
+uint32_t SpscQueue_Depth(SpscQueue *queue);
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,90 @@
+/*
+* SurfaceCapture.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Hand-off of received surfaces to the writer thread (see SurfaceCapture.h).
+*/
+
+#include "SurfaceCapture.h"
+#include "SurfaceStats.h"
+#include <string.h>
+
+void SurfaceCapture_Init(SurfaceCapture *capture, SurfaceWriter *writer, FrameMonitor *frameMonitor, ClockModel *clockModel,
+	PipelineStats *pipelineStats)
+{
+	memset(capture, 0, sizeof(*capture));
+	capture->writer = writer;
+	capture->frameMonitor = frameMonitor;
+	capture->clockModel = clockModel;
+	capture->pipelineStats = pipelineStats;
+}
+
+int SurfaceCapture_Surface(SurfaceCapture *capture, const SurfaceCaptureFrame *frame, uint64_t callbackNs, int wait)
+{
+	SurfaceWriter *writer = capture->writer;
+	uint64_t copyNs = GoLog_MonotonicNs();
+	uint32_t width = frame->surfaceWidth;
+	SurfaceStatsSums statsSums;
+	SurfaceRecord *record;
+	uint32_t rowIdx;
+
+	capture->count++;
+
+	// Check for surfaces lost before reaching the callback
+	capture->lostSinceWritten += FrameMonitor_Surface(capture->frameMonitor, frame->frameIndex, frame->timeStamp);
+
+	// Map the sensor time stamp to host time (uses the callback time - no extra clock reads)
+	ClockModel_Update(capture->clockModel, frame->timeStamp, callbackNs);
+
+	// Get buffer for a copy of the surface - the source is not kept after the callback returns
+	while ((record = SurfaceWriter_NewRecord(writer, width, frame->surfaceLength)) == NULL && wait)
+	{
+		GoLog_SleepMs(1);
+	}
+	if (record == NULL)
+	{
+		capture->lostSinceWritten++;
+		return 0;
+	}
+
+	// Copy header information
+	record->receiveNs = callbackNs;
+	record->frameIndex = frame->frameIndex;
+	record->lostBefore = capture->lostSinceWritten;
+	record->count = capture->count;
+	record->timeStamp = frame->timeStamp;
+	record->captureHostNs = ClockModel_HostNs(capture->clockModel, frame->timeStamp);
+	record->captureWallNs = ClockModel_WallNs(capture->clockModel, frame->timeStamp);
+	record->xResolution = frame->xResolution;
+	record->yResolution = frame->yResolution;
+	record->zResolution = frame->zResolution;
+	record->xOffset = frame->xOffset;
+	record->yOffset = frame->yOffset;
+	record->zOffset = frame->zOffset;
+	record->frameRate = frame->frameRate;
+	record->exposureTime = frame->exposureTime;
+	GoLog_WallTime(&record->receiveTime);
+
+	// Copy each row of the surface, summing the valid heights on the way
+	SurfaceStats_Begin(&statsSums);
+	for (rowIdx = 0; rowIdx < frame->surfaceLength; rowIdx++)
+	{
+		SurfaceStats_CopyRow(record->data + (size_t)rowIdx * width, frame->rowAt(frame->source, rowIdx), width, &statsSums);
+	}
+	SurfaceStats_Finish(&statsSums, record);
+
+	// Hand surface over to writer thread (dropped if the writer is too far behind)
+	PipelineStats_Record(capture->pipelineStats, PIPELINE_STAGE_COPY, copyNs, GoLog_MonotonicNs());
+	while (wait && SpscQueue_Depth(&writer->queue) == writer->queue.capacity)
+	{
+		GoLog_SleepMs(1);
+	}
+	if (!SurfaceWriter_Submit(writer, record))
+	{
+		capture->lostSinceWritten++;
+		return 0;
+	}
+	capture->lostSinceWritten = 0;
+	return 1;
+}
@@ -0,0 +1,62 @@
+/*
+* SurfaceCapture.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Hand-off of each received surface from the data callback to the
+* writer thread (SurfaceWriter.h), shared by the logger and Tools/SurfaceReplay
+* so that a replay drives exactly the same steps: the frame index and time
+* stamp are checked for lost surfaces (FrameMonitor.h) and mapped to host time
+* (ClockModel.h), the surface is copied into a buffer from the writer's pool
+* with its summary statistics (SurfaceStats.h), and the record is submitted.
+* If no buffer is free or the queue is full the surface is dropped, and it is
+* counted in lostBefore of the next surface that reaches the writer.
+*
+* The rows of the surface are read through a function, so that the SDK message
+* is copied straight into the record without an intermediate buffer.
+*/
+
+#ifndef SURFACE_CAPTURE_H
+#define SURFACE_CAPTURE_H
+
+#include "SurfaceWriter.h"
+
+// One surface as received: stamp, header fields and rows
+typedef struct
+{
+	uint64_t timeStamp;					// Sensor time stamp (us)
+	uint64_t frameIndex;				// Sensor frame index
+	uint32_t surfaceWidth;
+	uint32_t surfaceLength;
+	double xResolution;					// mm
+	double yResolution;
+	double zResolution;
+	double xOffset;						// mm
+	double yOffset;
+	double zOffset;
+	double frameRate;					// Configured sensor frame rate (Hz)
+	double exposureTime;
+	const int16_t *(*rowAt)(const void *source, uint32_t row);	// Row of the surface
+	const void *source;
+}SurfaceCaptureFrame;
+
+// Hand-off state of one sensor, only used by the data callback
+typedef struct
+{
+	SurfaceWriter *writer;
+	FrameMonitor *frameMonitor;
+	ClockModel *clockModel;
+	PipelineStats *pipelineStats;
+	uint32_t count;						// Surfaces received (number of the last one)
+	uint32_t lostSinceWritten;			// Surfaces lost since the last surface handed to the writer
+}SurfaceCapture;
+
+void SurfaceCapture_Init(SurfaceCapture *capture, SurfaceWriter *writer, FrameMonitor *frameMonitor, ClockModel *clockModel,
+	PipelineStats *pipelineStats);
+
+// Hand frame over to the writer thread. callbackNs is when the data callback was called. With wait, wait for a
+// free buffer and queue slot instead of dropping the surface (replay as fast as the pipeline goes).
+// Returns 1 if the surface was submitted, 0 if it was dropped.
+int SurfaceCapture_Surface(SurfaceCapture *capture, const SurfaceCaptureFrame *frame, uint64_t callbackNs, int wait);
+
+#endif // SURFACE_CAPTURE_H
@@ -0,0 +1,53 @@
+/*
+* SurfaceChecksum.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: CRC32C checksums of surface files (VER0006, option -checksum), so
+* that surfaces damaged after writing (power loss, bad disks, copying) can be
+* found. The header carries a checksum of its own fields, checked whenever
+* the header is parsed, and a checksum of each chunk of the payload, checked
+* on request (SurfaceChecksum_Verify, Tools/SurfaceVerify) so that reading
+* surfaces costs nothing extra.
+*
+* The payload is divided into at most SURFACECHECKSUM_MAXCHUNKS chunks of at
+* least SURFACECHECKSUM_MINCHUNK bytes, so that the checksums fit in a fixed
+* size header, a damaged region can be located, and a long surface can be
+* verified on several threads. Overview levels stored with a surface in a
+* session container (-pyramid) each get a checksum of their own as well.
+* Checksums are computed with the SSE4.2 CRC32
+* instruction where available (several GB/s on one core), otherwise with a
+* table.
+*/
+
+#ifndef SURFACE_CHECKSUM_H
+#define SURFACE_CHECKSUM_H
+
+#include "SurfaceFormat.h"
+
+#define SURFACECHECKSUM_MINCHUNK	(256 * 1024)	// Smallest chunk of payload with its own checksum (bytes)
+
+// CRC32C (Castagnoli) of size bytes, continuing from the checksum of the bytes before (0 to start)
+uint32_t SurfaceChecksum_Crc32c(uint32_t crc, const void *data, size_t size);
+
+// Chunk size used for a payload of payloadSize bytes
+uint32_t SurfaceChecksum_ChunkSize(uint64_t payloadSize);
+
+// Number of chunks of a payload of payloadSize bytes, divided into chunks of chunkSize bytes
+uint32_t SurfaceChecksum_ChunkCount(uint64_t payloadSize, uint32_t chunkSize);
+
+// Divide the payload of record into chunks and set their checksums (checksumChunkSize, checksumChunkCount,
+// chunkChecksums). The header checksum is set when the header is encoded (SurfaceFormat.h).
+void SurfaceChecksum_Compute(SurfaceRecord *record);
+
+// Check chunk number chunk of the payload of record against its checksum. Returns 0 if it matches.
+int SurfaceChecksum_VerifyChunk(const SurfaceRecord *record, uint32_t chunk);
+
+// CRC32C of an overview level: its factor, width and length, then its samples
+uint32_t SurfaceChecksum_Level(const SurfacePyramidLevel *level);
+
+// Check the payload of record against its chunk checksums. Returns the number of chunks that do not
+// match (0 for records without checksums).
+uint32_t SurfaceChecksum_Verify(const SurfaceRecord *record);
+
+#endif // SURFACE_CHECKSUM_H
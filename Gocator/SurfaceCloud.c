@@ -0,0 +1,500 @@
+/*
+* SurfaceCloud.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Point cloud export of surfaces (see SurfaceCloud.h). The SIMD row
+* loops handle 4 (SSE2) or 8 (AVX2) samples per iteration; the remaining
+* samples are done in C.
+*/
+
+#include "SurfaceCloud.h"
+#include "GoLogSimd.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SURFACECLOUD_XYZLINESIZE	80		// Room for one XYZ text line
+
+// For each validity pattern of 8 samples (bit n = sample n is valid): the lanes of the valid samples
+// (3 bits each, in order) in bits 0-23 and the number of valid samples in bits 24-31
+static const uint32_t SurfaceCloud_compaction[256] =
+{
+	0x00000000, 0x01000000, 0x01000001, 0x02000008, 0x01000002, 0x02000010, 0x02000011, 0x03000088,
+	0x01000003, 0x02000018, 0x02000019, 0x030000C8, 0x0200001A, 0x030000D0, 0x030000D1, 0x04000688,
+	0x01000004, 0x02000020, 0x02000021, 0x03000108, 0x02000022, 0x03000110, 0x03000111, 0x04000888,
+	0x02000023, 0x03000118, 0x03000119, 0x040008C8, 0x0300011A, 0x040008D0, 0x040008D1, 0x05004688,
+	0x01000005, 0x02000028, 0x02000029, 0x03000148, 0x0200002A, 0x03000150, 0x03000151, 0x04000A88,
+	0x0200002B, 0x03000158, 0x03000159, 0x04000AC8, 0x0300015A, 0x04000AD0, 0x04000AD1, 0x05005688,
+	0x0200002C, 0x03000160, 0x03000161, 0x04000B08, 0x03000162, 0x04000B10, 0x04000B11, 0x05005888,
+	0x03000163, 0x04000B18, 0x04000B19, 0x050058C8, 0x04000B1A, 0x050058D0, 0x050058D1, 0x0602C688,
+	0x01000006, 0x02000030, 0x02000031, 0x03000188, 0x02000032, 0x03000190, 0x03000191, 0x04000C88,
+	0x02000033, 0x03000198, 0x03000199, 0x04000CC8, 0x0300019A, 0x04000CD0, 0x04000CD1, 0x05006688,
+	0x02000034, 0x030001A0, 0x030001A1, 0x04000D08, 0x030001A2, 0x04000D10, 0x04000D11, 0x05006888,
+	0x030001A3, 0x04000D18, 0x04000D19, 0x050068C8, 0x04000D1A, 0x050068D0, 0x050068D1, 0x06034688,
+	0x02000035, 0x030001A8, 0x030001A9, 0x04000D48, 0x030001AA, 0x04000D50, 0x04000D51, 0x05006A88,
+	0x030001AB, 0x04000D58, 0x04000D59, 0x05006AC8, 0x04000D5A, 0x05006AD0, 0x05006AD1, 0x06035688,
+	0x030001AC, 0x04000D60, 0x04000D61, 0x05006B08, 0x04000D62, 0x05006B10, 0x05006B11, 0x06035888,
+	0x04000D63, 0x05006B18, 0x05006B19, 0x060358C8, 0x05006B1A, 0x060358D0, 0x060358D1, 0x071AC688,
+	0x01000007, 0x02000038, 0x02000039, 0x030001C8, 0x0200003A, 0x030001D0, 0x030001D1, 0x04000E88,
+	0x0200003B, 0x030001D8, 0x030001D9, 0x04000EC8, 0x030001DA, 0x04000ED0, 0x04000ED1, 0x05007688,
+	0x0200003C, 0x030001E0, 0x030001E1, 0x04000F08, 0x030001E2, 0x04000F10, 0x04000F11, 0x05007888,
+	0x030001E3, 0x04000F18, 0x04000F19, 0x050078C8, 0x04000F1A, 0x050078D0, 0x050078D1, 0x0603C688,
+	0x0200003D, 0x030001E8, 0x030001E9, 0x04000F48, 0x030001EA, 0x04000F50, 0x04000F51, 0x05007A88,
+	0x030001EB, 0x04000F58, 0x04000F59, 0x05007AC8, 0x04000F5A, 0x05007AD0, 0x05007AD1, 0x0603D688,
+	0x030001EC, 0x04000F60, 0x04000F61, 0x05007B08, 0x04000F62, 0x05007B10, 0x05007B11, 0x0603D888,
+	0x04000F63, 0x05007B18, 0x05007B19, 0x0603D8C8, 0x05007B1A, 0x0603D8D0, 0x0603D8D1, 0x071EC688,
+	0x0200003E, 0x030001F0, 0x030001F1, 0x04000F88, 0x030001F2, 0x04000F90, 0x04000F91, 0x05007C88,
+	0x030001F3, 0x04000F98, 0x04000F99, 0x05007CC8, 0x04000F9A, 0x05007CD0, 0x05007CD1, 0x0603E688,
+	0x030001F4, 0x04000FA0, 0x04000FA1, 0x05007D08, 0x04000FA2, 0x05007D10, 0x05007D11, 0x0603E888,
+	0x04000FA3, 0x05007D18, 0x05007D19, 0x0603E8C8, 0x05007D1A, 0x0603E8D0, 0x0603E8D1, 0x071F4688,
+	0x030001F5, 0x04000FA8, 0x04000FA9, 0x05007D48, 0x04000FAA, 0x05007D50, 0x05007D51, 0x0603EA88,
+	0x04000FAB, 0x05007D58, 0x05007D59, 0x0603EAC8, 0x05007D5A, 0x0603EAD0, 0x0603EAD1, 0x071F5688,
+	0x04000FAC, 0x05007D60, 0x05007D61, 0x0603EB08, 0x05007D62, 0x0603EB10, 0x0603EB11, 0x071F5888,
+	0x05007D63, 0x0603EB18, 0x0603EB19, 0x071F58C8, 0x0603EB1A, 0x071F58D0, 0x071F58D1, 0x08FAC688
+};
+
+// Plain C version, starting at sample start. Returns the number of points.
+static uint32_t SurfaceCloud_RowScalar(const int16_t *heights, uint32_t start, uint32_t count, uint32_t column,
+	float x0, float xStep, float y0, float zOffset, float zResolution, float *points)
+{
+	uint32_t pointCount = 0;
+	uint32_t i;
+
+	for (i = start; i < count; i++)
+	{
+		if (heights[i] != INVALID_RANGE_16BIT)
+		{
+			points[0] = x0 + (float)(column + i) * xStep;
+			points[1] = y0;
+			points[2] = zOffset + (float)heights[i] * zResolution;
+			points += 3;
+			pointCount++;
+		}
+	}
+	return pointCount;
+}
+
+static uint64_t SurfaceCloud_CountInvalidScalar(const int16_t *heights, size_t start, size_t count)
+{
+	uint64_t invalidCount = 0;
+	size_t i;
+
+	for (i = start; i < count; i++)
+	{
+		invalidCount += heights[i] == INVALID_RANGE_16BIT;
+	}
+	return invalidCount;
+}
+
+#if GOLOG_X86
+
+// Interleave x, y and z of 4 points into x y z triplets
+static void SurfaceCloud_Interleave(__m128 x, __m128 y, __m128 z, float *points)
+{
+	__m128 xyLo = _mm_unpacklo_ps(x, y);		// x0 y x1 y
+	__m128 xyHi = _mm_unpackhi_ps(x, y);		// x2 y x3 y
+	__m128 yzLo = _mm_unpacklo_ps(y, z);		// y z0 y z1
+	__m128 yzHi = _mm_unpackhi_ps(y, z);		// y z2 y z3
+	__m128 zxLo = _mm_unpacklo_ps(z, x);		// z0 x0 z1 x1
+	__m128 zxHi = _mm_unpackhi_ps(z, x);		// z2 x2 z3 x3
+
+	_mm_storeu_ps(points, _mm_shuffle_ps(xyLo, zxLo, _MM_SHUFFLE(3, 0, 1, 0)));		// x0 y z0 x1
+	_mm_storeu_ps(points + 4, _mm_shuffle_ps(yzLo, xyHi, _MM_SHUFFLE(1, 0, 3, 2)));	// y z1 x2 y
+	_mm_storeu_ps(points + 8, _mm_shuffle_ps(zxHi, yzHi, _MM_SHUFFLE(3, 2, 3, 0)));	// z2 x3 y z3
+}
+
+// Groups of 4 samples that are all valid are written with shuffles, groups with some valid samples one by one.
+// Returns the number of samples done; the number of points is stored in pointCount.
+static uint32_t SurfaceCloud_RowSse2(const int16_t *heights, uint32_t count, uint32_t firstColumn, float x0, float xStep,
+	float y0, float zOffset, float zResolution, float *points, uint32_t *pointCount)
+{
+	const __m128i invalid16 = _mm_set1_epi16(INVALID_RANGE_16BIT);
+	const __m128i four = _mm_set1_epi32(4);
+	const __m128 xOffset = _mm_set1_ps(x0);
+	const __m128 step = _mm_set1_ps(xStep);
+	const __m128 y = _mm_set1_ps(y0);
+	const __m128 offset = _mm_set1_ps(zOffset);
+	const __m128 resolution = _mm_set1_ps(zResolution);
+	__m128i column = _mm_add_epi32(_mm_set1_epi32((int)firstColumn), _mm_setr_epi32(0, 1, 2, 3));
+	uint32_t n = 0;
+	uint32_t i;
+
+	for (i = 0; i + 4 <= count; i += 4, column = _mm_add_epi32(column, four))
+	{
+		__m128i h = _mm_loadl_epi64((const __m128i *)(heights + i));
+		__m128i invalid = _mm_cmpeq_epi16(h, invalid16);
+		uint32_t valid = ~(uint32_t)_mm_movemask_epi8(_mm_packs_epi16(invalid, invalid)) & 0xF;
+		__m128 x;
+		__m128 z;
+
+		if (valid == 0)
+		{
+			continue;
+		}
+		x = _mm_add_ps(xOffset, _mm_mul_ps(_mm_cvtepi32_ps(column), step));
+		z = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(h, h), 16));		// Sign extend to 32 bit
+		z = _mm_add_ps(offset, _mm_mul_ps(z, resolution));
+		if (valid == 0xF)
+		{
+			SurfaceCloud_Interleave(x, y, z, points + 3 * n);
+			n += 4;
+		}
+		else
+		{
+			float xs[4];
+			float zs[4];
+			int lane;
+
+			_mm_storeu_ps(xs, x);
+			_mm_storeu_ps(zs, z);
+			for (lane = 0; lane < 4; lane++)
+			{
+				if (valid & (1u << lane))
+				{
+					points[3 * n] = xs[lane];
+					points[3 * n + 1] = y0;
+					points[3 * n + 2] = zs[lane];
+					n++;
+				}
+			}
+		}
+	}
+	*pointCount = n;
+	return i;
+}
+
+// Returns the number of samples counted; invalid samples are added to invalidCount
+static size_t SurfaceCloud_CountInvalidSse2(const int16_t *heights, size_t count, uint64_t *invalidCount)
+{
+	const __m128i invalid16 = _mm_set1_epi16(INVALID_RANGE_16BIT);
+	const __m128i ones = _mm_set1_epi16(1);
+	size_t i = 0;
+
+	while (i + 8 <= count)
+	{
+		// 16 bit counts, added up before they can overflow
+		size_t end = (count - i > 8 * 32767) ? i + 8 * 32767 : count;
+		__m128i sums = _mm_setzero_si128();
+
+		for (; i + 8 <= end; i += 8)
+		{
+			sums = _mm_sub_epi16(sums, _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(heights + i)), invalid16));
+		}
+		sums = _mm_madd_epi16(sums, ones);
+		sums = _mm_add_epi32(sums, _mm_srli_si128(sums, 8));
+		sums = _mm_add_epi32(sums, _mm_srli_si128(sums, 4));
+		*invalidCount += (uint32_t)_mm_cvtsi128_si32(sums);
+	}
+	return i;
+}
+
+// Invalid samples are removed by permuting the valid ones to the front, so every group of 8 samples is written
+// with the same shuffles and the output advances by the number of valid samples.
+GOLOG_TARGET_AVX2
+static uint32_t SurfaceCloud_RowAvx2(const int16_t *heights, uint32_t count, uint32_t firstColumn, float x0, float xStep,
+	float y0, float zOffset, float zResolution, float *points, uint32_t *pointCount)
+{
+	const __m128i invalid16 = _mm_set1_epi16(INVALID_RANGE_16BIT);
+	const __m256i laneShifts = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+	const __m256i laneMask = _mm256_set1_epi32(7);
+	const __m256i eight = _mm256_set1_epi32(8);
+	const __m256 xOffset = _mm256_set1_ps(x0);
+	const __m256 step = _mm256_set1_ps(xStep);
+	const __m256 y = _mm256_set1_ps(y0);
+	const __m256 offset = _mm256_set1_ps(zOffset);
+	const __m256 resolution = _mm256_set1_ps(zResolution);
+	__m256i column = _mm256_add_epi32(_mm256_set1_epi32((int)firstColumn), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	uint32_t n = 0;
+	uint32_t i;
+
+	for (i = 0; i + 8 <= count; i += 8, column = _mm256_add_epi32(column, eight))
+	{
+		__m128i h = _mm_loadu_si128((const __m128i *)(heights + i));
+		__m128i invalid = _mm_cmpeq_epi16(h, invalid16);
+		uint32_t valid = ~(uint32_t)_mm_movemask_epi8(_mm_packs_epi16(invalid, invalid)) & 0xFF;
+		uint32_t compaction = SurfaceCloud_compaction[valid];
+		__m256 x;
+		__m256 z;
+		__m256 xyLo, xyHi, yzLo, yzHi, zxLo, zxHi;
+		__m256 out0, out1, out2;
+
+		if (valid == 0)
+		{
+			continue;
+		}
+		x = _mm256_add_ps(xOffset, _mm256_mul_ps(_mm256_cvtepi32_ps(column), step));
+		z = _mm256_add_ps(offset, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(h)), resolution));
+		if (valid != 0xFF)
+		{
+			__m256i permutation = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32((int)compaction), laneShifts), laneMask);
+
+			x = _mm256_permutevar8x32_ps(x, permutation);
+			z = _mm256_permutevar8x32_ps(z, permutation);
+		}
+
+		// Points 0-3 in the low and 4-7 in the high half, as in SurfaceCloud_Interleave
+		xyLo = _mm256_unpacklo_ps(x, y);
+		xyHi = _mm256_unpackhi_ps(x, y);
+		yzLo = _mm256_unpacklo_ps(y, z);
+		yzHi = _mm256_unpackhi_ps(y, z);
+		zxLo = _mm256_unpacklo_ps(z, x);
+		zxHi = _mm256_unpackhi_ps(z, x);
+		out0 = _mm256_shuffle_ps(xyLo, zxLo, _MM_SHUFFLE(3, 0, 1, 0));
+		out1 = _mm256_shuffle_ps(yzLo, xyHi, _MM_SHUFFLE(1, 0, 3, 2));
+		out2 = _mm256_shuffle_ps(zxHi, yzHi, _MM_SHUFFLE(3, 2, 3, 0));
+		_mm256_storeu_ps(points + 3 * n, _mm256_permute2f128_ps(out0, out1, 0x20));
+		_mm256_storeu_ps(points + 3 * n + 8, _mm256_permute2f128_ps(out2, out0, 0x30));
+		_mm256_storeu_ps(points + 3 * n + 16, _mm256_permute2f128_ps(out1, out2, 0x31));
+		n += compaction >> 24;
+	}
+	*pointCount = n;
+	return i;
+}
+
+GOLOG_TARGET_AVX2
+static size_t SurfaceCloud_CountInvalidAvx2(const int16_t *heights, size_t count, uint64_t *invalidCount)
+{
+	const __m256i invalid16 = _mm256_set1_epi16(INVALID_RANGE_16BIT);
+	const __m256i ones = _mm256_set1_epi16(1);
+	size_t i = 0;
+
+	while (i + 16 <= count)
+	{
+		size_t end = (count - i > 16 * 32767) ? i + 16 * 32767 : count;
+		__m256i sums = _mm256_setzero_si256();
+		__m128i total;
+
+		for (; i + 16 <= end; i += 16)
+		{
+			sums = _mm256_sub_epi16(sums, _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(heights + i)), invalid16));
+		}
+		sums = _mm256_madd_epi16(sums, ones);
+		total = _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+		total = _mm_add_epi32(total, _mm_srli_si128(total, 8));
+		total = _mm_add_epi32(total, _mm_srli_si128(total, 4));
+		*invalidCount += (uint32_t)_mm_cvtsi128_si32(total);
+	}
+	return i;
+}
+
+#endif
+
+uint64_t SurfaceCloud_CountValid(const int16_t *heights, size_t count)
+{
+	uint64_t invalidCount = 0;
+	size_t done = 0;
+
+#if GOLOG_X86
+	switch (GoLogSimd_Level())
+	{
+		case GOLOG_SIMD_AVX2:
+			done = SurfaceCloud_CountInvalidAvx2(heights, count, &invalidCount);
+			break;
+		case GOLOG_SIMD_SSE2:
+			done = SurfaceCloud_CountInvalidSse2(heights, count, &invalidCount);
+			break;
+		default:
+			break;
+	}
+#endif
+	invalidCount += SurfaceCloud_CountInvalidScalar(heights, done, count);
+	return count - invalidCount;
+}
+
+uint32_t SurfaceCloud_Row(const int16_t *heights, uint32_t count, uint32_t column, float x0, float xStep, float y0,
+	float zOffset, float zResolution, float *points)
+{
+	uint32_t pointCount = 0;
+	uint32_t done = 0;
+
+#if GOLOG_X86
+	switch (GoLogSimd_Level())
+	{
+		case GOLOG_SIMD_AVX2:
+			done = SurfaceCloud_RowAvx2(heights, count, column, x0, xStep, y0, zOffset, zResolution, points, &pointCount);
+			break;
+		case GOLOG_SIMD_SSE2:
+			done = SurfaceCloud_RowSse2(heights, count, column, x0, xStep, y0, zOffset, zResolution, points, &pointCount);
+			break;
+		default:
+			break;
+	}
+#endif
+	return pointCount + SurfaceCloud_RowScalar(heights, done, count, column, x0, xStep, y0, zOffset, zResolution,
+		points + 3 * (size_t)pointCount);
+}
+
+// Write value with SURFACECLOUD_XYZDECIMALS decimals. Returns the number of characters.
+static int SurfaceCloud_FormatFixed(char *text, float value)
+{
+	double scaled = (double)value * 10000.0;
+	uint64_t fixed;
+	char digits[24];
+	int digitCount = 0;
+	int length = 0;
+
+	if (!(fabs(scaled) < 1e18))
+	{
+		return sprintf(text, "%.4f", value);
+	}
+	if (scaled < 0)
+	{
+		scaled = -scaled;
+		text[length++] = '-';
+	}
+	fixed = (uint64_t)(scaled + 0.5);
+	do
+	{
+		digits[digitCount++] = (char)('0' + fixed % 10);
+		fixed /= 10;
+	}
+	while (fixed != 0 || digitCount <= SURFACECLOUD_XYZDECIMALS);
+	while (digitCount > SURFACECLOUD_XYZDECIMALS)
+	{
+		text[length++] = digits[--digitCount];
+	}
+	text[length++] = '.';
+	while (digitCount > 0)
+	{
+		text[length++] = digits[--digitCount];
+	}
+	return length;
+}
+
+// Write the buffered points. Returns 0 on success.
+static int SurfaceCloudWriter_Flush(SurfaceCloudWriter *writer)
+{
+	uint32_t i;
+
+	if (writer->written + writer->bufferCount > writer->pointCount)
+	{
+		return -1;
+	}
+	if (writer->format == SURFACECLOUD_XYZ)
+	{
+		char *line = writer->text;
+
+		for (i = 0; i < writer->bufferCount; i++)
+		{
+			const float *point = writer->points + 3 * (size_t)i;
+
+			line += SurfaceCloud_FormatFixed(line, point[0]);
+			*line++ = ' ';
+			line += SurfaceCloud_FormatFixed(line, point[1]);
+			*line++ = ' ';
+			line += SurfaceCloud_FormatFixed(line, point[2]);
+			*line++ = '\n';
+		}
+		if (fwrite(writer->text, 1, (size_t)(line - writer->text), writer->fptr) != (size_t)(line - writer->text))
+		{
+			return -1;
+		}
+	}
+	else if (fwrite(writer->points, 3 * sizeof(float), writer->bufferCount, writer->fptr) != writer->bufferCount)
+	{
+		return -1;
+	}
+	writer->written += writer->bufferCount;
+	writer->bufferCount = 0;
+	return 0;
+}
+
+int SurfaceCloudWriter_Begin(SurfaceCloudWriter *writer, FILE *fptr, SurfaceCloudFormat format, uint64_t pointCount,
+	uint32_t maxRowWidth)
+{
+	unsigned long long points = (unsigned long long)pointCount;
+	int result = 0;
+
+	memset(writer, 0, sizeof(*writer));
+	writer->fptr = fptr;
+	writer->format = format;
+	writer->pointCount = pointCount;
+	writer->capacity = SURFACECLOUD_BUFFERPOINTS + maxRowWidth + SURFACECLOUD_SLACK;
+	writer->points = (float *)malloc(3 * sizeof(float) * (size_t)writer->capacity);
+	if (format == SURFACECLOUD_XYZ)
+	{
+		writer->text = (char *)malloc(SURFACECLOUD_XYZLINESIZE * (size_t)writer->capacity);
+	}
+	if (writer->points == NULL || (format == SURFACECLOUD_XYZ && writer->text == NULL))
+	{
+		free(writer->points);
+		free(writer->text);
+		writer->points = NULL;
+		writer->text = NULL;
+		return -1;
+	}
+
+	if (format == SURFACECLOUD_PLY)
+	{
+		result = fprintf(fptr, "ply\nformat binary_little_endian 1.0\nelement vertex %llu\n"
+			"property float x\nproperty float y\nproperty float z\nend_header\n", points);
+	}
+	else if (format == SURFACECLOUD_PCD)
+	{
+		result = fprintf(fptr, "# .PCD v0.7 - Point Cloud Data file format\nVERSION 0.7\nFIELDS x y z\nSIZE 4 4 4\n"
+			"TYPE F F F\nCOUNT 1 1 1\nWIDTH %llu\nHEIGHT 1\nVIEWPOINT 0 0 0 1 0 0 0\nPOINTS %llu\nDATA binary\n",
+			points, points);
+	}
+	return (result < 0) ? -1 : 0;
+}
+
+int SurfaceCloudWriter_Rows(SurfaceCloudWriter *writer, const SurfaceRecord *record, const int16_t *heights,
+	uint32_t width, uint32_t rowCount, uint32_t column, uint32_t row)
+{
+	uint32_t i;
+
+	if (writer->points == NULL || width + SURFACECLOUD_SLACK > writer->capacity - SURFACECLOUD_BUFFERPOINTS)
+	{
+		return -1;
+	}
+	for (i = 0; i < rowCount; i++)
+	{
+		if (writer->bufferCount + width + SURFACECLOUD_SLACK > writer->capacity && SurfaceCloudWriter_Flush(writer) != 0)
+		{
+			return -1;
+		}
+		writer->bufferCount += SurfaceCloud_Row(heights + (size_t)i * width, width, column, (float)record->xOffset,
+			(float)record->xResolution, (float)(record->yOffset + (double)(row + i) * record->yResolution),
+			(float)record->zOffset, (float)record->zResolution,
+			writer->points + 3 * (size_t)writer->bufferCount);
+	}
+	return 0;
+}
+
+int SurfaceCloudWriter_End(SurfaceCloudWriter *writer)
+{
+	int result = 0;
+
+	if (writer->points == NULL)
+	{
+		return -1;
+	}
+	if (writer->bufferCount > 0 && SurfaceCloudWriter_Flush(writer) != 0)
+	{
+		result = -1;
+	}
+	if (writer->written != writer->pointCount)
+	{
+		result = -1;
+	}
+	free(writer->points);
+	free(writer->text);
+	writer->points = NULL;
+	writer->text = NULL;
+	return result;
+}
+
+const char *SurfaceCloud_Extension(SurfaceCloudFormat format)
+{
+	switch (format)
+	{
+		case SURFACECLOUD_PCD:
+			return "pcd";
+		case SURFACECLOUD_XYZ:
+			return "xyz";
+		default:
+			return "ply";
+	}
+}
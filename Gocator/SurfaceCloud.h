@@ -0,0 +1,82 @@
+/*
+* SurfaceCloud.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Export of surfaces as point clouds (binary PLY, binary PCD or XYZ
+* text), streamed row by row so that the cloud is never held in memory:
+*	X = XOffset + (cropColumn + column) * XResolution
+*	Y = YOffset + (cropRow + row) * YResolution
+*	Z = ZOffset + height * ZResolution
+* with invalid samples (INVALID_RANGE_16BIT) left out.
+*
+* SurfaceCloud_Row makes the points of one row as float triplets in a single
+* pass: X and Z of 8 samples at a time with SIMD, invalid samples removed by
+* a permutation from a table of the 256 validity patterns (AVX2), and the
+* coordinates interleaved with shuffles. The SSE2 version writes groups of 4
+* samples that are all valid with shuffles, and the others one by one. All
+* versions use the same single precision operations, so they agree exactly
+* with the plain C version.
+*
+* The number of points is written in the PLY and PCD headers, so it must be
+* known before the points: count it with SurfaceCloud_CountValid (a compare
+* and count at memory speed), then write the rows with SurfaceCloudWriter.
+* Binary files are little endian, as written by x86 hosts.
+*/
+
+#ifndef SURFACE_CLOUD_H
+#define SURFACE_CLOUD_H
+
+#include "SurfaceFormat.h"
+
+#define SURFACECLOUD_SLACK			8		// Points written beyond the valid points of a row by SurfaceCloud_Row
+#define SURFACECLOUD_BUFFERPOINTS	65536	// Points buffered by the writer between writes
+#define SURFACECLOUD_XYZDECIMALS	4		// Decimals of the coordinates in XYZ text files
+
+typedef enum
+{
+	SURFACECLOUD_PLY,						// Binary little endian PLY, float x y z vertices
+	SURFACECLOUD_PCD,						// Binary PCD v0.7, float x y z fields, unorganized
+	SURFACECLOUD_XYZ						// Text, one "x y z" line per point
+}SurfaceCloudFormat;
+
+typedef struct
+{
+	FILE *fptr;
+	SurfaceCloudFormat format;
+	uint64_t pointCount;					// Points declared in the header
+	uint64_t written;						// Points written so far
+	float *points;							// Buffered points, x y z
+	uint32_t bufferCount;
+	uint32_t capacity;						// Points in buffer, with room for a row and SURFACECLOUD_SLACK
+	char *text;								// XYZ lines of the buffered points
+}SurfaceCloudWriter;
+
+// Number of samples of count heights that are valid
+uint64_t SurfaceCloud_CountValid(const int16_t *heights, size_t count);
+
+// Points (x, y, z float triplets) of the valid samples of count heights starting at column, with
+// x = x0 + (column + i) * xStep for sample i, y = y0 and z = zOffset + height * zResolution, in column order.
+// points must have room for count + SURFACECLOUD_SLACK points. Returns the number of points.
+uint32_t SurfaceCloud_Row(const int16_t *heights, uint32_t count, uint32_t column, float x0, float xStep, float y0,
+	float zOffset, float zResolution, float *points);
+
+// Start a cloud of pointCount points in fptr, for rows of at most maxRowWidth samples. Returns 0 on success.
+int SurfaceCloudWriter_Begin(SurfaceCloudWriter *writer, FILE *fptr, SurfaceCloudFormat format, uint64_t pointCount,
+	uint32_t maxRowWidth);
+
+// Add the valid samples of rowCount rows of width heights (row by row), with the offsets and resolutions of
+// record. The first sample is at column and row of the full surface (including cropColumn and cropRow), so
+// that the coordinates do not depend on how the surface was cropped or which region is exported. Returns 0
+// on success.
+int SurfaceCloudWriter_Rows(SurfaceCloudWriter *writer, const SurfaceRecord *record, const int16_t *heights,
+	uint32_t width, uint32_t rowCount, uint32_t column, uint32_t row);
+
+// Write the remaining points and free the buffers. Returns 0 if all points were written and their number
+// matches the header.
+int SurfaceCloudWriter_End(SurfaceCloudWriter *writer);
+
+// File name extension of format (without dot)
+const char *SurfaceCloud_Extension(SurfaceCloudFormat format);
+
+#endif // SURFACE_CLOUD_H
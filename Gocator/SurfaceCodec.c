@@ -0,0 +1,370 @@
+/*
+* SurfaceCodec.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Lossless MED / Golomb-Rice codec for k16s height maps (see SurfaceCodec.h).
+* Bits are written MSB first. Encoder and decoder must make identical
+* prediction and context decisions, so both use the same helper functions
+* operating on already coded samples only.
+*/
+
+#include "SurfaceCodec.h"
+#include "SurfaceFormat.h"
+#include <stdlib.h>
+
+#define CODEC_RESIDUAL_CONTEXTS		17		// 16 activity classes + 1 for incomplete neighbourhoods
+#define CODEC_DEGRADED_CONTEXT		16
+#define CODEC_RUN_INVALID			0
+#define CODEC_RUN_VALID				1
+#define CODEC_RESET					64		// Halve context statistics when count reaches this
+#define CODEC_UNARY_LIMIT			24		// Longer unary codes are escaped
+#define CODEC_RESIDUAL_ESCAPE_BITS	17		// Zigzag residual of two k16s values fits in 17 bits
+#define CODEC_RUN_ESCAPE_BITS		32
+
+// Adaptive Golomb-Rice parameter state (LOCO-I style)
+typedef struct
+{
+	uint32_t sum;						// Sum of coded values
+	uint32_t count;						// Number of coded values
+}CodecContext;
+
+typedef struct
+{
+	uint8_t *output;
+	size_t position;
+	size_t capacity;
+	uint64_t accumulator;
+	int bits;							// Bits waiting in accumulator
+	int overflow;
+}BitWriter;
+
+typedef struct
+{
+	const uint8_t *input;
+	size_t position;
+	size_t size;
+	uint64_t accumulator;
+	int bits;
+	int overrun;						// Read past end of input
+}BitReader;
+
+static void CodecContext_Init(CodecContext *contexts, int count)
+{
+	int i;
+	for (i = 0; i < count; i++)
+	{
+		contexts[i].sum = 16;
+		contexts[i].count = 1;
+	}
+}
+
+static int CodecContext_RiceParameter(const CodecContext *context)
+{
+	int k = 0;
+	while (((uint64_t)context->count << k) < context->sum && k < 30)
+	{
+		k++;
+	}
+	return k;
+}
+
+static void CodecContext_Update(CodecContext *context, uint32_t value)
+{
+	context->sum += value;
+	context->count++;
+	if (context->count >= CODEC_RESET)
+	{
+		context->sum >>= 1;
+		context->count >>= 1;
+	}
+}
+
+static void BitWriter_Put(BitWriter *writer, uint32_t value, int bitCount)
+{
+	writer->accumulator = (writer->accumulator << bitCount) | value;
+	writer->bits += bitCount;
+	while (writer->bits >= 8)
+	{
+		writer->bits -= 8;
+		if (writer->position < writer->capacity)
+		{
+			writer->output[writer->position++] = (uint8_t)(writer->accumulator >> writer->bits);
+		}
+		else
+		{
+			writer->overflow = 1;
+		}
+	}
+}
+
+static void BitWriter_Flush(BitWriter *writer)
+{
+	if (writer->bits > 0)
+	{
+		BitWriter_Put(writer, 0, 8 - writer->bits);
+	}
+}
+
+// Golomb-Rice code with parameter k, escaped to escapeBits raw bits for large values
+static void BitWriter_PutRice(BitWriter *writer, uint32_t value, int k, int escapeBits)
+{
+	uint32_t quotient = value >> k;
+
+	if (quotient < CODEC_UNARY_LIMIT)
+	{
+		BitWriter_Put(writer, 1, (int)quotient + 1);				// quotient zeros followed by a one
+		if (k > 0)
+		{
+			BitWriter_Put(writer, value & ((1u << k) - 1), k);
+		}
+	}
+	else
+	{
+		BitWriter_Put(writer, 1, CODEC_UNARY_LIMIT + 1);
+		if (escapeBits > 16)
+		{
+			BitWriter_Put(writer, value >> 16, escapeBits - 16);
+			BitWriter_Put(writer, value & 0xFFFF, 16);
+		}
+		else
+		{
+			BitWriter_Put(writer, value, escapeBits);
+		}
+	}
+}
+
+static uint32_t BitReader_Get(BitReader *reader, int bitCount)
+{
+	while (reader->bits < bitCount)
+	{
+		uint8_t byte = 0;
+		if (reader->position < reader->size)
+		{
+			byte = reader->input[reader->position++];
+		}
+		else
+		{
+			reader->overrun = 1;
+		}
+		reader->accumulator = (reader->accumulator << 8) | byte;
+		reader->bits += 8;
+	}
+	reader->bits -= bitCount;
+	return (uint32_t)(reader->accumulator >> reader->bits) & (uint32_t)((1ull << bitCount) - 1);
+}
+
+static uint32_t BitReader_GetRice(BitReader *reader, int k, int escapeBits)
+{
+	uint32_t quotient = 0;
+
+	while (BitReader_Get(reader, 1) == 0)
+	{
+		if (++quotient > CODEC_UNARY_LIMIT || reader->overrun)
+		{
+			reader->overrun = 1;
+			return 0;
+		}
+	}
+
+	if (quotient == CODEC_UNARY_LIMIT)
+	{
+		if (escapeBits > 16)
+		{
+			uint32_t high = BitReader_Get(reader, escapeBits - 16);
+			return (high << 16) | BitReader_Get(reader, 16);
+		}
+		return BitReader_Get(reader, escapeBits);
+	}
+	return (k > 0) ? (quotient << k) | BitReader_Get(reader, k) : quotient;
+}
+
+// Predict sample at column col from already coded samples; also select residual context
+static int32_t Codec_Predict(const int16_t *row, const int16_t *above, uint32_t col, int32_t lastValid, int *context)
+{
+	int aValid = col > 0 && row[col - 1] != INVALID_RANGE_16BIT;
+	int bValid = above != NULL && above[col] != INVALID_RANGE_16BIT;
+	int cValid = above != NULL && col > 0 && above[col - 1] != INVALID_RANGE_16BIT;
+
+	if (aValid && bValid && cValid)
+	{
+		int32_t a = row[col - 1];
+		int32_t b = above[col];
+		int32_t c = above[col - 1];
+		int32_t minAB = a < b ? a : b;
+		int32_t maxAB = a < b ? b : a;
+		uint32_t activity = (uint32_t)abs(a - c) + (uint32_t)abs(b - c);
+		int activityClass = 0;
+
+		while (activity > 0 && activityClass < CODEC_DEGRADED_CONTEXT - 1)
+		{
+			activity >>= 1;
+			activityClass++;
+		}
+		*context = activityClass;
+
+		// Median edge detector
+		if (c >= maxAB)
+		{
+			return minAB;
+		}
+		if (c <= minAB)
+		{
+			return maxAB;
+		}
+		return a + b - c;
+	}
+
+	*context = CODEC_DEGRADED_CONTEXT;
+	if (aValid && bValid)
+	{
+		return (row[col - 1] + above[col]) >> 1;
+	}
+	if (aValid)
+	{
+		return row[col - 1];
+	}
+	if (bValid)
+	{
+		return above[col];
+	}
+	return lastValid;
+}
+
+int SurfaceCodec_Encode(const int16_t *data, uint32_t width, uint32_t rows,
+	uint8_t *output, size_t capacity, size_t *outputSize)
+{
+	CodecContext residualContexts[CODEC_RESIDUAL_CONTEXTS];
+	CodecContext runContexts[2];
+	BitWriter writer = { 0 };
+	int32_t lastValid = 0;
+	uint32_t rowIdx;
+
+	writer.output = output;
+	writer.capacity = capacity;
+	CodecContext_Init(residualContexts, CODEC_RESIDUAL_CONTEXTS);
+	CodecContext_Init(runContexts, 2);
+
+	for (rowIdx = 0; rowIdx < rows && !writer.overflow; rowIdx++)
+	{
+		const int16_t *row = data + (size_t)rowIdx * width;
+		const int16_t *above = rowIdx > 0 ? row - width : NULL;
+		uint32_t col = 0;
+
+		while (col < width)
+		{
+			uint32_t runStart = col;
+			uint32_t runLength;
+
+			// Run of invalid samples (may be empty)
+			while (col < width && row[col] == INVALID_RANGE_16BIT)
+			{
+				col++;
+			}
+			runLength = col - runStart;
+			BitWriter_PutRice(&writer, runLength, CodecContext_RiceParameter(&runContexts[CODEC_RUN_INVALID]), CODEC_RUN_ESCAPE_BITS);
+			CodecContext_Update(&runContexts[CODEC_RUN_INVALID], runLength);
+			if (col == width)
+			{
+				break;
+			}
+
+			// Run of valid samples (at least one)
+			runStart = col;
+			while (col < width && row[col] != INVALID_RANGE_16BIT)
+			{
+				col++;
+			}
+			runLength = col - runStart;
+			BitWriter_PutRice(&writer, runLength - 1, CodecContext_RiceParameter(&runContexts[CODEC_RUN_VALID]), CODEC_RUN_ESCAPE_BITS);
+			CodecContext_Update(&runContexts[CODEC_RUN_VALID], runLength - 1);
+
+			for (; runStart < col; runStart++)
+			{
+				int context;
+				int32_t prediction = Codec_Predict(row, above, runStart, lastValid, &context);
+				int32_t residual = row[runStart] - prediction;
+				uint32_t mapped = ((uint32_t)residual << 1) ^ (uint32_t)(residual >> 31);		// Zigzag: 0, -1, 1, -2, ...
+
+				BitWriter_PutRice(&writer, mapped, CodecContext_RiceParameter(&residualContexts[context]), CODEC_RESIDUAL_ESCAPE_BITS);
+				CodecContext_Update(&residualContexts[context], mapped);
+				lastValid = row[runStart];
+			}
+		}
+	}
+
+	BitWriter_Flush(&writer);
+	if (writer.overflow)
+	{
+		return -1;
+	}
+	*outputSize = writer.position;
+	return 0;
+}
+
+int SurfaceCodec_Decode(const uint8_t *input, size_t inputSize, uint32_t width, uint32_t rows, int16_t *data)
+{
+	CodecContext residualContexts[CODEC_RESIDUAL_CONTEXTS];
+	CodecContext runContexts[2];
+	BitReader reader = { 0 };
+	int32_t lastValid = 0;
+	uint32_t rowIdx;
+
+	reader.input = input;
+	reader.size = inputSize;
+	CodecContext_Init(residualContexts, CODEC_RESIDUAL_CONTEXTS);
+	CodecContext_Init(runContexts, 2);
+
+	for (rowIdx = 0; rowIdx < rows; rowIdx++)
+	{
+		int16_t *row = data + (size_t)rowIdx * width;
+		const int16_t *above = rowIdx > 0 ? row - width : NULL;
+		uint32_t col = 0;
+
+		while (col < width)
+		{
+			uint32_t runLength;
+			uint32_t runEnd;
+
+			runLength = BitReader_GetRice(&reader, CodecContext_RiceParameter(&runContexts[CODEC_RUN_INVALID]), CODEC_RUN_ESCAPE_BITS);
+			CodecContext_Update(&runContexts[CODEC_RUN_INVALID], runLength);
+			if (reader.overrun || runLength > width - col)
+			{
+				return -1;
+			}
+			for (runEnd = col + runLength; col < runEnd; col++)
+			{
+				row[col] = INVALID_RANGE_16BIT;
+			}
+			if (col == width)
+			{
+				break;
+			}
+
+			runLength = BitReader_GetRice(&reader, CodecContext_RiceParameter(&runContexts[CODEC_RUN_VALID]), CODEC_RUN_ESCAPE_BITS);
+			CodecContext_Update(&runContexts[CODEC_RUN_VALID], runLength);
+			if (reader.overrun || runLength >= width - col)
+			{
+				return -1;
+			}
+
+			for (runEnd = col + runLength + 1; col < runEnd; col++)
+			{
+				int context;
+				int32_t prediction = Codec_Predict(row, above, col, lastValid, &context);
+				uint32_t mapped = BitReader_GetRice(&reader, CodecContext_RiceParameter(&residualContexts[context]), CODEC_RESIDUAL_ESCAPE_BITS);
+				int32_t residual = (int32_t)(mapped >> 1) ^ -(int32_t)(mapped & 1);
+				int32_t value = prediction + residual;
+
+				CodecContext_Update(&residualContexts[context], mapped);
+				if (reader.overrun || value < -32767 || value > 32767)
+				{
+					return -1;
+				}
+				row[col] = (int16_t)value;
+				lastValid = value;
+			}
+		}
+	}
+	return reader.overrun ? -1 : 0;
+}
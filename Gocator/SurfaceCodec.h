@@ -0,0 +1,37 @@
+/*
+* SurfaceCodec.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Lossless codec for Gocator k16s height maps.
+*
+* Each row is coded as alternating runs of invalid (INVALID_RANGE_16BIT) and
+* valid samples. Run lengths are Golomb-Rice coded, so invalid borders and
+* holes cost a few bits per row. Valid samples are predicted from their left,
+* upper and upper-left neighbours with the LOCO-I / JPEG-LS median edge
+* detector (MED); the prediction residual is Golomb-Rice coded with a
+* parameter that adapts per context (local gradient activity), as in LOCO-I.
+* Neighbours that are invalid are replaced by the nearest valid one.
+*
+* The encoder never produces more bytes than the raw surface: if the encoded
+* size would exceed the given capacity, encoding fails and the surface should
+* be stored raw.
+*/
+
+#ifndef SURFACE_CODEC_H
+#define SURFACE_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SURFACECODEC_RAW		0		// Rows stored as raw k16s
+#define SURFACECODEC_MEDRICE	1		// MED prediction + adaptive Golomb-Rice coding (this codec)
+
+// Encode width x rows samples. Returns 0 on success, -1 if output would exceed capacity.
+int SurfaceCodec_Encode(const int16_t *data, uint32_t width, uint32_t rows,
+	uint8_t *output, size_t capacity, size_t *outputSize);
+
+// Decode width x rows samples from inputSize bytes. Returns 0 on success, -1 on corrupt input.
+int SurfaceCodec_Decode(const uint8_t *input, size_t inputSize, uint32_t width, uint32_t rows, int16_t *data);
+
+#endif // SURFACE_CODEC_H
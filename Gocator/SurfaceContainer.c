@@ -0,0 +1,302 @@
+/*
+* SurfaceContainer.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Session container sink (see SurfaceContainer.h for the file format).
+* The index is kept in memory and written when a container file is closed.
+* After a failed write the position in the file is no longer known, so the
+* file is closed without index (readers then walk its complete records) and
+* the session continues in the next file.
+*/
+
+#include "SurfaceContainer.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define CONTAINER_STREAM_BUFFER_SIZE	(4 * 1024 * 1024)
+
+typedef struct
+{
+	uint64_t recordOffset;
+	uint64_t timeStamp;
+	uint32_t count;
+	uint32_t surfaceWidth;
+	uint32_t surfaceLength;
+	uint32_t lostBefore;
+	uint64_t frameIndex;
+}SurfaceContainerIndexEntry;
+
+typedef struct
+{
+	SurfaceSink base;
+	char rootFolder[1024];
+	SurfaceContainerOptions options;
+
+	// Current container file
+	FILE *fptr;
+	char filename[1024];
+	char *streamBuffer;
+	uint32_t sequenceNumber;
+	uint64_t offset;					// Bytes written to current file
+	uint64_t openTimeNs;				// Monotonic time when current file was opened
+
+	// Index of current file
+	SurfaceContainerIndexEntry *index;
+	size_t indexCount;
+	size_t indexCapacity;
+}SurfaceContainer;
+
+static int SurfaceContainer_OpenFile(SurfaceContainer *container)
+{
+	GoLogWallTime str_t;
+	uint32_t reserved[3] = { 0, 0, 0 };
+
+	GoLog_WallTime(&str_t);
+	if (snprintf(container->filename, sizeof container->filename, "%s%04d-%02d-%02d_%02d%02d%02d_%03u_%s",
+		container->rootFolder,
+		str_t.year, str_t.month, str_t.day, str_t.hour, str_t.minute, str_t.second,
+		container->sequenceNumber, SESSIONFILENAMESUFFIX) >= (int)sizeof container->filename)
+	{
+		printf("Error: session file name too long in folder %s\n", container->rootFolder);
+		return -1;
+	}
+
+	if ((container->fptr = fopen(container->filename, "wb")) == NULL)
+	{
+		printf("Error opening file %s\n", container->filename);
+		return -1;
+	}
+	setvbuf(container->fptr, container->streamBuffer, _IOFBF, CONTAINER_STREAM_BUFFER_SIZE);
+
+	fwrite(CONTAINERHEADERTEXT, HEADERTEXTSIZE, 1, container->fptr);
+	fwrite(&container->sequenceNumber, sizeof(container->sequenceNumber), 1, container->fptr);
+	if (fwrite(reserved, sizeof(reserved), 1, container->fptr) != 1)
+	{
+		fclose(container->fptr);
+		container->fptr = NULL;
+		return -1;
+	}
+
+	container->offset = CONTAINERHEADERSIZE;
+	container->openTimeNs = GoLog_MonotonicNs();
+	container->indexCount = 0;
+	printf("Session file opened: %s\n", container->filename);
+	return 0;
+}
+
+// Write index and footer, and close current file
+static int SurfaceContainer_CloseFile(SurfaceContainer *container)
+{
+	uint32_t entrySize = CONTAINERINDEXENTRYSIZE;
+	uint64_t entryCount = container->indexCount;
+	uint64_t indexOffset = container->offset;
+	int result = 0;
+
+	fwrite(CONTAINERINDEXTAG, 4, 1, container->fptr);
+	fwrite(&entrySize, sizeof(entrySize), 1, container->fptr);
+	fwrite(&entryCount, sizeof(entryCount), 1, container->fptr);
+	if (entryCount > 0 && fwrite(container->index, sizeof(SurfaceContainerIndexEntry), (size_t)entryCount, container->fptr) != entryCount)
+	{
+		result = -1;
+	}
+	fwrite(&indexOffset, sizeof(indexOffset), 1, container->fptr);
+	fwrite(&entryCount, sizeof(entryCount), 1, container->fptr);
+	if (fwrite(CONTAINERFOOTERTAG, 8, 1, container->fptr) != 1)
+	{
+		result = -1;
+	}
+
+	if (fclose(container->fptr) != 0)
+	{
+		result = -1;
+	}
+	container->fptr = NULL;
+	printf("Session file closed: %s (%llu surfaces, %.1f MB)\n", container->filename,
+		(unsigned long long)entryCount, container->offset / (1024.0 * 1024.0));
+	return result;
+}
+
+// Close current file after a failed write, without index: its offsets may no longer match the file
+static void SurfaceContainer_AbandonFile(SurfaceContainer *container)
+{
+	fclose(container->fptr);
+	container->fptr = NULL;
+	printf("WARNING: Session file %s closed without index after a write error (%llu complete surfaces)\n",
+		container->filename, (unsigned long long)container->indexCount);
+	container->sequenceNumber++;
+}
+
+static int SurfaceContainer_AddIndexEntry(SurfaceContainer *container, const SurfaceRecord *record, uint64_t recordOffset)
+{
+	SurfaceContainerIndexEntry *entry;
+
+	if (container->indexCount == container->indexCapacity)
+	{
+		size_t capacity = container->indexCapacity ? 2 * container->indexCapacity : 1024;
+		SurfaceContainerIndexEntry *index = realloc(container->index, capacity * sizeof(SurfaceContainerIndexEntry));
+		if (index == NULL)
+		{
+			return -1;
+		}
+		container->index = index;
+		container->indexCapacity = capacity;
+	}
+
+	entry = &container->index[container->indexCount++];
+	entry->recordOffset = recordOffset;
+	entry->timeStamp = record->timeStamp;
+	entry->count = record->count;
+	entry->surfaceWidth = record->surfaceWidth;
+	entry->surfaceLength = record->surfaceLength;
+	entry->lostBefore = record->lostBefore;
+	entry->frameIndex = record->frameIndex;
+	return 0;
+}
+
+// Write overview levels of record after its surface record. Returns 0 on success; offset is only advanced then.
+static int SurfaceContainer_WritePyramid(SurfaceContainer *container, const SurfacePyramid *pyramid)
+{
+	uint64_t recordSize = (uint64_t)pyramid->levelCount * CONTAINERPYRAMIDLEVELSIZE;
+	uint64_t zeros = 0;
+	uint32_t level;
+	int result = 0;
+
+	for (level = 0; level < pyramid->levelCount; level++)
+	{
+		uint64_t levelBytes = (uint64_t)pyramid->levels[level].width * pyramid->levels[level].length * sizeof(int16_t);
+		recordSize += (levelBytes + CONTAINERRECORDALIGNMENT - 1) & ~(uint64_t)(CONTAINERRECORDALIGNMENT - 1);
+	}
+
+	if (fwrite(CONTAINERPYRAMIDTAG, 4, 1, container->fptr) != 1 ||
+		fwrite(&pyramid->levelCount, sizeof(pyramid->levelCount), 1, container->fptr) != 1 ||
+		fwrite(&recordSize, sizeof(recordSize), 1, container->fptr) != 1)
+	{
+		return -1;
+	}
+	for (level = 0; level < pyramid->levelCount && result == 0; level++)
+	{
+		uint32_t levelHeader[4];
+
+		levelHeader[0] = pyramid->levels[level].factor;
+		levelHeader[1] = pyramid->levels[level].width;
+		levelHeader[2] = pyramid->levels[level].length;
+		levelHeader[3] = pyramid->levels[level].checksum;
+		if (fwrite(levelHeader, sizeof(levelHeader), 1, container->fptr) != 1)
+		{
+			result = -1;
+		}
+	}
+	for (level = 0; level < pyramid->levelCount && result == 0; level++)
+	{
+		size_t levelBytes = (size_t)pyramid->levels[level].width * pyramid->levels[level].length * sizeof(int16_t);
+		size_t padding = (CONTAINERRECORDALIGNMENT - levelBytes % CONTAINERRECORDALIGNMENT) % CONTAINERRECORDALIGNMENT;
+
+		if (fwrite(pyramid->levels[level].data, levelBytes, 1, container->fptr) != 1 ||
+			(padding > 0 && fwrite(&zeros, padding, 1, container->fptr) != 1))
+		{
+			result = -1;
+		}
+	}
+	if (result == 0)
+	{
+		container->offset += CONTAINERRECORDFRAMESIZE + recordSize;
+	}
+	return result;
+}
+
+static int SurfaceContainer_Write(SurfaceSink *sink, SurfaceRecord *record)
+{
+	SurfaceContainer *container = (SurfaceContainer *)sink;
+	uint64_t recordSize = SurfaceFormat_HeaderSize(record) + record->payloadSize;
+	uint64_t recordOffset;
+	uint32_t padding = (uint32_t)((CONTAINERRECORDALIGNMENT - recordSize % CONTAINERRECORDALIGNMENT) % CONTAINERRECORDALIGNMENT);
+	uint64_t zeros = 0;
+	uint32_t reserved = 0;
+	int result = 0;
+
+	// Rotate to a new file if size or time limit is reached (never leave a file empty)
+	if (container->fptr != NULL && container->indexCount > 0 &&
+		((container->options.rotateBytes > 0 && container->offset >= container->options.rotateBytes) ||
+		 (container->options.rotateSeconds > 0 &&
+		  GoLog_MonotonicNs() - container->openTimeNs >= (uint64_t)container->options.rotateSeconds * 1000000000ull)))
+	{
+		SurfaceContainer_CloseFile(container);
+		container->sequenceNumber++;
+	}
+
+	if (container->fptr == NULL && SurfaceContainer_OpenFile(container) != 0)
+	{
+		return -1;
+	}
+
+	// Record frame, header and payload
+	recordOffset = container->offset;
+	snprintf(record->fileName, sizeof record->fileName, "%s", container->filename + strlen(container->rootFolder));
+	record->fileOffset = recordOffset + CONTAINERRECORDFRAMESIZE;
+	if (fwrite(CONTAINERRECORDTAG, 4, 1, container->fptr) != 1 ||
+		fwrite(&reserved, sizeof(reserved), 1, container->fptr) != 1 ||
+		fwrite(&recordSize, sizeof(recordSize), 1, container->fptr) != 1 ||
+		SurfaceFormat_WriteHeader(container->fptr, record) != 0 ||
+		(record->payloadSize > 0 && fwrite(record->payload, (size_t)record->payloadSize, 1, container->fptr) != 1) ||
+		(padding > 0 && fwrite(&zeros, padding, 1, container->fptr) != 1))
+	{
+		printf("WARNING: Error while writing surface to file\n");
+		SurfaceContainer_AbandonFile(container);
+		return -1;
+	}
+	container->offset += CONTAINERRECORDFRAMESIZE + recordSize + padding;
+
+	if (record->pyramid != NULL && record->pyramid->levelCount > 0 &&
+		SurfaceContainer_WritePyramid(container, record->pyramid) != 0)
+	{
+		printf("WARNING: Error while writing surface overview to file\n");
+		SurfaceContainer_AbandonFile(container);
+		return -1;
+	}
+
+	// Only records written completely are indexed
+	if (SurfaceContainer_AddIndexEntry(container, record, recordOffset) != 0)
+	{
+		result = -1;
+	}
+
+	printf("Surface %u appended to session file at offset %llu\n", record->count, (unsigned long long)recordOffset);
+	return result;
+}
+
+static void SurfaceContainer_Close(SurfaceSink *sink)
+{
+	SurfaceContainer *container = (SurfaceContainer *)sink;
+
+	if (container->fptr != NULL)
+	{
+		SurfaceContainer_CloseFile(container);
+	}
+	free(container->index);
+	free(container->streamBuffer);
+	free(container);
+}
+
+SurfaceSink *SurfaceContainer_Open(const char *rootFolder, const SurfaceContainerOptions *options)
+{
+	SurfaceContainer *container = calloc(1, sizeof(SurfaceContainer));
+
+	if (container == NULL)
+	{
+		return NULL;
+	}
+	container->base.write = SurfaceContainer_Write;
+	container->base.close = SurfaceContainer_Close;
+	container->options = *options;
+	snprintf(container->rootFolder, sizeof container->rootFolder, "%s", rootFolder);
+
+	if ((container->streamBuffer = malloc(CONTAINER_STREAM_BUFFER_SIZE)) == NULL ||
+		SurfaceContainer_OpenFile(container) != 0)
+	{
+		free(container->streamBuffer);
+		free(container);
+		return NULL;
+	}
+	return &container->base;
+}
@@ -0,0 +1,99 @@
+/*
+* SurfaceContainer.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Session container - all surfaces of a logging session appended to
+* one large file instead of one file per surface. A new container file is
+* started when the current one exceeds a size limit or has been open for a
+* given time (rotation).
+*
+* Container files have the following format (all offsets are 64-bit, so
+* files larger than 4 GB are supported):
+*
+* File header (32 bytes):
+* char[16]				headerText			"MHSKJELV SES0001"
+* uint32				sequenceNumber		Rotation number within session (0, 1, 2, ...)
+* uint32				reserved
+* uint64				reserved
+*
+* Records (one per surface):
+* char[4]				recordTag			"SREC"
+* uint32				reserved
+* uint64				recordSize			Number of bytes that follow (surface file)
+* uint8					surfaceFile			recordSize bytes - identical to a separate surface file (header + surface data)
+* uint8					padding				Zeros up to the next multiple of 8 bytes, so that every record
+*											(and the k16s rows of raw surfaces) is aligned in memory mapped files
+*
+* Pyramid records (optional, directly after the record of their surface):
+* char[4]				recordTag			"SPYR"
+* uint32				levelCount
+* uint64				recordSize			Number of bytes that follow (including padding)
+* level[levelCount]:
+*	uint32				factor				Downsampling factor (2, 4, 8, ...)
+*	uint32				width
+*	uint32				length
+*	uint32				checksum			CRC32C of factor, width, length and the level data (SurfaceChecksum.h),
+*											in containers written with -checksum (surfaces with checksums); 0 otherwise
+* int16					levelData			width*length samples of each level in turn (see SurfacePyramid.h),
+*											each level zero padded to a multiple of 8 bytes. Levels are
+*											made from the surface as stored (the valid region if cropped)
+*
+* Readers walking the records must skip records with other tags than "SREC"
+* using recordSize. The index only refers to surface records.
+*
+* Index (written when the file is closed):
+* char[4]				indexTag			"SIDX"
+* uint32				entrySize			Size of one index entry (40 bytes; 32 in files without frameIndex)
+* uint64				entryCount
+* entry[entryCount]:
+*	uint64				recordOffset		File offset of record tag
+*	uint64				timeStamp			Sensor time stamp
+*	uint32				count				Surface number
+*	uint32				surfaceWidth
+*	uint32				surfaceLength
+*	uint32				lostBefore			Surfaces lost since the previous record (frame index gaps in the
+*											sensor/SDK, and surfaces dropped by the logger); 0 in older files
+*	uint64				frameIndex			Sensor frame index
+*
+* Readers must use entrySize to step through the index, so that fields can be
+* added at the end of an entry.
+*
+* Footer (24 bytes, last in file):
+* uint64				indexOffset			File offset of index tag
+* uint64				entryCount
+* char[8]				footerTag			"SESINDEX"
+*
+* If a container is not closed properly (e.g. power loss) the index and footer
+* are missing, but all complete records can still be found by walking the
+* records from the file header using recordSize.
+*/
+
+#ifndef SURFACE_CONTAINER_H
+#define SURFACE_CONTAINER_H
+
+#include "SurfaceSink.h"
+
+#define SESSIONFILENAMESUFFIX		"GocatorSession.bin"
+#define CONTAINERHEADERTEXT			"MHSKJELV SES0001"
+#define CONTAINERHEADERSIZE			32
+#define CONTAINERRECORDTAG			"SREC"
+#define CONTAINERRECORDFRAMESIZE	16
+#define CONTAINERPYRAMIDTAG			"SPYR"
+#define CONTAINERPYRAMIDLEVELSIZE	16
+#define CONTAINERINDEXTAG			"SIDX"
+#define CONTAINERINDEXENTRYSIZE		40
+#define CONTAINERFOOTERTAG			"SESINDEX"
+#define CONTAINERFOOTERSIZE			24
+#define CONTAINERRECORDALIGNMENT	8
+
+typedef struct
+{
+	uint64_t rotateBytes;				// Start new file when file reaches this size (0 = no limit)
+	uint32_t rotateSeconds;				// Start new file after this many seconds (0 = no limit)
+}SurfaceContainerOptions;
+
+// Sink appending all surfaces to container files in rootFolder. Returns NULL on failure.
+SurfaceSink *SurfaceContainer_Open(const char *rootFolder, const SurfaceContainerOptions *options);
+
+#endif // SURFACE_CONTAINER_H
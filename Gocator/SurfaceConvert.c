@@ -0,0 +1,260 @@
+/*
+* SurfaceConvert.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: k16s to metric Z conversion kernels (see SurfaceConvert.h).
+* The SIMD loops handle 8 (SSE2) or 16 (AVX2) samples per iteration, i.e.
+* whole bytes of the validity mask; the remaining samples are done in C.
+*/
+
+#include "SurfaceConvert.h"
+#include "SurfaceFormat.h"
+#include "GoLogSimd.h"
+
+// Plain C version, starting at sample start (a multiple of 8)
+static void SurfaceConvert_ToFloatScalar(const int16_t *heights, size_t start, size_t count, float zOffset, float zResolution,
+	float invalidValue, float *z, uint8_t *validMask)
+{
+	uint32_t maskByte = 0;
+	size_t i;
+
+	for (i = start; i < count; i++)
+	{
+		int valid = heights[i] != INVALID_RANGE_16BIT;
+
+		z[i] = valid ? zOffset + (float)heights[i] * zResolution : invalidValue;
+		maskByte |= (uint32_t)valid << (i & 7);
+		if ((i & 7) == 7 || i == count - 1)
+		{
+			if (validMask != NULL)
+			{
+				validMask[i >> 3] = (uint8_t)maskByte;
+			}
+			maskByte = 0;
+		}
+	}
+}
+
+static void SurfaceConvert_ToDoubleScalar(const int16_t *heights, size_t start, size_t count, double zOffset, double zResolution,
+	double invalidValue, double *z, uint8_t *validMask)
+{
+	uint32_t maskByte = 0;
+	size_t i;
+
+	for (i = start; i < count; i++)
+	{
+		int valid = heights[i] != INVALID_RANGE_16BIT;
+
+		z[i] = valid ? zOffset + (double)heights[i] * zResolution : invalidValue;
+		maskByte |= (uint32_t)valid << (i & 7);
+		if ((i & 7) == 7 || i == count - 1)
+		{
+			if (validMask != NULL)
+			{
+				validMask[i >> 3] = (uint8_t)maskByte;
+			}
+			maskByte = 0;
+		}
+	}
+}
+
+#if GOLOG_X86
+
+static size_t SurfaceConvert_ToFloatSse2(const int16_t *heights, size_t count, float zOffset, float zResolution,
+	float invalidValue, float *z, uint8_t *validMask)
+{
+	const __m128i invalid16 = _mm_set1_epi16(INVALID_RANGE_16BIT);
+	const __m128 offset = _mm_set1_ps(zOffset);
+	const __m128 resolution = _mm_set1_ps(zResolution);
+	const __m128 replacement = _mm_set1_ps(invalidValue);
+	size_t i;
+
+	for (i = 0; i + 8 <= count; i += 8)
+	{
+		__m128i h = _mm_loadu_si128((const __m128i *)(heights + i));
+		__m128i invalid = _mm_cmpeq_epi16(h, invalid16);
+		__m128 invalidLo = _mm_castsi128_ps(_mm_unpacklo_epi16(invalid, invalid));
+		__m128 invalidHi = _mm_castsi128_ps(_mm_unpackhi_epi16(invalid, invalid));
+		__m128 zLo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(h, h), 16));		// Sign extend to 32 bit
+		__m128 zHi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(h, h), 16));
+
+		zLo = _mm_add_ps(offset, _mm_mul_ps(zLo, resolution));
+		zHi = _mm_add_ps(offset, _mm_mul_ps(zHi, resolution));
+		zLo = _mm_or_ps(_mm_and_ps(invalidLo, replacement), _mm_andnot_ps(invalidLo, zLo));
+		zHi = _mm_or_ps(_mm_and_ps(invalidHi, replacement), _mm_andnot_ps(invalidHi, zHi));
+		_mm_storeu_ps(z + i, zLo);
+		_mm_storeu_ps(z + i + 4, zHi);
+
+		if (validMask != NULL)
+		{
+			validMask[i >> 3] = (uint8_t)~_mm_movemask_epi8(_mm_packs_epi16(invalid, invalid));
+		}
+	}
+	return i;
+}
+
+static size_t SurfaceConvert_ToDoubleSse2(const int16_t *heights, size_t count, double zOffset, double zResolution,
+	double invalidValue, double *z, uint8_t *validMask)
+{
+	const __m128i invalid16 = _mm_set1_epi16(INVALID_RANGE_16BIT);
+	const __m128d offset = _mm_set1_pd(zOffset);
+	const __m128d resolution = _mm_set1_pd(zResolution);
+	const __m128d replacement = _mm_set1_pd(invalidValue);
+	size_t i;
+
+	for (i = 0; i + 8 <= count; i += 8)
+	{
+		__m128i h = _mm_loadu_si128((const __m128i *)(heights + i));
+		__m128i invalid = _mm_cmpeq_epi16(h, invalid16);
+		__m128i h32Lo = _mm_srai_epi32(_mm_unpacklo_epi16(h, h), 16);
+		__m128i h32Hi = _mm_srai_epi32(_mm_unpackhi_epi16(h, h), 16);
+		__m128i invalid32Lo = _mm_unpacklo_epi16(invalid, invalid);
+		__m128i invalid32Hi = _mm_unpackhi_epi16(invalid, invalid);
+		__m128d invalid0 = _mm_castsi128_pd(_mm_unpacklo_epi32(invalid32Lo, invalid32Lo));
+		__m128d invalid1 = _mm_castsi128_pd(_mm_unpackhi_epi32(invalid32Lo, invalid32Lo));
+		__m128d invalid2 = _mm_castsi128_pd(_mm_unpacklo_epi32(invalid32Hi, invalid32Hi));
+		__m128d invalid3 = _mm_castsi128_pd(_mm_unpackhi_epi32(invalid32Hi, invalid32Hi));
+		__m128d z0 = _mm_add_pd(offset, _mm_mul_pd(_mm_cvtepi32_pd(h32Lo), resolution));
+		__m128d z1 = _mm_add_pd(offset, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(h32Lo, 8)), resolution));
+		__m128d z2 = _mm_add_pd(offset, _mm_mul_pd(_mm_cvtepi32_pd(h32Hi), resolution));
+		__m128d z3 = _mm_add_pd(offset, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(h32Hi, 8)), resolution));
+
+		_mm_storeu_pd(z + i, _mm_or_pd(_mm_and_pd(invalid0, replacement), _mm_andnot_pd(invalid0, z0)));
+		_mm_storeu_pd(z + i + 2, _mm_or_pd(_mm_and_pd(invalid1, replacement), _mm_andnot_pd(invalid1, z1)));
+		_mm_storeu_pd(z + i + 4, _mm_or_pd(_mm_and_pd(invalid2, replacement), _mm_andnot_pd(invalid2, z2)));
+		_mm_storeu_pd(z + i + 6, _mm_or_pd(_mm_and_pd(invalid3, replacement), _mm_andnot_pd(invalid3, z3)));
+
+		if (validMask != NULL)
+		{
+			validMask[i >> 3] = (uint8_t)~_mm_movemask_epi8(_mm_packs_epi16(invalid, invalid));
+		}
+	}
+	return i;
+}
+
+GOLOG_TARGET_AVX2
+static size_t SurfaceConvert_ToFloatAvx2(const int16_t *heights, size_t count, float zOffset, float zResolution,
+	float invalidValue, float *z, uint8_t *validMask)
+{
+	const __m256i invalid16 = _mm256_set1_epi16(INVALID_RANGE_16BIT);
+	const __m256 offset = _mm256_set1_ps(zOffset);
+	const __m256 resolution = _mm256_set1_ps(zResolution);
+	const __m256 replacement = _mm256_set1_ps(invalidValue);
+	size_t i;
+
+	for (i = 0; i + 16 <= count; i += 16)
+	{
+		__m256i h = _mm256_loadu_si256((const __m256i *)(heights + i));
+		__m256i invalid = _mm256_cmpeq_epi16(h, invalid16);
+		__m128i invalidLo16 = _mm256_castsi256_si128(invalid);
+		__m128i invalidHi16 = _mm256_extracti128_si256(invalid, 1);
+		__m256 zLo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(h)));
+		__m256 zHi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(h, 1)));
+
+		zLo = _mm256_add_ps(offset, _mm256_mul_ps(zLo, resolution));
+		zHi = _mm256_add_ps(offset, _mm256_mul_ps(zHi, resolution));
+		zLo = _mm256_blendv_ps(zLo, replacement, _mm256_castsi256_ps(_mm256_cvtepi16_epi32(invalidLo16)));
+		zHi = _mm256_blendv_ps(zHi, replacement, _mm256_castsi256_ps(_mm256_cvtepi16_epi32(invalidHi16)));
+		_mm256_storeu_ps(z + i, zLo);
+		_mm256_storeu_ps(z + i + 8, zHi);
+
+		if (validMask != NULL)
+		{
+			uint32_t bits = ~(uint32_t)_mm_movemask_epi8(_mm_packs_epi16(invalidLo16, invalidHi16));
+			validMask[i >> 3] = (uint8_t)bits;
+			validMask[(i >> 3) + 1] = (uint8_t)(bits >> 8);
+		}
+	}
+	return i;
+}
+
+GOLOG_TARGET_AVX2
+static size_t SurfaceConvert_ToDoubleAvx2(const int16_t *heights, size_t count, double zOffset, double zResolution,
+	double invalidValue, double *z, uint8_t *validMask)
+{
+	const __m256i invalid16 = _mm256_set1_epi16(INVALID_RANGE_16BIT);
+	const __m256d offset = _mm256_set1_pd(zOffset);
+	const __m256d resolution = _mm256_set1_pd(zResolution);
+	const __m256d replacement = _mm256_set1_pd(invalidValue);
+	size_t i;
+
+	for (i = 0; i + 16 <= count; i += 16)
+	{
+		__m256i h = _mm256_loadu_si256((const __m256i *)(heights + i));
+		__m256i invalid = _mm256_cmpeq_epi16(h, invalid16);
+		__m128i invalidLo16 = _mm256_castsi256_si128(invalid);
+		__m128i invalidHi16 = _mm256_extracti128_si256(invalid, 1);
+		__m128i hLo16 = _mm256_castsi256_si128(h);
+		__m128i hHi16 = _mm256_extracti128_si256(h, 1);
+		__m256d z0 = _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(hLo16));
+		__m256d z1 = _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(_mm_srli_si128(hLo16, 8)));
+		__m256d z2 = _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(hHi16));
+		__m256d z3 = _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(_mm_srli_si128(hHi16, 8)));
+
+		z0 = _mm256_add_pd(offset, _mm256_mul_pd(z0, resolution));
+		z1 = _mm256_add_pd(offset, _mm256_mul_pd(z1, resolution));
+		z2 = _mm256_add_pd(offset, _mm256_mul_pd(z2, resolution));
+		z3 = _mm256_add_pd(offset, _mm256_mul_pd(z3, resolution));
+		z0 = _mm256_blendv_pd(z0, replacement, _mm256_castsi256_pd(_mm256_cvtepi16_epi64(invalidLo16)));
+		z1 = _mm256_blendv_pd(z1, replacement, _mm256_castsi256_pd(_mm256_cvtepi16_epi64(_mm_srli_si128(invalidLo16, 8))));
+		z2 = _mm256_blendv_pd(z2, replacement, _mm256_castsi256_pd(_mm256_cvtepi16_epi64(invalidHi16)));
+		z3 = _mm256_blendv_pd(z3, replacement, _mm256_castsi256_pd(_mm256_cvtepi16_epi64(_mm_srli_si128(invalidHi16, 8))));
+		_mm256_storeu_pd(z + i, z0);
+		_mm256_storeu_pd(z + i + 4, z1);
+		_mm256_storeu_pd(z + i + 8, z2);
+		_mm256_storeu_pd(z + i + 12, z3);
+
+		if (validMask != NULL)
+		{
+			uint32_t bits = ~(uint32_t)_mm_movemask_epi8(_mm_packs_epi16(invalidLo16, invalidHi16));
+			validMask[i >> 3] = (uint8_t)bits;
+			validMask[(i >> 3) + 1] = (uint8_t)(bits >> 8);
+		}
+	}
+	return i;
+}
+
+#endif
+
+void SurfaceConvert_ToFloat(const int16_t *heights, size_t count, double zOffset, double zResolution,
+	float invalidValue, float *z, uint8_t *validMask)
+{
+	size_t done = 0;
+
+#if GOLOG_X86
+	switch (GoLogSimd_Level())
+	{
+		case GOLOG_SIMD_AVX2:
+			done = SurfaceConvert_ToFloatAvx2(heights, count, (float)zOffset, (float)zResolution, invalidValue, z, validMask);
+			break;
+		case GOLOG_SIMD_SSE2:
+			done = SurfaceConvert_ToFloatSse2(heights, count, (float)zOffset, (float)zResolution, invalidValue, z, validMask);
+			break;
+		default:
+			break;
+	}
+#endif
+	SurfaceConvert_ToFloatScalar(heights, done, count, (float)zOffset, (float)zResolution, invalidValue, z, validMask);
+}
+
+void SurfaceConvert_ToDouble(const int16_t *heights, size_t count, double zOffset, double zResolution,
+	double invalidValue, double *z, uint8_t *validMask)
+{
+	size_t done = 0;
+
+#if GOLOG_X86
+	switch (GoLogSimd_Level())
+	{
+		case GOLOG_SIMD_AVX2:
+			done = SurfaceConvert_ToDoubleAvx2(heights, count, zOffset, zResolution, invalidValue, z, validMask);
+			break;
+		case GOLOG_SIMD_SSE2:
+			done = SurfaceConvert_ToDoubleSse2(heights, count, zOffset, zResolution, invalidValue, z, validMask);
+			break;
+		default:
+			break;
+	}
+#endif
+	SurfaceConvert_ToDoubleScalar(heights, done, count, zOffset, zResolution, invalidValue, z, validMask);
+}
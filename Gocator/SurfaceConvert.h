@@ -0,0 +1,34 @@
+/*
+* SurfaceConvert.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Conversion of raw k16s heights to metric Z,
+*	Z = ZOffset + height * ZResolution
+* with invalid samples (INVALID_RANGE_16BIT) replaced by a given value
+* (typically NAN) and optionally reported in a validity bit mask.
+*
+* The functions work on any run of samples - one row from GoSurfaceMsg_RowAt,
+* or a complete surface loaded from file. Bit i of validMask (bit i%8 of byte
+* i/8) is set when sample i is valid; the mask must have room for (count+7)/8
+* bytes. Pass NULL if no mask is needed.
+*
+* SSE2 and AVX2 versions are selected at run time (see GoLogSimd.h). Float
+* output is computed in single precision and double output in double
+* precision in all versions, so they agree with the plain C version (exactly,
+* unless the compiler contracts the C version into fused multiply-adds).
+*/
+
+#ifndef SURFACE_CONVERT_H
+#define SURFACE_CONVERT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+void SurfaceConvert_ToFloat(const int16_t *heights, size_t count, double zOffset, double zResolution,
+	float invalidValue, float *z, uint8_t *validMask);
+
+void SurfaceConvert_ToDouble(const int16_t *heights, size_t count, double zOffset, double zResolution,
+	double invalidValue, double *z, uint8_t *validMask);
+
+#endif // SURFACE_CONVERT_H
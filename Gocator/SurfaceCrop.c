@@ -0,0 +1,239 @@
+/*
+* SurfaceCrop.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Valid-region bounding box and cropping of surfaces (see SurfaceCrop.h).
+* The SIMD versions compare a vector of samples with INVALID_RANGE_16BIT and
+* take the position of the first or last valid sample from the byte mask.
+*/
+
+#include "SurfaceCrop.h"
+#include "GoLogSimd.h"
+#include <string.h>
+
+#if GOLOG_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Position of the first valid sample in row[start, end), or end if there is none
+static uint32_t SurfaceCrop_FirstValidScalar(const int16_t *row, uint32_t start, uint32_t end)
+{
+	while (start < end && row[start] == INVALID_RANGE_16BIT)
+	{
+		start++;
+	}
+	return start;
+}
+
+// One past the position of the last valid sample in row[start, end), or start if there is none
+static uint32_t SurfaceCrop_LastValidScalar(const int16_t *row, uint32_t start, uint32_t end)
+{
+	while (end > start && row[end - 1] == INVALID_RANGE_16BIT)
+	{
+		end--;
+	}
+	return end;
+}
+
+#if GOLOG_X86
+
+// Lowest and highest set bit of a non-zero mask
+static uint32_t SurfaceCrop_LowestBit(uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long bit;
+	_BitScanForward(&bit, mask);
+	return (uint32_t)bit;
+#else
+	return (uint32_t)__builtin_ctz(mask);
+#endif
+}
+
+static uint32_t SurfaceCrop_HighestBit(uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long bit;
+	_BitScanReverse(&bit, mask);
+	return (uint32_t)bit;
+#else
+	return 31u - (uint32_t)__builtin_clz(mask);
+#endif
+}
+
+// The SIMD versions return the position found, or where the whole vectors ended for the plain C version to continue
+
+static uint32_t SurfaceCrop_FirstValidSse2(const int16_t *row, uint32_t start, uint32_t end)
+{
+	const __m128i invalid16 = _mm_set1_epi16(INVALID_RANGE_16BIT);
+
+	for (; start + 8 <= end; start += 8)
+	{
+		uint32_t valid = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(row + start)), invalid16)) & 0xFFFFu;
+		if (valid != 0)
+		{
+			return start + SurfaceCrop_LowestBit(valid) / 2;
+		}
+	}
+	return start;
+}
+
+static uint32_t SurfaceCrop_LastValidSse2(const int16_t *row, uint32_t start, uint32_t end)
+{
+	const __m128i invalid16 = _mm_set1_epi16(INVALID_RANGE_16BIT);
+
+	for (; end >= start + 8; end -= 8)
+	{
+		uint32_t valid = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(row + end - 8)), invalid16)) & 0xFFFFu;
+		if (valid != 0)
+		{
+			return end - 8 + SurfaceCrop_HighestBit(valid) / 2 + 1;
+		}
+	}
+	return end;
+}
+
+GOLOG_TARGET_AVX2
+static uint32_t SurfaceCrop_FirstValidAvx2(const int16_t *row, uint32_t start, uint32_t end)
+{
+	const __m256i invalid16 = _mm256_set1_epi16(INVALID_RANGE_16BIT);
+
+	for (; start + 16 <= end; start += 16)
+	{
+		uint32_t valid = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(row + start)), invalid16));
+		if (valid != 0)
+		{
+			return start + SurfaceCrop_LowestBit(valid) / 2;
+		}
+	}
+	return start;
+}
+
+GOLOG_TARGET_AVX2
+static uint32_t SurfaceCrop_LastValidAvx2(const int16_t *row, uint32_t start, uint32_t end)
+{
+	const __m256i invalid16 = _mm256_set1_epi16(INVALID_RANGE_16BIT);
+
+	for (; end >= start + 16; end -= 16)
+	{
+		uint32_t valid = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(row + end - 16)), invalid16));
+		if (valid != 0)
+		{
+			return end - 16 + SurfaceCrop_HighestBit(valid) / 2 + 1;
+		}
+	}
+	return end;
+}
+
+#endif
+
+static uint32_t SurfaceCrop_FirstValid(const int16_t *row, uint32_t start, uint32_t end)
+{
+#if GOLOG_X86
+	switch (GoLogSimd_Level())
+	{
+		case GOLOG_SIMD_AVX2:
+			start = SurfaceCrop_FirstValidAvx2(row, start, end);
+			break;
+		case GOLOG_SIMD_SSE2:
+			start = SurfaceCrop_FirstValidSse2(row, start, end);
+			break;
+		default:
+			break;
+	}
+#endif
+	return SurfaceCrop_FirstValidScalar(row, start, end);
+}
+
+static uint32_t SurfaceCrop_LastValid(const int16_t *row, uint32_t start, uint32_t end)
+{
+#if GOLOG_X86
+	switch (GoLogSimd_Level())
+	{
+		case GOLOG_SIMD_AVX2:
+			end = SurfaceCrop_LastValidAvx2(row, start, end);
+			break;
+		case GOLOG_SIMD_SSE2:
+			end = SurfaceCrop_LastValidSse2(row, start, end);
+			break;
+		default:
+			break;
+	}
+#endif
+	return SurfaceCrop_LastValidScalar(row, start, end);
+}
+
+void SurfaceCrop_Bounds(const int16_t *data, uint32_t width, uint32_t length, SurfaceCropBox *box)
+{
+	uint32_t top;
+	uint32_t bottom;
+	uint32_t left = width;
+	uint32_t right = 0;
+	uint32_t row;
+
+	memset(box, 0, sizeof(*box));
+
+	// First and last rows with a valid sample
+	for (top = 0; top < length; top++)
+	{
+		if ((left = SurfaceCrop_FirstValid(data + (size_t)top * width, 0, width)) < width)
+		{
+			break;
+		}
+	}
+	if (top == length)
+	{
+		return;
+	}
+	for (bottom = length - 1; bottom > top; bottom--)
+	{
+		if (SurfaceCrop_FirstValid(data + (size_t)bottom * width, 0, width) < width)
+		{
+			break;
+		}
+	}
+
+	// Rows between only need to be scanned outside the columns already known to be in the box
+	for (row = top; row <= bottom; row++)
+	{
+		const int16_t *rowData = data + (size_t)row * width;
+
+		left = SurfaceCrop_FirstValid(rowData, 0, left);
+		right = SurfaceCrop_LastValid(rowData, right, width);
+	}
+
+	box->column = left;
+	box->row = top;
+	box->width = right - left;
+	box->length = bottom - top + 1;
+}
+
+uint64_t SurfaceCrop_Apply(SurfaceRecord *record)
+{
+	SurfaceCropBox box;
+	uint64_t fullSize = (uint64_t)record->surfaceWidth * record->surfaceLength * sizeof(int16_t);
+	uint32_t row;
+
+	SurfaceCrop_Bounds(record->data, record->surfaceWidth, record->surfaceLength, &box);
+	if (box.width == record->surfaceWidth && box.length == record->surfaceLength)
+	{
+		return 0;
+	}
+
+	// Rows move towards the start of the buffer, so each can be moved in place
+	for (row = 0; row < box.length; row++)
+	{
+		memmove(record->data + (size_t)row * box.width,
+			record->data + (size_t)(box.row + row) * record->surfaceWidth + box.column, (size_t)box.width * sizeof(int16_t));
+	}
+
+	record->cropColumn = box.column;
+	record->cropRow = box.row;
+	record->fullWidth = record->surfaceWidth;
+	record->fullLength = record->surfaceLength;
+	record->surfaceWidth = box.width;
+	record->surfaceLength = box.length;
+	record->payload = record->data;
+	record->payloadSize = (uint64_t)box.width * box.length * sizeof(int16_t);
+	return fullSize - record->payloadSize;
+}
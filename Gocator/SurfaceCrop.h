@@ -0,0 +1,41 @@
+/*
+* SurfaceCrop.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Cropping of surfaces to the bounding box of their valid samples.
+* Gocator surfaces often have wide borders of invalid samples
+* (INVALID_RANGE_16BIT) outside the object; only the window with valid data
+* is then written. The position of the window in the full surface is kept in
+* the record (cropColumn, cropRow, fullWidth, fullLength) and written in a
+* VER0004 header, so the metric X and Y of every sample stay exact.
+*
+* The bounding box is found by scanning inwards from the edges: rows are
+* searched from the top and from the bottom for the first with a valid
+* sample, and the rows between are then only scanned from each end up to the
+* current left and right edges of the box. Invalid samples are found 8 (SSE2)
+* or 16 (AVX2) at a time, selected at run time (see GoLogSimd.h).
+*/
+
+#ifndef SURFACE_CROP_H
+#define SURFACE_CROP_H
+
+#include "SurfaceFormat.h"
+
+typedef struct
+{
+	uint32_t column;					// First column with a valid sample
+	uint32_t row;						// First row with a valid sample
+	uint32_t width;						// 0 if no sample is valid
+	uint32_t length;
+}SurfaceCropBox;
+
+// Bounding box of the valid samples of a width x length surface
+void SurfaceCrop_Bounds(const int16_t *data, uint32_t width, uint32_t length, SurfaceCropBox *box);
+
+// Crop a raw record to the bounding box of its valid samples, moving the rows to the start of
+// record->data and setting the crop fields, size and payloadSize. A surface without invalid
+// borders is left as it is; one without valid samples becomes 0 x 0. Returns bytes removed.
+uint64_t SurfaceCrop_Apply(SurfaceRecord *record);
+
+#endif // SURFACE_CROP_H
@@ -0,0 +1,203 @@
+/*
+* SurfaceFileSink.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Surface sink writing one VER0001 file per surface, named
+* <date>_<time>_<count>_GocatorSurface.bin.
+*
+* In direct mode the files bypass the OS file cache, so that long captures do
+* not fill memory with written data and cause writeback stalls. Unbuffered
+* writes must be aligned, so the files are VER0003: the header is padded to
+* one aligned block and the surface data to whole blocks. Whole blocks of
+* data are written straight from the (page aligned) surface buffer; the
+* header and the last partial block go through an aligned staging buffer.
+* Cropped (SurfaceCrop.h) and tiled (SurfaceTiles.h) surfaces are written as
+* VER0004 and VER0005 in both modes.
+*/
+
+#include "SurfaceSink.h"
+#include "SurfaceCodec.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DIRECT_STAGING_SIZE		(1024 * 1024)		// Aligned buffer for header, last block and unaligned data
+#define FILESINK_FOLDER_SIZE	1024				// Room for the root folder
+#define FILESINK_PATH_SIZE		(FILESINK_FOLDER_SIZE + SURFACEFILENAMESIZE)	// Root folder and file name
+
+typedef struct
+{
+	SurfaceSink base;
+	char rootFolder[FILESINK_FOLDER_SIZE];
+	int direct;							// Write VER0003 files with unbuffered I/O
+	int directUnsupported;				// File system does not support it (warned once)
+	uint8_t *staging;					// DIRECT_STAGING_SIZE bytes, page aligned
+	size_t stagingSize;
+}SurfaceFileSink;
+
+// Name of the surface file is stored in record, and the full path in filename
+static void SurfaceFileSink_FileName(const SurfaceFileSink *fileSink, SurfaceRecord *record, char *filename, size_t size)
+{
+	snprintf(record->fileName, sizeof record->fileName, "%04d-%02d-%02d_%02d%02d%02d_%04u_%s",
+		record->receiveTime.year, record->receiveTime.month, record->receiveTime.day,
+		record->receiveTime.hour, record->receiveTime.minute, record->receiveTime.second,
+		record->count, DATAFILENAMESUFFIX);
+	record->fileOffset = 0;
+	snprintf(filename, size, "%s%s", fileSink->rootFolder, record->fileName);
+}
+
+// Write VER0003 file with aligned, unbuffered writes
+static int SurfaceFileSink_WriteDirect(SurfaceFileSink *fileSink, const SurfaceRecord *record, const char *filename)
+{
+	GoLogFile file;
+	const uint8_t *payload = record->payload;
+	uint64_t wholeBlocks = record->payloadSize / GOLOG_DIRECT_ALIGNMENT * GOLOG_DIRECT_ALIGNMENT;
+	size_t lastBlock = (size_t)(record->payloadSize - wholeBlocks);
+	uint64_t offset;
+	uint32_t dataOffset;
+	int result = 0;
+
+	if (GoLog_CreateFile(&file, filename, 1) != 0)
+	{
+		printf("Error opening file %s\n", filename);
+		return -1;
+	}
+	if (!file.direct && !fileSink->directUnsupported)
+	{
+		printf("WARNING: Direct I/O not supported in %s, writing through the file cache\n", fileSink->rootFolder);
+		fileSink->directUnsupported = 1;
+	}
+
+	dataOffset = SurfaceFormat_EncodeAlignedHeader(fileSink->staging, record, GOLOG_DIRECT_ALIGNMENT);
+	if (GoLog_WriteFile(&file, fileSink->staging, dataOffset) != 0)
+	{
+		result = -1;
+	}
+
+	// Whole blocks - from the surface buffer if it is aligned, otherwise copied
+	if ((uintptr_t)payload % GOLOG_DIRECT_ALIGNMENT == 0)
+	{
+		if (result == 0 && wholeBlocks > 0 && GoLog_WriteFile(&file, payload, (size_t)wholeBlocks) != 0)
+		{
+			result = -1;
+		}
+	}
+	else
+	{
+		for (offset = 0; offset < wholeBlocks && result == 0; offset += fileSink->stagingSize)
+		{
+			size_t chunk = (size_t)(wholeBlocks - offset < fileSink->stagingSize ? wholeBlocks - offset : fileSink->stagingSize);
+			memcpy(fileSink->staging, payload + offset, chunk);
+			if (GoLog_WriteFile(&file, fileSink->staging, chunk) != 0)
+			{
+				result = -1;
+			}
+		}
+	}
+
+	// Last partial block, zero padded
+	if (result == 0 && lastBlock > 0)
+	{
+		memcpy(fileSink->staging, payload + wholeBlocks, lastBlock);
+		memset(fileSink->staging + lastBlock, 0, GOLOG_DIRECT_ALIGNMENT - lastBlock);
+		if (GoLog_WriteFile(&file, fileSink->staging, GOLOG_DIRECT_ALIGNMENT) != 0)
+		{
+			result = -1;
+		}
+	}
+
+	if (result != 0)
+	{
+		printf("WARNING: Error while writing surface to file\n");
+	}
+	if (GoLog_CloseFile(&file) != 0)
+	{
+		result = -1;
+	}
+	printf("Surface %u written to file: %s\n", record->count, filename);
+	return result;
+}
+
+static int SurfaceFileSink_Write(SurfaceSink *sink, SurfaceRecord *record)
+{
+	SurfaceFileSink *fileSink = (SurfaceFileSink *)sink;
+	char filename[FILESINK_PATH_SIZE];		// File name buffer
+	uint8_t header[HEADERSIZE_MAX];
+	GoLogIoVec pieces[2];
+	GoLogFile file;
+	int result = 0;
+
+	// Open binary output file
+	SurfaceFileSink_FileName(fileSink, record, filename, sizeof filename);
+	if (fileSink->direct)
+	{
+		return SurfaceFileSink_WriteDirect(fileSink, record, filename);
+	}
+
+	if (GoLog_CreateFile(&file, filename, 0) != 0)
+	{
+		printf("Error opening file %s\n", filename);
+		return -1;
+	}
+
+	// Header and surface data in one gathered write. The rows are contiguous in the record,
+	// so the data is one piece, written straight from the surface buffer without stdio copying.
+	pieces[0].data = header;
+	pieces[0].size = SurfaceFormat_EncodeHeader(header, record);
+	pieces[1].data = record->payload;
+	pieces[1].size = (size_t)record->payloadSize;
+	if (GoLog_WriteFileVectors(&file, pieces, 2) != 0)
+	{
+		printf("WARNING: Error while writing surface to file\n");
+		result = -1;
+	}
+
+	// Close file
+	if (GoLog_CloseFile(&file) != 0)
+	{
+		result = -1;
+	}
+	printf("Surface %u written to file: %s\n", record->count, filename);
+	return result;
+}
+
+static void SurfaceFileSink_Close(SurfaceSink *sink)
+{
+	SurfaceFileSink *fileSink = (SurfaceFileSink *)sink;
+
+	GoLog_FreePages(fileSink->staging, fileSink->stagingSize);
+	free(sink);
+}
+
+SurfaceSink *SurfaceFileSink_Open(const char *rootFolder)
+{
+	SurfaceFileSink *sink = calloc(1, sizeof(SurfaceFileSink));
+
+	if (sink == NULL)
+	{
+		return NULL;
+	}
+	sink->base.write = SurfaceFileSink_Write;
+	sink->base.close = SurfaceFileSink_Close;
+	snprintf(sink->rootFolder, sizeof sink->rootFolder, "%s", rootFolder);
+	return &sink->base;
+}
+
+SurfaceSink *SurfaceFileSink_OpenDirect(const char *rootFolder)
+{
+	SurfaceFileSink *sink = (SurfaceFileSink *)SurfaceFileSink_Open(rootFolder);
+	int hugePages = 0;
+
+	if (sink == NULL)
+	{
+		return NULL;
+	}
+	sink->stagingSize = DIRECT_STAGING_SIZE;
+	if ((sink->staging = GoLog_AllocPages(&sink->stagingSize, &hugePages)) == NULL)
+	{
+		free(sink);
+		return NULL;
+	}
+	sink->direct = 1;
+	return &sink->base;
+}
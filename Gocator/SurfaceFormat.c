@@ -0,0 +1,280 @@
+/*
+* SurfaceFormat.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Writing and parsing of the Gocator surface file header.
+*/
+
+#include "SurfaceFormat.h"
+#include "SurfaceCodec.h"
+#include "SurfaceChecksum.h"
+#include <string.h>
+
+uint32_t SurfaceFormat_HeaderSize(const SurfaceRecord *record)
+{
+	if (record->checksumChunkSize != 0)
+	{
+		return HEADERSIZE_VER0006;
+	}
+	if (record->tileWidth != 0)
+	{
+		return HEADERSIZE_VER0005;
+	}
+	if (record->fullWidth != 0)
+	{
+		return HEADERSIZE_VER0004;
+	}
+	return (record->codec == SURFACECODEC_RAW) ? HEADERSIZE_VER0001 : HEADERSIZE_VER0002;
+}
+
+int SurfaceFormat_WriteHeader(FILE *fptr, const SurfaceRecord *record)
+{
+	uint8_t header[HEADERSIZE_MAX];
+	uint32_t headerSize = SurfaceFormat_EncodeHeader(header, record);
+
+	return (fwrite(header, headerSize, 1, fptr) == 1) ? 0 : -1;
+}
+
+// Fields common to all versions (HEADERSIZE_VER0001 bytes)
+static void SurfaceFormat_EncodeFields(uint8_t *buffer, const SurfaceRecord *record, const char *headerText)
+{
+	memcpy(buffer, headerText, HEADERTEXTSIZE);
+	memcpy(buffer + 16, &record->timeStamp, sizeof(record->timeStamp));
+	memcpy(buffer + 24, &record->surfaceWidth, sizeof(record->surfaceWidth));
+	memcpy(buffer + 28, &record->surfaceLength, sizeof(record->surfaceLength));
+	memcpy(buffer + 32, &record->xOffset, sizeof(record->xOffset));
+	memcpy(buffer + 40, &record->xResolution, sizeof(record->xResolution));
+	memcpy(buffer + 48, &record->yOffset, sizeof(record->yOffset));
+	memcpy(buffer + 56, &record->yResolution, sizeof(record->yResolution));
+	memcpy(buffer + 64, &record->zOffset, sizeof(record->zOffset));
+	memcpy(buffer + 72, &record->zResolution, sizeof(record->zResolution));
+	memcpy(buffer + 80, &record->frameRate, sizeof(record->frameRate));
+	memcpy(buffer + 88, &record->exposureTime, sizeof(record->exposureTime));
+}
+
+// VER0002 and later: payload coding
+static void SurfaceFormat_EncodePayloadFields(uint8_t *buffer, const SurfaceRecord *record)
+{
+	uint32_t reserved = 0;
+
+	memcpy(buffer + 96, &record->codec, sizeof(record->codec));
+	memcpy(buffer + 100, &reserved, sizeof(reserved));
+	memcpy(buffer + 104, &record->payloadSize, sizeof(record->payloadSize));
+}
+
+uint32_t SurfaceFormat_EncodeHeader(uint8_t *buffer, const SurfaceRecord *record)
+{
+	// Cropped, tiled and checksummed surfaces need the fields of VER0004 / VER0005 / VER0006, with the surface data
+	// straight after the header
+	if (record->fullWidth != 0 || record->tileWidth != 0 || record->checksumChunkSize != 0)
+	{
+		return SurfaceFormat_EncodeAlignedHeader(buffer, record, 1);
+	}
+	if (record->codec == SURFACECODEC_RAW)
+	{
+		SurfaceFormat_EncodeFields(buffer, record, HEADERTEXT);
+		return HEADERSIZE_VER0001;
+	}
+	SurfaceFormat_EncodeFields(buffer, record, HEADERTEXT_VER0002);
+	SurfaceFormat_EncodePayloadFields(buffer, record);
+	return HEADERSIZE_VER0002;
+}
+
+uint32_t SurfaceFormat_EncodeAlignedHeader(uint8_t *buffer, const SurfaceRecord *record, uint32_t alignment)
+{
+	uint32_t headerSize = HEADERSIZE_VER0003;
+	const char *headerText = HEADERTEXT_VER0003;
+	uint64_t dataOffset;
+	uint32_t headerChecksum;
+
+	if (record->checksumChunkSize != 0)
+	{
+		headerSize = HEADERSIZE_VER0006;
+		headerText = HEADERTEXT_VER0006;
+	}
+	else if (record->tileWidth != 0)
+	{
+		headerSize = HEADERSIZE_VER0005;
+		headerText = HEADERTEXT_VER0005;
+	}
+	else if (record->fullWidth != 0)
+	{
+		headerSize = HEADERSIZE_VER0004;
+		headerText = HEADERTEXT_VER0004;
+	}
+	dataOffset = (headerSize + alignment - 1) / alignment * alignment;
+
+	memset(buffer, 0, (size_t)dataOffset);
+	SurfaceFormat_EncodeFields(buffer, record, headerText);
+	SurfaceFormat_EncodePayloadFields(buffer, record);
+	memcpy(buffer + 112, &dataOffset, sizeof(dataOffset));
+
+	// VER0004 and later: position of the cropped surface in the full surface (zero if not cropped)
+	if (headerSize >= HEADERSIZE_VER0004)
+	{
+		memcpy(buffer + 120, &record->cropColumn, sizeof(record->cropColumn));
+		memcpy(buffer + 124, &record->cropRow, sizeof(record->cropRow));
+		memcpy(buffer + 128, &record->fullWidth, sizeof(record->fullWidth));
+		memcpy(buffer + 132, &record->fullLength, sizeof(record->fullLength));
+	}
+
+	// VER0005 and later: tile size (zero if not tiled in VER0006)
+	if (headerSize >= HEADERSIZE_VER0005)
+	{
+		memcpy(buffer + 136, &record->tileWidth, sizeof(record->tileWidth));
+		memcpy(buffer + 140, &record->tileLength, sizeof(record->tileLength));
+	}
+
+	// VER0006: chunk checksums of the payload, and checksum of all header fields before it
+	if (headerSize == HEADERSIZE_VER0006)
+	{
+		memcpy(buffer + 144, &record->checksumChunkSize, sizeof(record->checksumChunkSize));
+		memcpy(buffer + 148, &record->checksumChunkCount, sizeof(record->checksumChunkCount));
+		memcpy(buffer + 152, record->chunkChecksums, sizeof(record->chunkChecksums));
+		headerChecksum = SurfaceChecksum_Crc32c(0, buffer, HEADERSIZE_VER0006 - sizeof(headerChecksum));
+		memcpy(buffer + HEADERSIZE_VER0006 - sizeof(headerChecksum), &headerChecksum, sizeof(headerChecksum));
+	}
+	return (uint32_t)dataOffset;
+}
+
+uint32_t SurfaceFormat_ParseHeader(const uint8_t *bytes, uint64_t size, SurfaceRecord *record)
+{
+	uint32_t headerSize;
+	uint32_t headerChecksum;
+	uint64_t dataOffset;
+	uint64_t rawSize;
+
+	memset(record, 0, sizeof(*record));
+	if (size < HEADERSIZE_VER0001)
+	{
+		return 0;
+	}
+
+	if (memcmp(bytes, HEADERTEXT, HEADERTEXTSIZE) == 0)
+	{
+		headerSize = HEADERSIZE_VER0001;
+	}
+	else if (memcmp(bytes, HEADERTEXT_VER0002, HEADERTEXTSIZE) == 0 && size >= HEADERSIZE_VER0002)
+	{
+		headerSize = HEADERSIZE_VER0002;
+	}
+	else if (memcmp(bytes, HEADERTEXT_VER0003, HEADERTEXTSIZE) == 0 && size >= HEADERSIZE_VER0003)
+	{
+		headerSize = HEADERSIZE_VER0003;
+	}
+	else if (memcmp(bytes, HEADERTEXT_VER0004, HEADERTEXTSIZE) == 0 && size >= HEADERSIZE_VER0004)
+	{
+		headerSize = HEADERSIZE_VER0004;
+	}
+	else if (memcmp(bytes, HEADERTEXT_VER0005, HEADERTEXTSIZE) == 0 && size >= HEADERSIZE_VER0005)
+	{
+		headerSize = HEADERSIZE_VER0005;
+	}
+	else if (memcmp(bytes, HEADERTEXT_VER0006, HEADERTEXTSIZE) == 0 && size >= HEADERSIZE_VER0006)
+	{
+		headerSize = HEADERSIZE_VER0006;
+	}
+	else
+	{
+		return 0;
+	}
+
+	// Fields are read with memcpy, as they are not necessarily aligned
+	memcpy(&record->timeStamp, bytes + 16, sizeof(record->timeStamp));
+	memcpy(&record->surfaceWidth, bytes + 24, sizeof(record->surfaceWidth));
+	memcpy(&record->surfaceLength, bytes + 28, sizeof(record->surfaceLength));
+	memcpy(&record->xOffset, bytes + 32, sizeof(record->xOffset));
+	memcpy(&record->xResolution, bytes + 40, sizeof(record->xResolution));
+	memcpy(&record->yOffset, bytes + 48, sizeof(record->yOffset));
+	memcpy(&record->yResolution, bytes + 56, sizeof(record->yResolution));
+	memcpy(&record->zOffset, bytes + 64, sizeof(record->zOffset));
+	memcpy(&record->zResolution, bytes + 72, sizeof(record->zResolution));
+	memcpy(&record->frameRate, bytes + 80, sizeof(record->frameRate));
+	memcpy(&record->exposureTime, bytes + 88, sizeof(record->exposureTime));
+
+	rawSize = (uint64_t)record->surfaceWidth * record->surfaceLength * sizeof(int16_t);
+	dataOffset = headerSize;
+	if (headerSize == HEADERSIZE_VER0001)
+	{
+		record->codec = SURFACECODEC_RAW;
+		record->payloadSize = rawSize;
+	}
+	else
+	{
+		memcpy(&record->codec, bytes + 96, sizeof(record->codec));
+		memcpy(&record->payloadSize, bytes + 104, sizeof(record->payloadSize));
+		if (record->codec != SURFACECODEC_RAW && record->codec != SURFACECODEC_MEDRICE)
+		{
+			return 0;
+		}
+	}
+
+	// VER0003 and later: surface data after padding, and padded at the end (ignored)
+	if (headerSize >= HEADERSIZE_VER0003)
+	{
+		memcpy(&dataOffset, bytes + 112, sizeof(dataOffset));
+		if (dataOffset < headerSize || dataOffset > size || dataOffset > 0xFFFFFFFFu)
+		{
+			return 0;
+		}
+	}
+
+	// VER0004 and later: cropped surface within the full surface (VER0005: full size 0 if not cropped)
+	if (headerSize >= HEADERSIZE_VER0004)
+	{
+		memcpy(&record->cropColumn, bytes + 120, sizeof(record->cropColumn));
+		memcpy(&record->cropRow, bytes + 124, sizeof(record->cropRow));
+		memcpy(&record->fullWidth, bytes + 128, sizeof(record->fullWidth));
+		memcpy(&record->fullLength, bytes + 132, sizeof(record->fullLength));
+		if ((headerSize == HEADERSIZE_VER0004 || record->fullWidth != 0) &&
+			((uint64_t)record->cropColumn + record->surfaceWidth > record->fullWidth ||
+			 (uint64_t)record->cropRow + record->surfaceLength > record->fullLength))
+		{
+			return 0;
+		}
+	}
+
+	// VER0005: tiled payload (SurfaceTiles.h), not row by row even if the tiles are raw (VER0006: tile size 0 if not tiled)
+	if (headerSize >= HEADERSIZE_VER0005)
+	{
+		memcpy(&record->tileWidth, bytes + 136, sizeof(record->tileWidth));
+		memcpy(&record->tileLength, bytes + 140, sizeof(record->tileLength));
+		if ((headerSize == HEADERSIZE_VER0005 || record->tileWidth != 0) && (record->tileWidth == 0 || record->tileLength == 0))
+		{
+			return 0;
+		}
+	}
+
+	// VER0006: header fields must match their checksum; the chunk checksums are checked on request
+	if (headerSize == HEADERSIZE_VER0006)
+	{
+		memcpy(&headerChecksum, bytes + HEADERSIZE_VER0006 - sizeof(headerChecksum), sizeof(headerChecksum));
+		if (SurfaceChecksum_Crc32c(0, bytes, HEADERSIZE_VER0006 - sizeof(headerChecksum)) != headerChecksum)
+		{
+			return 0;
+		}
+		memcpy(&record->checksumChunkSize, bytes + 144, sizeof(record->checksumChunkSize));
+		memcpy(&record->checksumChunkCount, bytes + 148, sizeof(record->checksumChunkCount));
+		memcpy(record->chunkChecksums, bytes + 152, sizeof(record->chunkChecksums));
+		if (record->checksumChunkSize == 0 ||
+			record->checksumChunkCount != SurfaceChecksum_ChunkCount(record->payloadSize, record->checksumChunkSize) ||
+			record->checksumChunkCount > SURFACECHECKSUM_MAXCHUNKS)
+		{
+			return 0;
+		}
+	}
+
+	if ((record->codec == SURFACECODEC_RAW && record->tileWidth == 0 && record->payloadSize != rawSize) ||
+		record->payloadSize > size - dataOffset)
+	{
+		return 0;
+	}
+
+	record->payload = bytes + dataOffset;
+	if (record->codec == SURFACECODEC_RAW && record->tileWidth == 0)
+	{
+		record->data = (int16_t *)(bytes + dataOffset);
+	}
+	return (uint32_t)dataOffset;
+}
@@ -0,0 +1,107 @@
+/*
+* SurfaceFormat.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Constants describing the Gocator surface file format, and the
+* in-memory surface record that is written by the logger.
+* See ReceiveSurfaceAsync.c for the layout of the surface files.
+*/
+
+#ifndef SURFACE_FORMAT_H
+#define SURFACE_FORMAT_H
+
+#include <stdio.h>
+#include "GoLogPlatform.h"
+#include "SurfacePyramid.h"
+
+#define INVALID_RANGE_16BIT		((signed short)0x8000)			// gocator transmits range data as 16-bit signed integers. 0x8000 signifies invalid range data.
+
+#define DATAFILENAMESUFFIX		"GocatorSurface.bin"
+#define HEADERTEXT				"MHSKJELV VER0001"
+#define HEADERTEXT_VER0002		"MHSKJELV VER0002"
+#define HEADERTEXT_VER0003		"MHSKJELV VER0003"
+#define HEADERTEXT_VER0004		"MHSKJELV VER0004"
+#define HEADERTEXT_VER0005		"MHSKJELV VER0005"
+#define HEADERTEXT_VER0006		"MHSKJELV VER0006"
+#define HEADERTEXTSIZE			16
+#define HEADERSIZE_VER0001		96			// Bytes before surface data in a VER0001 file
+#define HEADERSIZE_VER0002		112			// Bytes before surface data in a VER0002 file
+#define HEADERSIZE_VER0003		120			// Header fields of a VER0003 file (surface data starts at dataOffset)
+#define HEADERSIZE_VER0004		136			// Header fields of a VER0004 (cropped) file (surface data starts at dataOffset)
+#define HEADERSIZE_VER0005		144			// Header fields of a VER0005 (tiled) file (surface data starts at dataOffset)
+#define HEADERSIZE_VER0006		288			// Header fields of a VER0006 (checksummed) file (surface data starts at dataOffset)
+#define HEADERSIZE_MAX			HEADERSIZE_VER0006
+#define SURFACECHECKSUM_MAXCHUNKS	32		// Payload chunks with their own checksum in a VER0006 header (SurfaceChecksum.h)
+#define SURFACEFILENAMESIZE		48			// Room for the name (without folder) of a surface or session file
+
+// A captured surface with all header information
+typedef struct
+{
+	uint32_t count;						// Surface number
+	uint64_t timeStamp;					// Sensor time stamp
+	uint64_t frameIndex;				// Sensor frame index (stored in container index only)
+	uint32_t lostBefore;				// Surfaces lost (by sensor/SDK or dropped) since previous written surface (container index only)
+	uint32_t surfaceWidth;
+	uint32_t surfaceLength;
+	uint32_t cropColumn;				// Position of the surface in the full sensor surface, if cropped
+	uint32_t cropRow;
+	uint32_t fullWidth;					// Size of the full sensor surface if cropped (SurfaceCrop.h), 0 if not
+	uint32_t fullLength;
+	uint32_t tileWidth;					// Tile size of a tiled payload (SurfaceTiles.h), 0 if stored row by row
+	uint32_t tileLength;
+	uint32_t checksumChunkSize;			// Payload bytes per chunk checksum (SurfaceChecksum.h), 0 if there are no checksums
+	uint32_t checksumChunkCount;
+	uint32_t chunkChecksums[SURFACECHECKSUM_MAXCHUNKS];	// CRC32C of each chunk of the payload
+	double xOffset;						// mm
+	double xResolution;					// mm
+	double yOffset;						// mm
+	double yResolution;					// mm
+	double zOffset;						// mm
+	double zResolution;					// mm
+	double frameRate;
+	double exposureTime;
+	GoLogWallTime receiveTime;			// Host time when the surface was received (used in file name)
+	int16_t *data;						// surfaceWidth*surfaceLength samples, row by row
+	uint32_t codec;						// Payload coding (SurfaceCodec.h). SURFACECODEC_RAW is written as VER0001, others as VER0002
+	const void *payload;				// Surface data as written to file - data itself, or encoded or tiled data
+	uint64_t payloadSize;				// Bytes in payload
+	uint64_t receiveNs;					// Monotonic time when the callback received the surface (index only)
+	uint64_t captureHostNs;				// Monotonic time of the sensor time stamp, from the clock model (index only, 0 = unknown)
+	uint64_t captureWallNs;				// Wall clock time of the sensor time stamp (ns since 1970 UTC, index only, 0 = unknown)
+	uint64_t validCount;				// Valid samples before cropping, from SurfaceStats.h (index only)
+	double zMin;						// mm, of the valid samples (index only, 0 if none)
+	double zMax;						// mm
+	double zMean;						// mm
+	double zStdDev;						// mm, population standard deviation
+	uint64_t submitNs;					// Monotonic time when the surface was queued for writing (not stored)
+	const void *bufferRegion;			// Memory block containing data (e.g. for registering with the OS), or NULL
+	uint64_t bufferRegionSize;
+	const SurfacePyramid *pyramid;		// Overview levels of data (stored by containers only), or NULL
+	char fileName[SURFACEFILENAMESIZE];	// Set by the sink: file the surface was written to (without folder)
+	uint64_t fileOffset;				// Set by the sink: offset of the surface header in fileName (0 for separate files)
+}SurfaceRecord;
+
+// Size of the file header written for record
+uint32_t SurfaceFormat_HeaderSize(const SurfaceRecord *record);
+
+// Write file header for record (SurfaceFormat_HeaderSize bytes). Returns 0 on success.
+int SurfaceFormat_WriteHeader(FILE *fptr, const SurfaceRecord *record);
+
+// Store file header for record in buffer (room for HEADERSIZE_MAX bytes). Returns header size.
+uint32_t SurfaceFormat_EncodeHeader(uint8_t *buffer, const SurfaceRecord *record);
+
+// Store VER0003 header (VER0004 if the record is cropped, VER0005 if tiled, VER0006 if it has checksums) for record in
+// buffer, zero padded to a multiple of alignment (at least HEADERSIZE_MAX bytes). Returns the padded size, which is where
+// the surface data starts.
+uint32_t SurfaceFormat_EncodeAlignedHeader(uint8_t *buffer, const SurfaceRecord *record, uint32_t alignment);
+
+// Parse surface file header from the size bytes at bytes, and check that the surface data is complete.
+// Fills the header fields of record; payload points to the surface data within bytes, and data points
+// to it as well if the surface is raw and not tiled (NULL otherwise). The crop and tile fields are cleared
+// for files that are not cropped or tiled. count and receiveTime are not stored in files and are cleared. The header
+// checksum of VER0006 files is checked; the chunk checksums are only read (see SurfaceChecksum_Verify). Returns the
+// offset of the surface data (header size, or dataOffset for VER0003), or 0 if the bytes do not contain a valid surface.
+uint32_t SurfaceFormat_ParseHeader(const uint8_t *bytes, uint64_t size, SurfaceRecord *record);
+
+#endif // SURFACE_FORMAT_H
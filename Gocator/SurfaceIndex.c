@@ -0,0 +1,492 @@
+/*
+* SurfaceIndex.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Time stamp index of a logging session (see SurfaceIndex.h for the
+* file format). Entries are appended as surfaces are written, so an index is
+* usable even if the logger is not stopped properly. Asynchronous sinks may
+* finish surfaces out of order; the entries are then sorted when the index is
+* closed.
+*/
+
+#include "SurfaceIndex.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Order by surface number, the order the surfaces were received in. The sensor time stamps are not used, as they
+// start over when the sensor restarts.
+static int SurfaceIndex_CompareEntries(const void *a, const void *b)
+{
+	const SurfaceIndexEntry *entryA = a;
+	const SurfaceIndexEntry *entryB = b;
+
+	if (entryA->count != entryB->count)
+	{
+		return entryA->count < entryB->count ? -1 : 1;
+	}
+	return 0;
+}
+
+static int SurfaceIndexWriter_WriteHeader(SurfaceIndexWriter *index, uint32_t flags, uint64_t entryCount)
+{
+	uint32_t entrySize = INDEXENTRYSIZE;
+
+	if (fseek(index->fptr, 0, SEEK_SET) != 0)
+	{
+		return -1;
+	}
+	fwrite(INDEXHEADERTEXT, HEADERTEXTSIZE, 1, index->fptr);
+	fwrite(&entrySize, sizeof(entrySize), 1, index->fptr);
+	fwrite(&flags, sizeof(flags), 1, index->fptr);
+	return fwrite(&entryCount, sizeof(entryCount), 1, index->fptr) == 1 ? 0 : -1;
+}
+
+int SurfaceIndexWriter_Open(SurfaceIndexWriter *index, const char *filename)
+{
+	memset(index, 0, sizeof(*index));
+	index->sorted = 1;
+	if ((index->fptr = fopen(filename, "w+b")) == NULL)
+	{
+		printf("Error opening file %s\n", filename);
+		return -1;
+	}
+	if (SurfaceIndexWriter_WriteHeader(index, 0, 0) != 0)
+	{
+		fclose(index->fptr);
+		index->fptr = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+int SurfaceIndexWriter_Add(SurfaceIndexWriter *index, const SurfaceRecord *record)
+{
+	SurfaceIndexEntry entry;
+	uint64_t samples;
+
+	memset(&entry, 0, sizeof(entry));
+	entry.timeStamp = record->timeStamp;
+	entry.hostNs = record->receiveNs;
+	entry.wallTimeMs = SurfaceIndex_WallTimeMs(&record->receiveTime);
+	entry.fileOffset = record->fileOffset;
+	entry.count = record->count;
+	entry.surfaceWidth = record->surfaceWidth;
+	entry.surfaceLength = record->surfaceLength;
+	memcpy(entry.fileName, record->fileName, sizeof(entry.fileName));
+	entry.fileName[SURFACEFILENAMESIZE - 1] = 0;
+	entry.captureHostNs = record->captureHostNs;
+	entry.captureWallNs = record->captureWallNs;
+	entry.validCount = record->validCount;
+	samples = record->fullWidth ? (uint64_t)record->fullWidth * record->fullLength : (uint64_t)record->surfaceWidth * record->surfaceLength;
+	entry.validFraction = samples ? (double)record->validCount / samples : 0.0;
+	entry.zMin = record->zMin;
+	entry.zMax = record->zMax;
+	entry.zMean = record->zMean;
+	entry.zStdDev = record->zStdDev;
+
+	if (fwrite(&entry, sizeof(entry), 1, index->fptr) != 1)
+	{
+		index->writeErrors++;
+		return -1;
+	}
+	if (index->entryCount > 0 && entry.count < index->lastCount)
+	{
+		index->sorted = 0;
+	}
+	index->lastCount = entry.count;
+	index->entryCount++;
+	return 0;
+}
+
+void SurfaceIndexWriter_Flush(SurfaceIndexWriter *index)
+{
+	fflush(index->fptr);
+}
+
+int SurfaceIndexWriter_Close(SurfaceIndexWriter *index)
+{
+	SurfaceIndexEntry *entries = NULL;
+	size_t count = (size_t)index->entryCount;
+	int result = index->writeErrors > 0 ? -1 : 0;
+
+	// Surfaces finished out of order - read entries back and rewrite them sorted
+	if (!index->sorted && result == 0)
+	{
+		if ((entries = malloc(count * sizeof(SurfaceIndexEntry))) == NULL ||
+			fseek(index->fptr, INDEXHEADERSIZE, SEEK_SET) != 0 ||
+			fread(entries, sizeof(SurfaceIndexEntry), count, index->fptr) != count)
+		{
+			result = -1;
+		}
+		else
+		{
+			qsort(entries, count, sizeof(SurfaceIndexEntry), SurfaceIndex_CompareEntries);
+			if (fseek(index->fptr, INDEXHEADERSIZE, SEEK_SET) != 0 ||
+				fwrite(entries, sizeof(SurfaceIndexEntry), count, index->fptr) != count)
+			{
+				result = -1;
+			}
+			else
+			{
+				index->sorted = 1;
+			}
+		}
+		free(entries);
+	}
+
+	// Header is only completed if all entries are in the file; otherwise readers use the file size
+	if (result == 0 && SurfaceIndexWriter_WriteHeader(index, index->sorted ? INDEXFLAG_SORTED : 0, index->entryCount) != 0)
+	{
+		result = -1;
+	}
+	if (fclose(index->fptr) != 0)
+	{
+		result = -1;
+	}
+	index->fptr = NULL;
+	return result;
+}
+
+// Split the sorted entries into segments of increasing sensor time stamps. Returns 0 on success.
+static int SurfaceIndex_FindSegments(SurfaceIndex *index)
+{
+	uint64_t previous = 0;
+	uint64_t i;
+	uint32_t segment = 0;
+
+	for (i = 0; i < index->entryCount; i++)
+	{
+		uint64_t timeStamp = SurfaceIndex_Entry(index, i)->timeStamp;
+
+		if (i == 0 || timeStamp < previous)
+		{
+			index->segmentCount++;
+		}
+		previous = timeStamp;
+	}
+	if ((index->segmentStarts = malloc((index->segmentCount + 1) * sizeof(uint64_t))) == NULL)
+	{
+		return -1;
+	}
+	for (i = 0; i < index->entryCount; i++)
+	{
+		uint64_t timeStamp = SurfaceIndex_Entry(index, i)->timeStamp;
+
+		if (i == 0 || timeStamp < previous)
+		{
+			index->segmentStarts[segment++] = i;
+		}
+		previous = timeStamp;
+	}
+	index->segmentStarts[segment] = index->entryCount;
+	return 0;
+}
+
+int SurfaceIndex_Open(SurfaceIndex *index, const char *path)
+{
+	const uint8_t *bytes;
+	uint32_t flags;
+	uint64_t entryCount;
+	uint64_t i;
+
+	memset(index, 0, sizeof(*index));
+	if (GoLog_MapFile(&index->map, path) != 0)
+	{
+		return -1;
+	}
+	bytes = index->map.data;
+	if (index->map.size < INDEXHEADERSIZE || memcmp(bytes, INDEXHEADERTEXT, HEADERTEXTSIZE) != 0)
+	{
+		SurfaceIndex_Close(index);
+		return -1;
+	}
+	memcpy(&index->entrySize, bytes + 16, sizeof(uint32_t));
+	memcpy(&flags, bytes + 20, sizeof(uint32_t));
+	memcpy(&entryCount, bytes + 24, sizeof(uint64_t));
+	if (index->entrySize < sizeof(SurfaceIndexEntry))
+	{
+		SurfaceIndex_Close(index);
+		return -1;
+	}
+	index->entries = bytes + INDEXHEADERSIZE;
+	index->entryCount = (index->map.size - INDEXHEADERSIZE) / index->entrySize;
+
+	if ((flags & INDEXFLAG_SORTED) && entryCount <= index->entryCount)
+	{
+		index->entryCount = entryCount;
+	}
+	else if (index->entryCount > 0)
+	{
+		// Index not closed - sort a copy of the complete entries
+		if ((index->sortedEntries = malloc((size_t)index->entryCount * sizeof(SurfaceIndexEntry))) == NULL)
+		{
+			SurfaceIndex_Close(index);
+			return -1;
+		}
+		for (i = 0; i < index->entryCount; i++)
+		{
+			memcpy(&index->sortedEntries[i], index->entries + i * index->entrySize, sizeof(SurfaceIndexEntry));
+		}
+		qsort(index->sortedEntries, (size_t)index->entryCount, sizeof(SurfaceIndexEntry), SurfaceIndex_CompareEntries);
+	}
+
+	if (SurfaceIndex_FindSegments(index) != 0)
+	{
+		SurfaceIndex_Close(index);
+		return -1;
+	}
+	return 0;
+}
+
+const SurfaceIndexEntry *SurfaceIndex_Entry(const SurfaceIndex *index, uint64_t idx)
+{
+	if (idx >= index->entryCount)
+	{
+		return NULL;
+	}
+	if (index->sortedEntries != NULL)
+	{
+		return &index->sortedEntries[idx];
+	}
+	return (const SurfaceIndexEntry *)(index->entries + idx * index->entrySize);
+}
+
+uint64_t SurfaceIndex_Key(const SurfaceIndexEntry *entry, SurfaceIndexKey key)
+{
+	switch (key)
+	{
+	case SURFACEINDEX_KEY_HOST:
+		return entry->hostNs;
+	case SURFACEINDEX_KEY_WALL:
+		return entry->wallTimeMs;
+	case SURFACEINDEX_KEY_CAPTURE:
+		return entry->captureWallNs;
+	default:
+		return entry->timeStamp;
+	}
+}
+
+uint32_t SurfaceIndex_SegmentCount(const SurfaceIndex *index)
+{
+	return index->segmentCount;
+}
+
+uint64_t SurfaceIndex_Segment(const SurfaceIndex *index, uint32_t segment, uint64_t *first)
+{
+	if (segment >= index->segmentCount)
+	{
+		*first = index->entryCount;
+		return 0;
+	}
+	*first = index->segmentStarts[segment];
+	return index->segmentStarts[segment + 1] - *first;
+}
+
+// Index of first entry from begin to end with key time or later (end if none)
+static uint64_t SurfaceIndex_LowerBoundIn(const SurfaceIndex *index, SurfaceIndexKey key, uint64_t time, uint64_t begin,
+	uint64_t end)
+{
+	uint64_t low = begin;
+	uint64_t high = end;
+
+	while (low < high)
+	{
+		uint64_t middle = low + (high - low) / 2;
+
+		if (SurfaceIndex_Key(SurfaceIndex_Entry(index, middle), key) < time)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return low;
+}
+
+// Index of entry from begin to end (not empty) closest to time
+static uint64_t SurfaceIndex_NearestIn(const SurfaceIndex *index, SurfaceIndexKey key, uint64_t time, uint64_t begin,
+	uint64_t end)
+{
+	uint64_t idx = SurfaceIndex_LowerBoundIn(index, key, time, begin, end);
+
+	if (idx == end)
+	{
+		return idx - 1;
+	}
+	if (idx > begin && time - SurfaceIndex_Key(SurfaceIndex_Entry(index, idx - 1), key) <=
+		SurfaceIndex_Key(SurfaceIndex_Entry(index, idx), key) - time)
+	{
+		return idx - 1;
+	}
+	return idx;
+}
+
+// Entries from begin to end with key from fromTime to toTime (inclusive)
+static uint64_t SurfaceIndex_RangeIn(const SurfaceIndex *index, SurfaceIndexKey key, uint64_t fromTime, uint64_t toTime,
+	uint64_t begin, uint64_t end, uint64_t *first)
+{
+	*first = SurfaceIndex_LowerBoundIn(index, key, fromTime, begin, end);
+	if (toTime < fromTime)
+	{
+		return 0;
+	}
+	if (toTime != UINT64_MAX)
+	{
+		end = SurfaceIndex_LowerBoundIn(index, key, toTime + 1, *first, end);
+	}
+	return end - *first;
+}
+
+uint64_t SurfaceIndex_LowerBound(const SurfaceIndex *index, SurfaceIndexKey key, uint64_t time)
+{
+	uint32_t segment;
+
+	if (key != SURFACEINDEX_KEY_SENSOR)
+	{
+		return SurfaceIndex_LowerBoundIn(index, key, time, 0, index->entryCount);
+	}
+	for (segment = 0; segment < index->segmentCount; segment++)
+	{
+		uint64_t end = index->segmentStarts[segment + 1];
+		uint64_t idx = SurfaceIndex_LowerBoundIn(index, key, time, index->segmentStarts[segment], end);
+
+		if (idx < end)
+		{
+			return idx;
+		}
+	}
+	return index->entryCount;
+}
+
+int64_t SurfaceIndex_Nearest(const SurfaceIndex *index, SurfaceIndexKey key, uint64_t time)
+{
+	uint64_t nearest;
+	uint64_t nearestDistance;
+	uint32_t segment;
+
+	if (index->entryCount == 0)
+	{
+		return -1;
+	}
+	if (key != SURFACEINDEX_KEY_SENSOR)
+	{
+		return (int64_t)SurfaceIndex_NearestIn(index, key, time, 0, index->entryCount);
+	}
+
+	// Closest of the closest entries of each segment (the earliest segment if equally close)
+	nearest = index->entryCount;
+	nearestDistance = UINT64_MAX;
+	for (segment = 0; segment < index->segmentCount; segment++)
+	{
+		uint64_t idx = SurfaceIndex_NearestIn(index, key, time, index->segmentStarts[segment], index->segmentStarts[segment + 1]);
+		uint64_t timeStamp = SurfaceIndex_Entry(index, idx)->timeStamp;
+		uint64_t distance = (timeStamp > time) ? timeStamp - time : time - timeStamp;
+
+		if (distance < nearestDistance)
+		{
+			nearest = idx;
+			nearestDistance = distance;
+		}
+	}
+	return (int64_t)nearest;
+}
+
+uint64_t SurfaceIndex_Range(const SurfaceIndex *index, SurfaceIndexKey key, uint64_t fromTime, uint64_t toTime, uint64_t *first)
+{
+	uint32_t segment;
+
+	if (key != SURFACEINDEX_KEY_SENSOR)
+	{
+		return SurfaceIndex_RangeIn(index, key, fromTime, toTime, 0, index->entryCount, first);
+	}
+	for (segment = 0; segment < index->segmentCount; segment++)
+	{
+		uint64_t count = SurfaceIndex_SegmentRange(index, segment, fromTime, toTime, first);
+
+		if (count > 0)
+		{
+			return count;
+		}
+	}
+	*first = SurfaceIndex_LowerBound(index, key, fromTime);
+	return 0;
+}
+
+uint64_t SurfaceIndex_SegmentRange(const SurfaceIndex *index, uint32_t segment, uint64_t fromTime, uint64_t toTime,
+	uint64_t *first)
+{
+	if (segment >= index->segmentCount)
+	{
+		*first = index->entryCount;
+		return 0;
+	}
+	return SurfaceIndex_RangeIn(index, SURFACEINDEX_KEY_SENSOR, fromTime, toTime, index->segmentStarts[segment],
+		index->segmentStarts[segment + 1], first);
+}
+
+void SurfaceIndex_Close(SurfaceIndex *index)
+{
+	free(index->sortedEntries);
+	index->sortedEntries = NULL;
+	free(index->segmentStarts);
+	index->segmentStarts = NULL;
+	index->segmentCount = 0;
+	if (index->map.data != NULL)
+	{
+		GoLog_UnmapFile(&index->map);
+	}
+	index->entryCount = 0;
+}
+
+// Days since 1970-01-01 of a date in the proleptic Gregorian calendar
+static int64_t SurfaceIndex_DaysFromCivil(int year, int month, int day)
+{
+	int64_t era;
+	int64_t yearOfEra;
+	int64_t dayOfYear;
+	int64_t dayOfEra;
+
+	year -= month <= 2;
+	era = (year >= 0 ? year : year - 399) / 400;
+	yearOfEra = year - era * 400;
+	dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+	return era * 146097 + dayOfEra - 719468;
+}
+
+uint64_t SurfaceIndex_WallTimeMs(const GoLogWallTime *wallTime)
+{
+	int64_t days = SurfaceIndex_DaysFromCivil(wallTime->year, wallTime->month, wallTime->day);
+	int64_t seconds = days * 86400 + wallTime->hour * 3600 + wallTime->minute * 60 + wallTime->second;
+
+	return (uint64_t)(seconds * 1000 + wallTime->millisecond);
+}
+
+void SurfaceIndex_WallTime(uint64_t wallTimeMs, GoLogWallTime *wallTime)
+{
+	int64_t days = (int64_t)(wallTimeMs / 86400000u);
+	int64_t msOfDay = (int64_t)(wallTimeMs % 86400000u);
+	int64_t era;
+	int64_t dayOfEra;
+	int64_t yearOfEra;
+	int64_t dayOfYear;
+	int64_t monthIndex;
+
+	// Inverse of SurfaceIndex_DaysFromCivil
+	days += 719468;
+	era = days / 146097;
+	dayOfEra = days - era * 146097;
+	yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+	dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	monthIndex = (5 * dayOfYear + 2) / 153;
+	wallTime->day = (int)(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+	wallTime->month = (int)(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+	wallTime->year = (int)(yearOfEra + era * 400 + (wallTime->month <= 2));
+	wallTime->hour = (int)(msOfDay / 3600000);
+	wallTime->minute = (int)(msOfDay / 60000 % 60);
+	wallTime->second = (int)(msOfDay / 1000 % 60);
+	wallTime->millisecond = (int)(msOfDay % 1000);
+}
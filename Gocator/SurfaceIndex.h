@@ -0,0 +1,167 @@
+/*
+* SurfaceIndex.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Time stamp index of a logging session, for finding the surface
+* closest to a given time (e.g. to align with frames from other cameras)
+* without opening the surface files.
+*
+* The writer thread adds an entry for every surface written, and the index is
+* sorted by surface number (the order the surfaces were received in) when it
+* is closed. The host receive and capture times increase with the surface
+* number, so the index can be searched by them in O(log n). The sensor time
+* stamps start over when the sensor restarts; they only increase within a
+* segment of the index between restarts, and are searched segment by
+* segment (FrameMonitor.h and ClockModel.h detect the same restarts). Each
+* entry also holds summary statistics of the surface heights (SurfaceStats.h),
+* so that surfaces can be selected by their content without opening the
+* surface files.
+*
+* Index files have the following format:
+*
+* File header (32 bytes):
+* char[16]				headerText			"MHSKJELV IDX0001"
+* uint32				entrySize			Size of one entry (160 bytes)
+* uint32				flags				1 = sorted by surface number (set when the index is closed)
+* uint64				entryCount			0 until the index is closed
+*
+* Entries (one per surface):
+* uint64				timeStamp			Sensor time stamp (us)
+* uint64				hostNs				Host monotonic time when the surface was received (ns, GoLog_MonotonicNs)
+* uint64				wallTimeMs			Host wall clock time when received (ms since 1970-01-01 UTC)
+* uint64				fileOffset			Offset of the surface header in fileName (0 for separate surface files)
+* uint32				count				Surface number
+* uint32				surfaceWidth
+* uint32				surfaceLength
+* uint32				reserved
+* char[48]				fileName			Surface or session file (in the same folder as the index), zero terminated
+* uint64				captureHostNs		Host monotonic time of the sensor time stamp (ns, see ClockModel.h); 0 if unknown
+* uint64				captureWallNs		Host wall clock time of the sensor time stamp (ns since 1970-01-01 UTC); 0 if unknown
+* uint64				validCount			Valid samples of the surface
+* double				validFraction		validCount / samples of the full surface (before cropping)
+* double				zMin				Smallest valid height (mm); 0 if no sample is valid
+* double				zMax				Largest valid height (mm)
+* double				zMean				Mean of the valid heights (mm)
+* double				zStdDev				Population standard deviation of the valid heights (mm)
+*
+* The receive times are when the data callback got the surface, after a
+* variable network and SDK delay; the capture times map the sensor time stamp
+* to the host clocks with the clock model, and should be used to correlate
+* with other cameras.
+*
+* Readers must use entrySize to step through the entries, so that fields can
+* be added at the end of an entry. If the logger was not stopped properly the
+* header is not updated; all complete entries are then used, and sorted when
+* the index is opened.
+*/
+
+#ifndef SURFACE_INDEX_H
+#define SURFACE_INDEX_H
+
+#include "GoLogPlatform.h"
+#include "SurfaceFormat.h"
+
+#define INDEXFILENAMESUFFIX			"GocatorIndex.bin"
+#define INDEXHEADERTEXT				"MHSKJELV IDX0001"
+#define INDEXHEADERSIZE				32
+#define INDEXENTRYSIZE				160
+#define INDEXFLAG_SORTED			1
+
+typedef struct
+{
+	uint64_t timeStamp;
+	uint64_t hostNs;
+	uint64_t wallTimeMs;
+	uint64_t fileOffset;
+	uint32_t count;
+	uint32_t surfaceWidth;
+	uint32_t surfaceLength;
+	uint32_t reserved;
+	char fileName[SURFACEFILENAMESIZE];
+	uint64_t captureHostNs;
+	uint64_t captureWallNs;
+	uint64_t validCount;
+	double validFraction;
+	double zMin;
+	double zMax;
+	double zMean;
+	double zStdDev;
+}SurfaceIndexEntry;
+
+typedef enum
+{
+	SURFACEINDEX_KEY_SENSOR,			// timeStamp
+	SURFACEINDEX_KEY_HOST,				// hostNs
+	SURFACEINDEX_KEY_WALL,				// wallTimeMs
+	SURFACEINDEX_KEY_CAPTURE			// captureWallNs
+}SurfaceIndexKey;
+
+// Index being written by the logger
+typedef struct
+{
+	FILE *fptr;
+	uint64_t entryCount;
+	uint32_t lastCount;
+	int sorted;							// Entries have been added in surface number order so far
+	uint64_t writeErrors;
+}SurfaceIndexWriter;
+
+// Index opened for searching
+typedef struct
+{
+	GoLogMappedFile map;
+	const uint8_t *entries;
+	uint32_t entrySize;
+	uint64_t entryCount;
+	SurfaceIndexEntry *sortedEntries;	// Sorted copy if the index in the file is not sorted
+	uint64_t *segmentStarts;			// First entry of each restart segment, and entryCount at the end
+	uint32_t segmentCount;
+}SurfaceIndex;
+
+// Create index file. Returns 0 on success.
+int SurfaceIndexWriter_Open(SurfaceIndexWriter *index, const char *filename);
+
+// Add written surface (fileName and fileOffset set by the sink). Returns 0 on success.
+int SurfaceIndexWriter_Add(SurfaceIndexWriter *index, const SurfaceRecord *record);
+
+// Write buffered entries to the file
+void SurfaceIndexWriter_Flush(SurfaceIndexWriter *index);
+
+// Sort entries if needed, complete the header and close the file. Returns 0 on success.
+int SurfaceIndexWriter_Close(SurfaceIndexWriter *index);
+
+// Open index file for searching. Returns 0 on success.
+int SurfaceIndex_Open(SurfaceIndex *index, const char *path);
+
+const SurfaceIndexEntry *SurfaceIndex_Entry(const SurfaceIndex *index, uint64_t idx);
+
+uint64_t SurfaceIndex_Key(const SurfaceIndexEntry *entry, SurfaceIndexKey key);
+
+// Number of restart segments (1 if the sensor was not restarted, 0 if the index is empty). Returns the number of
+// entries of segment, and its first entry in *first.
+uint32_t SurfaceIndex_SegmentCount(const SurfaceIndex *index);
+uint64_t SurfaceIndex_Segment(const SurfaceIndex *index, uint32_t segment, uint64_t *first);
+
+// Index of first entry with key time or later (entryCount if none). With SURFACEINDEX_KEY_SENSOR, the first
+// such entry of the first segment that has one.
+uint64_t SurfaceIndex_LowerBound(const SurfaceIndex *index, SurfaceIndexKey key, uint64_t time);
+
+// Index of entry closest to time (with SURFACEINDEX_KEY_SENSOR, of all segments). Returns -1 if the index is empty.
+int64_t SurfaceIndex_Nearest(const SurfaceIndex *index, SurfaceIndexKey key, uint64_t time);
+
+// Entries with key from fromTime to toTime (inclusive): returns number of entries, and the first in *first.
+// With SURFACEINDEX_KEY_SENSOR, the entries of the first segment that has any (see SurfaceIndex_SegmentRange).
+uint64_t SurfaceIndex_Range(const SurfaceIndex *index, SurfaceIndexKey key, uint64_t fromTime, uint64_t toTime, uint64_t *first);
+
+// Entries of segment with sensor time stamps from fromTime to toTime (inclusive), as SurfaceIndex_Range
+uint64_t SurfaceIndex_SegmentRange(const SurfaceIndex *index, uint32_t segment, uint64_t fromTime, uint64_t toTime,
+	uint64_t *first);
+
+void SurfaceIndex_Close(SurfaceIndex *index);
+
+// Conversion between wall clock time and ms since 1970-01-01 UTC
+uint64_t SurfaceIndex_WallTimeMs(const GoLogWallTime *wallTime);
+void SurfaceIndex_WallTime(uint64_t wallTimeMs, GoLogWallTime *wallTime);
+
+#endif // SURFACE_INDEX_H
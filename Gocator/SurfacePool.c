@@ -0,0 +1,227 @@
+/*
+* SurfacePool.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Preallocated surface buffer pool (see SurfacePool.h).
+* A block is one OS allocation divided into equal slots. Each slot holds the
+* surface data first (page aligned) and the buffer header at the end. All
+* bookkeeping except the returned queue is done on the producer thread.
+*/
+
+#include "SurfacePool.h"
+#include "SurfaceCodec.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define POOL_SLOT_ALIGNMENT		4096	// Surface data starts on a page boundary
+
+struct SurfacePoolBlock
+{
+	uint8_t *memory;
+	size_t size;						// Bytes allocated (may be rounded up for huge pages)
+	size_t slotSize;
+	size_t dataCapacity;				// Bytes of surface data a slot can hold
+	uint32_t unused;					// Slots never handed out
+	uint32_t outstanding;				// Buffers taken and not yet given back
+	int hugePages;
+};
+
+struct SurfacePoolBuffer
+{
+	SurfaceRecord record;				// Must be first
+	SurfacePoolBlock *block;
+	SurfacePoolBuffer *next;			// Spare list
+};
+
+static size_t SurfacePool_RoundUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+static SurfacePoolBlock *SurfacePoolBlock_Create(SurfacePool *pool, size_t dataSize)
+{
+	SurfacePoolBlock *block = calloc(1, sizeof(SurfacePoolBlock));
+	size_t headerSize = SurfacePool_RoundUp(sizeof(SurfacePoolBuffer), GOLOG_CACHE_LINE);
+
+	if (block == NULL)
+	{
+		return NULL;
+	}
+	block->slotSize = SurfacePool_RoundUp(dataSize + headerSize, POOL_SLOT_ALIGNMENT);
+	block->dataCapacity = block->slotSize - headerSize;
+	block->size = block->slotSize * pool->bufferCount;
+	block->hugePages = pool->hugePages;
+	block->unused = pool->bufferCount;
+
+	if ((block->memory = GoLog_AllocPages(&block->size, &block->hugePages)) == NULL)
+	{
+		free(block);
+		return NULL;
+	}
+	return block;
+}
+
+static void SurfacePoolBlock_Destroy(SurfacePoolBlock *block)
+{
+	GoLog_FreePages(block->memory, block->size);
+	free(block);
+}
+
+// A buffer of block is no longer used. Frees the block if it is retired and this was its last buffer.
+static void SurfacePool_Release(SurfacePool *pool, SurfacePoolBuffer *buffer)
+{
+	SurfacePoolBlock *block = buffer->block;
+
+	block->outstanding--;
+	GoLogAtomic_Store32(&pool->inUse, pool->inUse - 1);
+	if (block == pool->retired && block->outstanding == 0)
+	{
+		SurfacePoolBlock_Destroy(block);
+		pool->retired = NULL;
+	}
+}
+
+// Replace current block by one with room for dataSize bytes per buffer. Returns 0 on success.
+static int SurfacePool_Grow(SurfacePool *pool, size_t dataSize)
+{
+	SurfacePoolBlock *block;
+	SurfacePoolBuffer *buffer;
+
+	// Only one old block is kept waiting; another change must wait until it has been freed
+	while (pool->retired != NULL && (buffer = SpscQueue_Pop(&pool->returned)) != NULL)
+	{
+		SurfacePool_Release(pool, buffer);
+	}
+	if (pool->retired != NULL)
+	{
+		return -1;
+	}
+
+	if ((block = SurfacePoolBlock_Create(pool, dataSize)) == NULL)
+	{
+		GoLogAtomic_Store64(&pool->allocFailures, pool->allocFailures + 1);
+		return -1;
+	}
+
+	if (pool->current != NULL)
+	{
+		pool->retired = pool->current;
+		pool->spare = NULL;
+		while ((buffer = SpscQueue_Pop(&pool->returned)) != NULL)
+		{
+			SurfacePool_Release(pool, buffer);
+		}
+		if (pool->retired != NULL && pool->retired->outstanding == 0)
+		{
+			SurfacePoolBlock_Destroy(pool->retired);
+			pool->retired = NULL;
+		}
+		GoLogAtomic_Store64(&pool->regrows, pool->regrows + 1);
+	}
+	pool->current = block;
+	GoLogAtomic_Store32(&pool->usingHugePages, (uint32_t)block->hugePages);
+	GoLogAtomic_Store64(&pool->blockBytes, block->size);
+	return 0;
+}
+
+int SurfacePool_Init(SurfacePool *pool, uint32_t bufferCount, int hugePages)
+{
+	memset(pool, 0, sizeof(*pool));
+	pool->bufferCount = bufferCount > 0 ? bufferCount : 1;
+	pool->hugePages = hugePages;
+
+	// Room for all buffers of the current and a retired block
+	return SpscQueue_Init(&pool->returned, 2 * pool->bufferCount);
+}
+
+void SurfacePool_Destroy(SurfacePool *pool)
+{
+	if (pool->current != NULL)
+	{
+		SurfacePoolBlock_Destroy(pool->current);
+		pool->current = NULL;
+	}
+	if (pool->retired != NULL)
+	{
+		SurfacePoolBlock_Destroy(pool->retired);
+		pool->retired = NULL;
+	}
+	pool->spare = NULL;
+	SpscQueue_Destroy(&pool->returned);
+}
+
+void SurfacePool_Put(SurfacePool *pool, SurfaceRecord *record)
+{
+	SurfacePoolBuffer *buffer = (SurfacePoolBuffer *)record;
+
+	if (buffer->block == pool->current)
+	{
+		buffer->block->outstanding--;
+		GoLogAtomic_Store32(&pool->inUse, pool->inUse - 1);
+		buffer->next = pool->spare;
+		pool->spare = buffer;
+	}
+	else
+	{
+		SurfacePool_Release(pool, buffer);
+	}
+}
+
+SurfaceRecord *SurfacePool_Get(SurfacePool *pool, uint32_t surfaceWidth, uint32_t surfaceLength)
+{
+	size_t dataSize = (size_t)surfaceWidth * surfaceLength * sizeof(int16_t);
+	SurfacePoolBlock *block;
+	SurfacePoolBuffer *buffer = NULL;
+
+	if ((pool->current == NULL || dataSize > pool->current->dataCapacity) && SurfacePool_Grow(pool, dataSize) != 0)
+	{
+		GoLogAtomic_Store64(&pool->exhausted, pool->exhausted + 1);
+		return NULL;
+	}
+	block = pool->current;
+
+	// Collect buffers returned by the consumer
+	while ((buffer = SpscQueue_Pop(&pool->returned)) != NULL)
+	{
+		SurfacePool_Put(pool, &buffer->record);
+	}
+
+	if (pool->spare != NULL)
+	{
+		buffer = pool->spare;
+		pool->spare = buffer->next;
+	}
+	else if (block->unused > 0)
+	{
+		uint8_t *slot = block->memory + (size_t)(pool->bufferCount - block->unused) * block->slotSize;
+		buffer = (SurfacePoolBuffer *)(slot + block->dataCapacity);
+		buffer->block = block;
+		block->unused--;
+	}
+	else
+	{
+		GoLogAtomic_Store64(&pool->exhausted, pool->exhausted + 1);
+		return NULL;
+	}
+
+	block->outstanding++;
+	GoLogAtomic_Store32(&pool->inUse, pool->inUse + 1);
+
+	memset(&buffer->record, 0, sizeof(SurfaceRecord));
+	buffer->record.surfaceWidth = surfaceWidth;
+	buffer->record.surfaceLength = surfaceLength;
+	buffer->record.data = (int16_t *)((uint8_t *)buffer - block->dataCapacity);
+	buffer->record.codec = SURFACECODEC_RAW;
+	buffer->record.payload = buffer->record.data;
+	buffer->record.payloadSize = dataSize;
+	buffer->record.bufferRegion = block->memory;
+	buffer->record.bufferRegionSize = block->size;
+	return &buffer->record;
+}
+
+void SurfacePool_Return(SurfacePool *pool, SurfaceRecord *record)
+{
+	// Cannot fail - the queue has room for every buffer that exists
+	SpscQueue_Push(&pool->returned, record);
+}
@@ -0,0 +1,67 @@
+/*
+* SurfacePool.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Fixed pool of preallocated surface buffers, so that no memory is
+* allocated or freed per surface on the capture path. Allocating and freeing
+* multi-megabyte blocks for every frame makes the C runtime map and unmap
+* memory from the OS each time, and every page of a fresh block is faulted in
+* while the surface is copied.
+*
+* The pool is allocated when the first surface arrives, sized for its width and
+* length, and all pages are touched (pre-faulted) before it is used. Huge pages
+* can be requested to reduce TLB misses when copying. If a larger surface
+* arrives (sensor reconfigured), a new pool is allocated and the old one is
+* freed once all its buffers have been returned.
+*
+* The producer thread (data callback) takes buffers with SurfacePool_Get and
+* gives unused ones back with SurfacePool_Put. The consumer thread (writer)
+* returns written buffers with SurfacePool_Return, through a lock-free SPSC
+* queue. If no buffer is free the surface must be dropped; this is counted as
+* pool exhaustion.
+*/
+
+#ifndef SURFACE_POOL_H
+#define SURFACE_POOL_H
+
+#include "GoLogPlatform.h"
+#include "SpscQueue.h"
+#include "SurfaceFormat.h"
+
+typedef struct SurfacePoolBlock SurfacePoolBlock;
+typedef struct SurfacePoolBuffer SurfacePoolBuffer;
+
+typedef struct
+{
+	SpscQueue returned;					// Buffers returned by consumer, taken by producer
+	SurfacePoolBlock *current;			// Block buffers are taken from
+	SurfacePoolBlock *retired;			// Previous block, freed when all its buffers are back
+	SurfacePoolBuffer *spare;			// Buffers put back by producer (list)
+	uint32_t bufferCount;				// Buffers per block
+	int hugePages;						// Huge pages requested
+	volatile uint32_t usingHugePages;	// Current block is backed by huge pages
+	volatile uint32_t inUse;			// Buffers currently taken
+	volatile uint64_t exhausted;		// Get calls that found no free buffer
+	volatile uint64_t allocFailures;	// Blocks that could not be allocated
+	volatile uint64_t regrows;			// Blocks allocated after the first one
+	volatile uint64_t blockBytes;		// Size of current block
+}SurfacePool;
+
+// Create empty pool of bufferCount buffers. Returns 0 on success.
+int SurfacePool_Init(SurfacePool *pool, uint32_t bufferCount, int hugePages);
+
+// Free all memory. All buffers must have been returned (consumer stopped).
+void SurfacePool_Destroy(SurfacePool *pool);
+
+// Producer: take a buffer for width*length samples, with record fields cleared and
+// data/payload set up for a raw surface. Returns NULL if no buffer is free.
+SurfaceRecord *SurfacePool_Get(SurfacePool *pool, uint32_t surfaceWidth, uint32_t surfaceLength);
+
+// Producer: give back a buffer that was not submitted
+void SurfacePool_Put(SurfacePool *pool, SurfaceRecord *record);
+
+// Consumer: give back a buffer when it is no longer used
+void SurfacePool_Return(SurfacePool *pool, SurfaceRecord *record);
+
+#endif // SURFACE_POOL_H
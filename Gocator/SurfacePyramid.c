@@ -0,0 +1,229 @@
+/*
+* SurfacePyramid.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Invalid-aware 2 x 2 downsampling kernels (see SurfacePyramid.h).
+* Pairs of samples are summed with madd (k16s * 1 + k16s * 1 into k32s), with
+* invalid samples zeroed and counted separately in the same way. The SIMD
+* loops produce 8 (SSE2) or 16 (AVX2) outputs per iteration from two rows;
+* the remaining outputs and an odd last row are done in C.
+*/
+
+#include "SurfacePyramid.h"
+#include "SurfaceFormat.h"
+#include "GoLogSimd.h"
+#include <math.h>
+#include <stdlib.h>
+
+// Mean of valid samples, rounded like the SIMD versions (float division, round to nearest even)
+static int16_t SurfacePyramid_Mean(int32_t sum, int32_t count)
+{
+	return count > 0 ? (int16_t)lrintf((float)sum / (float)count) : INVALID_RANGE_16BIT;
+}
+
+// Plain C version for outputs start to targetWidth of one row. row1 is NULL for an odd last row.
+static void SurfacePyramid_RowScalar(const int16_t *row0, const int16_t *row1, uint32_t width, uint32_t start,
+	uint32_t targetWidth, int16_t *target)
+{
+	uint32_t x;
+
+	for (x = start; x < targetWidth; x++)
+	{
+		int32_t sum = 0;
+		int32_t count = 0;
+		uint32_t column = 2 * x;
+		uint32_t columnEnd = (column + 2 < width) ? column + 2 : width;
+
+		for (; column < columnEnd; column++)
+		{
+			if (row0[column] != INVALID_RANGE_16BIT)
+			{
+				sum += row0[column];
+				count++;
+			}
+			if (row1 != NULL && row1[column] != INVALID_RANGE_16BIT)
+			{
+				sum += row1[column];
+				count++;
+			}
+		}
+		target[x] = SurfacePyramid_Mean(sum, count);
+	}
+}
+
+#if GOLOG_X86
+
+static uint32_t SurfacePyramid_RowSse2(const int16_t *row0, const int16_t *row1, uint32_t width, int16_t *target)
+{
+	const __m128i invalid16 = _mm_set1_epi16(INVALID_RANGE_16BIT);
+	const __m128i ones = _mm_set1_epi16(1);
+	const __m128i zero = _mm_setzero_si128();
+	uint32_t x;
+
+	for (x = 0; 2 * x + 16 <= width; x += 8)
+	{
+		__m128i a0 = _mm_loadu_si128((const __m128i *)(row0 + 2 * x));
+		__m128i a1 = _mm_loadu_si128((const __m128i *)(row0 + 2 * x + 8));
+		__m128i b0 = _mm_loadu_si128((const __m128i *)(row1 + 2 * x));
+		__m128i b1 = _mm_loadu_si128((const __m128i *)(row1 + 2 * x + 8));
+		__m128i invalidA0 = _mm_cmpeq_epi16(a0, invalid16);
+		__m128i invalidA1 = _mm_cmpeq_epi16(a1, invalid16);
+		__m128i invalidB0 = _mm_cmpeq_epi16(b0, invalid16);
+		__m128i invalidB1 = _mm_cmpeq_epi16(b1, invalid16);
+		__m128i sumLo = _mm_add_epi32(_mm_madd_epi16(_mm_andnot_si128(invalidA0, a0), ones),
+			_mm_madd_epi16(_mm_andnot_si128(invalidB0, b0), ones));
+		__m128i sumHi = _mm_add_epi32(_mm_madd_epi16(_mm_andnot_si128(invalidA1, a1), ones),
+			_mm_madd_epi16(_mm_andnot_si128(invalidB1, b1), ones));
+		__m128i countLo = _mm_add_epi32(_mm_madd_epi16(_mm_andnot_si128(invalidA0, ones), ones),
+			_mm_madd_epi16(_mm_andnot_si128(invalidB0, ones), ones));
+		__m128i countHi = _mm_add_epi32(_mm_madd_epi16(_mm_andnot_si128(invalidA1, ones), ones),
+			_mm_madd_epi16(_mm_andnot_si128(invalidB1, ones), ones));
+		__m128i meanLo = _mm_cvtps_epi32(_mm_div_ps(_mm_cvtepi32_ps(sumLo), _mm_cvtepi32_ps(countLo)));
+		__m128i meanHi = _mm_cvtps_epi32(_mm_div_ps(_mm_cvtepi32_ps(sumHi), _mm_cvtepi32_ps(countHi)));
+		__m128i empty = _mm_packs_epi32(_mm_cmpeq_epi32(countLo, zero), _mm_cmpeq_epi32(countHi, zero));
+		__m128i mean = _mm_packs_epi32(meanLo, meanHi);
+
+		_mm_storeu_si128((__m128i *)(target + x), _mm_or_si128(_mm_and_si128(empty, invalid16), _mm_andnot_si128(empty, mean)));
+	}
+	return x;
+}
+
+GOLOG_TARGET_AVX2
+static uint32_t SurfacePyramid_RowAvx2(const int16_t *row0, const int16_t *row1, uint32_t width, int16_t *target)
+{
+	const __m256i invalid16 = _mm256_set1_epi16(INVALID_RANGE_16BIT);
+	const __m256i ones = _mm256_set1_epi16(1);
+	const __m256i zero = _mm256_setzero_si256();
+	uint32_t x;
+
+	for (x = 0; 2 * x + 32 <= width; x += 16)
+	{
+		__m256i a0 = _mm256_loadu_si256((const __m256i *)(row0 + 2 * x));
+		__m256i a1 = _mm256_loadu_si256((const __m256i *)(row0 + 2 * x + 16));
+		__m256i b0 = _mm256_loadu_si256((const __m256i *)(row1 + 2 * x));
+		__m256i b1 = _mm256_loadu_si256((const __m256i *)(row1 + 2 * x + 16));
+		__m256i invalidA0 = _mm256_cmpeq_epi16(a0, invalid16);
+		__m256i invalidA1 = _mm256_cmpeq_epi16(a1, invalid16);
+		__m256i invalidB0 = _mm256_cmpeq_epi16(b0, invalid16);
+		__m256i invalidB1 = _mm256_cmpeq_epi16(b1, invalid16);
+		__m256i sumLo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_andnot_si256(invalidA0, a0), ones),
+			_mm256_madd_epi16(_mm256_andnot_si256(invalidB0, b0), ones));
+		__m256i sumHi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_andnot_si256(invalidA1, a1), ones),
+			_mm256_madd_epi16(_mm256_andnot_si256(invalidB1, b1), ones));
+		__m256i countLo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_andnot_si256(invalidA0, ones), ones),
+			_mm256_madd_epi16(_mm256_andnot_si256(invalidB0, ones), ones));
+		__m256i countHi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_andnot_si256(invalidA1, ones), ones),
+			_mm256_madd_epi16(_mm256_andnot_si256(invalidB1, ones), ones));
+		__m256i meanLo = _mm256_cvtps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(sumLo), _mm256_cvtepi32_ps(countLo)));
+		__m256i meanHi = _mm256_cvtps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(sumHi), _mm256_cvtepi32_ps(countHi)));
+		__m256i empty = _mm256_packs_epi32(_mm256_cmpeq_epi32(countLo, zero), _mm256_cmpeq_epi32(countHi, zero));
+		__m256i mean = _mm256_packs_epi32(meanLo, meanHi);
+
+		// packs works within 128-bit lanes - put the four groups of outputs back in order
+		mean = _mm256_permute4x64_epi64(_mm256_blendv_epi8(mean, invalid16, empty), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i *)(target + x), mean);
+	}
+	return x;
+}
+
+#endif
+
+void SurfacePyramid_Downsample(const int16_t *source, uint32_t width, uint32_t length, int16_t *target)
+{
+	uint32_t targetWidth = (width + 1) / 2;
+	uint32_t row;
+
+	for (row = 0; row < length / 2; row++)
+	{
+		const int16_t *row0 = source + (size_t)(2 * row) * width;
+		const int16_t *row1 = row0 + width;
+		int16_t *targetRow = target + (size_t)row * targetWidth;
+		uint32_t done = 0;
+
+#if GOLOG_X86
+		switch (GoLogSimd_Level())
+		{
+			case GOLOG_SIMD_AVX2:
+				done = SurfacePyramid_RowAvx2(row0, row1, width, targetRow);
+				break;
+			case GOLOG_SIMD_SSE2:
+				done = SurfacePyramid_RowSse2(row0, row1, width, targetRow);
+				break;
+			default:
+				break;
+		}
+#endif
+		SurfacePyramid_RowScalar(row0, row1, width, done, targetWidth, targetRow);
+	}
+	if (length % 2 != 0)
+	{
+		SurfacePyramid_RowScalar(source + (size_t)(length - 1) * width, NULL, width, 0, targetWidth,
+			target + (size_t)(length / 2) * targetWidth);
+	}
+}
+
+int SurfacePyramid_Build(SurfacePyramid *pyramid, const int16_t *data, uint32_t width, uint32_t length, uint32_t levelCount)
+{
+	size_t samples = 0;
+	uint32_t levelWidth = width;
+	uint32_t levelLength = length;
+	uint32_t level;
+	int16_t *target;
+
+	if (levelCount > PYRAMID_MAXLEVELS)
+	{
+		levelCount = PYRAMID_MAXLEVELS;
+	}
+
+	// Sizes of all levels
+	pyramid->levelCount = 0;
+	for (level = 0; level < levelCount && (levelWidth > 1 || levelLength > 1); level++)
+	{
+		SurfacePyramidLevel *current = &pyramid->levels[level];
+
+		levelWidth = (levelWidth + 1) / 2;
+		levelLength = (levelLength + 1) / 2;
+		current->factor = 2u << level;
+		current->width = levelWidth;
+		current->length = levelLength;
+		current->checksum = 0;
+		samples += (size_t)levelWidth * levelLength;
+		pyramid->levelCount++;
+	}
+
+	if (pyramid->bufferSamples < samples)
+	{
+		free(pyramid->buffer);
+		pyramid->bufferSamples = 0;
+		if ((pyramid->buffer = malloc(samples * sizeof(int16_t))) == NULL)
+		{
+			pyramid->levelCount = 0;
+			return -1;
+		}
+		pyramid->bufferSamples = samples;
+	}
+
+	// Each level from the previous one
+	target = pyramid->buffer;
+	for (level = 0; level < pyramid->levelCount; level++)
+	{
+		SurfacePyramidLevel *current = &pyramid->levels[level];
+
+		SurfacePyramid_Downsample(data, width, length, target);
+		current->data = target;
+		data = target;
+		width = current->width;
+		length = current->length;
+		target += (size_t)current->width * current->length;
+	}
+	return 0;
+}
+
+void SurfacePyramid_Free(SurfacePyramid *pyramid)
+{
+	free(pyramid->buffer);
+	pyramid->buffer = NULL;
+	pyramid->bufferSamples = 0;
+	pyramid->levelCount = 0;
+}
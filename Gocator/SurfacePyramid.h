@@ -0,0 +1,55 @@
+/*
+* SurfacePyramid.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Downsampled overview levels (2x, 4x, 8x, ...) of a surface, for
+* previews and coarse analysis without reading the full resolution data.
+*
+* Each level is made from the previous one by 2 x 2 block means that ignore
+* invalid samples (INVALID_RANGE_16BIT): a block with 1 to 4 valid samples
+* gets their mean, rounded to nearest (ties to even), and a block with no
+* valid samples is invalid. A level has ceil(width / 2) x ceil(length / 2)
+* samples; blocks at an odd edge have only 1 or 2 samples. Means of means are
+* not weighted by the number of valid samples below them, so levels beyond 2x
+* differ slightly from a direct mean where invalid samples are present.
+*
+* SSE2 and AVX2 versions are selected at run time (see GoLogSimd.h), and give
+* the same result as the plain C version.
+*/
+
+#ifndef SURFACE_PYRAMID_H
+#define SURFACE_PYRAMID_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PYRAMID_MAXLEVELS		8
+
+typedef struct
+{
+	uint32_t factor;					// Downsampling factor relative to the surface (2, 4, 8, ...)
+	uint32_t width;
+	uint32_t length;
+	const int16_t *data;				// width*length samples, row by row
+	uint32_t checksum;					// CRC32C of the level (SurfaceChecksum_Level), 0 if not computed
+}SurfacePyramidLevel;
+
+typedef struct
+{
+	uint32_t levelCount;
+	SurfacePyramidLevel levels[PYRAMID_MAXLEVELS];
+	int16_t *buffer;					// All levels (reused between surfaces)
+	size_t bufferSamples;
+}SurfacePyramid;
+
+// Downsample width x length samples by 2 into target (ceil(width/2) x ceil(length/2) samples)
+void SurfacePyramid_Downsample(const int16_t *source, uint32_t width, uint32_t length, int16_t *target);
+
+// Build levelCount levels (factor 2, 4, ...) of a surface. Returns 0 on success, -1 if out of memory.
+// Levels stop early if the surface becomes a single sample.
+int SurfacePyramid_Build(SurfacePyramid *pyramid, const int16_t *data, uint32_t width, uint32_t length, uint32_t levelCount);
+
+void SurfacePyramid_Free(SurfacePyramid *pyramid);
+
+#endif // SURFACE_PYRAMID_H
@@ -0,0 +1,528 @@
+/*
+* SurfaceReader.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Zero-copy reader for surface files and session containers (see SurfaceReader.h).
+* Containers are located through the index at the end of the file; if the
+* index is missing (container not closed properly) the records are found by
+* walking them from the file header.
+*/
+
+#include "SurfaceReader.h"
+#include "SurfaceContainer.h"
+#include "SurfaceCodec.h"
+#include "SurfaceTiles.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SURFACEREGION_TOLERANCE		1.0e-6		// Samples this close (in samples) outside a window are included
+
+static uint64_t SurfaceReader_Get64(const uint8_t *bytes)
+{
+	uint64_t value;
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+// Read record offsets from container index. Returns 0 on success, -1 if there is no valid index.
+static int SurfaceFile_ReadIndex(SurfaceFile *file)
+{
+	const uint8_t *data = file->map.data;
+	uint64_t size = file->map.size;
+	const uint8_t *footer;
+	uint64_t indexOffset;
+	uint64_t entryCount;
+	uint64_t i;
+	uint32_t entrySize;
+
+	if (size < CONTAINERHEADERSIZE + CONTAINERFOOTERSIZE)
+	{
+		return -1;
+	}
+	footer = data + size - CONTAINERFOOTERSIZE;
+	if (memcmp(footer + 16, CONTAINERFOOTERTAG, 8) != 0)
+	{
+		return -1;
+	}
+
+	indexOffset = SurfaceReader_Get64(footer);
+	entryCount = SurfaceReader_Get64(footer + 8);
+	if (indexOffset < CONTAINERHEADERSIZE || indexOffset + 16 > size - CONTAINERFOOTERSIZE ||
+		memcmp(data + indexOffset, CONTAINERINDEXTAG, 4) != 0)
+	{
+		return -1;
+	}
+	memcpy(&entrySize, data + indexOffset + 4, sizeof(entrySize));
+	if (entrySize < 8 || SurfaceReader_Get64(data + indexOffset + 8) != entryCount ||
+		entryCount > (size - CONTAINERFOOTERSIZE - indexOffset - 16) / entrySize)
+	{
+		return -1;
+	}
+
+	file->recordOffsets = malloc((size_t)(entryCount ? entryCount : 1) * sizeof(uint64_t));
+	if (file->recordOffsets == NULL)
+	{
+		return -1;
+	}
+	for (i = 0; i < entryCount; i++)
+	{
+		file->recordOffsets[i] = SurfaceReader_Get64(data + indexOffset + 16 + i * entrySize);
+	}
+	file->surfaceCount = entryCount;
+	file->indexEntries = data + indexOffset + 16;
+	file->indexEntrySize = entrySize;
+	return 0;
+}
+
+// Find record offsets by walking the records. Stops at the first incomplete record.
+static int SurfaceFile_WalkRecords(SurfaceFile *file)
+{
+	const uint8_t *data = file->map.data;
+	uint64_t size = file->map.size;
+	uint64_t offset = CONTAINERHEADERSIZE;
+	uint64_t capacity = 0;
+
+	file->surfaceCount = 0;
+	while (offset + CONTAINERRECORDFRAMESIZE <= size &&
+		(memcmp(data + offset, CONTAINERRECORDTAG, 4) == 0 || memcmp(data + offset, CONTAINERPYRAMIDTAG, 4) == 0))
+	{
+		uint64_t recordSize = SurfaceReader_Get64(data + offset + 8);
+
+		if (recordSize > size - offset - CONTAINERRECORDFRAMESIZE)
+		{
+			break;
+		}
+		if (memcmp(data + offset, CONTAINERRECORDTAG, 4) != 0)
+		{
+			// Not a surface (overview levels) - skip
+			offset += CONTAINERRECORDFRAMESIZE + recordSize;
+			continue;
+		}
+		if (file->surfaceCount == capacity)
+		{
+			uint64_t *offsets;
+			capacity = capacity ? 2 * capacity : 1024;
+			if ((offsets = realloc(file->recordOffsets, (size_t)capacity * sizeof(uint64_t))) == NULL)
+			{
+				return -1;
+			}
+			file->recordOffsets = offsets;
+		}
+		file->recordOffsets[file->surfaceCount++] = offset;
+
+		offset += CONTAINERRECORDFRAMESIZE + recordSize;
+		offset = (offset + CONTAINERRECORDALIGNMENT - 1) & ~(uint64_t)(CONTAINERRECORDALIGNMENT - 1);
+	}
+	file->trailingBytes = (offset < size) ? size - offset : 0;
+	return 0;
+}
+
+int SurfaceFile_Open(SurfaceFile *file, const char *path)
+{
+	memset(file, 0, sizeof(*file));
+	if (GoLog_MapFile(&file->map, path) != 0)
+	{
+		printf("Error opening file %s\n", path);
+		return -1;
+	}
+
+	if (file->map.size >= CONTAINERHEADERSIZE && memcmp(file->map.data, CONTAINERHEADERTEXT, HEADERTEXTSIZE) == 0)
+	{
+		file->isContainer = 1;
+		if (SurfaceFile_ReadIndex(file) != 0)
+		{
+			if (SurfaceFile_WalkRecords(file) != 0)
+			{
+				SurfaceFile_Close(file);
+				return -1;
+			}
+			printf("No index in %s, %lu complete records found\n", path, (unsigned long)file->surfaceCount);
+		}
+	}
+	else
+	{
+		SurfaceRecord record;
+		if (SurfaceFormat_ParseHeader(file->map.data, file->map.size, &record) == 0)
+		{
+			printf("Not a surface file: %s\n", path);
+			SurfaceFile_Close(file);
+			return -1;
+		}
+		file->surfaceCount = 1;
+	}
+	return 0;
+}
+
+uint64_t SurfaceFile_Count(const SurfaceFile *file)
+{
+	return file->surfaceCount;
+}
+
+int SurfaceFile_Surface(const SurfaceFile *file, uint64_t idx, SurfaceRecord *record)
+{
+	uint64_t offset;
+	uint64_t recordSize;
+
+	if (idx >= file->surfaceCount)
+	{
+		return -1;
+	}
+	if (!file->isContainer)
+	{
+		return SurfaceFormat_ParseHeader(file->map.data, file->map.size, record) ? 0 : -1;
+	}
+
+	offset = file->recordOffsets[idx];
+	if (offset > file->map.size - CONTAINERRECORDFRAMESIZE ||
+		memcmp(file->map.data + offset, CONTAINERRECORDTAG, 4) != 0)
+	{
+		return -1;
+	}
+	recordSize = SurfaceReader_Get64(file->map.data + offset + 8);
+	if (recordSize > file->map.size - offset - CONTAINERRECORDFRAMESIZE)
+	{
+		return -1;
+	}
+	if (SurfaceFormat_ParseHeader(file->map.data + offset + CONTAINERRECORDFRAMESIZE, recordSize, record) == 0)
+	{
+		return -1;
+	}
+	record->count = (uint32_t)idx;
+	if (file->indexEntries != NULL && file->indexEntrySize >= 32)
+	{
+		const uint8_t *entry = file->indexEntries + idx * file->indexEntrySize;
+		memcpy(&record->count, entry + 16, sizeof(record->count));
+		memcpy(&record->lostBefore, entry + 28, sizeof(record->lostBefore));
+		if (file->indexEntrySize >= 40)
+		{
+			memcpy(&record->frameIndex, entry + 32, sizeof(record->frameIndex));
+		}
+	}
+	return 0;
+}
+
+// Find the pyramid record of surface number idx: offset of its tag, and recordSize and levelCount of its
+// frame. Returns 0 if there is one.
+static int SurfaceFile_FindPyramid(const SurfaceFile *file, uint64_t idx, uint64_t *pyramidOffset, uint64_t *pyramidSize,
+	uint32_t *levelCount)
+{
+	const uint8_t *data = file->map.data;
+	uint64_t size = file->map.size;
+	uint64_t offset;
+	uint64_t recordSize;
+
+	if (!file->isContainer || idx >= file->surfaceCount)
+	{
+		return -1;
+	}
+
+	// Pyramid record follows the surface record
+	offset = file->recordOffsets[idx];
+	if (offset > size - CONTAINERRECORDFRAMESIZE)
+	{
+		return -1;
+	}
+	recordSize = SurfaceReader_Get64(data + offset + 8);
+	if (recordSize > size - offset - CONTAINERRECORDFRAMESIZE)
+	{
+		return -1;
+	}
+	offset += CONTAINERRECORDFRAMESIZE + recordSize;
+	offset = (offset + CONTAINERRECORDALIGNMENT - 1) & ~(uint64_t)(CONTAINERRECORDALIGNMENT - 1);
+	if (offset > size - CONTAINERRECORDFRAMESIZE || memcmp(data + offset, CONTAINERPYRAMIDTAG, 4) != 0)
+	{
+		return -1;
+	}
+	memcpy(levelCount, data + offset + 4, sizeof(*levelCount));
+	*pyramidOffset = offset;
+	*pyramidSize = SurfaceReader_Get64(data + offset + 8);
+	return 0;
+}
+
+uint32_t SurfaceFile_PyramidLevels(const SurfaceFile *file, uint64_t idx)
+{
+	uint64_t offset;
+	uint64_t recordSize;
+	uint32_t levelCount;
+
+	return (SurfaceFile_FindPyramid(file, idx, &offset, &recordSize, &levelCount) == 0) ? levelCount : 0;
+}
+
+int SurfaceFile_Pyramid(const SurfaceFile *file, uint64_t idx, uint32_t level, SurfacePyramidLevel *pyramidLevel)
+{
+	const uint8_t *data = file->map.data;
+	uint64_t size = file->map.size;
+	uint64_t offset;
+	uint64_t recordSize;
+	uint64_t levelOffset;
+	uint32_t levelCount;
+	uint32_t i;
+
+	if (SurfaceFile_FindPyramid(file, idx, &offset, &recordSize, &levelCount) != 0 ||
+		level >= levelCount || recordSize > size - offset - CONTAINERRECORDFRAMESIZE ||
+		(uint64_t)levelCount * CONTAINERPYRAMIDLEVELSIZE > recordSize)
+	{
+		return -1;
+	}
+
+	// Level data follows the level headers, each level padded to 8 bytes
+	levelOffset = CONTAINERRECORDFRAMESIZE + (uint64_t)levelCount * CONTAINERPYRAMIDLEVELSIZE;
+	for (i = 0; i <= level; i++)
+	{
+		const uint8_t *levelHeader = data + offset + CONTAINERRECORDFRAMESIZE + (uint64_t)i * CONTAINERPYRAMIDLEVELSIZE;
+		uint64_t levelBytes;
+
+		memcpy(&pyramidLevel->factor, levelHeader, sizeof(uint32_t));
+		memcpy(&pyramidLevel->width, levelHeader + 4, sizeof(uint32_t));
+		memcpy(&pyramidLevel->length, levelHeader + 8, sizeof(uint32_t));
+		memcpy(&pyramidLevel->checksum, levelHeader + 12, sizeof(uint32_t));
+		levelBytes = (uint64_t)pyramidLevel->width * pyramidLevel->length * sizeof(int16_t);
+		if (levelOffset + levelBytes > CONTAINERRECORDFRAMESIZE + recordSize)
+		{
+			return -1;
+		}
+		pyramidLevel->data = (const int16_t *)(data + offset + levelOffset);
+		levelOffset += (levelBytes + CONTAINERRECORDALIGNMENT - 1) & ~(uint64_t)(CONTAINERRECORDALIGNMENT - 1);
+	}
+	return 0;
+}
+
+int SurfaceFile_Decode(const SurfaceRecord *record, int16_t *data)
+{
+	SurfaceRegion region;
+
+	if (record->tileWidth != 0)
+	{
+		memset(&region, 0, sizeof(region));
+		region.width = record->surfaceWidth;
+		region.length = record->surfaceLength;
+		return SurfaceFile_DecodeRegion(record, &region, data, NULL);
+	}
+	if (record->codec == SURFACECODEC_MEDRICE)
+	{
+		return SurfaceCodec_Decode(record->payload, (size_t)record->payloadSize,
+			record->surfaceWidth, record->surfaceLength, data);
+	}
+	memcpy(data, record->payload, (size_t)record->payloadSize);
+	return 0;
+}
+
+// Samples first to first + count - 1 of one axis with positions from minimum to maximum (mm)
+static void SurfaceFile_SampleRange(double offset, double resolution, uint32_t crop, uint32_t size,
+	double minimum, double maximum, uint32_t *first, uint32_t *count)
+{
+	double start;
+	double end;
+
+	*first = 0;
+	*count = 0;
+	if (size == 0 || resolution == 0.0)
+	{
+		return;
+	}
+
+	// Sample positions are offset + (crop + sample) * resolution; resolution may be negative
+	start = (minimum - offset) / resolution - crop;
+	end = (maximum - offset) / resolution - crop;
+	if (start > end)
+	{
+		double swap = start;
+		start = end;
+		end = swap;
+	}
+	start = ceil(start - SURFACEREGION_TOLERANCE);
+	end = floor(end + SURFACEREGION_TOLERANCE);
+	if (start < 0.0)
+	{
+		start = 0.0;
+	}
+	if (end > size - 1.0)
+	{
+		end = size - 1.0;
+	}
+	if (start <= end)
+	{
+		*first = (uint32_t)start;
+		*count = (uint32_t)(end - start) + 1;
+	}
+}
+
+void SurfaceFile_Region(const SurfaceRecord *record, double xMin, double xMax, double yMin, double yMax, SurfaceRegion *region)
+{
+	SurfaceFile_SampleRange(record->xOffset, record->xResolution, record->cropColumn, record->surfaceWidth, xMin, xMax,
+		&region->column, &region->width);
+	SurfaceFile_SampleRange(record->yOffset, record->yResolution, record->cropRow, record->surfaceLength, yMin, yMax,
+		&region->row, &region->length);
+	if (region->width == 0 || region->length == 0)
+	{
+		region->width = 0;
+		region->length = 0;
+	}
+	region->xOffset = record->xOffset + ((double)record->cropColumn + region->column) * record->xResolution;
+	region->yOffset = record->yOffset + ((double)record->cropRow + region->row) * record->yResolution;
+}
+
+int SurfaceFile_DecodeRegion(const SurfaceRecord *record, const SurfaceRegion *region, int16_t *data, uint64_t *bytesRead)
+{
+	size_t rowSize = (size_t)region->width * sizeof(int16_t);
+	int16_t *scratch;
+	uint32_t row;
+	int result;
+
+	if ((uint64_t)region->column + region->width > record->surfaceWidth ||
+		(uint64_t)region->row + region->length > record->surfaceLength)
+	{
+		return -1;
+	}
+	if (region->width == 0 || region->length == 0)
+	{
+		return 0;
+	}
+
+	// Tiled: only the tiles that intersect the region
+	if (record->tileWidth != 0)
+	{
+		if ((scratch = malloc((size_t)record->tileWidth * record->tileLength * sizeof(int16_t))) == NULL)
+		{
+			return -1;
+		}
+		result = SurfaceTiles_Decode(record->payload, record->payloadSize, record->surfaceWidth, record->surfaceLength,
+			record->tileWidth, record->tileLength, region->column, region->row, region->width, region->length,
+			scratch, data, bytesRead);
+		free(scratch);
+		return result;
+	}
+
+	// Raw rows: only the rows of the region
+	if (record->codec == SURFACECODEC_RAW)
+	{
+		for (row = 0; row < region->length; row++)
+		{
+			memcpy(data + (size_t)row * region->width, (const uint8_t *)record->payload +
+				((size_t)(region->row + row) * record->surfaceWidth + region->column) * sizeof(int16_t), rowSize);
+		}
+		if (bytesRead != NULL)
+		{
+			*bytesRead += (uint64_t)region->length * record->surfaceWidth * sizeof(int16_t);
+		}
+		return 0;
+	}
+
+	// Coded rows depend on the rows before them - the whole surface is decoded
+	if ((scratch = malloc((size_t)record->surfaceWidth * record->surfaceLength * sizeof(int16_t))) == NULL)
+	{
+		return -1;
+	}
+	if ((result = SurfaceFile_Decode(record, scratch)) == 0)
+	{
+		for (row = 0; row < region->length; row++)
+		{
+			memcpy(data + (size_t)row * region->width,
+				scratch + (size_t)(region->row + row) * record->surfaceWidth + region->column, rowSize);
+		}
+		if (bytesRead != NULL)
+		{
+			*bytesRead += record->payloadSize;
+		}
+	}
+	free(scratch);
+	return result;
+}
+
+void SurfaceFile_Close(SurfaceFile *file)
+{
+	GoLog_UnmapFile(&file->map);
+	free(file->recordOffsets);
+	file->recordOffsets = NULL;
+	file->indexEntries = NULL;
+	file->surfaceCount = 0;
+}
+
+static int SurfaceBatch_HasSuffix(const char *name, const char *suffix)
+{
+	size_t nameLength = strlen(name);
+	size_t suffixLength = strlen(suffix);
+	return nameLength >= suffixLength && strcmp(name + nameLength - suffixLength, suffix) == 0;
+}
+
+int SurfaceBatch_Open(SurfaceBatch *batch, const char *folder)
+{
+	size_t length = strlen(folder);
+
+	memset(batch, 0, sizeof(*batch));
+	if (length == 0 || length + 2 > sizeof(batch->folder))
+	{
+		return -1;
+	}
+	strcpy(batch->folder, folder);
+	if (folder[length - 1] != '/' && folder[length - 1] != '\\')
+	{
+		strcat(batch->folder, "/");
+	}
+
+	// Surface files and containers share the same time stamped name prefix, so a
+	// single sorted list gives the files in logging order
+	batch->nameCount = GoLog_ListFiles(batch->folder, ".bin", &batch->names);
+	if (batch->nameCount < 0)
+	{
+		printf("Error reading folder %s\n", folder);
+		batch->nameCount = 0;
+		return -1;
+	}
+	return 0;
+}
+
+int SurfaceBatch_Next(SurfaceBatch *batch, SurfaceRecord *record, const char **path)
+{
+	const char *name;
+
+	for (;;)
+	{
+		if (batch->fileOpen)
+		{
+			while (batch->surfaceIdx < SurfaceFile_Count(&batch->file))
+			{
+				if (SurfaceFile_Surface(&batch->file, batch->surfaceIdx++, record) == 0)
+				{
+					*path = batch->path;
+					return 1;
+				}
+				printf("Invalid record %lu in %s\n", (unsigned long)(batch->surfaceIdx - 1), batch->path);
+			}
+			SurfaceFile_Close(&batch->file);
+			batch->fileOpen = 0;
+		}
+
+		if (batch->nameIdx >= batch->nameCount)
+		{
+			return 0;
+		}
+
+		name = batch->names[batch->nameIdx++];
+		if (!SurfaceBatch_HasSuffix(name, DATAFILENAMESUFFIX) && !SurfaceBatch_HasSuffix(name, SESSIONFILENAMESUFFIX))
+		{
+			continue;
+		}
+		snprintf(batch->path, sizeof batch->path, "%s%s", batch->folder, name);
+		if (SurfaceFile_Open(&batch->file, batch->path) == 0)
+		{
+			batch->fileOpen = 1;
+			batch->surfaceIdx = 0;
+		}
+	}
+}
+
+void SurfaceBatch_Close(SurfaceBatch *batch)
+{
+	if (batch->fileOpen)
+	{
+		SurfaceFile_Close(&batch->file);
+		batch->fileOpen = 0;
+	}
+	GoLog_FreeFileList(batch->names, batch->nameCount);
+	batch->names = NULL;
+	batch->nameCount = 0;
+}
@@ -0,0 +1,109 @@
+/*
+* SurfaceReader.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Reading of logged surfaces - both separate surface files
+* (*GocatorSurface.bin) and session containers (*GocatorSession.bin).
+*
+* Files are memory mapped and surfaces are returned as SurfaceRecords
+* pointing into the mapping, so nothing is copied when a surface is opened.
+* For raw surfaces the k16s rows can be used directly through record.data;
+* coded surfaces must be decoded with SurfaceFile_Decode. Records are valid
+* until the file is closed. Downsampled overview levels stored in containers
+* are read with SurfaceFile_Pyramid, also without copying. Surfaces written
+* with -crop (VER0004) hold only the valid region of the full surface; its
+* position is in record.cropColumn / cropRow, and record.fullWidth is 0 for
+* surfaces that are not cropped.
+*
+* SurfaceFile_Region finds the samples of a surface within a window in metric
+* X and Y, and SurfaceFile_DecodeRegion reads them. For tiled surfaces
+* (-tiles, VER0005) only the tiles that intersect the window are read and
+* decoded, so only those parts of the mapped file are loaded from disk. For
+* raw surfaces stored row by row the rows of the window are read; compressed
+* surfaces stored row by row are decoded completely.
+*
+* SurfaceBatch iterates over all surfaces in all files of a folder, in file
+* name (= time) order, so that a complete logging session can be processed
+* with a single loop.
+*/
+
+#ifndef SURFACE_READER_H
+#define SURFACE_READER_H
+
+#include "GoLogPlatform.h"
+#include "SurfaceFormat.h"
+
+typedef struct
+{
+	GoLogMappedFile map;
+	int isContainer;
+	uint64_t surfaceCount;
+	uint64_t *recordOffsets;			// Container: file offset of each record tag
+	const uint8_t *indexEntries;		// Container: index in file (NULL if missing)
+	uint32_t indexEntrySize;
+	uint64_t trailingBytes;				// Container without index: bytes after the last complete record
+}SurfaceFile;
+
+typedef struct
+{
+	char folder[1024];
+	char path[1280];					// Path of current file
+	char **names;
+	int nameCount;
+	int nameIdx;						// Next file to open
+	int fileOpen;
+	uint64_t surfaceIdx;				// Next surface in current file
+	SurfaceFile file;
+}SurfaceBatch;
+
+// Samples of a surface within a metric window
+typedef struct
+{
+	uint32_t column;					// First column and row of the region in the surface as stored
+	uint32_t row;
+	uint32_t width;						// 0 if the window does not overlap the surface
+	uint32_t length;
+	double xOffset;						// mm, X and Y of the first sample of the region
+	double yOffset;
+}SurfaceRegion;
+
+// Open surface file or session container. Returns 0 on success.
+int SurfaceFile_Open(SurfaceFile *file, const char *path);
+
+uint64_t SurfaceFile_Count(const SurfaceFile *file);
+
+// Get surface number idx without copying. For containers with an index, count, lostBefore and
+// frameIndex are taken from the index; otherwise count is set to idx. Returns 0 on success.
+int SurfaceFile_Surface(const SurfaceFile *file, uint64_t idx, SurfaceRecord *record);
+
+// Get overview level (0 = 2x downsampled, 1 = 4x, ...) of surface number idx without copying, from a
+// session container logged with -pyramid. Returns 0 on success, -1 if the level is not stored.
+int SurfaceFile_Pyramid(const SurfaceFile *file, uint64_t idx, uint32_t level, SurfacePyramidLevel *pyramidLevel);
+
+// Number of overview levels stored after surface number idx (0 if none). The levels of surfaces with checksums
+// carry a checksum each (pyramidLevel.checksum, see SurfaceChecksum_Level).
+uint32_t SurfaceFile_PyramidLevels(const SurfaceFile *file, uint64_t idx);
+
+// Copy or decode surface data of record into data (surfaceWidth * surfaceLength samples). Returns 0 on success.
+int SurfaceFile_Decode(const SurfaceRecord *record, int16_t *data);
+
+// Region of record with X from xMin to xMax and Y from yMin to yMax (mm, inclusive), clipped to the surface
+void SurfaceFile_Region(const SurfaceRecord *record, double xMin, double xMax, double yMin, double yMax, SurfaceRegion *region);
+
+// Copy or decode the samples of region into data (region width * length samples, row by row). Bytes of
+// surface data read are added to bytesRead (if not NULL). Returns 0 on success.
+int SurfaceFile_DecodeRegion(const SurfaceRecord *record, const SurfaceRegion *region, int16_t *data, uint64_t *bytesRead);
+
+void SurfaceFile_Close(SurfaceFile *file);
+
+// Open all surface files and session containers in folder. Returns 0 on success.
+int SurfaceBatch_Open(SurfaceBatch *batch, const char *folder);
+
+// Get next surface; path is set to the file it was read from. Returns 1 if a surface was found, 0 at end.
+// Files that cannot be read are reported and skipped.
+int SurfaceBatch_Next(SurfaceBatch *batch, SurfaceRecord *record, const char **path);
+
+void SurfaceBatch_Close(SurfaceBatch *batch);
+
+#endif // SURFACE_READER_H
@@ -0,0 +1,54 @@
+/*
+* SurfaceSink.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Interface for the output of the surface writer thread.
+* A sink receives complete surface records, one at a time, on the writer
+* thread. Three sinks are available:
+*	SurfaceFileSink		- one VER0001 file per surface (the original output), or VER0003 with direct I/O (VER0004 if cropped, VER0005 if tiled)
+*	SurfaceContainer	- all surfaces of a session appended to one file (see SurfaceContainer.h)
+*	SurfaceUringSink	- as SurfaceFileSink, written asynchronously with io_uring on Linux (see SurfaceUringSink.h)
+*
+* Synchronous sinks have finished with the record when write returns.
+* Asynchronous sinks may instead return SURFACESINK_PENDING: record->data is
+* then still in use, and the sink calls complete when the surface has been
+* written. record->payload is only valid during write if it is not record->data,
+* and record->pyramid is only valid during write.
+* The sink sets record->fileName and fileOffset to where the surface is written.
+*/
+
+#ifndef SURFACE_SINK_H
+#define SURFACE_SINK_H
+
+#include "SurfaceFormat.h"
+
+#define SURFACESINK_PENDING		1		// write: surface is being written asynchronously
+
+typedef struct SurfaceSink SurfaceSink;
+
+// Asynchronous write finished (result 0 on success)
+typedef void (*SurfaceSinkCompleteFunc)(void *context, SurfaceRecord *record, int result);
+
+struct SurfaceSink
+{
+	// Write one surface. Returns 0 on success, SURFACESINK_PENDING if not finished yet, -1 on error.
+	int (*write)(SurfaceSink *sink, SurfaceRecord *record);
+
+	// Flush and close all output, and free the sink. Pending writes are finished first.
+	void (*close)(SurfaceSink *sink);
+
+	// Asynchronous sinks only (NULL otherwise): call complete for finished writes, waiting for
+	// at least one if wait is set and writes are pending. Returns number of writes still pending.
+	int (*poll)(SurfaceSink *sink, int wait);
+	SurfaceSinkCompleteFunc complete;	// Set by the user of the sink before the first write
+	void *completeContext;
+};
+
+// Sink writing each surface to its own file in rootFolder. Returns NULL on failure.
+SurfaceSink *SurfaceFileSink_Open(const char *rootFolder);
+
+// As SurfaceFileSink_Open, but written with direct (unbuffered) I/O as aligned VER0003 files
+SurfaceSink *SurfaceFileSink_OpenDirect(const char *rootFolder);
+
+#endif // SURFACE_SINK_H
@@ -0,0 +1,229 @@
+/*
+* SurfaceStats.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Summary statistics of surfaces (see SurfaceStats.h).
+* The SIMD versions replace invalid samples by 0 for the sums and by
+* INT16_MAX for the minimum (INVALID_RANGE_16BIT is already the smallest
+* value for the maximum). Sums are kept in 32-bit lanes for blocks of
+* SURFACESTATS_BLOCK vectors, and squares (at most 2 * 32767^2 per pair) are
+* widened to 64 bits as they are added.
+*/
+
+#include "SurfaceStats.h"
+#include "GoLogSimd.h"
+#include <math.h>
+#include <string.h>
+
+#define SURFACESTATS_BLOCK		16384	// Vectors per block - keeps the 16-bit counts and 32-bit sums from overflowing
+
+static void SurfaceStats_CopyRowScalar(int16_t *target, const int16_t *row, uint32_t count, SurfaceStatsSums *sums)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+	{
+		int16_t value = row[i];
+
+		target[i] = value;
+		if (value != INVALID_RANGE_16BIT)
+		{
+			sums->validCount++;
+			sums->sum += value;
+			sums->sumSquares += (uint64_t)((int32_t)value * value);
+			sums->min = (value < sums->min) ? value : sums->min;
+			sums->max = (value > sums->max) ? value : sums->max;
+		}
+	}
+}
+
+#if GOLOG_X86
+
+// Add the lanes of the block sums (int32) and invalid counts (int16) of a block of samples to sums
+static void SurfaceStats_AddBlock(SurfaceStatsSums *sums, const int32_t *sum32, uint32_t sumLanes,
+	const int16_t *invalid16, uint32_t samples)
+{
+	uint32_t invalid = 0;
+	uint32_t i;
+
+	for (i = 0; i < sumLanes; i++)
+	{
+		sums->sum += sum32[i];
+	}
+	for (i = 0; i < 2 * sumLanes; i++)
+	{
+		invalid += (uint16_t)invalid16[i];
+	}
+	sums->validCount += samples - invalid;
+}
+
+// The SIMD versions return where the whole vectors ended, for the plain C version to continue
+
+static uint32_t SurfaceStats_CopyRowSse2(int16_t *target, const int16_t *row, uint32_t count, SurfaceStatsSums *sums)
+{
+	const __m128i invalid16 = _mm_set1_epi16(INVALID_RANGE_16BIT);
+	const __m128i max16 = _mm_set1_epi16(INT16_MAX);
+	const __m128i ones16 = _mm_set1_epi16(1);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i minimum = max16;
+	__m128i maximum = invalid16;
+	__m128i squares64 = zero;
+	int16_t lanes16[8];
+	int32_t lanes32[4];
+	uint64_t lanes64[2];
+	uint32_t i = 0;
+	uint32_t lane;
+
+	while (i + 8 <= count)
+	{
+		__m128i sum32 = zero;
+		__m128i invalidCount16 = zero;
+		uint32_t start = i;
+		uint32_t block;
+
+		for (block = 0; block < SURFACESTATS_BLOCK && i + 8 <= count; block++, i += 8)
+		{
+			__m128i value = _mm_loadu_si128((const __m128i *)(row + i));
+			__m128i isInvalid = _mm_cmpeq_epi16(value, invalid16);
+			__m128i valid = _mm_andnot_si128(isInvalid, value);
+			__m128i squares = _mm_madd_epi16(valid, valid);
+
+			_mm_storeu_si128((__m128i *)(target + i), value);
+			minimum = _mm_min_epi16(minimum, _mm_or_si128(valid, _mm_and_si128(isInvalid, max16)));
+			maximum = _mm_max_epi16(maximum, value);
+			invalidCount16 = _mm_sub_epi16(invalidCount16, isInvalid);
+			sum32 = _mm_add_epi32(sum32, _mm_madd_epi16(valid, ones16));
+			squares64 = _mm_add_epi64(squares64, _mm_unpacklo_epi32(squares, zero));
+			squares64 = _mm_add_epi64(squares64, _mm_unpackhi_epi32(squares, zero));
+		}
+		_mm_storeu_si128((__m128i *)lanes32, sum32);
+		_mm_storeu_si128((__m128i *)lanes16, invalidCount16);
+		SurfaceStats_AddBlock(sums, lanes32, 4, lanes16, i - start);
+	}
+
+	_mm_storeu_si128((__m128i *)lanes64, squares64);
+	sums->sumSquares += lanes64[0] + lanes64[1];
+	_mm_storeu_si128((__m128i *)lanes16, minimum);
+	for (lane = 0; lane < 8; lane++)
+	{
+		sums->min = (lanes16[lane] < sums->min) ? lanes16[lane] : sums->min;
+	}
+	_mm_storeu_si128((__m128i *)lanes16, maximum);
+	for (lane = 0; lane < 8; lane++)
+	{
+		sums->max = (lanes16[lane] > sums->max) ? lanes16[lane] : sums->max;
+	}
+	return i;
+}
+
+GOLOG_TARGET_AVX2
+static uint32_t SurfaceStats_CopyRowAvx2(int16_t *target, const int16_t *row, uint32_t count, SurfaceStatsSums *sums)
+{
+	const __m256i invalid16 = _mm256_set1_epi16(INVALID_RANGE_16BIT);
+	const __m256i max16 = _mm256_set1_epi16(INT16_MAX);
+	const __m256i ones16 = _mm256_set1_epi16(1);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i minimum = max16;
+	__m256i maximum = invalid16;
+	__m256i squares64 = zero;
+	int16_t lanes16[16];
+	int32_t lanes32[8];
+	uint64_t lanes64[4];
+	uint32_t i = 0;
+	uint32_t lane;
+
+	while (i + 16 <= count)
+	{
+		__m256i sum32 = zero;
+		__m256i invalidCount16 = zero;
+		uint32_t start = i;
+		uint32_t block;
+
+		for (block = 0; block < SURFACESTATS_BLOCK && i + 16 <= count; block++, i += 16)
+		{
+			__m256i value = _mm256_loadu_si256((const __m256i *)(row + i));
+			__m256i isInvalid = _mm256_cmpeq_epi16(value, invalid16);
+			__m256i valid = _mm256_andnot_si256(isInvalid, value);
+			__m256i squares = _mm256_madd_epi16(valid, valid);
+
+			_mm256_storeu_si256((__m256i *)(target + i), value);
+			minimum = _mm256_min_epi16(minimum, _mm256_or_si256(valid, _mm256_and_si256(isInvalid, max16)));
+			maximum = _mm256_max_epi16(maximum, value);
+			invalidCount16 = _mm256_sub_epi16(invalidCount16, isInvalid);
+			sum32 = _mm256_add_epi32(sum32, _mm256_madd_epi16(valid, ones16));
+			squares64 = _mm256_add_epi64(squares64, _mm256_unpacklo_epi32(squares, zero));
+			squares64 = _mm256_add_epi64(squares64, _mm256_unpackhi_epi32(squares, zero));
+		}
+		_mm256_storeu_si256((__m256i *)lanes32, sum32);
+		_mm256_storeu_si256((__m256i *)lanes16, invalidCount16);
+		SurfaceStats_AddBlock(sums, lanes32, 8, lanes16, i - start);
+	}
+
+	_mm256_storeu_si256((__m256i *)lanes64, squares64);
+	sums->sumSquares += lanes64[0] + lanes64[1] + lanes64[2] + lanes64[3];
+	_mm256_storeu_si256((__m256i *)lanes16, minimum);
+	for (lane = 0; lane < 16; lane++)
+	{
+		sums->min = (lanes16[lane] < sums->min) ? lanes16[lane] : sums->min;
+	}
+	_mm256_storeu_si256((__m256i *)lanes16, maximum);
+	for (lane = 0; lane < 16; lane++)
+	{
+		sums->max = (lanes16[lane] > sums->max) ? lanes16[lane] : sums->max;
+	}
+	return i;
+}
+
+#endif
+
+void SurfaceStats_Begin(SurfaceStatsSums *sums)
+{
+	memset(sums, 0, sizeof(*sums));
+	sums->min = INT16_MAX;
+	sums->max = INVALID_RANGE_16BIT;
+}
+
+void SurfaceStats_CopyRow(int16_t *target, const int16_t *row, uint32_t count, SurfaceStatsSums *sums)
+{
+	uint32_t done = 0;
+
+#if GOLOG_X86
+	switch (GoLogSimd_Level())
+	{
+		case GOLOG_SIMD_AVX2:
+			done = SurfaceStats_CopyRowAvx2(target, row, count, sums);
+			break;
+		case GOLOG_SIMD_SSE2:
+			done = SurfaceStats_CopyRowSse2(target, row, count, sums);
+			break;
+		default:
+			break;
+	}
+#endif
+	SurfaceStats_CopyRowScalar(target + done, row + done, count - done, sums);
+}
+
+void SurfaceStats_Finish(const SurfaceStatsSums *sums, SurfaceRecord *record)
+{
+	double mean;
+	double variance;
+
+	record->validCount = sums->validCount;
+	if (sums->validCount == 0)
+	{
+		record->zMin = 0.0;
+		record->zMax = 0.0;
+		record->zMean = 0.0;
+		record->zStdDev = 0.0;
+		return;
+	}
+
+	// Population variance from the exact integer sums
+	mean = (double)sums->sum / sums->validCount;
+	variance = (double)sums->sumSquares / sums->validCount - mean * mean;
+	record->zMin = record->zOffset + sums->min * record->zResolution;
+	record->zMax = record->zOffset + sums->max * record->zResolution;
+	record->zMean = record->zOffset + mean * record->zResolution;
+	record->zStdDev = (variance > 0.0) ? sqrt(variance) * record->zResolution : 0.0;
+}
@@ -0,0 +1,42 @@
+/*
+* SurfaceStats.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Summary statistics of each surface (number of valid samples,
+* minimum, maximum, mean and standard deviation of the valid heights),
+* computed while the data callback copies the rows of the surface, so that
+* they cost no extra pass over the data. The statistics are stored in the
+* time stamp index (SurfaceIndex.h), where they can be searched without
+* opening the surface files.
+*
+* Each row is copied and summed in one pass, 8 (SSE2) or 16 (AVX2) samples at
+* a time, selected at run time (see GoLogSimd.h). Sums are exact integers, so
+* all SIMD levels give the same result.
+*/
+
+#ifndef SURFACE_STATS_H
+#define SURFACE_STATS_H
+
+#include "SurfaceFormat.h"
+
+// Running sums of the valid samples of a surface, in sensor units
+typedef struct
+{
+	uint64_t validCount;				// Samples that are not INVALID_RANGE_16BIT
+	int64_t sum;
+	uint64_t sumSquares;
+	int16_t min;						// INT16_MAX if there are no valid samples
+	int16_t max;						// INVALID_RANGE_16BIT if there are no valid samples
+}SurfaceStatsSums;
+
+void SurfaceStats_Begin(SurfaceStatsSums *sums);
+
+// Copy count samples from row to target, and add them to sums
+void SurfaceStats_CopyRow(int16_t *target, const int16_t *row, uint32_t count, SurfaceStatsSums *sums);
+
+// Set the statistics of record (validCount, zMin, zMax, zMean, zStdDev) from sums, in mm using the
+// zOffset and zResolution of record. Statistics are 0 if there are no valid samples.
+void SurfaceStats_Finish(const SurfaceStatsSums *sums, SurfaceRecord *record);
+
+#endif // SURFACE_STATS_H
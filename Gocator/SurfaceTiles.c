@@ -0,0 +1,227 @@
+/*
+* SurfaceTiles.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Tiled surface layout (see SurfaceTiles.h).
+*/
+
+#include "SurfaceTiles.h"
+#include "SurfaceCodec.h"
+#include <string.h>
+
+static uint32_t SurfaceTiles_Count(uint32_t size, uint32_t tileSize)
+{
+	return (uint32_t)(((uint64_t)size + tileSize - 1) / tileSize);
+}
+
+static uint64_t SurfaceTiles_Padded(uint64_t size)
+{
+	return (size + SURFACETILES_ALIGNMENT - 1) / SURFACETILES_ALIGNMENT * SURFACETILES_ALIGNMENT;
+}
+
+void SurfaceTiles_Layout(SurfaceTileLayout *layout, uint32_t width, uint32_t length, uint32_t tileWidth, uint32_t tileLength)
+{
+	layout->width = width;
+	layout->length = length;
+	layout->tileWidth = tileWidth;
+	layout->tileLength = tileLength;
+	layout->tileColumns = SurfaceTiles_Count(width, tileWidth);
+	layout->tileRows = SurfaceTiles_Count(length, tileLength);
+	layout->tileCount = layout->tileColumns * layout->tileRows;
+	layout->tableSize = (uint64_t)layout->tileCount * SURFACETILES_ENTRYSIZE;
+	layout->slotSize = SurfaceTiles_Padded((uint64_t)((width < tileWidth) ? width : tileWidth) *
+		((length < tileLength) ? length : tileLength) * sizeof(int16_t));
+}
+
+uint64_t SurfaceTiles_MaxSize(uint32_t width, uint32_t length, uint32_t tileWidth, uint32_t tileLength)
+{
+	SurfaceTileLayout layout;
+
+	SurfaceTiles_Layout(&layout, width, length, tileWidth, tileLength);
+	return layout.tableSize + (uint64_t)layout.tileCount * layout.slotSize;
+}
+
+uint64_t SurfaceTiles_SlotOffset(const SurfaceTileLayout *layout, uint32_t tile)
+{
+	return layout->tableSize + (uint64_t)tile * layout->slotSize;
+}
+
+void SurfaceTiles_EncodeTile(const SurfaceTileLayout *layout, const int16_t *data, uint32_t tile, uint32_t codec,
+	int16_t *scratch, uint8_t *slot, uint32_t *size, uint32_t *tileCodec)
+{
+	uint32_t x = (tile % layout->tileColumns) * layout->tileWidth;
+	uint32_t y = (tile / layout->tileColumns) * layout->tileLength;
+	uint32_t columns = (layout->width - x < layout->tileWidth) ? layout->width - x : layout->tileWidth;
+	uint32_t rows = (layout->length - y < layout->tileLength) ? layout->length - y : layout->tileLength;
+	const int16_t *first = data + (size_t)y * layout->width + x;
+	size_t rowSize = (size_t)columns * sizeof(int16_t);
+	size_t rawSize = rowSize * rows;
+	size_t codedSize = 0;
+	uint32_t row;
+
+	// Coded tile if it is smaller than the raw tile (the codec never writes more than capacity)
+	if (codec == SURFACECODEC_MEDRICE)
+	{
+		const int16_t *samples = first;
+
+		// Tiles as wide as the surface are already contiguous
+		if (columns != layout->width)
+		{
+			for (row = 0; row < rows; row++)
+			{
+				memcpy(scratch + (size_t)row * columns, first + (size_t)row * layout->width, rowSize);
+			}
+			samples = scratch;
+		}
+		if (SurfaceCodec_Encode(samples, columns, rows, slot, rawSize, &codedSize) == 0 && codedSize < rawSize)
+		{
+			*size = (uint32_t)codedSize;
+			*tileCodec = SURFACECODEC_MEDRICE;
+			return;
+		}
+	}
+
+	for (row = 0; row < rows; row++)
+	{
+		memcpy(slot + row * rowSize, first + (size_t)row * layout->width, rowSize);
+	}
+	*size = (uint32_t)rawSize;
+	*tileCodec = SURFACECODEC_RAW;
+}
+
+// Zero the padding after a tile, and write its table entry
+static void SurfaceTiles_Entry(uint8_t *output, uint32_t tile, uint64_t offset, uint32_t size, uint32_t codec)
+{
+	uint8_t *entry = output + (size_t)tile * SURFACETILES_ENTRYSIZE;
+
+	memset(output + offset + size, 0, (size_t)(SurfaceTiles_Padded(size) - size));
+	memcpy(entry, &offset, sizeof(offset));
+	memcpy(entry + 8, &size, sizeof(size));
+	memcpy(entry + 12, &codec, sizeof(codec));
+}
+
+uint64_t SurfaceTiles_Pack(const SurfaceTileLayout *layout, uint8_t *output, const uint32_t *sizes, const uint32_t *codecs)
+{
+	uint64_t offset = layout->tableSize;
+	uint32_t tile;
+
+	// Each tile moves down (or stays), as every tile before it is at most one slot
+	for (tile = 0; tile < layout->tileCount; tile++)
+	{
+		memmove(output + offset, output + SurfaceTiles_SlotOffset(layout, tile), sizes[tile]);
+		SurfaceTiles_Entry(output, tile, offset, sizes[tile], codecs[tile]);
+		offset += SurfaceTiles_Padded(sizes[tile]);
+	}
+	return offset;
+}
+
+int SurfaceTiles_Encode(const int16_t *data, uint32_t width, uint32_t length, uint32_t tileWidth, uint32_t tileLength,
+	uint32_t codec, int16_t *scratch, uint8_t *output, size_t capacity, size_t *outputSize)
+{
+	SurfaceTileLayout layout;
+	uint64_t offset;
+	uint32_t tile;
+
+	SurfaceTiles_Layout(&layout, width, length, tileWidth, tileLength);
+	if (layout.tableSize + (uint64_t)layout.tileCount * layout.slotSize > capacity)
+	{
+		return -1;
+	}
+
+	// Coded in place one after the other (each tile starts at or before its own slot)
+	offset = layout.tableSize;
+	for (tile = 0; tile < layout.tileCount; tile++)
+	{
+		uint32_t size;
+		uint32_t tileCodec;
+
+		SurfaceTiles_EncodeTile(&layout, data, tile, codec, scratch, output + offset, &size, &tileCodec);
+		SurfaceTiles_Entry(output, tile, offset, size, tileCodec);
+		offset += SurfaceTiles_Padded(size);
+	}
+
+	*outputSize = (size_t)offset;
+	return 0;
+}
+
+int SurfaceTiles_Decode(const uint8_t *payload, uint64_t payloadSize, uint32_t width, uint32_t length,
+	uint32_t tileWidth, uint32_t tileLength, uint32_t column, uint32_t row, uint32_t windowWidth, uint32_t windowLength,
+	int16_t *scratch, int16_t *target, uint64_t *bytesRead)
+{
+	uint32_t tileColumns = SurfaceTiles_Count(width, tileWidth);
+	uint32_t tileRows = SurfaceTiles_Count(length, tileLength);
+	uint64_t tableSize = (uint64_t)tileColumns * tileRows * SURFACETILES_ENTRYSIZE;
+	uint32_t tileRow;
+	uint32_t tileColumn;
+	uint32_t y;
+
+	if (tileWidth == 0 || tileLength == 0 || tableSize > payloadSize ||
+		(uint64_t)column + windowWidth > width || (uint64_t)row + windowLength > length)
+	{
+		return -1;
+	}
+	if (windowWidth == 0 || windowLength == 0)
+	{
+		return 0;
+	}
+
+	// Tiles that intersect the window
+	for (tileRow = row / tileLength; tileRow <= (row + windowLength - 1) / tileLength; tileRow++)
+	{
+		for (tileColumn = column / tileWidth; tileColumn <= (column + windowWidth - 1) / tileWidth; tileColumn++)
+		{
+			const uint8_t *entry = payload + ((size_t)tileRow * tileColumns + tileColumn) * SURFACETILES_ENTRYSIZE;
+			uint32_t x0 = tileColumn * tileWidth;
+			uint32_t y0 = tileRow * tileLength;
+			uint32_t columns = (width - x0 < tileWidth) ? width - x0 : tileWidth;
+			uint32_t rows = (length - y0 < tileLength) ? length - y0 : tileLength;
+			uint32_t first = (column > x0) ? column : x0;
+			uint32_t last = (column + windowWidth < x0 + columns) ? column + windowWidth : x0 + columns;
+			uint32_t top = (row > y0) ? row : y0;
+			uint32_t bottom = (row + windowLength < y0 + rows) ? row + windowLength : y0 + rows;
+			const int16_t *tile;
+			uint64_t offset;
+			uint32_t size;
+			uint32_t codec;
+
+			memcpy(&offset, entry, sizeof(offset));
+			memcpy(&size, entry + 8, sizeof(size));
+			memcpy(&codec, entry + 12, sizeof(codec));
+			if (offset < tableSize || offset > payloadSize || size > payloadSize - offset)
+			{
+				return -1;
+			}
+
+			if (codec == SURFACECODEC_MEDRICE)
+			{
+				if (SurfaceCodec_Decode(payload + offset, size, columns, rows, scratch) != 0)
+				{
+					return -1;
+				}
+				tile = scratch;
+			}
+			else if (codec == SURFACECODEC_RAW && size == (uint64_t)columns * rows * sizeof(int16_t))
+			{
+				tile = (const int16_t *)(payload + offset);
+			}
+			else
+			{
+				return -1;
+			}
+			if (bytesRead != NULL)
+			{
+				*bytesRead += size;
+			}
+
+			// Part of the tile inside the window (memcpy, as raw tiles are only aligned if the payload is)
+			for (y = top; y < bottom; y++)
+			{
+				memcpy(target + (size_t)(y - row) * windowWidth + (first - column),
+					(const uint8_t *)tile + ((size_t)(y - y0) * columns + (first - x0)) * sizeof(int16_t),
+					(size_t)(last - first) * sizeof(int16_t));
+			}
+		}
+	}
+	return 0;
+}
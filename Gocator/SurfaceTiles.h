@@ -0,0 +1,83 @@
+/*
+* SurfaceTiles.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Tiled surface layout (VER0005 files), so that a small region of a
+* long surface can be read without reading or decoding the whole surface.
+*
+* The surface is divided into tiles of tileWidth x tileLength samples, in
+* rows of tiles from the start of the surface; tiles at the right and bottom
+* edges are smaller. The payload of a tiled surface is:
+*
+* entry[tileCount] (tile table, tiles row by row):
+*	uint64				offset				Offset of the tile data from the start of the payload
+*	uint32				size				Bytes of tile data
+*	uint32				codec				Coding of this tile (SurfaceCodec.h)
+* uint8					tileData			Each tile in turn, coded on its own as a surface of the
+*											tile's size, zero padded to a multiple of 8 bytes
+*
+* Tiles are coded with the codec of the surface, except that tiles that do
+* not compress are stored raw. Raw tiles are 8 byte aligned within the
+* payload, so they can be used in place in memory mapped files.
+*
+* Tiles are independent, so they can be coded in parallel: each tile is
+* coded into its own slot of the output buffer (room for the raw tile), and
+* SurfaceTiles_Pack then moves the coded tiles together in order and writes
+* the tile table, giving the same payload as SurfaceTiles_Encode.
+*/
+
+#ifndef SURFACE_TILES_H
+#define SURFACE_TILES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SURFACETILES_ENTRYSIZE		16
+#define SURFACETILES_ALIGNMENT		8
+
+typedef struct
+{
+	uint32_t width;
+	uint32_t length;
+	uint32_t tileWidth;
+	uint32_t tileLength;
+	uint32_t tileColumns;
+	uint32_t tileRows;
+	uint32_t tileCount;
+	uint64_t tableSize;					// Bytes of tile table at the start of the payload
+	uint64_t slotSize;					// Bytes for one raw tile, padded
+}SurfaceTileLayout;
+
+void SurfaceTiles_Layout(SurfaceTileLayout *layout, uint32_t width, uint32_t length, uint32_t tileWidth, uint32_t tileLength);
+
+// Output buffer needed to encode a tiled surface (the tile table and a slot for every tile)
+uint64_t SurfaceTiles_MaxSize(uint32_t width, uint32_t length, uint32_t tileWidth, uint32_t tileLength);
+
+// Offset of the slot of tile number tile in the output buffer
+uint64_t SurfaceTiles_SlotOffset(const SurfaceTileLayout *layout, uint32_t tile);
+
+// Code tile number tile (row by row) of data into slot, which has room for layout->slotSize bytes; a tile
+// that does not compress is stored raw. scratch must have room for one tile, unless tiles are as wide as
+// the surface. Safe to call for different tiles from different threads.
+void SurfaceTiles_EncodeTile(const SurfaceTileLayout *layout, const int16_t *data, uint32_t tile, uint32_t codec,
+	int16_t *scratch, uint8_t *slot, uint32_t *size, uint32_t *tileCodec);
+
+// Move the tiles coded into their slots of output together in order, and write the tile table. sizes and
+// codecs are those returned by SurfaceTiles_EncodeTile. Returns the payload size.
+uint64_t SurfaceTiles_Pack(const SurfaceTileLayout *layout, uint8_t *output, const uint32_t *sizes, const uint32_t *codecs);
+
+// Store width x length samples as tiles coded with codec. scratch must have room for one tile
+// (tileWidth * tileLength samples). Returns 0 on success, -1 if capacity is less than SurfaceTiles_MaxSize.
+int SurfaceTiles_Encode(const int16_t *data, uint32_t width, uint32_t length, uint32_t tileWidth, uint32_t tileLength,
+	uint32_t codec, int16_t *scratch, uint8_t *output, size_t capacity, size_t *outputSize);
+
+// Decode the window of windowWidth x windowLength samples at (column, row) of a tiled surface into target,
+// row by row. Only the tiles that intersect the window are read; the bytes of tile data read are added
+// to bytesRead (if not NULL). scratch must have room for one tile. Returns 0 on success, -1 if the
+// window is outside the surface or the payload is corrupt.
+int SurfaceTiles_Decode(const uint8_t *payload, uint64_t payloadSize, uint32_t width, uint32_t length,
+	uint32_t tileWidth, uint32_t tileLength, uint32_t column, uint32_t row, uint32_t windowWidth, uint32_t windowLength,
+	int16_t *scratch, int16_t *target, uint64_t *bytesRead);
+
+#endif // SURFACE_TILES_H
@@ -0,0 +1,506 @@
+/*
+* SurfaceUringSink.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Asynchronous file-per-surface sink using io_uring (see SurfaceUringSink.h).
+* The kernel interface is used directly through system calls and the shared
+* submission and completion rings, so no extra library is needed.
+*
+* Each slot i owns fixed file i and header area i. user_data of an entry is
+* slot * 2 + operation, and a slot is free again when both completions are in.
+* Entries the kernel has not taken (a failed io_uring_enter) are counted and
+* submitted again with the next call; if the kernel keeps refusing them while
+* waiting, they are taken back and their surfaces fail, so that waiting for
+* the outstanding surfaces always ends.
+*/
+
+#include "SurfaceUringSink.h"
+
+#if defined(__linux__)
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define URING_HEADER_AREA_SIZE	320		// Room for the largest header (HEADERSIZE_MAX) per slot, in whole cache lines
+#define URING_OP_HEADER			0
+#define URING_OP_DATA			1
+#define URING_BUFFER_HEADERS	0		// Registered buffer indices
+#define URING_BUFFER_POOL		1
+#define URING_FOLDER_SIZE		1024	// Room for the root folder
+#define URING_PATH_SIZE			(URING_FOLDER_SIZE + SURFACEFILENAMESIZE)	// Root folder and file name
+
+typedef struct
+{
+	SurfaceRecord *record;				// Surface being written (NULL = slot free)
+	uint32_t completionsPending;
+	int result;
+	uint32_t headerSize;
+	uint64_t payloadSize;
+	uint8_t *staging;					// Copy of coded payload
+	size_t stagingCapacity;
+	char filename[URING_PATH_SIZE];
+}SurfaceUringSlot;
+
+typedef struct
+{
+	SurfaceSink base;
+	char rootFolder[URING_FOLDER_SIZE];
+	int ringFd;
+
+	// Submission ring
+	void *sqRing;
+	size_t sqRingSize;
+	volatile uint32_t *sqTail;
+	uint32_t sqMask;
+	uint32_t unsubmitted;				// Entries at the end of the ring not yet taken by the kernel
+	uint32_t *sqArray;
+	struct io_uring_sqe *sqes;
+	size_t sqesSize;
+
+	// Completion ring (shares the submission ring mapping with IORING_FEAT_SINGLE_MMAP)
+	void *cqRing;
+	size_t cqRingSize;
+	volatile uint32_t *cqHead;
+	volatile uint32_t *cqTail;
+	uint32_t cqMask;
+	struct io_uring_cqe *cqes;
+
+	SurfaceUringSlot *slots;
+	uint32_t depth;
+	uint32_t slotsInUse;
+	uint8_t *headers;					// depth header areas, registered buffer 0
+	const void *region;					// Surface pool memory registered as buffer 1 (NULL = none)
+	int registerBuffers;				// Cleared if buffers cannot be registered
+}SurfaceUringSink;
+
+static int SurfaceUring_Setup(uint32_t entries, struct io_uring_params *params)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int SurfaceUring_Enter(int ringFd, uint32_t submit, uint32_t minComplete, uint32_t flags)
+{
+	return (int)syscall(__NR_io_uring_enter, ringFd, submit, minComplete, flags, NULL, 0);
+}
+
+static int SurfaceUring_Register(int ringFd, uint32_t opcode, const void *arg, uint32_t count)
+{
+	return (int)syscall(__NR_io_uring_register, ringFd, opcode, arg, count);
+}
+
+static int SurfaceUringSink_MapRings(SurfaceUringSink *sink, const struct io_uring_params *params)
+{
+	uint8_t *sq;
+	uint8_t *cq;
+
+	sink->sqRingSize = params->sq_off.array + params->sq_entries * sizeof(uint32_t);
+	sink->cqRingSize = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+	if (params->features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (sink->cqRingSize > sink->sqRingSize)
+		{
+			sink->sqRingSize = sink->cqRingSize;
+		}
+		sink->cqRingSize = 0;
+	}
+
+	sink->sqRing = mmap(NULL, sink->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, sink->ringFd, IORING_OFF_SQ_RING);
+	if (sink->sqRing == MAP_FAILED)
+	{
+		sink->sqRing = NULL;
+		return -1;
+	}
+	sink->cqRing = sink->sqRing;
+	if (sink->cqRingSize > 0)
+	{
+		sink->cqRing = mmap(NULL, sink->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, sink->ringFd, IORING_OFF_CQ_RING);
+		if (sink->cqRing == MAP_FAILED)
+		{
+			sink->cqRing = NULL;
+			return -1;
+		}
+	}
+	sink->sqesSize = params->sq_entries * sizeof(struct io_uring_sqe);
+	sink->sqes = mmap(NULL, sink->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, sink->ringFd, IORING_OFF_SQES);
+	if (sink->sqes == MAP_FAILED)
+	{
+		sink->sqes = NULL;
+		return -1;
+	}
+
+	sq = sink->sqRing;
+	cq = sink->cqRing;
+	sink->sqTail = (volatile uint32_t *)(sq + params->sq_off.tail);
+	sink->sqMask = *(uint32_t *)(sq + params->sq_off.ring_mask);
+	sink->sqArray = (uint32_t *)(sq + params->sq_off.array);
+	sink->cqHead = (volatile uint32_t *)(cq + params->cq_off.head);
+	sink->cqTail = (volatile uint32_t *)(cq + params->cq_off.tail);
+	sink->cqMask = *(uint32_t *)(cq + params->cq_off.ring_mask);
+	sink->cqes = (struct io_uring_cqe *)(cq + params->cq_off.cqes);
+	return 0;
+}
+
+// Register header areas and the memory block record->data is in, replacing the previous block.
+// Only called with no writes in flight.
+static void SurfaceUringSink_RegisterBuffers(SurfaceUringSink *sink, const SurfaceRecord *record)
+{
+	struct iovec buffers[2];
+
+	if (sink->region != NULL)
+	{
+		SurfaceUring_Register(sink->ringFd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+		sink->region = NULL;
+	}
+
+	buffers[URING_BUFFER_HEADERS].iov_base = sink->headers;
+	buffers[URING_BUFFER_HEADERS].iov_len = (size_t)sink->depth * URING_HEADER_AREA_SIZE;
+	buffers[URING_BUFFER_POOL].iov_base = (void *)record->bufferRegion;
+	buffers[URING_BUFFER_POOL].iov_len = (size_t)record->bufferRegionSize;
+	if (SurfaceUring_Register(sink->ringFd, IORING_REGISTER_BUFFERS, buffers, 2) != 0)
+	{
+		printf("WARNING: io_uring buffers could not be registered (%s), using unregistered writes\n", strerror(errno));
+		sink->registerBuffers = 0;
+		return;
+	}
+	sink->region = record->bufferRegion;
+}
+
+// Surface written - free the slot and report to the writer
+static void SurfaceUringSink_Finish(SurfaceUringSink *sink, SurfaceUringSlot *slot)
+{
+	SurfaceRecord *record = slot->record;
+
+	if (slot->result == 0)
+	{
+		printf("Surface %u written to file: %s\n", record->count, slot->filename);
+	}
+	else
+	{
+		printf("WARNING: Error while writing surface to file %s\n", slot->filename);
+	}
+	slot->record = NULL;
+	sink->slotsInUse--;
+	sink->base.complete(sink->base.completeContext, record, slot->result);
+}
+
+// Handle all completions in the ring
+static void SurfaceUringSink_Reap(SurfaceUringSink *sink)
+{
+	uint32_t head = *sink->cqHead;
+	uint32_t tail = GoLogAtomic_Load32(sink->cqTail);
+
+	while (head != tail)
+	{
+		struct io_uring_cqe *cqe = &sink->cqes[head & sink->cqMask];
+		SurfaceUringSlot *slot = &sink->slots[cqe->user_data >> 1];
+		uint64_t expected = ((cqe->user_data & 1) == URING_OP_HEADER) ? slot->headerSize : slot->payloadSize;
+
+		// A short write to a regular file only happens on error (e.g. disk full)
+		if (cqe->res < 0 || (uint64_t)cqe->res != expected)
+		{
+			slot->result = -1;
+		}
+		head++;
+		if (--slot->completionsPending == 0)
+		{
+			SurfaceUringSink_Finish(sink, slot);
+		}
+	}
+	GoLogAtomic_Store32(sink->cqHead, head);
+}
+
+// Submit the entries not yet taken by the kernel, and with wait, wait for at least one completion.
+// Returns 0 on success, or -1 with errno set.
+static int SurfaceUringSink_Submit(SurfaceUringSink *sink, int wait)
+{
+	int submitted;
+
+	do
+	{
+		submitted = SurfaceUring_Enter(sink->ringFd, sink->unsubmitted, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0);
+	} while (submitted < 0 && errno == EINTR);
+	if (submitted < 0)
+	{
+		return -1;
+	}
+	sink->unsubmitted -= (uint32_t)submitted;
+	return 0;
+}
+
+// Take back the entries the kernel has not taken (it only reads the ring in io_uring_enter), and fail their surfaces
+static void SurfaceUringSink_Discard(SurfaceUringSink *sink)
+{
+	uint32_t tail = *sink->sqTail;
+
+	for (; sink->unsubmitted > 0; sink->unsubmitted--)
+	{
+		struct io_uring_sqe *sqe = &sink->sqes[--tail & sink->sqMask];
+		SurfaceUringSlot *slot = &sink->slots[sqe->user_data >> 1];
+
+		slot->result = -1;
+		if (--slot->completionsPending == 0)
+		{
+			SurfaceUringSink_Finish(sink, slot);
+		}
+	}
+	GoLogAtomic_Store32(sink->sqTail, tail);
+}
+
+static int SurfaceUringSink_Poll(SurfaceSink *base, int wait)
+{
+	SurfaceUringSink *sink = (SurfaceUringSink *)base;
+
+	SurfaceUringSink_Reap(sink);
+	if ((wait && sink->slotsInUse > 0) || sink->unsubmitted > 0)
+	{
+		if (SurfaceUringSink_Submit(sink, wait && sink->slotsInUse > 0) != 0 && errno != EAGAIN && errno != EBUSY)
+		{
+			// EAGAIN and EBUSY clear as completions are reaped; otherwise nothing left in the ring would complete
+			printf("WARNING: io_uring_enter failed (%s)\n", strerror(errno));
+			if (wait)
+			{
+				SurfaceUringSink_Discard(sink);
+			}
+		}
+		SurfaceUringSink_Reap(sink);
+	}
+	return (int)sink->slotsInUse;
+}
+
+static void SurfaceUringSink_PrepareWrite(struct io_uring_sqe *sqe, uint32_t slotIdx, uint32_t operation,
+	const void *buffer, uint32_t length, uint64_t offset, int bufferIndex)
+{
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = (bufferIndex >= 0) ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+	sqe->flags = IOSQE_FIXED_FILE;
+	sqe->fd = (int32_t)slotIdx;
+	sqe->addr = (uint64_t)(uintptr_t)buffer;
+	sqe->len = length;
+	sqe->off = offset;
+	sqe->buf_index = (uint16_t)(bufferIndex >= 0 ? bufferIndex : 0);
+	sqe->user_data = (uint64_t)slotIdx * 2 + operation;
+}
+
+static int SurfaceUringSink_Write(SurfaceSink *base, SurfaceRecord *record)
+{
+	SurfaceUringSink *sink = (SurfaceUringSink *)base;
+	SurfaceUringSlot *slot;
+	struct io_uring_files_update filesUpdate;
+	struct io_uring_sqe *sqe;
+	const void *payload = record->payload;
+	uint32_t slotIdx;
+	uint32_t tail;
+	uint32_t entryCount = 0;
+	int fd;
+	int registered;
+
+	// New pool memory (first surface or pool reallocated) - register it once nothing refers to the old one
+	if (sink->registerBuffers && record->bufferRegion != NULL && record->bufferRegion != sink->region)
+	{
+		while (SurfaceUringSink_Poll(base, 1) > 0)
+		{
+		}
+		SurfaceUringSink_RegisterBuffers(sink, record);
+	}
+	registered = (sink->region != NULL && record->bufferRegion == sink->region);
+
+	// Wait for a free slot
+	while (sink->slotsInUse == sink->depth)
+	{
+		SurfaceUringSink_Poll(base, 1);
+	}
+	for (slotIdx = 0; sink->slots[slotIdx].record != NULL; slotIdx++)
+	{
+	}
+	slot = &sink->slots[slotIdx];
+
+	// Coded payload is in the writer's encode buffer, which is reused for the next surface
+	if (record->payloadSize > 0 && payload != record->data)
+	{
+		if (slot->stagingCapacity < record->payloadSize)
+		{
+			free(slot->staging);
+			slot->stagingCapacity = 0;
+			if ((slot->staging = malloc((size_t)record->payloadSize)) == NULL)
+			{
+				printf("WARNING: Out of memory for surface %u\n", record->count);
+				return -1;
+			}
+			slot->stagingCapacity = (size_t)record->payloadSize;
+		}
+		memcpy(slot->staging, payload, (size_t)record->payloadSize);
+		payload = slot->staging;
+		registered = 0;
+	}
+
+	// Open binary output file, and replace the slot's fixed file with it
+	snprintf(record->fileName, sizeof record->fileName, "%04d-%02d-%02d_%02d%02d%02d_%04u_%s",
+		record->receiveTime.year, record->receiveTime.month, record->receiveTime.day,
+		record->receiveTime.hour, record->receiveTime.minute, record->receiveTime.second,
+		record->count, DATAFILENAMESUFFIX);
+	record->fileOffset = 0;
+	snprintf(slot->filename, sizeof slot->filename, "%s%s", sink->rootFolder, record->fileName);
+	if ((fd = open(slot->filename, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
+	{
+		printf("Error opening file %s\n", slot->filename);
+		return -1;
+	}
+	memset(&filesUpdate, 0, sizeof(filesUpdate));
+	filesUpdate.offset = slotIdx;
+	filesUpdate.fds = (uint64_t)(uintptr_t)&fd;
+	if (SurfaceUring_Register(sink->ringFd, IORING_REGISTER_FILES_UPDATE, &filesUpdate, 1) != 1)
+	{
+		printf("Error opening file %s (%s)\n", slot->filename, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	close(fd);		// The file table holds its own reference until the slot is reused
+
+	slot->headerSize = SurfaceFormat_EncodeHeader(sink->headers + (size_t)slotIdx * URING_HEADER_AREA_SIZE, record);
+	slot->payloadSize = record->payloadSize;
+	slot->result = 0;
+
+	// Header, then data linked to it (not written if the header fails)
+	tail = *sink->sqTail;
+	sqe = &sink->sqes[tail & sink->sqMask];
+	SurfaceUringSink_PrepareWrite(sqe, slotIdx, URING_OP_HEADER, sink->headers + (size_t)slotIdx * URING_HEADER_AREA_SIZE,
+		slot->headerSize, 0, sink->region != NULL ? URING_BUFFER_HEADERS : -1);
+	sink->sqArray[tail & sink->sqMask] = tail & sink->sqMask;
+	entryCount++;
+	if (record->payloadSize > 0)
+	{
+		sqe->flags |= IOSQE_IO_LINK;
+		sqe = &sink->sqes[(tail + 1) & sink->sqMask];
+		SurfaceUringSink_PrepareWrite(sqe, slotIdx, URING_OP_DATA, payload, (uint32_t)record->payloadSize,
+			slot->headerSize, registered ? URING_BUFFER_POOL : -1);
+		sink->sqArray[(tail + 1) & sink->sqMask] = (tail + 1) & sink->sqMask;
+		entryCount++;
+	}
+	GoLogAtomic_Store32(sink->sqTail, tail + entryCount);
+
+	slot->record = record;
+	slot->completionsPending = entryCount;
+	sink->slotsInUse++;
+	sink->unsubmitted += entryCount;
+	if (SurfaceUringSink_Submit(sink, 0) != 0)
+	{
+		// Entries stay in the ring and are submitted with the next call (Write or Poll)
+		printf("WARNING: io_uring submit failed (%s)\n", strerror(errno));
+	}
+
+	SurfaceUringSink_Reap(sink);
+	return SURFACESINK_PENDING;
+}
+
+static void SurfaceUringSink_Close(SurfaceSink *base)
+{
+	SurfaceUringSink *sink = (SurfaceUringSink *)base;
+	uint32_t slotIdx;
+
+	if (sink->slots != NULL && sink->ringFd >= 0)
+	{
+		while (SurfaceUringSink_Poll(base, 1) > 0)
+		{
+		}
+	}
+	if (sink->sqes != NULL)
+	{
+		munmap(sink->sqes, sink->sqesSize);
+	}
+	if (sink->cqRing != NULL && sink->cqRing != sink->sqRing)
+	{
+		munmap(sink->cqRing, sink->cqRingSize);
+	}
+	if (sink->sqRing != NULL)
+	{
+		munmap(sink->sqRing, sink->sqRingSize);
+	}
+	if (sink->ringFd >= 0)
+	{
+		close(sink->ringFd);			// Releases registered files and buffers
+	}
+	for (slotIdx = 0; sink->slots != NULL && slotIdx < sink->depth; slotIdx++)
+	{
+		free(sink->slots[slotIdx].staging);
+	}
+	free(sink->slots);
+	free(sink->headers);
+	free(sink);
+}
+
+SurfaceSink *SurfaceUringSink_Open(const char *rootFolder, uint32_t depth)
+{
+	SurfaceUringSink *sink = calloc(1, sizeof(SurfaceUringSink));
+	struct io_uring_params params;
+	int *files;
+	uint32_t slotIdx;
+
+	if (sink == NULL)
+	{
+		return NULL;
+	}
+	sink->base.write = SurfaceUringSink_Write;
+	sink->base.close = SurfaceUringSink_Close;
+	sink->base.poll = SurfaceUringSink_Poll;
+	snprintf(sink->rootFolder, sizeof sink->rootFolder, "%s", rootFolder);
+	sink->depth = depth > 0 ? depth : URINGSINKDEPTH;
+	sink->registerBuffers = 1;
+
+	// Two entries per surface
+	memset(&params, 0, sizeof(params));
+	if ((sink->ringFd = SurfaceUring_Setup(2 * sink->depth, &params)) < 0)
+	{
+		printf("io_uring not available (%s)\n", strerror(errno));
+		SurfaceUringSink_Close(&sink->base);
+		return NULL;
+	}
+	if (SurfaceUringSink_MapRings(sink, &params) != 0)
+	{
+		printf("io_uring rings could not be mapped (%s)\n", strerror(errno));
+		SurfaceUringSink_Close(&sink->base);
+		return NULL;
+	}
+
+	sink->slots = calloc(sink->depth, sizeof(SurfaceUringSlot));
+	sink->headers = calloc(sink->depth, URING_HEADER_AREA_SIZE);
+	files = malloc(sink->depth * sizeof(int));
+	if (sink->slots == NULL || sink->headers == NULL || files == NULL)
+	{
+		free(files);
+		SurfaceUringSink_Close(&sink->base);
+		return NULL;
+	}
+
+	// Empty fixed file table, filled per surface
+	for (slotIdx = 0; slotIdx < sink->depth; slotIdx++)
+	{
+		files[slotIdx] = -1;
+	}
+	if (SurfaceUring_Register(sink->ringFd, IORING_REGISTER_FILES, files, sink->depth) != 0)
+	{
+		printf("io_uring files could not be registered (%s)\n", strerror(errno));
+		free(files);
+		SurfaceUringSink_Close(&sink->base);
+		return NULL;
+	}
+	free(files);
+	return &sink->base;
+}
+
+#else
+
+SurfaceSink *SurfaceUringSink_Open(const char *rootFolder, uint32_t depth)
+{
+	printf("io_uring not available on this platform\n");
+	return NULL;
+}
+
+#endif
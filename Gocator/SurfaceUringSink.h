@@ -0,0 +1,39 @@
+/*
+* SurfaceUringSink.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Surface sink writing the same files as SurfaceFileSink (one
+* VER0001/VER0002 file per surface), asynchronously through Linux io_uring.
+*
+* Writing a surface with stdio costs an open, a write call per row and a
+* close, all on the writer thread, and the thread is blocked until the data
+* has been copied to the page cache. This sink instead queues the header and
+* data writes of a surface as two linked submission queue entries and returns
+* at once; the kernel copies the data while the writer takes the next surface
+* from the queue. Finished writes are collected by the writer's poll calls.
+*
+* Up to depth surfaces are in flight. The files are kept in a registered
+* (fixed) file table, one slot per surface in flight, and the surface pool
+* memory and the header staging area are registered as fixed buffers, so the
+* kernel does not look up the file or map the user pages for every write. If
+* the buffers cannot be registered (e.g. locked memory limit), normal writes
+* are used. Coded surfaces are copied to a per-slot staging buffer, since the
+* writer reuses its encode buffer for the next surface.
+*
+* Only available on Linux 5.6 or later; SurfaceUringSink_Open returns NULL
+* elsewhere, and the caller should fall back to SurfaceFileSink.
+*/
+
+#ifndef SURFACE_URING_SINK_H
+#define SURFACE_URING_SINK_H
+
+#include "SurfaceSink.h"
+
+#define URINGSINKDEPTH			8		// Default number of surfaces written concurrently
+
+// Create io_uring file-per-surface sink. rootFolder must end with a path separator.
+// Returns NULL if io_uring is not available.
+SurfaceSink *SurfaceUringSink_Open(const char *rootFolder, uint32_t depth);
+
+#endif // SURFACE_URING_SINK_H
@@ -0,0 +1,464 @@
+/*
+* SurfaceWriter.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Background writer thread for Gocator surfaces (see SurfaceWriter.h).
+*/
+
+#include "SurfaceWriter.h"
+#include "SurfaceCodec.h"
+#include "SurfaceCrop.h"
+#include "SurfaceTiles.h"
+#include "SurfaceChecksum.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define WRITER_IDLE_SLEEP_MS	1		// Sleep time when queue is empty
+
+typedef struct
+{
+	const SurfaceTileLayout *layout;
+	const int16_t *data;
+	uint32_t codec;
+	int16_t *scratch;					// One tile per worker
+	size_t scratchSamples;
+	uint8_t *output;
+	uint32_t *sizes;
+	uint32_t *codecs;
+}SurfaceWriterTileJob;
+
+// Code one tile into its slot of the encode buffer - run on any worker of the encode pool
+static void SurfaceWriter_EncodeTask(void *context, uint32_t task, uint32_t worker)
+{
+	SurfaceWriterTileJob *job = context;
+
+	SurfaceTiles_EncodeTile(job->layout, job->data, task, job->codec, job->scratch + worker * job->scratchSamples,
+		job->output + SurfaceTiles_SlotOffset(job->layout, task), &job->sizes[task], &job->codecs[task]);
+}
+
+// Code the tiles of a surface on the encode pool, and pack them in order. Returns 0 on success.
+static int SurfaceWriter_EncodeParallel(SurfaceWriter *writer, const SurfaceRecord *record, const SurfaceTileLayout *layout,
+	size_t *encodedSize)
+{
+	SurfaceWriterTileJob job;
+	uint64_t tasks;
+	uint64_t steals;
+
+	if (writer->tileCapacity < layout->tileCount)
+	{
+		free(writer->tileSizes);
+		free(writer->tileCodecs);
+		writer->tileSizes = malloc(layout->tileCount * sizeof(uint32_t));
+		writer->tileCodecs = malloc(layout->tileCount * sizeof(uint32_t));
+		writer->tileCapacity = (writer->tileSizes != NULL && writer->tileCodecs != NULL) ? layout->tileCount : 0;
+		if (writer->tileCapacity == 0)
+		{
+			return -1;
+		}
+	}
+
+	job.layout = layout;
+	job.data = record->data;
+	job.codec = writer->options.codec;
+	job.scratch = writer->tileScratch;
+	job.scratchSamples = (size_t)writer->options.tileSize * writer->options.tileSize;
+	job.output = writer->encodeBuffer;
+	job.sizes = writer->tileSizes;
+	job.codecs = writer->tileCodecs;
+	TaskPool_Run(&writer->encodePool, layout->tileCount, SurfaceWriter_EncodeTask, &job);
+	*encodedSize = (size_t)SurfaceTiles_Pack(layout, writer->encodeBuffer, writer->tileSizes, writer->tileCodecs);
+
+	TaskPool_Counts(&writer->encodePool, &tasks, &steals);
+	GoLogAtomic_Store64(&writer->encodeTasks, tasks);
+	GoLogAtomic_Store64(&writer->encodeSteals, steals);
+	return 0;
+}
+
+// Encode surface data if a codec is selected, and divide it into tiles if a tile size is set.
+// Surfaces (or tiles) that do not compress are kept raw. With several encode threads, coded
+// surfaces without a tile size are divided into bands of full rows, so that they can be coded in parallel.
+static void SurfaceWriter_Encode(SurfaceWriter *writer, SurfaceRecord *record)
+{
+	size_t capacity = (size_t)record->payloadSize;
+	size_t encodedSize;
+	uint32_t tileWidth = writer->options.tileSize;
+	uint32_t tileLength = writer->options.tileSize;
+	int parallel = writer->options.encodeThreads > 1;
+	SurfaceTileLayout layout;
+
+	if (tileWidth == 0 && parallel && writer->options.codec == SURFACECODEC_MEDRICE && capacity > 0)
+	{
+		tileWidth = record->surfaceWidth;
+		tileLength = WRITERENCODEBANDROWS;
+	}
+	if (tileWidth > 0)
+	{
+		SurfaceTiles_Layout(&layout, record->surfaceWidth, record->surfaceLength, tileWidth, tileLength);
+		capacity = (size_t)SurfaceTiles_MaxSize(record->surfaceWidth, record->surfaceLength, tileWidth, tileLength);
+	}
+	else if (writer->options.codec != SURFACECODEC_MEDRICE || capacity == 0)
+	{
+		return;
+	}
+
+	// Page aligned, like the pool buffers, so that sinks can write it with direct I/O
+	if (writer->encodeCapacity < capacity)
+	{
+		int hugePages = 0;
+
+		GoLog_FreePages(writer->encodeBuffer, writer->encodeCapacity);
+		writer->encodeCapacity = capacity;
+		if ((writer->encodeBuffer = GoLog_AllocPages(&writer->encodeCapacity, &hugePages)) == NULL)
+		{
+			writer->encodeCapacity = 0;
+			return;
+		}
+	}
+
+	if (tileWidth > 0)
+	{
+		if ((parallel && SurfaceWriter_EncodeParallel(writer, record, &layout, &encodedSize) == 0) ||
+			SurfaceTiles_Encode(record->data, record->surfaceWidth, record->surfaceLength, tileWidth, tileLength,
+			writer->options.codec, writer->tileScratch, writer->encodeBuffer, capacity, &encodedSize) == 0)
+		{
+			record->codec = writer->options.codec;
+			record->tileWidth = tileWidth;
+			record->tileLength = tileLength;
+			record->payload = writer->encodeBuffer;
+			record->payloadSize = encodedSize;
+		}
+	}
+	else if (SurfaceCodec_Encode(record->data, record->surfaceWidth, record->surfaceLength,
+		writer->encodeBuffer, capacity, &encodedSize) == 0)
+	{
+		record->codec = SURFACECODEC_MEDRICE;
+		record->payload = writer->encodeBuffer;
+		record->payloadSize = encodedSize;
+	}
+}
+
+// Surface written (or failed) - called from the write call, or later from the sink's poll for asynchronous sinks
+static void SurfaceWriter_Complete(void *context, SurfaceRecord *record, int result)
+{
+	SurfaceWriter *writer = context;
+
+	if (result != 0)
+	{
+		GoLogAtomic_Store64(&writer->writeErrors, writer->writeErrors + 1);
+	}
+	else
+	{
+		if (writer->options.index != NULL)
+		{
+			SurfaceIndexWriter_Add(writer->options.index, record);
+		}
+		GoLogAtomic_Store64(&writer->written, writer->written + 1);
+	}
+	if (writer->options.pipelineStats != NULL)
+	{
+		PipelineStats_Record(writer->options.pipelineStats, PIPELINE_STAGE_TOTAL, record->receiveNs, GoLog_MonotonicNs());
+	}
+	SurfacePool_Return(&writer->pool, record);
+}
+
+// Write throughput since previous report and stage latencies to the stats file
+static void SurfaceWriter_Report(SurfaceWriter *writer, uint64_t nowNs)
+{
+	FILE *fptr = writer->options.statsFile;
+	PipelineStats *current = writer->options.pipelineStats;
+	SurfaceWriterStats stats;
+	double seconds = (nowNs - writer->reportedNs) / 1.0e9;
+	int stage;
+
+	SurfaceWriter_GetStats(writer, &stats);
+	fprintf(fptr, "[%8.1f s] received %.1f/s, written %.1f/s, %.1f MB/s raw, %.1f MB/s to disk, queue %u/%u (high %u), "
+		"buffers in use %u/%u, dropped %llu, write errors %llu\n",
+		(nowNs - writer->startNs) / 1.0e9,
+		(stats.submitted + stats.dropped - writer->reported.submitted - writer->reported.dropped) / seconds,
+		(stats.written - writer->reported.written) / seconds,
+		(stats.rawBytes - writer->reported.rawBytes) / seconds / 1048576.0,
+		(stats.payloadBytes - writer->reported.payloadBytes) / seconds / 1048576.0,
+		stats.queueDepth, stats.queueCapacity, stats.queueHighWater, stats.poolInUse, stats.poolBuffers,
+		(unsigned long long)stats.dropped, (unsigned long long)stats.writeErrors);
+
+	if (writer->options.frameMonitor != NULL)
+	{
+		FrameMonitor_Print(fptr, writer->options.frameMonitor, stats.written);
+	}
+	if (writer->options.clockModel != NULL)
+	{
+		ClockModel_Print(fptr, writer->options.clockModel);
+	}
+
+	// Latencies of this interval only
+	if (current != NULL && writer->reportedStats != NULL)
+	{
+		PipelineStats interval;
+		for (stage = 0; stage < PIPELINE_STAGE_COUNT; stage++)
+		{
+			LatencyHistogram_Subtract(&interval.stages[stage], &current->stages[stage], &writer->reportedStats->stages[stage]);
+		}
+		PipelineStats_Print(fptr, &interval);
+		memcpy(writer->reportedStats, current, sizeof(PipelineStats));
+	}
+	fflush(fptr);
+	if (writer->options.index != NULL)
+	{
+		SurfaceIndexWriter_Flush(writer->options.index);
+	}
+
+	writer->reported = stats;
+	writer->reportedNs = nowNs;
+}
+
+// Writer thread main loop - write queued surfaces until stop is requested and the queue is empty
+static void SurfaceWriter_Thread(void *arg)
+{
+	SurfaceWriter *writer = arg;
+	SurfaceSink *sink = writer->sink;
+	PipelineStats *pipelineStats = writer->options.pipelineStats;
+	uint64_t reportIntervalNs = (uint64_t)writer->options.statsIntervalSeconds * 1000000000u;
+	SurfaceRecord *record;
+	uint32_t level;
+
+	for (;;)
+	{
+		if (writer->options.statsFile != NULL && reportIntervalNs > 0 &&
+			GoLog_MonotonicNs() - writer->reportedNs >= reportIntervalNs)
+		{
+			SurfaceWriter_Report(writer, GoLog_MonotonicNs());
+		}
+		if (writer->options.measurementLog != NULL)
+		{
+			MeasurementLog_Write(writer->options.measurementLog);
+		}
+
+		if ((record = SpscQueue_Pop(&writer->queue)) != NULL)
+		{
+			uint64_t rawSize;
+			uint64_t stageNs = 0;
+			uint64_t nowNs;
+			int result;
+
+			if (pipelineStats != NULL)
+			{
+				stageNs = GoLog_MonotonicNs();
+				PipelineStats_Record(pipelineStats, PIPELINE_STAGE_QUEUE, record->submitNs, stageNs);
+			}
+
+			// Invalid borders removed first, so that the later stages only see the valid region
+			if (writer->options.crop)
+			{
+				GoLogAtomic_Store64(&writer->croppedBytes, writer->croppedBytes + SurfaceCrop_Apply(record));
+				if (pipelineStats != NULL)
+				{
+					nowNs = GoLog_MonotonicNs();
+					PipelineStats_Record(pipelineStats, PIPELINE_STAGE_CROP, stageNs, nowNs);
+					stageNs = nowNs;
+				}
+			}
+			rawSize = record->payloadSize;
+
+			// Overview levels from the raw data, before it is encoded
+			if (writer->options.pyramidLevels > 0)
+			{
+				if (SurfacePyramid_Build(&writer->pyramid, record->data, record->surfaceWidth, record->surfaceLength,
+					writer->options.pyramidLevels) == 0)
+				{
+					record->pyramid = &writer->pyramid;
+				}
+				if (pipelineStats != NULL)
+				{
+					nowNs = GoLog_MonotonicNs();
+					PipelineStats_Record(pipelineStats, PIPELINE_STAGE_PYRAMID, stageNs, nowNs);
+					stageNs = nowNs;
+				}
+			}
+
+			SurfaceWriter_Encode(writer, record);
+			GoLogAtomic_Store64(&writer->rawBytes, writer->rawBytes + rawSize);
+			GoLogAtomic_Store64(&writer->payloadBytes, writer->payloadBytes + record->payloadSize);
+			if (pipelineStats != NULL && (writer->options.codec != SURFACECODEC_RAW || writer->options.tileSize > 0))
+			{
+				nowNs = GoLog_MonotonicNs();
+				PipelineStats_Record(pipelineStats, PIPELINE_STAGE_ENCODE, stageNs, nowNs);
+				stageNs = nowNs;
+			}
+
+			// Checksums of the payload exactly as it is written, and of the overview levels
+			if (writer->options.checksum)
+			{
+				SurfaceChecksum_Compute(record);
+				for (level = 0; record->pyramid != NULL && level < writer->pyramid.levelCount; level++)
+				{
+					writer->pyramid.levels[level].checksum = SurfaceChecksum_Level(&writer->pyramid.levels[level]);
+				}
+				if (pipelineStats != NULL)
+				{
+					nowNs = GoLog_MonotonicNs();
+					PipelineStats_Record(pipelineStats, PIPELINE_STAGE_CHECKSUM, stageNs, nowNs);
+					stageNs = nowNs;
+				}
+			}
+
+			// Asynchronous sinks return before the data is written; the write stage is then the submission only
+			result = sink->write(sink, record);
+			if (pipelineStats != NULL)
+			{
+				PipelineStats_Record(pipelineStats, PIPELINE_STAGE_WRITE, stageNs, GoLog_MonotonicNs());
+			}
+			if (result != SURFACESINK_PENDING)
+			{
+				SurfaceWriter_Complete(writer, record, result);
+			}
+		}
+		else if (GoLogAtomic_Load32(&writer->stopRequested))
+		{
+			// A surface may have been pushed after the pop above - only exit when the queue is empty
+			if (SpscQueue_Depth(&writer->queue) == 0)
+			{
+				while (sink->poll != NULL && sink->poll(sink, 1) > 0)
+				{
+				}
+				break;
+			}
+		}
+		else
+		{
+			// Collect finished asynchronous writes while waiting for the next surface
+			if (sink->poll != NULL)
+			{
+				sink->poll(sink, 0);
+			}
+			GoLog_SleepMs(WRITER_IDLE_SLEEP_MS);
+		}
+	}
+}
+
+int SurfaceWriter_Start(SurfaceWriter *writer, SurfaceSink *sink, const SurfaceWriterOptions *options)
+{
+	memset(writer, 0, sizeof(*writer));
+	writer->sink = sink;
+	sink->complete = SurfaceWriter_Complete;
+	sink->completeContext = writer;
+	writer->options = *options;
+	writer->startNs = GoLog_MonotonicNs();
+	writer->reportedNs = writer->startNs;
+
+	if (SpscQueue_Init(&writer->queue, options->queueCapacity) != 0)
+	{
+		return -1;
+	}
+
+	// Enough buffers for a full queue, the surface being written and the one being received
+	if (SurfacePool_Init(&writer->pool, options->poolBuffers ? options->poolBuffers : writer->queue.capacity + 2,
+		options->hugePages) != 0)
+	{
+		SpscQueue_Destroy(&writer->queue);
+		return -1;
+	}
+
+	if (options->tileSize > 0 && (writer->tileScratch = malloc((size_t)options->tileSize * options->tileSize *
+		(options->encodeThreads > 1 ? options->encodeThreads : 1) * sizeof(int16_t))) == NULL)
+	{
+		SurfacePool_Destroy(&writer->pool);
+		SpscQueue_Destroy(&writer->queue);
+		return -1;
+	}
+
+	// The writer thread is one of the encode workers
+	if (options->encodeThreads > 1 && TaskPool_Start(&writer->encodePool, options->encodeThreads) != 0)
+	{
+		free(writer->tileScratch);
+		SurfacePool_Destroy(&writer->pool);
+		SpscQueue_Destroy(&writer->queue);
+		return -1;
+	}
+
+	// Interval latencies are reported as the difference from a copy of the histograms
+	if (options->pipelineStats != NULL && options->statsFile != NULL)
+	{
+		writer->reportedStats = calloc(1, sizeof(PipelineStats));
+	}
+
+	if (GoLogThread_Start(&writer->thread, SurfaceWriter_Thread, writer) != 0)
+	{
+		free(writer->reportedStats);
+		TaskPool_Stop(&writer->encodePool);
+		free(writer->tileScratch);
+		SurfacePool_Destroy(&writer->pool);
+		SpscQueue_Destroy(&writer->queue);
+		return -1;
+	}
+	if (options->writerCpu >= 0 && GoLogThread_SetAffinity(writer->thread, options->writerCpu) != 0)
+	{
+		printf("WARNING: Writer thread could not be bound to CPU %d\n", options->writerCpu);
+	}
+	return 0;
+}
+
+void SurfaceWriter_Stop(SurfaceWriter *writer)
+{
+	GoLogAtomic_Store32(&writer->stopRequested, 1);
+	GoLogThread_Join(writer->thread);
+	SpscQueue_Destroy(&writer->queue);
+	SurfacePool_Destroy(&writer->pool);
+	writer->sink->close(writer->sink);
+	writer->sink = NULL;
+	GoLog_FreePages(writer->encodeBuffer, writer->encodeCapacity);
+	writer->encodeBuffer = NULL;
+	SurfacePyramid_Free(&writer->pyramid);
+	TaskPool_Stop(&writer->encodePool);
+	free(writer->tileScratch);
+	writer->tileScratch = NULL;
+	free(writer->tileSizes);
+	free(writer->tileCodecs);
+	writer->tileSizes = NULL;
+	writer->tileCodecs = NULL;
+	writer->tileCapacity = 0;
+	free(writer->reportedStats);
+	writer->reportedStats = NULL;
+}
+
+SurfaceRecord *SurfaceWriter_NewRecord(SurfaceWriter *writer, uint32_t surfaceWidth, uint32_t surfaceLength)
+{
+	return SurfacePool_Get(&writer->pool, surfaceWidth, surfaceLength);
+}
+
+int SurfaceWriter_Submit(SurfaceWriter *writer, SurfaceRecord *record)
+{
+	if (writer->options.pipelineStats != NULL)
+	{
+		record->submitNs = GoLog_MonotonicNs();
+	}
+	if (!SpscQueue_Push(&writer->queue, record))
+	{
+		SurfacePool_Put(&writer->pool, record);
+		return 0;
+	}
+	return 1;
+}
+
+void SurfaceWriter_GetStats(SurfaceWriter *writer, SurfaceWriterStats *stats)
+{
+	stats->submitted = GoLogAtomic_Load64(&writer->queue.pushed);
+	stats->written = GoLogAtomic_Load64(&writer->written);
+	stats->poolExhausted = GoLogAtomic_Load64(&writer->pool.exhausted);
+	stats->dropped = GoLogAtomic_Load64(&writer->queue.rejected) + stats->poolExhausted;
+	stats->writeErrors = GoLogAtomic_Load64(&writer->writeErrors);
+	stats->rawBytes = GoLogAtomic_Load64(&writer->rawBytes);
+	stats->payloadBytes = GoLogAtomic_Load64(&writer->payloadBytes);
+	stats->croppedBytes = GoLogAtomic_Load64(&writer->croppedBytes);
+	stats->encodeTasks = GoLogAtomic_Load64(&writer->encodeTasks);
+	stats->encodeSteals = GoLogAtomic_Load64(&writer->encodeSteals);
+	stats->queueDepth = SpscQueue_Depth(&writer->queue);
+	stats->queueHighWater = GoLogAtomic_Load32(&writer->queue.highWater);
+	stats->queueCapacity = writer->queue.capacity;
+	stats->poolRegrows = GoLogAtomic_Load64(&writer->pool.regrows);
+	stats->poolBytes = GoLogAtomic_Load64(&writer->pool.blockBytes);
+	stats->poolBuffers = writer->pool.bufferCount;
+	stats->poolInUse = GoLogAtomic_Load32(&writer->pool.inUse);
+	stats->poolInUse -= (stats->poolInUse > SpscQueue_Depth(&writer->pool.returned)) ? SpscQueue_Depth(&writer->pool.returned) : stats->poolInUse;
+	stats->poolHugePages = GoLogAtomic_Load32(&writer->pool.usingHugePages);
+}
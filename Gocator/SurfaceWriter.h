@@ -0,0 +1,135 @@
+/*
+* SurfaceWriter.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Background writer thread for Gocator surfaces.
+* The data callback copies each surface into a SurfaceRecord and submits it;
+* the writer thread takes records from a lock-free SPSC queue and passes them
+* to a SurfaceSink, so that slow disk access never stalls the GoSdk receive thread.
+* If the queue is full the surface is dropped and counted, never waited for.
+* Optional cropping (SurfaceCrop.h), compression (SurfaceCodec.h), tiling
+* (SurfaceTiles.h) and overview levels (SurfacePyramid.h) are made on the
+* writer thread. With encodeThreads > 1, the tiles of each surface are coded
+* in parallel on a work-stealing pool (TaskPool.h), with the writer thread as
+* one of the workers; without a tile size, surfaces are then coded in bands of
+* WRITERENCODEBANDROWS full rows, stored as tiles as wide as the surface.
+* With checksum set, CRC32C checksums of the payload as written are computed
+* last on the writer thread and stored in the header (SurfaceChecksum.h), and
+* each overview level gets a checksum stored with it.
+* Surface buffers come from a preallocated pool (SurfacePool.h), so nothing is
+* allocated per surface; if all buffers are in use the surface is dropped.
+* With pipelineStats set, the writer records the latency of its stages and
+* writes a throughput and latency report to statsFile at a fixed interval.
+* With index set, every written surface is added to a time stamp index
+* (SurfaceIndex.h), which is flushed with each report. With measurementLog
+* set, the full blocks of the measurement log (MeasurementLog.h) are written
+* by the writer thread as well.
+*/
+
+#ifndef SURFACE_WRITER_H
+#define SURFACE_WRITER_H
+
+#include "GoLogPlatform.h"
+#include "SpscQueue.h"
+#include "SurfacePool.h"
+#include "PipelineStats.h"
+#include "FrameMonitor.h"
+#include "ClockModel.h"
+#include "SurfaceSink.h"
+#include "SurfaceIndex.h"
+#include "MeasurementLog.h"
+#include "TaskPool.h"
+
+#define WRITERQUEUESIZE			64		// Default number of surfaces that can be in flight
+#define WRITERENCODEBANDROWS	64		// Rows per band when surfaces without tiles are coded in parallel
+
+typedef struct
+{
+	uint32_t queueCapacity;				// Number of surfaces that can be in flight
+	uint32_t codec;						// Surface coding, SURFACECODEC_RAW or SURFACECODEC_MEDRICE
+	uint32_t poolBuffers;				// Number of preallocated surface buffers (0 = queue capacity + 2, never exhausted)
+	int hugePages;						// Back surface buffers by huge pages if possible
+	PipelineStats *pipelineStats;		// Stage latencies are recorded here (NULL = no instrumentation)
+	FILE *statsFile;					// Periodic report (NULL = none)
+	uint32_t statsIntervalSeconds;		// Time between reports
+	const FrameMonitor *frameMonitor;	// Sensor frame gaps, included in report (NULL = none)
+	const ClockModel *clockModel;		// Sensor to host clock model, included in report (NULL = none)
+	int writerCpu;						// Run writer thread on this CPU only (-1 = any)
+	SurfaceIndexWriter *index;			// Written surfaces are added to this time stamp index (NULL = none)
+	uint32_t pyramidLevels;				// Downsampled levels (2x, 4x, ...) made for each surface (0 = none; stored by containers only)
+	int crop;							// Crop surfaces to the bounding box of their valid samples before writing
+	uint32_t tileSize;					// Store surfaces in tileSize x tileSize tiles, each coded on its own (0 = row by row)
+	uint32_t encodeThreads;				// Threads coding the tiles of each surface, including the writer thread (0 or 1 = writer thread only)
+	int checksum;						// Store CRC32C checksums of header and payload chunks with each surface (VER0006)
+	MeasurementLog *measurementLog;		// Full measurement blocks are written by the writer thread (NULL = none)
+}SurfaceWriterOptions;
+
+typedef struct
+{
+	uint64_t submitted;					// Surfaces accepted into the queue
+	uint64_t written;					// Surfaces written to disk
+	uint64_t dropped;					// Surfaces dropped (queue full or no free buffer)
+	uint64_t writeErrors;				// Surfaces that could not be (completely) written
+	uint64_t rawBytes;					// Surface data bytes before coding
+	uint64_t payloadBytes;				// Surface data bytes after coding
+	uint64_t croppedBytes;				// Surface data bytes removed by cropping (not included in rawBytes)
+	uint64_t encodeTasks;				// Tiles (or bands) coded in parallel
+	uint64_t encodeSteals;				// Tiles (or bands) coded by another worker than the one they were first given to
+	uint32_t queueDepth;				// Surfaces currently waiting
+	uint32_t queueHighWater;			// Largest number of surfaces waiting at any time
+	uint32_t queueCapacity;
+	uint64_t poolExhausted;				// Surfaces dropped because no buffer was free (included in dropped)
+	uint64_t poolRegrows;				// Buffer pool reallocations for larger surfaces
+	uint64_t poolBytes;					// Memory of current buffer pool
+	uint32_t poolBuffers;
+	uint32_t poolInUse;					// Buffers currently queued or being written
+	uint32_t poolHugePages;				// Buffer pool is backed by huge pages
+}SurfaceWriterStats;
+
+typedef struct
+{
+	SpscQueue queue;
+	GoLogThread thread;
+	SurfacePool pool;
+	volatile uint32_t stopRequested;
+	volatile uint64_t written;			// Written by writer thread
+	volatile uint64_t writeErrors;		// Written by writer thread
+	volatile uint64_t rawBytes;			// Written by writer thread
+	volatile uint64_t payloadBytes;		// Written by writer thread
+	volatile uint64_t croppedBytes;		// Written by writer thread
+	volatile uint64_t encodeTasks;		// Written by writer thread
+	volatile uint64_t encodeSteals;		// Written by writer thread
+	SurfaceSink *sink;					// Output, only used by writer thread
+	SurfaceWriterOptions options;
+	uint8_t *encodeBuffer;				// Coded surface (page aligned), only used by writer thread
+	size_t encodeCapacity;
+	int16_t *tileScratch;				// One tile per encode thread, for coding tiles
+	TaskPool encodePool;				// Parallel coding (encodeThreads > 1)
+	uint32_t *tileSizes;				// Coded size and codec of each tile, for parallel coding
+	uint32_t *tileCodecs;
+	uint32_t tileCapacity;
+	SurfacePyramid pyramid;				// Overview levels of current surface, only used by writer thread
+
+	// Periodic report, only used by writer thread
+	PipelineStats *reportedStats;		// Histograms at previous report
+	SurfaceWriterStats reported;		// Counters at previous report
+	uint64_t startNs;
+	uint64_t reportedNs;
+}SurfaceWriter;
+
+// Create queue and start writer thread writing to sink. Returns 0 on success.
+int SurfaceWriter_Start(SurfaceWriter *writer, SurfaceSink *sink, const SurfaceWriterOptions *options);
+
+// Stop writer thread after all queued surfaces have been written, and close the sink
+void SurfaceWriter_Stop(SurfaceWriter *writer);
+
+// Producer: get a record with room for width*length samples. Returns NULL (and counts a drop) if no buffer is free.
+SurfaceRecord *SurfaceWriter_NewRecord(SurfaceWriter *writer, uint32_t surfaceWidth, uint32_t surfaceLength);
+
+// Producer: hand record over to the writer thread. Returns 0 if the queue was full (record is dropped and reused).
+int SurfaceWriter_Submit(SurfaceWriter *writer, SurfaceRecord *record);
+
+void SurfaceWriter_GetStats(SurfaceWriter *writer, SurfaceWriterStats *stats);
+
+#endif // SURFACE_WRITER_H
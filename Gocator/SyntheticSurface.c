@@ -0,0 +1,43 @@
+/*
+* SyntheticSurface.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Synthetic Gocator-like height maps (see SyntheticSurface.h).
+*/
+
+#include "SyntheticSurface.h"
+#include "SurfaceFormat.h"
+#include <math.h>
+
+void SyntheticSurface_Fill(int16_t *data, uint32_t width, uint32_t rows, uint32_t firstRow)
+{
+	uint32_t border = width / 8;
+	uint32_t rowIdx, colIdx;
+
+	for (rowIdx = 0; rowIdx < rows; rowIdx++)
+	{
+		int16_t *row = data + (size_t)rowIdx * width;
+		uint32_t y = firstRow + rowIdx;
+		uint32_t seed = y * 2654435761u + 12345u;
+
+		for (colIdx = 0; colIdx < width; colIdx++)
+		{
+			double x = colIdx - width / 2.0;
+			int32_t noise;
+
+			seed = seed * 1103515245u + 12345u;
+			noise = (int32_t)((seed >> 16) % 7) - 3;
+
+			if (colIdx < border || colIdx >= width - border ||
+				((y / 40 + colIdx / 50) % 17) == 0)
+			{
+				row[colIdx] = INVALID_RANGE_16BIT;
+			}
+			else
+			{
+				row[colIdx] = (int16_t)(4000.0 * sin(x * 0.011) * cos(y * 0.013) + 3.0 * x + noise);
+			}
+		}
+	}
+}
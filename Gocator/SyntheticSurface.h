@@ -0,0 +1,20 @@
+/*
+* SyntheticSurface.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Synthetic Gocator-like height maps for the mock sensor and the
+* benchmarks - a smooth surface with small noise, invalid borders and a few
+* invalid patches. The pattern continues seamlessly in the row direction,
+* so consecutive row ranges look like an object moving on a conveyor.
+*/
+
+#ifndef SYNTHETIC_SURFACE_H
+#define SYNTHETIC_SURFACE_H
+
+#include <stdint.h>
+
+// Fill width x rows samples, starting at row firstRow of the endless pattern
+void SyntheticSurface_Fill(int16_t *data, uint32_t width, uint32_t rows, uint32_t firstRow);
+
+#endif // SYNTHETIC_SURFACE_H
@@ -0,0 +1,219 @@
+/*
+* TaskPool.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Work-stealing thread pool (see TaskPool.h).
+*/
+
+#include "TaskPool.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TASKPOOL_RANGE(begin, end)	(((uint64_t)(begin) << 32) | (uint32_t)(end))
+
+// Take the first task of the worker's own range. Returns 1 if a task was taken.
+static int TaskPool_Take(TaskQueue *queue, uint32_t *task)
+{
+	for (;;)
+	{
+		uint64_t range = GoLogAtomic_Load64(&queue->range);
+		uint32_t begin = (uint32_t)(range >> 32);
+		uint32_t end = (uint32_t)range;
+
+		if (begin >= end)
+		{
+			return 0;
+		}
+		if (GoLogAtomic_CompareExchange64(&queue->range, range, TASKPOOL_RANGE(begin + 1, end)))
+		{
+			*task = begin;
+			return 1;
+		}
+	}
+}
+
+// Steal the back half of another worker's range: run the first stolen task, and keep the rest in the
+// thief's own (empty) range, where others can steal from it in turn. Returns 1 if a task was stolen.
+static int TaskPool_Steal(TaskPool *pool, uint32_t thief, uint32_t *task)
+{
+	TaskQueue *own = &pool->queues[thief];
+	uint32_t i;
+
+	for (i = 1; i < pool->workerCount; i++)
+	{
+		TaskQueue *victim = &pool->queues[(thief + i) % pool->workerCount];
+
+		for (;;)
+		{
+			uint64_t range = GoLogAtomic_Load64(&victim->range);
+			uint32_t begin = (uint32_t)(range >> 32);
+			uint32_t end = (uint32_t)range;
+			uint32_t half = (end - begin + 1) / 2;
+
+			if (begin >= end)
+			{
+				break;
+			}
+			if (GoLogAtomic_CompareExchange64(&victim->range, range, TASKPOOL_RANGE(begin, end - half)))
+			{
+				*task = end - half;
+				GoLogAtomic_Store64(&own->range, TASKPOOL_RANGE(end - half + 1, end));
+				GoLogAtomic_Store64(&own->stolen, own->stolen + half);
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+// Run tasks until no worker has any left. Only the worker itself fills its empty range (TaskPool_Steal), so
+// when all workers have returned every range is empty and every task has finished.
+static void TaskPool_Work(TaskPool *pool, uint32_t worker)
+{
+	TaskQueue *queue = &pool->queues[worker];
+	uint32_t task;
+
+	while (TaskPool_Take(queue, &task) || TaskPool_Steal(pool, worker, &task))
+	{
+		pool->func(pool->context, task, worker);
+		GoLogAtomic_Store64(&queue->executed, queue->executed + 1);
+	}
+}
+
+static void TaskPool_Thread(void *arg)
+{
+	TaskQueue *queue = arg;
+	TaskPool *pool = queue->pool;
+
+	for (;;)
+	{
+		GoLogSemaphore_Wait(&pool->wake);
+		if (GoLogAtomic_Load32(&pool->stopRequested))
+		{
+			break;
+		}
+		TaskPool_Work(pool, queue->index);
+
+		// Check out of the run - the last thread lets TaskPool_Run return
+		if (GoLogAtomic_Add64(&pool->active, (uint64_t)-1) == 0)
+		{
+			GoLogSemaphore_Post(&pool->done, 1);
+		}
+	}
+}
+
+int TaskPool_Start(TaskPool *pool, uint32_t workerCount)
+{
+	uint32_t i;
+
+	memset(pool, 0, sizeof(*pool));
+	pool->workerCount = (workerCount > 1) ? workerCount : 1;
+	pool->queues = calloc(pool->workerCount, sizeof(TaskQueue));
+	pool->threads = calloc(pool->workerCount, sizeof(GoLogThread));
+	if (pool->queues == NULL || pool->threads == NULL)
+	{
+		free(pool->queues);
+		free(pool->threads);
+		return -1;
+	}
+	if (GoLogSemaphore_Init(&pool->wake) != 0)
+	{
+		free(pool->queues);
+		free(pool->threads);
+		return -1;
+	}
+	if (GoLogSemaphore_Init(&pool->done) != 0)
+	{
+		GoLogSemaphore_Destroy(&pool->wake);
+		free(pool->queues);
+		free(pool->threads);
+		return -1;
+	}
+
+	for (i = 0; i < pool->workerCount; i++)
+	{
+		pool->queues[i].pool = pool;
+		pool->queues[i].index = i;
+	}
+	for (i = 1; i < pool->workerCount; i++)
+	{
+		if (GoLogThread_Start(&pool->threads[i], TaskPool_Thread, &pool->queues[i]) != 0)
+		{
+			// Run with the threads started so far
+			pool->workerCount = i;
+			break;
+		}
+	}
+	return 0;
+}
+
+void TaskPool_Run(TaskPool *pool, uint32_t taskCount, TaskFunc func, void *context)
+{
+	uint32_t i;
+
+	if (taskCount == 0)
+	{
+		return;
+	}
+	pool->func = func;
+	pool->context = context;
+	GoLogAtomic_Store64(&pool->active, pool->workerCount - 1);
+
+	// Contiguous shares, so that each worker starts on neighbouring tasks
+	for (i = 0; i < pool->workerCount; i++)
+	{
+		GoLogAtomic_Store64(&pool->queues[i].range, TASKPOOL_RANGE((uint64_t)taskCount * i / pool->workerCount,
+			(uint64_t)taskCount * (i + 1) / pool->workerCount));
+	}
+	if (pool->workerCount > 1)
+	{
+		GoLogSemaphore_Post(&pool->wake, pool->workerCount - 1);
+	}
+
+	// Each posted wake is taken by one thread, which checks out once when it has left the run (a thread may
+	// take two if another has not woken yet). Wait until all have, so that none touches the next run's ranges.
+	TaskPool_Work(pool, 0);
+	if (pool->workerCount > 1)
+	{
+		GoLogSemaphore_Wait(&pool->done);
+	}
+}
+
+void TaskPool_Counts(const TaskPool *pool, uint64_t *executed, uint64_t *stolen)
+{
+	uint32_t i;
+
+	*executed = 0;
+	*stolen = 0;
+	for (i = 0; i < pool->workerCount; i++)
+	{
+		*executed += GoLogAtomic_Load64(&pool->queues[i].executed);
+		*stolen += GoLogAtomic_Load64(&pool->queues[i].stolen);
+	}
+}
+
+void TaskPool_Stop(TaskPool *pool)
+{
+	uint32_t i;
+
+	if (pool->queues == NULL)
+	{
+		return;
+	}
+	GoLogAtomic_Store32(&pool->stopRequested, 1);
+	if (pool->workerCount > 1)
+	{
+		GoLogSemaphore_Post(&pool->wake, pool->workerCount - 1);
+	}
+	for (i = 1; i < pool->workerCount; i++)
+	{
+		GoLogThread_Join(pool->threads[i]);
+	}
+	GoLogSemaphore_Destroy(&pool->done);
+	GoLogSemaphore_Destroy(&pool->wake);
+	free(pool->queues);
+	free(pool->threads);
+	pool->queues = NULL;
+	pool->threads = NULL;
+}
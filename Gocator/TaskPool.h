@@ -0,0 +1,69 @@
+/*
+* TaskPool.h
+*
+* Licensed under The MIT License.
+*
+* Purpose: Work-stealing thread pool for splitting the processing of one
+* surface (e.g. coding its tiles) over several cores.
+*
+* TaskPool_Run runs func for task numbers 0 to taskCount - 1 and returns when
+* all have finished. The calling thread works as well, as worker 0. Each
+* worker starts with a contiguous share of the task numbers, kept as a
+* [begin, end) range in one 64-bit word, and takes tasks from the front of
+* its own range. A worker whose range is empty steals the back half of the
+* range of another worker, so uneven tasks (e.g. tiles that compress well or
+* badly) are balanced without a shared queue. Both take and steal are a
+* single compare-and-swap on the victim's range word.
+*
+* Workers wait on a semaphore between runs, so an idle pool uses no CPU.
+* TaskPool_Run returns only when every thread woken for the run has left it,
+* not just when the last task has finished: a thread still looking for work
+* could otherwise steal from the ranges of the next run and overwrite its own.
+* Only one thread may call TaskPool_Run at a time.
+*/
+
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include "GoLogPlatform.h"
+
+// Run task number task on worker number worker (0 = thread calling TaskPool_Run)
+typedef void (*TaskFunc)(void *context, uint32_t task, uint32_t worker);
+
+typedef struct TaskPool TaskPool;
+
+typedef struct
+{
+	volatile uint64_t range;			// Tasks not yet taken: begin << 32 | end
+	volatile uint64_t executed;			// Tasks run by this worker
+	volatile uint64_t stolen;			// Tasks taken from other workers
+	TaskPool *pool;
+	uint32_t index;
+	uint8_t padding[GOLOG_CACHE_LINE - 3 * sizeof(uint64_t) - sizeof(void *) - sizeof(uint32_t)];
+}TaskQueue;
+
+struct TaskPool
+{
+	uint32_t workerCount;				// Including the thread calling TaskPool_Run
+	TaskQueue *queues;					// One per worker
+	GoLogThread *threads;				// workerCount - 1 threads
+	GoLogSemaphore wake;				// Posted once per thread for each run
+	GoLogSemaphore done;				// Posted when the last thread has left the current run
+	volatile uint32_t stopRequested;
+	volatile uint64_t active;			// Threads woken for the current run that have not left it
+	TaskFunc func;						// Current run - set before the ranges are published
+	void *context;
+};
+
+// Start workerCount - 1 threads (workerCount 0 or 1 = no threads, tasks run by the caller). Returns 0 on success.
+int TaskPool_Start(TaskPool *pool, uint32_t workerCount);
+
+// Run func(context, task, worker) for task = 0 to taskCount - 1, and wait for all to finish
+void TaskPool_Run(TaskPool *pool, uint32_t taskCount, TaskFunc func, void *context);
+
+// Tasks run by all workers, and tasks stolen, since the pool was started
+void TaskPool_Counts(const TaskPool *pool, uint64_t *executed, uint64_t *stolen);
+
+void TaskPool_Stop(TaskPool *pool);
+
+#endif // TASK_POOL_H
@@ -0,0 +1,133 @@
+/*
+* MeasurementToCsv.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Convert binary measurement logs (MeasurementLog.h) to the semicolon
+* separated text file written by earlier versions of the logger:
+*
+*	Surface number; Measurement ID; Measurement value
+*	   1;   0; 12.34
+*
+* With -extended, the measurement decision and sensor time stamp are added as
+* two more columns.
+*
+* Usage: MeasurementToCsv [-extended] <log file> [<log file> ...]
+* Each xxx.bin file is converted to xxx.txt in the same folder.
+*/
+
+#include "../GoLogPlatform.h"
+#include "../MeasurementLog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Convert one log file. Returns number of measurements, or -1 on error.
+static int64_t Convert(const char *inputName, int extended)
+{
+	GoLogMappedFile map;
+	MeasurementBlock block;
+	char outputName[1024];
+	FILE *output;
+	uint64_t offset = MEASLOGHEADERSIZE;
+	uint64_t blockSize;
+	int64_t measurementCount = 0;
+	size_t nameLength = strlen(inputName);
+	uint32_t i;
+
+	if (GoLog_MapFile(&map, inputName) != 0)
+	{
+		printf("Error opening file %s\n", inputName);
+		return -1;
+	}
+	if (map.size < MEASLOGHEADERSIZE || memcmp(map.data, MEASLOGHEADERTEXT, 16) != 0)
+	{
+		printf("Not a measurement log: %s\n", inputName);
+		GoLog_UnmapFile(&map);
+		return -1;
+	}
+
+	if (nameLength > 4 && strcmp(inputName + nameLength - 4, ".bin") == 0)
+	{
+		snprintf(outputName, sizeof outputName, "%.*s.txt", (int)(nameLength - 4), inputName);
+	}
+	else
+	{
+		snprintf(outputName, sizeof outputName, "%s.txt", inputName);
+	}
+	if ((output = fopen(outputName, "w")) == NULL)
+	{
+		printf("Error opening file %s\n", outputName);
+		GoLog_UnmapFile(&map);
+		return -1;
+	}
+
+	// Same layout and formatting as the text file written by the logger up to 2018
+	if (extended)
+	{
+		fprintf(output, "Surface number; Measurement ID; Measurement value; Decision; Time stamp\r\n");
+	}
+	else
+	{
+		fprintf(output, "Surface number; Measurement ID; Measurement value\r\n");
+	}
+
+	while ((blockSize = MeasurementLog_ParseBlock(map.data + offset, map.size - offset, &block)) > 0)
+	{
+		for (i = 0; i < block.entryCount; i++)
+		{
+			if (extended)
+			{
+				fprintf(output, "%4.0u;%4.0u; %.2f;%u;%llu\r\n", block.counts[i], block.ids[i], block.values[i],
+					block.decisions[i], (unsigned long long)block.timeStamps[i]);
+			}
+			else
+			{
+				fprintf(output, "%4.0u;%4.0u; %.2f\r\n", block.counts[i], block.ids[i], block.values[i]);
+			}
+		}
+		measurementCount += block.entryCount;
+		offset += blockSize;
+	}
+	if (offset != map.size)
+	{
+		printf("Warning: %s ends with an incomplete block (%llu bytes ignored)\n", inputName,
+			(unsigned long long)(map.size - offset));
+	}
+
+	fclose(output);
+	GoLog_UnmapFile(&map);
+	printf("%s: %lld measurements written to %s\n", inputName, (long long)measurementCount, outputName);
+	return measurementCount;
+}
+
+int main(int argc, char **argv)
+{
+	int extended = 0;
+	int fileCount = 0;
+	int errorCount = 0;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-extended") == 0)
+		{
+			extended = 1;
+		}
+		else
+		{
+			fileCount++;
+			if (Convert(argv[i], extended) < 0)
+			{
+				errorCount++;
+			}
+		}
+	}
+
+	if (fileCount == 0)
+	{
+		printf("Usage: %s [-extended] <log file> [<log file> ...]\n", argv[0]);
+		return 1;
+	}
+	return errorCount > 0 ? 1 : 0;
+}
@@ -0,0 +1,777 @@
+/*
+* SurfaceBatchConvert.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Convert all logged surfaces under a folder (e.g. a day of
+* captures, with the Sensor<serial> subfolders of multi-sensor sessions) on
+* all CPUs: export point clouds (SurfaceCloud.h), recode the surface files
+* (compressed, tiled, with checksums, or back to raw) and collect summary
+* statistics (SurfaceStats.h) into one CSV file.
+*
+* Usage: SurfaceBatchConvert <input folder> <output folder> [-ply | -pcd | -xyz] [-compress | -raw] [-tiles <size>]
+*	[-checksum] [-stats] [-threads <n>] [-memory <MB>] [-readahead <files>] [-quiet]
+*
+* Surface files (*GocatorSurface.bin) and session containers
+* (*GocatorSession.bin) are found in the input folder and all its
+* subfolders, and the outputs are written to the same relative paths under
+* the output folder: xxx.ply / .pcd / .xyz point clouds, recoded xxx.bin
+* surface files, and SurfaceStats.csv with one line per surface. Surfaces
+* of a session container xxx_GocatorSession.bin are written to
+* xxx_GocatorSession_<surface number>.ply and to surface files
+* xxx_<surface number>_GocatorSurface.bin.
+*
+* The files are processed on n threads (default: all CPUs) with the
+* work-stealing pool (TaskPool.h), one task per file, so that a thread that
+* gets small files takes over files from one that gets large ones. Each
+* thread starts reading the next files of its share into the OS file cache
+* (GoLog_ReadAhead) before it needs them, so that the disk is kept busy
+* while the CPUs convert. Surfaces are read from the mapped files; the
+* memory used for decoded surfaces, coding buffers and point buffers is
+* reserved from a budget (-memory, default 1024 MB) before a surface is
+* converted, so that the threads together never hold more than the budget
+* however large the surfaces are.
+*
+* Progress (files, MB read and written, throughput and time left) is
+* printed every second, and a summary at the end. The exit code is 1 if any
+* file or surface could not be converted.
+*/
+
+#include "../GoLogPlatform.h"
+#include "../GoLogSimd.h"
+#include "../SurfaceReader.h"
+#include "../SurfaceContainer.h"
+#include "../SurfaceCloud.h"
+#include "../SurfaceCodec.h"
+#include "../SurfaceTiles.h"
+#include "../SurfaceStats.h"
+#include "../SurfaceChecksum.h"
+#include "../TaskPool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BATCH_MAXTHREADS		256
+#define BATCH_PATHSIZE			1280
+#define BATCH_MEMORYUNIT		(1024 * 1024)			// Memory budget is reserved in units of 1 MB
+#define BATCH_REPORTNS			1000000000ull			// Time between progress lines
+#define BATCH_STATSLINESIZE		256
+
+typedef struct
+{
+	char inputPath[BATCH_PATHSIZE];
+	char outputStem[BATCH_PATHSIZE];	// Output path without extension
+	char relativePath[BATCH_PATHSIZE];	// Input path relative to the input folder, for the statistics
+	uint64_t size;
+	volatile uint64_t readAhead;		// Set when the file has been read ahead
+	char *statsText;					// Statistics lines of the surfaces of the file
+	size_t statsLength;
+	size_t statsCapacity;
+	uint32_t errors;
+}BatchFile;
+
+// Per thread buffers that do not depend on the surface size
+typedef struct
+{
+	int16_t *row;						// Copy target for the statistics
+	uint32_t rowCapacity;
+	uint8_t padding[GOLOG_CACHE_LINE];
+}BatchWorker;
+
+typedef struct
+{
+	// Options
+	int cloud;
+	SurfaceCloudFormat cloudFormat;
+	int recode;
+	uint32_t codec;
+	uint32_t tileSize;
+	int checksum;
+	int stats;
+	uint32_t threads;
+	uint32_t memoryUnits;				// Memory budget in BATCH_MEMORYUNIT
+	uint32_t readAhead;					// Files read ahead of each thread
+	int quiet;
+
+	const char *outputFolder;
+	BatchFile *files;
+	uint32_t fileCount;
+	uint32_t fileCapacity;
+	uint64_t inputBytes;
+
+	TaskPool pool;
+	BatchWorker workers[BATCH_MAXTHREADS];
+	GoLogSemaphore memory;				// Free memory units
+	GoLogSemaphore memoryGate;			// One thread reserves memory at a time, so partial reservations cannot deadlock
+	volatile uint64_t memoryInUse;		// Units reserved
+	volatile uint64_t memoryHighWater;
+
+	uint64_t startNs;
+	volatile uint64_t lastReportNs;
+	volatile uint64_t filesDone;
+	volatile uint64_t bytesRead;
+	volatile uint64_t bytesWritten;
+	volatile uint64_t surfacesDone;
+	volatile uint64_t pointsWritten;
+	volatile uint64_t errors;
+}BatchConvert;
+
+static int BatchConvert_HasSuffix(const char *name, const char *suffix)
+{
+	size_t nameLength = strlen(name);
+	size_t suffixLength = strlen(suffix);
+	return nameLength >= suffixLength && strcmp(name + nameLength - suffixLength, suffix) == 0;
+}
+
+static int BatchConvert_AddFile(BatchConvert *batch, const char *folder, const char *relativeFolder, const char *outputFolder,
+	const char *name)
+{
+	GoLogMappedFile map;
+	BatchFile *file;
+	size_t stemLength = strlen(name) - 4;		// Without .bin
+
+	if (batch->fileCount == batch->fileCapacity)
+	{
+		uint32_t capacity = batch->fileCapacity ? 2 * batch->fileCapacity : 256;
+		BatchFile *grown = (BatchFile *)realloc(batch->files, capacity * sizeof(BatchFile));
+
+		if (grown == NULL)
+		{
+			return -1;
+		}
+		batch->files = grown;
+		batch->fileCapacity = capacity;
+	}
+	file = &batch->files[batch->fileCount];
+	memset(file, 0, sizeof(*file));
+	snprintf(file->inputPath, sizeof file->inputPath, "%s/%s", folder, name);
+	snprintf(file->outputStem, sizeof file->outputStem, "%s/%.*s", outputFolder, (int)stemLength, name);
+	snprintf(file->relativePath, sizeof file->relativePath, "%s%s%s", relativeFolder, relativeFolder[0] ? "/" : "", name);
+
+	// Size for the progress report; empty or unreadable files are reported when they are converted
+	if (GoLog_MapFile(&map, file->inputPath) == 0)
+	{
+		file->size = map.size;
+		GoLog_UnmapFile(&map);
+	}
+	batch->inputBytes += file->size;
+	batch->fileCount++;
+	return 0;
+}
+
+// Find the surface files and containers in folder and its subfolders, and create the output folders. Returns 0 on success.
+static int BatchConvert_Discover(BatchConvert *batch, const char *folder, const char *relativeFolder, const char *outputFolder)
+{
+	char subfolder[BATCH_PATHSIZE];
+	char relativeSubfolder[BATCH_PATHSIZE];
+	char outputSubfolder[BATCH_PATHSIZE];
+	char **names;
+	int nameCount;
+	int result = 0;
+	int i;
+
+	if (GoLog_MakeFolder(outputFolder) != 0)
+	{
+		printf("Error creating folder %s\n", outputFolder);
+		return -1;
+	}
+
+	if ((nameCount = GoLog_ListFiles(folder, ".bin", &names)) < 0)
+	{
+		printf("Error reading folder %s\n", folder);
+		return -1;
+	}
+	for (i = 0; i < nameCount && result == 0; i++)
+	{
+		if (BatchConvert_HasSuffix(names[i], DATAFILENAMESUFFIX) || BatchConvert_HasSuffix(names[i], SESSIONFILENAMESUFFIX))
+		{
+			result = BatchConvert_AddFile(batch, folder, relativeFolder, outputFolder, names[i]);
+		}
+	}
+	GoLog_FreeFileList(names, nameCount);
+
+	if (result != 0 || (nameCount = GoLog_ListFolders(folder, &names)) < 0)
+	{
+		return -1;
+	}
+	for (i = 0; i < nameCount && result == 0; i++)
+	{
+		snprintf(subfolder, sizeof subfolder, "%s/%s", folder, names[i]);
+		if (strcmp(subfolder, batch->outputFolder) == 0)
+		{
+			continue;							// Output folder inside the input folder
+		}
+		snprintf(relativeSubfolder, sizeof relativeSubfolder, "%s%s%s", relativeFolder, relativeFolder[0] ? "/" : "", names[i]);
+		snprintf(outputSubfolder, sizeof outputSubfolder, "%s/%s", outputFolder, names[i]);
+		result = BatchConvert_Discover(batch, subfolder, relativeSubfolder, outputSubfolder);
+	}
+	GoLog_FreeFileList(names, nameCount);
+	return result;
+}
+
+// Wait until size bytes of the memory budget are free and reserve them. Returns the units reserved.
+static uint32_t BatchConvert_Reserve(BatchConvert *batch, uint64_t size)
+{
+	uint64_t units = (size + BATCH_MEMORYUNIT - 1) / BATCH_MEMORYUNIT;
+	uint64_t inUse;
+	uint64_t highWater;
+	uint32_t i;
+
+	// A surface larger than the whole budget runs on its own
+	if (units > batch->memoryUnits)
+	{
+		units = batch->memoryUnits;
+	}
+	GoLogSemaphore_Wait(&batch->memoryGate);
+	for (i = 0; i < units; i++)
+	{
+		GoLogSemaphore_Wait(&batch->memory);
+	}
+	GoLogSemaphore_Post(&batch->memoryGate, 1);
+
+	inUse = GoLogAtomic_Add64(&batch->memoryInUse, units);
+	while ((highWater = GoLogAtomic_Load64(&batch->memoryHighWater)) < inUse &&
+		!GoLogAtomic_CompareExchange64(&batch->memoryHighWater, highWater, inUse))
+	{
+	}
+	return (uint32_t)units;
+}
+
+static void BatchConvert_Release(BatchConvert *batch, uint32_t units)
+{
+	GoLogAtomic_Add64(&batch->memoryInUse, (uint64_t)0 - units);
+	GoLogSemaphore_Post(&batch->memory, units);
+}
+
+// Append a statistics line to the text of file. Returns 0 on success.
+static int BatchConvert_AddStats(BatchFile *file, const SurfaceRecord *record)
+{
+	uint64_t samples;
+	double validPercent;
+	char *grown;
+
+	if (file->statsLength + BATCH_STATSLINESIZE > file->statsCapacity)
+	{
+		size_t capacity = 2 * file->statsCapacity + 16 * BATCH_STATSLINESIZE;
+
+		if ((grown = (char *)realloc(file->statsText, capacity)) == NULL)
+		{
+			return -1;
+		}
+		file->statsText = grown;
+		file->statsCapacity = capacity;
+	}
+
+	// Valid share of the full surface, also for cropped surfaces, as in the time stamp index (SurfaceIndex.h)
+	samples = record->fullWidth ? (uint64_t)record->fullWidth * record->fullLength : (uint64_t)record->surfaceWidth * record->surfaceLength;
+	validPercent = samples ? 100.0 * record->validCount / samples : 0.0;
+	file->statsLength += (size_t)snprintf(file->statsText + file->statsLength, BATCH_STATSLINESIZE,
+		"%s;%u;%llu;%u;%u;%.2f;%.4f;%.4f;%.4f;%.4f\n", file->relativePath, record->count,
+		(unsigned long long)record->timeStamp, record->surfaceWidth, record->surfaceLength, validPercent,
+		record->zMin, record->zMax, record->zMean, record->zStdDev);
+	return 0;
+}
+
+// Write the valid samples of heights (the surface of record) as a point cloud. Returns bytes written, or -1 on error.
+static int64_t BatchConvert_WriteCloud(BatchConvert *batch, const SurfaceRecord *record, const int16_t *heights,
+	const char *path, uint64_t *pointCount)
+{
+	SurfaceCloudWriter writer;
+	FILE *fptr;
+	int64_t size;
+	int result;
+
+	*pointCount = SurfaceCloud_CountValid(heights, (size_t)record->surfaceWidth * record->surfaceLength);
+	if ((fptr = fopen(path, "wb")) == NULL)
+	{
+		return -1;
+	}
+	if (SurfaceCloudWriter_Begin(&writer, fptr, batch->cloudFormat, *pointCount, record->surfaceWidth) != 0)
+	{
+		fclose(fptr);
+		return -1;
+	}
+	result = SurfaceCloudWriter_Rows(&writer, record, heights, record->surfaceWidth, record->surfaceLength,
+		record->cropColumn, record->cropRow);
+	if (SurfaceCloudWriter_End(&writer) != 0)
+	{
+		result = -1;
+	}
+	size = (int64_t)ftell(fptr);
+	if (fclose(fptr) != 0 || result != 0)
+	{
+		return -1;
+	}
+	return size;
+}
+
+// Write heights (the surface of record) as a surface file, coded as selected. buffer has room for the coded surface and
+// scratch for one tile. Returns bytes written, or -1 on error.
+static int64_t BatchConvert_WriteSurface(BatchConvert *batch, const SurfaceRecord *record, const int16_t *heights,
+	uint8_t *buffer, size_t capacity, int16_t *scratch, const char *path)
+{
+	SurfaceRecord output = *record;
+	uint8_t header[HEADERSIZE_MAX];
+	GoLogIoVec pieces[2];
+	GoLogFile file;
+	size_t encodedSize;
+	int result;
+
+	// Starts as a raw surface stored row by row, as after SurfaceFile_Decode
+	output.data = (int16_t *)heights;
+	output.codec = SURFACECODEC_RAW;
+	output.tileWidth = 0;
+	output.tileLength = 0;
+	output.payload = heights;
+	output.payloadSize = (uint64_t)record->surfaceWidth * record->surfaceLength * sizeof(int16_t);
+	output.checksumChunkSize = 0;
+	output.checksumChunkCount = 0;
+	output.pyramid = NULL;
+
+	if (batch->tileSize > 0 && output.payloadSize > 0)
+	{
+		if (SurfaceTiles_Encode(heights, record->surfaceWidth, record->surfaceLength, batch->tileSize, batch->tileSize,
+			batch->codec, scratch, buffer, capacity, &encodedSize) == 0)
+		{
+			output.codec = batch->codec;
+			output.tileWidth = batch->tileSize;
+			output.tileLength = batch->tileSize;
+			output.payload = buffer;
+			output.payloadSize = encodedSize;
+		}
+	}
+	else if (batch->codec == SURFACECODEC_MEDRICE && output.payloadSize > 0 &&
+		SurfaceCodec_Encode(heights, record->surfaceWidth, record->surfaceLength, buffer, capacity, &encodedSize) == 0)
+	{
+		output.codec = SURFACECODEC_MEDRICE;
+		output.payload = buffer;
+		output.payloadSize = encodedSize;
+	}
+	if (batch->checksum)
+	{
+		SurfaceChecksum_Compute(&output);
+	}
+
+	// Header and payload in one gathered write, as the file sink does
+	pieces[0].data = header;
+	pieces[0].size = SurfaceFormat_EncodeHeader(header, &output);
+	pieces[1].data = output.payload;
+	pieces[1].size = (size_t)output.payloadSize;
+	if (GoLog_CreateFile(&file, path, 0) != 0)
+	{
+		return -1;
+	}
+	result = GoLog_WriteFileVectors(&file, pieces, 2);
+	if (GoLog_CloseFile(&file) != 0 || result != 0)
+	{
+		return -1;
+	}
+	return (int64_t)(pieces[0].size + pieces[1].size);
+}
+
+// Convert one surface. Returns 0 on success.
+static int BatchConvert_Surface(BatchConvert *batch, BatchWorker *worker, BatchFile *file, int isContainer,
+	SurfaceRecord *record)
+{
+	char path[BATCH_PATHSIZE + 32];
+	size_t sampleCount = (size_t)record->surfaceWidth * record->surfaceLength;
+	size_t rawSize = sampleCount * sizeof(int16_t);
+	size_t codedCapacity = 0;
+	size_t scratchSize = 0;
+	uint64_t need = 0;
+	uint32_t units;
+	int16_t *decoded = NULL;
+	uint8_t *coded = NULL;
+	int16_t *scratch = NULL;
+	const int16_t *heights = record->data;
+	uint64_t pointCount;
+	int64_t written;
+	int result = 0;
+
+	// Memory needed for this surface: decoded heights unless they can be read from the mapped file, coding buffers,
+	// and the point buffer of the cloud writer
+	if (heights == NULL)
+	{
+		need += rawSize;
+	}
+	if (batch->recode)
+	{
+		codedCapacity = (batch->tileSize > 0) ?
+			(size_t)SurfaceTiles_MaxSize(record->surfaceWidth, record->surfaceLength, batch->tileSize, batch->tileSize) : rawSize;
+		scratchSize = (batch->tileSize > 0) ? (size_t)batch->tileSize * batch->tileSize * sizeof(int16_t) : 0;
+		need += codedCapacity + scratchSize;
+	}
+	if (batch->cloud)
+	{
+		need += ((uint64_t)SURFACECLOUD_BUFFERPOINTS + record->surfaceWidth + SURFACECLOUD_SLACK) *
+			(3 * sizeof(float) + (batch->cloudFormat == SURFACECLOUD_XYZ ? 80 : 0));
+	}
+	units = BatchConvert_Reserve(batch, need);
+
+	if (heights == NULL)
+	{
+		if ((decoded = (int16_t *)malloc(rawSize > 0 ? rawSize : 1)) == NULL || SurfaceFile_Decode(record, decoded) != 0)
+		{
+			printf("Error decoding surface %u of %s\n", record->count, file->inputPath);
+			result = -1;
+		}
+		heights = decoded;
+	}
+
+	if (result == 0 && batch->stats)
+	{
+		SurfaceStatsSums sums;
+		uint32_t row;
+
+		if (worker->rowCapacity < record->surfaceWidth)
+		{
+			free(worker->row);
+			worker->rowCapacity = record->surfaceWidth;
+			if ((worker->row = (int16_t *)malloc(worker->rowCapacity * sizeof(int16_t))) == NULL)
+			{
+				worker->rowCapacity = 0;
+			}
+		}
+		if (worker->rowCapacity < record->surfaceWidth && record->surfaceWidth > 0)
+		{
+			result = -1;
+		}
+		else
+		{
+			SurfaceStats_Begin(&sums);
+			for (row = 0; row < record->surfaceLength; row++)
+			{
+				SurfaceStats_CopyRow(worker->row, heights + (size_t)row * record->surfaceWidth, record->surfaceWidth, &sums);
+			}
+			SurfaceStats_Finish(&sums, record);
+			result = BatchConvert_AddStats(file, record);
+		}
+		if (result != 0)
+		{
+			printf("Out of memory\n");
+		}
+	}
+
+	if (result == 0 && batch->cloud)
+	{
+		if (isContainer)
+		{
+			snprintf(path, sizeof path, "%s_%u.%s", file->outputStem, record->count, SurfaceCloud_Extension(batch->cloudFormat));
+		}
+		else
+		{
+			snprintf(path, sizeof path, "%s.%s", file->outputStem, SurfaceCloud_Extension(batch->cloudFormat));
+		}
+		if ((written = BatchConvert_WriteCloud(batch, record, heights, path, &pointCount)) < 0)
+		{
+			printf("Error writing file %s\n", path);
+			result = -1;
+		}
+		else
+		{
+			GoLogAtomic_Add64(&batch->bytesWritten, (uint64_t)written);
+			GoLogAtomic_Add64(&batch->pointsWritten, pointCount);
+		}
+	}
+
+	if (result == 0 && batch->recode)
+	{
+		if (isContainer)
+		{
+			// Named like the surface files of the logger, so that they are found as surface files again
+			snprintf(path, sizeof path, "%.*s%04u_%s", (int)(strlen(file->outputStem) - (sizeof(SESSIONFILENAMESUFFIX) - 5)),
+				file->outputStem, record->count, DATAFILENAMESUFFIX);
+		}
+		else
+		{
+			snprintf(path, sizeof path, "%s.bin", file->outputStem);
+		}
+		coded = (uint8_t *)malloc(codedCapacity > 0 ? codedCapacity : 1);
+		scratch = (int16_t *)malloc(scratchSize > 0 ? scratchSize : 1);
+		if (coded == NULL || scratch == NULL)
+		{
+			printf("Out of memory\n");
+			result = -1;
+		}
+		else if ((written = BatchConvert_WriteSurface(batch, record, heights, coded, codedCapacity, scratch, path)) < 0)
+		{
+			printf("Error writing file %s\n", path);
+			result = -1;
+		}
+		else
+		{
+			GoLogAtomic_Add64(&batch->bytesWritten, (uint64_t)written);
+		}
+	}
+
+	free(decoded);
+	free(coded);
+	free(scratch);
+	BatchConvert_Release(batch, units);
+	return result;
+}
+
+static void BatchConvert_Report(BatchConvert *batch, uint64_t nowNs)
+{
+	double seconds = (nowNs - batch->startNs) / 1e9;
+	uint64_t bytesRead = GoLogAtomic_Load64(&batch->bytesRead);
+	double fraction = (batch->inputBytes > 0) ? (double)bytesRead / batch->inputBytes : 0.0;
+
+	printf("[%7.1f s] %llu / %u files (%.1f%%), %.1f MB read at %.1f MB/s, %.1f MB written at %.1f MB/s, %llu MB reserved",
+		seconds, (unsigned long long)GoLogAtomic_Load64(&batch->filesDone), batch->fileCount, 100.0 * fraction,
+		bytesRead / 1e6, (seconds > 0) ? bytesRead / seconds / 1e6 : 0.0, GoLogAtomic_Load64(&batch->bytesWritten) / 1e6,
+		(seconds > 0) ? GoLogAtomic_Load64(&batch->bytesWritten) / seconds / 1e6 : 0.0,
+		(unsigned long long)GoLogAtomic_Load64(&batch->memoryInUse));
+	if (fraction > 0.0 && fraction < 1.0)
+	{
+		printf(", %.0f s left", seconds * (1.0 - fraction) / fraction);
+	}
+	printf("\n");
+}
+
+static void BatchConvert_FileTask(void *context, uint32_t task, uint32_t workerIdx)
+{
+	BatchConvert *batch = (BatchConvert *)context;
+	BatchFile *file = &batch->files[task];
+	SurfaceFile surfaceFile;
+	SurfaceRecord record;
+	uint64_t surfaceIdx;
+	uint64_t lastReportNs;
+	uint64_t nowNs;
+	uint32_t ahead;
+
+	// The pool hands each thread its share of the files in order, so the next files of this thread follow this one
+	for (ahead = 1; ahead <= batch->readAhead && task + ahead < batch->fileCount; ahead++)
+	{
+		if (GoLogAtomic_CompareExchange64(&batch->files[task + ahead].readAhead, 0, 1))
+		{
+			GoLog_ReadAhead(batch->files[task + ahead].inputPath);
+		}
+	}
+
+	if (SurfaceFile_Open(&surfaceFile, file->inputPath) != 0)
+	{
+		printf("Error opening file %s\n", file->inputPath);
+		file->errors++;
+	}
+	else
+	{
+		for (surfaceIdx = 0; surfaceIdx < SurfaceFile_Count(&surfaceFile); surfaceIdx++)
+		{
+			if (SurfaceFile_Surface(&surfaceFile, surfaceIdx, &record) != 0)
+			{
+				printf("Error reading surface %llu of %s\n", (unsigned long long)surfaceIdx, file->inputPath);
+				file->errors++;
+			}
+			else if (BatchConvert_Surface(batch, &batch->workers[workerIdx], file, surfaceFile.isContainer, &record) != 0)
+			{
+				file->errors++;
+			}
+			else
+			{
+				GoLogAtomic_Add64(&batch->surfacesDone, 1);
+			}
+		}
+		SurfaceFile_Close(&surfaceFile);
+	}
+
+	GoLogAtomic_Add64(&batch->bytesRead, file->size);
+	GoLogAtomic_Add64(&batch->errors, file->errors);
+	GoLogAtomic_Add64(&batch->filesDone, 1);
+
+	// Whichever thread finishes a file first after the report interval prints the progress
+	nowNs = GoLog_MonotonicNs();
+	lastReportNs = GoLogAtomic_Load64(&batch->lastReportNs);
+	if (!batch->quiet && nowNs - lastReportNs >= BATCH_REPORTNS &&
+		GoLogAtomic_CompareExchange64(&batch->lastReportNs, lastReportNs, nowNs))
+	{
+		BatchConvert_Report(batch, nowNs);
+	}
+}
+
+// Write the statistics of all files, in file order. Returns 0 on success.
+static int BatchConvert_WriteStats(BatchConvert *batch, const char *path)
+{
+	FILE *fptr;
+	uint32_t i;
+	int result = 0;
+
+	if ((fptr = fopen(path, "w")) == NULL)
+	{
+		return -1;
+	}
+	fprintf(fptr, "File;Surface;Time stamp;Width;Length;Valid [%%];zMin [mm];zMax [mm];zMean [mm];zStdDev [mm]\n");
+	for (i = 0; i < batch->fileCount; i++)
+	{
+		if (batch->files[i].statsLength > 0 &&
+			fwrite(batch->files[i].statsText, 1, batch->files[i].statsLength, fptr) != batch->files[i].statsLength)
+		{
+			result = -1;
+		}
+	}
+	if (fclose(fptr) != 0)
+	{
+		result = -1;
+	}
+	return result;
+}
+
+static void BatchConvert_Usage(const char *program)
+{
+	printf("Usage: %s <input folder> <output folder> [-ply | -pcd | -xyz] [-compress | -raw] [-tiles <size>]\n", program);
+	printf("       [-checksum] [-stats] [-threads <n>] [-memory <MB>] [-readahead <files>] [-quiet]\n");
+	printf("  -ply, -pcd, -xyz     export each surface as a point cloud\n");
+	printf("  -compress, -raw      write each surface as a compressed or raw surface file\n");
+	printf("  -tiles <size>        ... stored in size x size tiles (VER0005)\n");
+	printf("  -checksum            ... with CRC32C checksums (VER0006)\n");
+	printf("  -stats               write summary statistics of all surfaces to SurfaceStats.csv\n");
+	printf("  -threads <n>         threads (default: number of CPUs)\n");
+	printf("  -memory <MB>         most memory for surfaces being converted (default 1024)\n");
+	printf("  -readahead <files>   files read ahead of each thread (default 4, 0 = none)\n");
+}
+
+int main(int argc, char **argv)
+{
+	static BatchConvert batch;
+	char statsPath[BATCH_PATHSIZE];
+	uint64_t executed;
+	uint64_t stolen;
+	double seconds;
+	uint32_t i;
+	int argi;
+
+	if (argc < 3)
+	{
+		BatchConvert_Usage(argv[0]);
+		return 1;
+	}
+
+	batch.threads = (uint32_t)GoLog_CpuCount();
+	batch.memoryUnits = 1024;
+	batch.readAhead = 4;
+	for (argi = 3; argi < argc; argi++)
+	{
+		if (strcmp(argv[argi], "-ply") == 0 || strcmp(argv[argi], "-pcd") == 0 || strcmp(argv[argi], "-xyz") == 0)
+		{
+			batch.cloud = 1;
+			batch.cloudFormat = (argv[argi][1] == 'p') ? ((argv[argi][2] == 'l') ? SURFACECLOUD_PLY : SURFACECLOUD_PCD) :
+				SURFACECLOUD_XYZ;
+		}
+		else if (strcmp(argv[argi], "-compress") == 0)
+		{
+			batch.recode = 1;
+			batch.codec = SURFACECODEC_MEDRICE;
+		}
+		else if (strcmp(argv[argi], "-raw") == 0)
+		{
+			batch.recode = 1;
+			batch.codec = SURFACECODEC_RAW;
+		}
+		else if (strcmp(argv[argi], "-tiles") == 0 && argi + 1 < argc)
+		{
+			batch.recode = 1;
+			batch.tileSize = (uint32_t)atoi(argv[++argi]);
+		}
+		else if (strcmp(argv[argi], "-checksum") == 0)
+		{
+			batch.recode = 1;
+			batch.checksum = 1;
+		}
+		else if (strcmp(argv[argi], "-stats") == 0)
+		{
+			batch.stats = 1;
+		}
+		else if (strcmp(argv[argi], "-threads") == 0 && argi + 1 < argc)
+		{
+			batch.threads = (uint32_t)atoi(argv[++argi]);
+		}
+		else if (strcmp(argv[argi], "-memory") == 0 && argi + 1 < argc)
+		{
+			batch.memoryUnits = (uint32_t)atoi(argv[++argi]);
+		}
+		else if (strcmp(argv[argi], "-readahead") == 0 && argi + 1 < argc)
+		{
+			batch.readAhead = (uint32_t)atoi(argv[++argi]);
+		}
+		else if (strcmp(argv[argi], "-quiet") == 0)
+		{
+			batch.quiet = 1;
+		}
+		else
+		{
+			BatchConvert_Usage(argv[0]);
+			return 1;
+		}
+	}
+	if (batch.threads == 0 || batch.threads > BATCH_MAXTHREADS || batch.memoryUnits == 0 ||
+		(!batch.cloud && !batch.recode && !batch.stats))
+	{
+		BatchConvert_Usage(argv[0]);
+		return 1;
+	}
+
+	batch.outputFolder = argv[2];
+	if (BatchConvert_Discover(&batch, argv[1], "", argv[2]) != 0)
+	{
+		return 1;
+	}
+	// The SIMD level is detected here, before the threads start
+	printf("%u files (%.1f MB) in %s, converting on %u threads with %u MB of memory, SIMD level %s\n", batch.fileCount,
+		batch.inputBytes / 1e6, argv[1], batch.threads, batch.memoryUnits, GoLogSimd_Name(GoLogSimd_Level()));
+
+	if (GoLogSemaphore_Init(&batch.memory) != 0 || GoLogSemaphore_Init(&batch.memoryGate) != 0 ||
+		TaskPool_Start(&batch.pool, batch.threads) != 0)
+	{
+		printf("Error starting threads\n");
+		return 1;
+	}
+	GoLogSemaphore_Post(&batch.memory, batch.memoryUnits);
+	GoLogSemaphore_Post(&batch.memoryGate, 1);
+
+	batch.startNs = GoLog_MonotonicNs();
+	batch.lastReportNs = batch.startNs;
+	TaskPool_Run(&batch.pool, batch.fileCount, BatchConvert_FileTask, &batch);
+	seconds = (GoLog_MonotonicNs() - batch.startNs) / 1e9;
+	TaskPool_Counts(&batch.pool, &executed, &stolen);
+	TaskPool_Stop(&batch.pool);
+
+	if (batch.stats)
+	{
+		snprintf(statsPath, sizeof statsPath, "%s/SurfaceStats.csv", argv[2]);
+		if (BatchConvert_WriteStats(&batch, statsPath) != 0)
+		{
+			printf("Error writing file %s\n", statsPath);
+			batch.errors++;
+		}
+	}
+
+	printf("%llu files, %llu surfaces in %.2f s (%.1f surfaces/s): %.1f MB read at %.1f MB/s, %.1f MB written at %.1f MB/s\n",
+		(unsigned long long)batch.filesDone, (unsigned long long)batch.surfacesDone, seconds,
+		(seconds > 0) ? batch.surfacesDone / seconds : 0.0, batch.bytesRead / 1e6, (seconds > 0) ? batch.bytesRead / seconds / 1e6 : 0.0,
+		batch.bytesWritten / 1e6, (seconds > 0) ? batch.bytesWritten / seconds / 1e6 : 0.0);
+	if (batch.cloud)
+	{
+		printf("%llu points (%.1f Mpoints/s)\n", (unsigned long long)batch.pointsWritten,
+			(seconds > 0) ? batch.pointsWritten / seconds / 1e6 : 0.0);
+	}
+	printf("Memory: %llu of %u MB reserved at most; %llu of %llu files taken over by another thread\n",
+		(unsigned long long)batch.memoryHighWater, batch.memoryUnits, (unsigned long long)stolen,
+		(unsigned long long)executed);
+	if (batch.errors > 0)
+	{
+		printf("%llu files or surfaces could not be converted\n", (unsigned long long)batch.errors);
+	}
+
+	for (i = 0; i < batch.fileCount; i++)
+	{
+		free(batch.files[i].statsText);
+	}
+	for (i = 0; i < BATCH_MAXTHREADS; i++)
+	{
+		free(batch.workers[i].row);
+	}
+	free(batch.files);
+	GoLogSemaphore_Destroy(&batch.memory);
+	GoLogSemaphore_Destroy(&batch.memoryGate);
+	return batch.errors > 0 ? 1 : 0;
+}
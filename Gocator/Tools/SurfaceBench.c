@@ -0,0 +1,1199 @@
+/*
+* SurfaceBench.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Micro-benchmarks for the surface processing kernels, run on
+* synthetic surfaces (SyntheticSurface.h).
+*
+* Usage: SurfaceBench <benchmark> [-width W] [-length L] [-iterations N] [-folder F] [-threads T]
+*
+* Benchmarks:
+*	convert		k16s to metric Z (SurfaceConvert.h) for each SIMD level, float and
+*				double, compared with the plain scalar loop used by consumers
+*	cloud		point cloud rows (SurfaceCloud.h) for each SIMD level in points/s, checked
+*				against plain C and compared with the double precision loop used by
+*				consumers, and a binary PLY file written to folder F (deleted afterwards)
+*	pyramid		2x, 4x and 8x overview levels (SurfacePyramid.h) for each SIMD level,
+*				checked against the plain C version
+*	stats		copying the rows of a surface with summary statistics (SurfaceStats.h) for
+*				each SIMD level, compared with memcpy alone and checked against plain C
+*	checksum	CRC32C of a raw surface (SurfaceChecksum.h) with the table and with the SSE4.2
+*				instruction, compared with memcpy, and verifying it chunk by chunk
+*	crop		bounding box of the valid samples (SurfaceCrop.h) for each SIMD level, on
+*				a surface with invalid rows added at both ends, checked against plain C
+*	tiles		reading a 25 x 25 mm region (250 x 250 samples) from the middle of the
+*				surface (SurfaceReader.h), stored row by row and in 256 x 256 tiles
+*				(SurfaceTiles.h), raw and compressed; bytes of surface data read and time
+*				per region, checked against decoding the whole surface. Use a long
+*				surface, e.g. -length 20000.
+*	compress	compression of one surface on 1 to T threads (default: number of CPUs) with
+*				the work-stealing pool (TaskPool.h), in bands of 64 rows and in 256 x 256
+*				tiles, compared with coding the whole surface on one thread; checked
+*				against coding the tiles one after the other
+*	taskpool	N * 1000 back-to-back runs of the work-stealing pool (TaskPool.h) on T threads
+*				(at least 4), with 1 to 4 tasks per thread that only count themselves, as
+*				the encoder calls it once per surface; checks that every task of every run
+*				ran exactly once, and reports runs per second
+*	sink		N surfaces through the writer thread to one file each, with the stdio
+*				sink, the direct I/O sink and the io_uring sink, raw and compressed.
+*				Files are written to folder F (default current folder) and deleted
+*				afterwards. On Linux the write system calls per surface are counted.
+*/
+
+#include "../GoLogPlatform.h"
+#include "../GoLogSimd.h"
+#include "../SurfaceFormat.h"
+#include "../SurfaceConvert.h"
+#include "../SurfaceCloud.h"
+#include "../SurfacePyramid.h"
+#include "../SurfaceCrop.h"
+#include "../SurfaceStats.h"
+#include "../SurfaceChecksum.h"
+#include "../SurfaceTiles.h"
+#include "../SurfaceReader.h"
+#include "../SyntheticSurface.h"
+#include "../SurfaceCodec.h"
+#include "../SurfaceWriter.h"
+#include "../SurfaceUringSink.h"
+#include "../TaskPool.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+	uint32_t width;
+	uint32_t length;
+	uint32_t iterations;
+	char folder[1024];					// With trailing path separator
+	uint32_t threads;					// Most threads for compress
+}BenchOptions;
+
+typedef int (*BenchFunc)(const BenchOptions *options);
+
+// Best SIMD level of this CPU, ignoring any limit set with GOLOG_SIMD
+static GoLogSimdLevel Bench_CpuSimdLevel(void)
+{
+	GoLogSimd_Level();
+	GoLogSimd_SetMaxLevel(GOLOG_SIMD_AVX2);
+	return GoLogSimd_Level();
+}
+
+static double Bench_Seconds(uint64_t startNs)
+{
+	return (GoLog_MonotonicNs() - startNs) / 1.0e9;
+}
+
+// Reference: the loop every consumer writes
+static void Bench_ConvertNaive(const int16_t *heights, size_t count, double zOffset, double zResolution, double *z)
+{
+	size_t i;
+	for (i = 0; i < count; i++)
+	{
+		z[i] = (heights[i] == INVALID_RANGE_16BIT) ? NAN : zOffset + heights[i] * zResolution;
+	}
+}
+
+static int Bench_Convert(const BenchOptions *options)
+{
+	size_t count = (size_t)options->width * options->length;
+	int16_t *heights = malloc(count * sizeof(int16_t));
+	double *zReference = malloc(count * sizeof(double));
+	double *zDouble = malloc(count * sizeof(double));
+	float *zFloat = malloc(count * sizeof(float));
+	uint8_t *mask = malloc((count + 7) / 8);
+	const double zOffset = 10.0;
+	const double zResolution = 0.002;
+	double naiveSeconds;
+	uint64_t startNs;
+	uint32_t iteration;
+	int level;
+	GoLogSimdLevel cpuLevel = Bench_CpuSimdLevel();
+
+	if (heights == NULL || zReference == NULL || zDouble == NULL || zFloat == NULL || mask == NULL)
+	{
+		printf("Out of memory\n");
+		return -1;
+	}
+	SyntheticSurface_Fill(heights, options->width, options->length, 0);
+
+	startNs = GoLog_MonotonicNs();
+	for (iteration = 0; iteration < options->iterations; iteration++)
+	{
+		Bench_ConvertNaive(heights, count, zOffset, zResolution, zReference);
+	}
+	naiveSeconds = Bench_Seconds(startNs) / options->iterations;
+	printf("%-8s %-7s %10.1f Msamples/s  (reference)\n", "naive", "double", count / naiveSeconds / 1.0e6);
+
+	for (level = GOLOG_SIMD_SCALAR; level <= (int)cpuLevel; level++)
+	{
+		double seconds;
+		double maxError = 0.0;
+		size_t i;
+
+		GoLogSimd_SetMaxLevel((GoLogSimdLevel)level);
+
+		startNs = GoLog_MonotonicNs();
+		for (iteration = 0; iteration < options->iterations; iteration++)
+		{
+			SurfaceConvert_ToDouble(heights, count, zOffset, zResolution, NAN, zDouble, mask);
+		}
+		seconds = Bench_Seconds(startNs) / options->iterations;
+		for (i = 0; i < count; i++)
+		{
+			int valid = (mask[i >> 3] >> (i & 7)) & 1;
+			if (valid != !isnan(zReference[i]) || isnan(zDouble[i]) != isnan(zReference[i]))
+			{
+				printf("Mismatch at sample %lu\n", (unsigned long)i);
+				return -1;
+			}
+			if (valid && fabs(zDouble[i] - zReference[i]) > maxError)
+			{
+				maxError = fabs(zDouble[i] - zReference[i]);
+			}
+		}
+		printf("%-8s %-7s %10.1f Msamples/s  %5.2fx  max error %.2g mm\n", GoLogSimd_Name((GoLogSimdLevel)level), "double",
+			count / seconds / 1.0e6, naiveSeconds / seconds, maxError);
+
+		startNs = GoLog_MonotonicNs();
+		for (iteration = 0; iteration < options->iterations; iteration++)
+		{
+			SurfaceConvert_ToFloat(heights, count, zOffset, zResolution, NAN, zFloat, mask);
+		}
+		seconds = Bench_Seconds(startNs) / options->iterations;
+		maxError = 0.0;
+		for (i = 0; i < count; i++)
+		{
+			if (isnan(zFloat[i]) != isnan(zReference[i]))
+			{
+				printf("Mismatch at sample %lu\n", (unsigned long)i);
+				return -1;
+			}
+			if (!isnan(zFloat[i]) && fabs(zFloat[i] - zReference[i]) > maxError)
+			{
+				maxError = fabs(zFloat[i] - zReference[i]);
+			}
+		}
+		printf("%-8s %-7s %10.1f Msamples/s  %5.2fx  max error %.2g mm\n", GoLogSimd_Name((GoLogSimdLevel)level), "float",
+			count / seconds / 1.0e6, naiveSeconds / seconds, maxError);
+	}
+	GoLogSimd_SetMaxLevel(GOLOG_SIMD_AVX2);
+
+	free(heights);
+	free(zReference);
+	free(zDouble);
+	free(zFloat);
+	free(mask);
+	return 0;
+}
+
+// Reference: the point loop every consumer writes
+static size_t Bench_CloudNaive(const int16_t *heights, const SurfaceRecord *record, double *points)
+{
+	size_t n = 0;
+	uint32_t row;
+	uint32_t column;
+
+	for (row = 0; row < record->surfaceLength; row++)
+	{
+		for (column = 0; column < record->surfaceWidth; column++)
+		{
+			int16_t h = heights[(size_t)row * record->surfaceWidth + column];
+
+			if (h != INVALID_RANGE_16BIT)
+			{
+				points[3 * n] = record->xOffset + column * record->xResolution;
+				points[3 * n + 1] = record->yOffset + row * record->yResolution;
+				points[3 * n + 2] = record->zOffset + h * record->zResolution;
+				n++;
+			}
+		}
+	}
+	return n;
+}
+
+// Points of all rows of record into points. Returns the number of points.
+static size_t Bench_CloudRows(const int16_t *heights, const SurfaceRecord *record, float *points)
+{
+	size_t n = 0;
+	uint32_t row;
+
+	for (row = 0; row < record->surfaceLength; row++)
+	{
+		n += SurfaceCloud_Row(heights + (size_t)row * record->surfaceWidth, record->surfaceWidth, 0, (float)record->xOffset,
+			(float)record->xResolution, (float)(record->yOffset + row * record->yResolution), (float)record->zOffset,
+			(float)record->zResolution, points + 3 * n);
+	}
+	return n;
+}
+
+static int Bench_Cloud(const BenchOptions *options)
+{
+	size_t count = (size_t)options->width * options->length;
+	int16_t *heights = malloc(count * sizeof(int16_t));
+	double *naive = malloc(3 * count * sizeof(double));
+	float *reference = malloc(3 * (count + SURFACECLOUD_SLACK) * sizeof(float));
+	float *points = malloc(3 * (count + SURFACECLOUD_SLACK) * sizeof(float));
+	SurfaceRecord record;
+	SurfaceCloudWriter writer;
+	char path[1280];
+	FILE *fptr;
+	size_t pointCount = 0;
+	size_t n = 0;
+	double naiveSeconds;
+	double seconds;
+	uint64_t startNs;
+	uint32_t iteration;
+	int simdLevel;
+	int result = 0;
+	GoLogSimdLevel cpuLevel = Bench_CpuSimdLevel();
+
+	if (heights == NULL || naive == NULL || reference == NULL || points == NULL)
+	{
+		printf("Out of memory\n");
+		return -1;
+	}
+	SyntheticSurface_Fill(heights, options->width, options->length, 0);
+	memset(&record, 0, sizeof(record));
+	record.surfaceWidth = options->width;
+	record.surfaceLength = options->length;
+	record.xOffset = -64.0;
+	record.xResolution = 0.1;
+	record.yOffset = 1000.0;
+	record.yResolution = 0.1;
+	record.zOffset = 10.0;
+	record.zResolution = 0.002;
+
+	startNs = GoLog_MonotonicNs();
+	for (iteration = 0; iteration < options->iterations; iteration++)
+	{
+		pointCount = Bench_CloudNaive(heights, &record, naive);
+	}
+	naiveSeconds = Bench_Seconds(startNs) / options->iterations;
+	printf("%-8s %10.1f Mpoints/s  (reference, double)\n", "naive", pointCount / naiveSeconds / 1.0e6);
+
+	GoLogSimd_SetMaxLevel(GOLOG_SIMD_SCALAR);
+	if (Bench_CloudRows(heights, &record, reference) != pointCount)
+	{
+		printf("Point count mismatch\n");
+		return -1;
+	}
+
+	for (simdLevel = GOLOG_SIMD_SCALAR; simdLevel <= (int)cpuLevel; simdLevel++)
+	{
+		double maxError = 0.0;
+		size_t i;
+
+		GoLogSimd_SetMaxLevel((GoLogSimdLevel)simdLevel);
+		startNs = GoLog_MonotonicNs();
+		for (iteration = 0; iteration < options->iterations; iteration++)
+		{
+			n = Bench_CloudRows(heights, &record, points);
+		}
+		seconds = Bench_Seconds(startNs) / options->iterations;
+
+		if (n != pointCount || memcmp(points, reference, 3 * pointCount * sizeof(float)) != 0)
+		{
+			printf("Mismatch at SIMD level %s\n", GoLogSimd_Name((GoLogSimdLevel)simdLevel));
+			return -1;
+		}
+		for (i = 0; i < 3 * pointCount; i++)
+		{
+			if (fabs(points[i] - naive[i]) > maxError)
+			{
+				maxError = fabs(points[i] - naive[i]);
+			}
+		}
+		printf("%-8s %10.1f Mpoints/s  %5.2fx  %.3f ms per surface  max error %.2g mm\n",
+			GoLogSimd_Name((GoLogSimdLevel)simdLevel), pointCount / seconds / 1.0e6, naiveSeconds / seconds,
+			seconds * 1000.0, maxError);
+	}
+	GoLogSimd_SetMaxLevel(GOLOG_SIMD_AVX2);
+
+	// Complete export: count, then rows through the writer to a PLY file
+	snprintf(path, sizeof path, "%sSurfaceBenchCloud.ply", options->folder);
+	startNs = GoLog_MonotonicNs();
+	for (iteration = 0; iteration < options->iterations && result == 0; iteration++)
+	{
+		if ((fptr = fopen(path, "wb")) == NULL)
+		{
+			printf("Error opening file %s\n", path);
+			result = -1;
+			break;
+		}
+		if (SurfaceCloudWriter_Begin(&writer, fptr, SURFACECLOUD_PLY, SurfaceCloud_CountValid(heights, count),
+			options->width) != 0 ||
+			SurfaceCloudWriter_Rows(&writer, &record, heights, options->width, options->length, 0, 0) != 0)
+		{
+			result = -1;
+		}
+		if (SurfaceCloudWriter_End(&writer) != 0 || fclose(fptr) != 0)
+		{
+			result = -1;
+		}
+	}
+	seconds = Bench_Seconds(startNs) / options->iterations;
+	remove(path);
+	if (result != 0)
+	{
+		printf("Error writing file %s\n", path);
+		return -1;
+	}
+	printf("%-8s %10.1f Mpoints/s         %.3f ms per surface  %.1f MB/s (count, rows and writing)\n", "PLY file",
+		pointCount / seconds / 1.0e6, seconds * 1000.0, pointCount * 3 * sizeof(float) / seconds / 1.0e6);
+	printf("Valid samples: %.1f %%\n", 100.0 * pointCount / count);
+
+	free(heights);
+	free(naive);
+	free(reference);
+	free(points);
+	return 0;
+}
+
+static int Bench_Pyramid(const BenchOptions *options)
+{
+	size_t count = (size_t)options->width * options->length;
+	int16_t *heights = malloc(count * sizeof(int16_t));
+	SurfacePyramid reference;
+	SurfacePyramid pyramid;
+	double scalarSeconds = 0.0;
+	uint64_t startNs;
+	uint32_t iteration;
+	uint32_t level;
+	int simdLevel;
+	GoLogSimdLevel cpuLevel = Bench_CpuSimdLevel();
+
+	memset(&reference, 0, sizeof(reference));
+	memset(&pyramid, 0, sizeof(pyramid));
+	if (heights == NULL)
+	{
+		printf("Out of memory\n");
+		return -1;
+	}
+	SyntheticSurface_Fill(heights, options->width, options->length, 0);
+
+	GoLogSimd_SetMaxLevel(GOLOG_SIMD_SCALAR);
+	if (SurfacePyramid_Build(&reference, heights, options->width, options->length, 3) != 0)
+	{
+		printf("Out of memory\n");
+		return -1;
+	}
+
+	for (simdLevel = GOLOG_SIMD_SCALAR; simdLevel <= (int)cpuLevel; simdLevel++)
+	{
+		double seconds;
+
+		GoLogSimd_SetMaxLevel((GoLogSimdLevel)simdLevel);
+		startNs = GoLog_MonotonicNs();
+		for (iteration = 0; iteration < options->iterations; iteration++)
+		{
+			SurfacePyramid_Build(&pyramid, heights, options->width, options->length, 3);
+		}
+		seconds = Bench_Seconds(startNs) / options->iterations;
+		if (simdLevel == GOLOG_SIMD_SCALAR)
+		{
+			scalarSeconds = seconds;
+		}
+
+		for (level = 0; level < reference.levelCount; level++)
+		{
+			if (memcmp(pyramid.levels[level].data, reference.levels[level].data,
+				(size_t)reference.levels[level].width * reference.levels[level].length * sizeof(int16_t)) != 0)
+			{
+				printf("Mismatch in level %u\n", level);
+				return -1;
+			}
+		}
+		printf("%-8s %10.1f Msamples/s  %5.2fx  %.3f ms per surface\n", GoLogSimd_Name((GoLogSimdLevel)simdLevel),
+			count / seconds / 1.0e6, scalarSeconds / seconds, seconds * 1000.0);
+	}
+	GoLogSimd_SetMaxLevel(GOLOG_SIMD_AVX2);
+
+	for (level = 0; level < reference.levelCount; level++)
+	{
+		printf("Level %ux: %u x %u (%.1f KB)\n", reference.levels[level].factor, reference.levels[level].width,
+			reference.levels[level].length, reference.levels[level].width * reference.levels[level].length * 2 / 1024.0);
+	}
+
+	SurfacePyramid_Free(&reference);
+	SurfacePyramid_Free(&pyramid);
+	free(heights);
+	return 0;
+}
+
+static int Bench_Stats(const BenchOptions *options)
+{
+	size_t count = (size_t)options->width * options->length;
+	int16_t *heights = malloc(count * sizeof(int16_t));
+	int16_t *copy = malloc(count * sizeof(int16_t));
+	SurfaceStatsSums reference;
+	SurfaceStatsSums sums;
+	double copySeconds;
+	uint64_t startNs;
+	uint32_t iteration;
+	uint32_t row;
+	int simdLevel;
+	GoLogSimdLevel cpuLevel = Bench_CpuSimdLevel();
+
+	if (heights == NULL || copy == NULL)
+	{
+		printf("Out of memory\n");
+		return -1;
+	}
+	SyntheticSurface_Fill(heights, options->width, options->length, 0);
+
+	// Row by row, as in the data callback
+	startNs = GoLog_MonotonicNs();
+	for (iteration = 0; iteration < options->iterations; iteration++)
+	{
+		for (row = 0; row < options->length; row++)
+		{
+			memcpy(copy + (size_t)row * options->width, heights + (size_t)row * options->width, options->width * sizeof(int16_t));
+		}
+	}
+	copySeconds = Bench_Seconds(startNs) / options->iterations;
+	printf("%-8s %10.1f Msamples/s  %5.2fx  %.3f ms per surface\n", "memcpy", count / copySeconds / 1.0e6, 1.0,
+		copySeconds * 1000.0);
+
+	GoLogSimd_SetMaxLevel(GOLOG_SIMD_SCALAR);
+	SurfaceStats_Begin(&reference);
+	for (row = 0; row < options->length; row++)
+	{
+		SurfaceStats_CopyRow(copy + (size_t)row * options->width, heights + (size_t)row * options->width, options->width, &reference);
+	}
+
+	for (simdLevel = GOLOG_SIMD_SCALAR; simdLevel <= (int)cpuLevel; simdLevel++)
+	{
+		double seconds;
+
+		GoLogSimd_SetMaxLevel((GoLogSimdLevel)simdLevel);
+		memset(copy, 0, count * sizeof(int16_t));
+		startNs = GoLog_MonotonicNs();
+		for (iteration = 0; iteration < options->iterations; iteration++)
+		{
+			SurfaceStats_Begin(&sums);
+			for (row = 0; row < options->length; row++)
+			{
+				SurfaceStats_CopyRow(copy + (size_t)row * options->width, heights + (size_t)row * options->width,
+					options->width, &sums);
+			}
+		}
+		seconds = Bench_Seconds(startNs) / options->iterations;
+
+		if (memcmp(&sums, &reference, sizeof(sums)) != 0 || memcmp(copy, heights, count * sizeof(int16_t)) != 0)
+		{
+			printf("Mismatch at SIMD level %s\n", GoLogSimd_Name((GoLogSimdLevel)simdLevel));
+			return -1;
+		}
+		printf("%-8s %10.1f Msamples/s  %5.2fx  %.3f ms per surface\n", GoLogSimd_Name((GoLogSimdLevel)simdLevel),
+			count / seconds / 1.0e6, copySeconds / seconds, seconds * 1000.0);
+	}
+	GoLogSimd_SetMaxLevel(GOLOG_SIMD_AVX2);
+
+	printf("Valid samples: %.1f %%, heights %d to %d, mean %.2f\n", 100.0 * reference.validCount / count,
+		reference.min, reference.max, (double)reference.sum / reference.validCount);
+
+	free(copy);
+	free(heights);
+	return 0;
+}
+
+static int Bench_Crop(const BenchOptions *options)
+{
+	size_t count = (size_t)options->width * options->length;
+	int16_t *heights = malloc(count * sizeof(int16_t));
+	SurfaceCropBox reference;
+	SurfaceCropBox box;
+	double scalarSeconds = 0.0;
+	uint64_t startNs;
+	uint32_t iteration;
+	size_t i;
+	int simdLevel;
+	GoLogSimdLevel cpuLevel = Bench_CpuSimdLevel();
+
+	if (heights == NULL)
+	{
+		printf("Out of memory\n");
+		return -1;
+	}
+
+	// Synthetic surface has invalid borders on the sides only - make the first and last eighth of the rows invalid too
+	SyntheticSurface_Fill(heights, options->width, options->length, 0);
+	for (i = 0; i < (size_t)(options->length / 8) * options->width; i++)
+	{
+		heights[i] = INVALID_RANGE_16BIT;
+		heights[count - 1 - i] = INVALID_RANGE_16BIT;
+	}
+
+	GoLogSimd_SetMaxLevel(GOLOG_SIMD_SCALAR);
+	SurfaceCrop_Bounds(heights, options->width, options->length, &reference);
+
+	for (simdLevel = GOLOG_SIMD_SCALAR; simdLevel <= (int)cpuLevel; simdLevel++)
+	{
+		double seconds;
+
+		GoLogSimd_SetMaxLevel((GoLogSimdLevel)simdLevel);
+		startNs = GoLog_MonotonicNs();
+		for (iteration = 0; iteration < options->iterations; iteration++)
+		{
+			SurfaceCrop_Bounds(heights, options->width, options->length, &box);
+		}
+		seconds = Bench_Seconds(startNs) / options->iterations;
+		if (simdLevel == GOLOG_SIMD_SCALAR)
+		{
+			scalarSeconds = seconds;
+		}
+
+		if (memcmp(&box, &reference, sizeof(box)) != 0)
+		{
+			printf("Mismatch: %u x %u at (%u, %u)\n", box.width, box.length, box.column, box.row);
+			return -1;
+		}
+		printf("%-8s %10.1f Msamples/s  %5.2fx  %.3f ms per surface\n", GoLogSimd_Name((GoLogSimdLevel)simdLevel),
+			count / seconds / 1.0e6, scalarSeconds / seconds, seconds * 1000.0);
+	}
+	GoLogSimd_SetMaxLevel(GOLOG_SIMD_AVX2);
+
+	printf("Valid region: %u x %u at (%u, %u), %.1f %% of the surface data removed\n", reference.width, reference.length,
+		reference.column, reference.row, 100.0 - 100.0 * reference.width * reference.length / count);
+
+	free(heights);
+	return 0;
+}
+
+static int Bench_Tiles(const BenchOptions *options)
+{
+	static const struct
+	{
+		const char *name;
+		uint32_t codec;
+		uint32_t tileSize;
+	}layouts[] =
+	{
+		{ "rows raw", SURFACECODEC_RAW, 0 },
+		{ "rows coded", SURFACECODEC_MEDRICE, 0 },
+		{ "tiles raw", SURFACECODEC_RAW, 256 },
+		{ "tiles coded", SURFACECODEC_MEDRICE, 256 },
+	};
+	size_t count = (size_t)options->width * options->length;
+	uint64_t capacity = SurfaceTiles_MaxSize(options->width, options->length, 256, 256);
+	int16_t *heights = malloc(count * sizeof(int16_t));
+	int16_t *scratch = malloc(256 * 256 * sizeof(int16_t));
+	uint8_t *payload = malloc((size_t)capacity);
+	int16_t *region = NULL;
+	SurfaceRecord record;
+	SurfaceRegion window;
+	size_t layoutIdx;
+	size_t payloadSize;
+	uint32_t row;
+
+	if (heights == NULL || scratch == NULL || payload == NULL)
+	{
+		printf("Out of memory\n");
+		return -1;
+	}
+	SyntheticSurface_Fill(heights, options->width, options->length, 0);
+
+	// 0.1 mm samples, region in the middle of the surface
+	memset(&record, 0, sizeof(record));
+	record.surfaceWidth = options->width;
+	record.surfaceLength = options->length;
+	record.xOffset = -0.05 * options->width;
+	record.xResolution = 0.1;
+	record.yResolution = 0.1;
+	SurfaceFile_Region(&record, -12.5, 12.4, 0.05 * options->length - 12.5, 0.05 * options->length + 12.4, &window);
+	if (window.width == 0 || (region = malloc((size_t)window.width * window.length * sizeof(int16_t))) == NULL)
+	{
+		printf("Region outside surface\n");
+		return -1;
+	}
+	printf("Region %u x %u samples at column %u, row %u (X %.2f mm, Y %.2f mm)\n", window.width, window.length,
+		window.column, window.row, window.xOffset, window.yOffset);
+
+	for (layoutIdx = 0; layoutIdx < sizeof(layouts) / sizeof(layouts[0]); layoutIdx++)
+	{
+		uint64_t bytesRead = 0;
+		uint64_t startNs;
+		uint32_t iteration;
+		double seconds;
+		int result = 0;
+
+		record.codec = layouts[layoutIdx].codec;
+		record.tileWidth = layouts[layoutIdx].tileSize;
+		record.tileLength = layouts[layoutIdx].tileSize;
+		if (record.tileWidth != 0)
+		{
+			result = SurfaceTiles_Encode(heights, options->width, options->length, 256, 256, record.codec, scratch,
+				payload, (size_t)capacity, &payloadSize);
+		}
+		else if (record.codec == SURFACECODEC_MEDRICE)
+		{
+			result = SurfaceCodec_Encode(heights, options->width, options->length, payload, count * sizeof(int16_t), &payloadSize);
+		}
+		else
+		{
+			memcpy(payload, heights, count * sizeof(int16_t));
+			payloadSize = count * sizeof(int16_t);
+		}
+		if (result != 0)
+		{
+			printf("%-12s encoding failed\n", layouts[layoutIdx].name);
+			continue;
+		}
+		record.payload = payload;
+		record.payloadSize = payloadSize;
+
+		startNs = GoLog_MonotonicNs();
+		for (iteration = 0; iteration < options->iterations && result == 0; iteration++)
+		{
+			bytesRead = 0;
+			result = SurfaceFile_DecodeRegion(&record, &window, region, &bytesRead);
+		}
+		seconds = Bench_Seconds(startNs) / options->iterations;
+
+		for (row = 0; row < window.length && result == 0; row++)
+		{
+			if (memcmp(region + (size_t)row * window.width,
+				heights + (size_t)(window.row + row) * options->width + window.column, window.width * sizeof(int16_t)) != 0)
+			{
+				result = -1;
+			}
+		}
+		if (result != 0)
+		{
+			printf("%-12s mismatch\n", layouts[layoutIdx].name);
+			return -1;
+		}
+		printf("%-12s %10.1f MB stored, %10.3f MB read per region (%6.2f %%), %8.3f ms per region\n",
+			layouts[layoutIdx].name, payloadSize / 1048576.0, bytesRead / 1048576.0, 100.0 * bytesRead / payloadSize,
+			seconds * 1000.0);
+	}
+
+	free(region);
+	free(payload);
+	free(scratch);
+	free(heights);
+	return 0;
+}
+
+// Write system calls made by this process so far (Linux only, 0 elsewhere)
+typedef struct
+{
+	const SurfaceTileLayout *layout;
+	const int16_t *heights;
+	int16_t *scratch;					// One tile per worker
+	uint8_t *output;
+	uint32_t *sizes;
+	uint32_t *codecs;
+}BenchTileJob;
+
+static void Bench_EncodeTile(void *context, uint32_t task, uint32_t worker)
+{
+	BenchTileJob *job = context;
+
+	SurfaceTiles_EncodeTile(job->layout, job->heights, task, SURFACECODEC_MEDRICE,
+		job->scratch + (size_t)worker * job->layout->tileWidth * job->layout->tileLength,
+		job->output + SurfaceTiles_SlotOffset(job->layout, task), &job->sizes[task], &job->codecs[task]);
+}
+
+static int Bench_Compress(const BenchOptions *options)
+{
+	static const struct
+	{
+		const char *name;
+		uint32_t tileWidth;				// 0 = surface width
+		uint32_t tileLength;
+	}layouts[] =
+	{
+		{ "bands", 0, 64 },
+		{ "tiles", 256, 256 },
+	};
+	size_t count = (size_t)options->width * options->length;
+	int16_t *heights = malloc(count * sizeof(int16_t));
+	uint8_t *coded = malloc(count * sizeof(int16_t));
+	double serialSeconds;
+	size_t codedSize = 0;
+	uint64_t startNs;
+	uint32_t iteration;
+	size_t layoutIdx;
+
+	if (heights == NULL || coded == NULL)
+	{
+		printf("Out of memory\n");
+		return -1;
+	}
+	SyntheticSurface_Fill(heights, options->width, options->length, 0);
+
+	// Whole surface on one thread, as written without -tiles and -compress-threads
+	startNs = GoLog_MonotonicNs();
+	for (iteration = 0; iteration < options->iterations; iteration++)
+	{
+		SurfaceCodec_Encode(heights, options->width, options->length, coded, count * sizeof(int16_t), &codedSize);
+	}
+	serialSeconds = Bench_Seconds(startNs) / options->iterations;
+	printf("%-6s %3u threads %10.1f MB/s  %5.2fx  %8.3f ms per surface, ratio %.2f\n", "rows", 1,
+		count * sizeof(int16_t) / serialSeconds / 1048576.0, 1.0, serialSeconds * 1000.0,
+		(double)count * sizeof(int16_t) / codedSize);
+
+	for (layoutIdx = 0; layoutIdx < sizeof(layouts) / sizeof(layouts[0]); layoutIdx++)
+	{
+		uint32_t tileWidth = layouts[layoutIdx].tileWidth ? layouts[layoutIdx].tileWidth : options->width;
+		uint64_t capacity = SurfaceTiles_MaxSize(options->width, options->length, tileWidth, layouts[layoutIdx].tileLength);
+		SurfaceTileLayout layout;
+		BenchTileJob job;
+		uint8_t *reference = malloc((size_t)capacity);
+		size_t referenceSize;
+		uint32_t threads;
+
+		SurfaceTiles_Layout(&layout, options->width, options->length, tileWidth, layouts[layoutIdx].tileLength);
+		job.layout = &layout;
+		job.heights = heights;
+		job.scratch = malloc((size_t)options->threads * tileWidth * layout.tileLength * sizeof(int16_t));
+		job.output = malloc((size_t)capacity);
+		job.sizes = malloc(layout.tileCount * sizeof(uint32_t));
+		job.codecs = malloc(layout.tileCount * sizeof(uint32_t));
+		if (reference == NULL || job.scratch == NULL || job.output == NULL || job.sizes == NULL || job.codecs == NULL ||
+			SurfaceTiles_Encode(heights, options->width, options->length, tileWidth, layout.tileLength,
+			SURFACECODEC_MEDRICE, job.scratch, reference, (size_t)capacity, &referenceSize) != 0)
+		{
+			printf("Out of memory\n");
+			return -1;
+		}
+
+		// 1, 2, 4, ... threads, and the largest number
+		for (threads = 1; threads <= options->threads; threads = (threads * 2 <= options->threads ||
+			threads == options->threads) ? threads * 2 : options->threads)
+		{
+			TaskPool pool;
+			uint64_t tasks;
+			uint64_t stolen;
+			uint64_t payloadSize = 0;
+			double seconds;
+
+			if (TaskPool_Start(&pool, threads) != 0)
+			{
+				printf("TaskPool_Start failed\n");
+				return -1;
+			}
+			startNs = GoLog_MonotonicNs();
+			for (iteration = 0; iteration < options->iterations; iteration++)
+			{
+				TaskPool_Run(&pool, layout.tileCount, Bench_EncodeTile, &job);
+				payloadSize = SurfaceTiles_Pack(&layout, job.output, job.sizes, job.codecs);
+			}
+			seconds = Bench_Seconds(startNs) / options->iterations;
+			TaskPool_Counts(&pool, &tasks, &stolen);
+			TaskPool_Stop(&pool);
+
+			if (payloadSize != referenceSize || memcmp(job.output, reference, referenceSize) != 0)
+			{
+				printf("%-6s %3u threads mismatch\n", layouts[layoutIdx].name, threads);
+				return -1;
+			}
+			printf("%-6s %3u threads %10.1f MB/s  %5.2fx  %8.3f ms per surface, ratio %.2f, %u tiles, %.1f %% stolen\n",
+				layouts[layoutIdx].name, pool.workerCount, count * sizeof(int16_t) / seconds / 1048576.0,
+				serialSeconds / seconds, seconds * 1000.0, (double)count * sizeof(int16_t) / referenceSize, layout.tileCount,
+				100.0 * stolen / tasks);
+			if (threads == options->threads)
+			{
+				break;
+			}
+		}
+
+		free(job.codecs);
+		free(job.sizes);
+		free(job.output);
+		free(job.scratch);
+		free(reference);
+	}
+
+	free(coded);
+	free(heights);
+	return 0;
+}
+
+static uint64_t Bench_WriteCalls(void)
+{
+	unsigned long long count = 0;
+#if defined(__linux__)
+	FILE *fptr = fopen("/proc/self/io", "r");
+	char line[128];
+
+	while (fptr != NULL && fgets(line, sizeof line, fptr) != NULL)
+	{
+		if (sscanf(line, "syscw: %llu", &count) == 1)
+		{
+			break;
+		}
+	}
+	if (fptr != NULL)
+	{
+		fclose(fptr);
+	}
+#endif
+	return count;
+}
+
+// Write options->iterations copies of a synthetic surface through a writer with the given sink.
+// Returns seconds from first submit until all surfaces are written, or -1 on error.
+static double Bench_SinkRun(const BenchOptions *options, SurfaceSink *sink, uint32_t codec, const int16_t *heights)
+{
+	SurfaceWriter writer;
+	SurfaceWriterOptions writerOptions;
+	SurfaceRecord *record;
+	size_t dataSize = (size_t)options->width * options->length * sizeof(int16_t);
+	uint64_t startNs;
+	uint32_t surfaceIdx;
+	double seconds;
+
+	memset(&writerOptions, 0, sizeof(writerOptions));
+	writerOptions.queueCapacity = WRITERQUEUESIZE;
+	writerOptions.codec = codec;
+	writerOptions.poolBuffers = WRITERQUEUESIZE + 2 + URINGSINKDEPTH;
+	writerOptions.writerCpu = -1;
+	if (SurfaceWriter_Start(&writer, sink, &writerOptions) != 0)
+	{
+		sink->close(sink);
+		return -1.0;
+	}
+
+	startNs = GoLog_MonotonicNs();
+	for (surfaceIdx = 0; surfaceIdx < options->iterations; surfaceIdx++)
+	{
+		// Wait for the writer instead of dropping surfaces
+		while ((record = SurfaceWriter_NewRecord(&writer, options->width, options->length)) == NULL)
+		{
+			GoLog_SleepMs(1);
+		}
+		memcpy(record->data, heights, dataSize);
+		record->count = surfaceIdx + 1;
+		record->timeStamp = surfaceIdx;
+		record->xResolution = 0.1;
+		record->yResolution = 0.1;
+		record->zResolution = 0.002;
+		GoLog_WallTime(&record->receiveTime);
+		while (SpscQueue_Depth(&writer.queue) == writer.queue.capacity)
+		{
+			GoLog_SleepMs(1);
+		}
+		SurfaceWriter_Submit(&writer, record);
+	}
+	SurfaceWriter_Stop(&writer);		// Waits for all surfaces to be written
+	seconds = Bench_Seconds(startNs);
+	return writer.writeErrors == 0 ? seconds : -1.0;
+}
+
+// Delete the files written by a sink run
+static void Bench_SinkCleanUp(const BenchOptions *options)
+{
+	char **names;
+	char path[2048];
+	int count;
+	int i;
+
+	if ((count = GoLog_ListFiles(options->folder, DATAFILENAMESUFFIX, &names)) <= 0)
+	{
+		return;
+	}
+	for (i = 0; i < count; i++)
+	{
+		snprintf(path, sizeof path, "%s%s", options->folder, names[i]);
+		remove(path);
+	}
+	GoLog_FreeFileList(names, count);
+}
+
+#define BENCH_SINKS		3
+
+static int Bench_Sink(const BenchOptions *options)
+{
+	static const char *sinkNames[BENCH_SINKS] = { "stdio", "direct", "io_uring" };
+	double results[2][BENCH_SINKS];
+	double writeCalls[2][BENCH_SINKS];
+	double surfaceMBytes = (double)options->width * options->length * sizeof(int16_t) / 1048576.0;
+	int16_t *heights = malloc((size_t)options->width * options->length * sizeof(int16_t));
+	uint32_t codec;
+	int sinkIdx;
+
+	if (heights == NULL)
+	{
+		printf("Out of memory\n");
+		return -1;
+	}
+	SyntheticSurface_Fill(heights, options->width, options->length, 0);
+
+	// Keep the per-surface messages of the sinks out of the write call count
+	setvbuf(stdout, NULL, _IOFBF, 65536);
+
+	for (codec = SURFACECODEC_RAW; codec <= SURFACECODEC_MEDRICE; codec++)
+	{
+		for (sinkIdx = 0; sinkIdx < BENCH_SINKS; sinkIdx++)
+		{
+			SurfaceSink *sink = (sinkIdx == 0) ? SurfaceFileSink_Open(options->folder) :
+				(sinkIdx == 1) ? SurfaceFileSink_OpenDirect(options->folder) :
+				SurfaceUringSink_Open(options->folder, URINGSINKDEPTH);
+			uint64_t writeCallsBefore = Bench_WriteCalls();
+
+			results[codec][sinkIdx] = (sink != NULL) ? Bench_SinkRun(options, sink, codec, heights) : -1.0;
+			writeCalls[codec][sinkIdx] = (double)(Bench_WriteCalls() - writeCallsBefore) / options->iterations;
+			Bench_SinkCleanUp(options);
+		}
+	}
+
+	// Summary after the per-surface messages of the sinks
+	printf("\n%-9s %-7s %10s %10s %8s %12s\n", "sink", "codec", "surfaces/s", "MB/s raw", "speedup", "writes/surf.");
+	for (codec = SURFACECODEC_RAW; codec <= SURFACECODEC_MEDRICE; codec++)
+	{
+		for (sinkIdx = 0; sinkIdx < BENCH_SINKS; sinkIdx++)
+		{
+			double seconds = results[codec][sinkIdx];
+
+			if (seconds <= 0.0)
+			{
+				printf("%-9s %-7s %10s\n", sinkNames[sinkIdx], codec == SURFACECODEC_RAW ? "raw" : "medrice",
+					"failed / not available");
+				continue;
+			}
+			printf("%-9s %-7s %10.1f %10.1f %7.2fx %12.1f\n", sinkNames[sinkIdx], codec == SURFACECODEC_RAW ? "raw" : "medrice",
+				options->iterations / seconds, options->iterations * surfaceMBytes / seconds,
+				results[codec][0] > 0.0 ? results[codec][0] / seconds : 0.0, writeCalls[codec][sinkIdx]);
+		}
+	}
+
+	free(heights);
+	return 0;
+}
+
+static int Bench_Checksum(const BenchOptions *options)
+{
+	size_t size = (size_t)options->width * options->length * sizeof(int16_t);
+	int16_t *heights = malloc(size);
+	int16_t *copy = malloc(size);
+	SurfaceRecord record;
+	double copySeconds;
+	double seconds;
+	uint64_t startNs;
+	uint32_t iteration;
+	uint32_t reference = 0;
+	uint32_t crc = 0;
+	int simdLevel;
+	GoLogSimdLevel cpuLevel = Bench_CpuSimdLevel();
+
+	if (heights == NULL || copy == NULL)
+	{
+		printf("Out of memory\n");
+		return -1;
+	}
+	SyntheticSurface_Fill(heights, options->width, options->length, 0);
+
+	startNs = GoLog_MonotonicNs();
+	for (iteration = 0; iteration < options->iterations; iteration++)
+	{
+		memcpy(copy, heights, size);
+	}
+	copySeconds = Bench_Seconds(startNs) / options->iterations;
+	printf("%-8s %10.1f MB/s  %.3f ms per surface\n", "memcpy", size / copySeconds / 1048576.0, copySeconds * 1000.0);
+
+	// Table at the scalar level, SSE4.2 instruction at the others
+	for (simdLevel = GOLOG_SIMD_SCALAR; simdLevel <= (cpuLevel > GOLOG_SIMD_SSE2 ? GOLOG_SIMD_SSE2 : (int)cpuLevel); simdLevel++)
+	{
+		GoLogSimd_SetMaxLevel((GoLogSimdLevel)simdLevel);
+		startNs = GoLog_MonotonicNs();
+		for (iteration = 0; iteration < options->iterations; iteration++)
+		{
+			crc = SurfaceChecksum_Crc32c(0, heights, size);
+		}
+		seconds = Bench_Seconds(startNs) / options->iterations;
+		if (simdLevel == GOLOG_SIMD_SCALAR)
+		{
+			reference = crc;
+		}
+		else if (crc != reference)
+		{
+			printf("Mismatch with the SSE4.2 instruction\n");
+			return -1;
+		}
+		printf("%-8s %10.1f MB/s  %.3f ms per surface\n", GoLogSimd_HasCrc32c() ? "sse4.2" : "table",
+			size / seconds / 1048576.0, seconds * 1000.0);
+	}
+	GoLogSimd_SetMaxLevel(GOLOG_SIMD_AVX2);
+
+	// Chunk checksums as written, and verified
+	memset(&record, 0, sizeof(record));
+	record.payload = heights;
+	record.payloadSize = size;
+	startNs = GoLog_MonotonicNs();
+	for (iteration = 0; iteration < options->iterations; iteration++)
+	{
+		SurfaceChecksum_Compute(&record);
+	}
+	seconds = Bench_Seconds(startNs) / options->iterations;
+	if (SurfaceChecksum_Verify(&record) != 0)
+	{
+		printf("Chunk checksums do not verify\n");
+		return -1;
+	}
+	printf("%-8s %10.1f MB/s  %.3f ms per surface, %u chunks of %u bytes\n", "chunks", size / seconds / 1048576.0,
+		seconds * 1000.0, record.checksumChunkCount, record.checksumChunkSize);
+
+	free(copy);
+	free(heights);
+	return 0;
+}
+
+#define BENCH_TASKPOOLRUNS		1000		// Runs per iteration
+#define BENCH_TASKPOOLMINTHREADS	4
+#define BENCH_TASKPOOLMAXTASKS		4		// Most tasks per thread in a run
+
+// Count the task; yield now and then, so that threads are preempted in the middle of a run
+static void Bench_CountTask(void *context, uint32_t task, uint32_t worker)
+{
+	volatile uint64_t *runs = context;
+
+	(void)worker;
+	if (GoLogAtomic_Add64(&runs[task], 1) % 3 == 0)
+	{
+		GoLog_SleepMs(0);
+	}
+}
+
+static int Bench_TaskPool(const BenchOptions *options)
+{
+	uint32_t threads = (options->threads > BENCH_TASKPOOLMINTHREADS) ? options->threads : BENCH_TASKPOOLMINTHREADS;
+	uint32_t maxTasks = threads * BENCH_TASKPOOLMAXTASKS;
+	uint64_t runCount = (uint64_t)options->iterations * BENCH_TASKPOOLRUNS;
+	volatile uint64_t *runs = calloc(maxTasks, sizeof(uint64_t));	// Times each task ran in the current run
+	uint64_t totalTasks = 0;
+	uint64_t startNs;
+	uint64_t run;
+	uint64_t tasks;
+	uint64_t stolen;
+	double seconds;
+	TaskPool pool;
+	uint32_t task;
+
+	if (runs == NULL || TaskPool_Start(&pool, threads) != 0)
+	{
+		printf("Out of memory\n");
+		free((void *)runs);
+		return -1;
+	}
+
+	// Task counts that do not divide evenly between the threads, so that ranges are stolen in most runs.
+	// A lost task never lets the run return, so a hang here is a failure as well.
+	startNs = GoLog_MonotonicNs();
+	for (run = 0; run < runCount; run++)
+	{
+		uint32_t taskCount = 1 + (uint32_t)(run * 7 % maxTasks);
+
+		TaskPool_Run(&pool, taskCount, Bench_CountTask, (void *)runs);
+		totalTasks += taskCount;
+		for (task = 0; task < maxTasks; task++)
+		{
+			if (runs[task] != (task < taskCount ? 1u : 0u))
+			{
+				printf("Run %llu of %u tasks: task %u ran %llu times\n", (unsigned long long)run, taskCount, task,
+					(unsigned long long)runs[task]);
+				TaskPool_Stop(&pool);
+				free((void *)runs);
+				return -1;
+			}
+			runs[task] = 0;
+		}
+	}
+	seconds = Bench_Seconds(startNs);
+	TaskPool_Counts(&pool, &tasks, &stolen);
+	TaskPool_Stop(&pool);
+	free((void *)runs);
+
+	if (tasks != totalTasks)
+	{
+		printf("%llu tasks run, %llu expected\n", (unsigned long long)tasks, (unsigned long long)totalTasks);
+		return -1;
+	}
+	printf("%llu runs on %u threads, every task ran once: %.0f runs/s, %.1f us per run, %.1f %% of tasks stolen\n",
+		(unsigned long long)runCount, pool.workerCount, runCount / seconds, seconds * 1e6 / runCount,
+		tasks > 0 ? 100.0 * stolen / tasks : 0.0);
+	return 0;
+}
+
+static const struct
+{
+	const char *name;
+	BenchFunc func;
+}benchmarks[] =
+{
+	{ "convert", Bench_Convert },
+	{ "cloud", Bench_Cloud },
+	{ "pyramid", Bench_Pyramid },
+	{ "stats", Bench_Stats },
+	{ "checksum", Bench_Checksum },
+	{ "crop", Bench_Crop },
+	{ "tiles", Bench_Tiles },
+	{ "compress", Bench_Compress },
+	{ "taskpool", Bench_TaskPool },
+	{ "sink", Bench_Sink },
+};
+
+int main(int argc, char **argv)
+{
+	BenchOptions options;
+	size_t benchIdx;
+	int i;
+
+	options.width = 1280;
+	options.length = 1000;
+	options.iterations = 20;
+	options.threads = (uint32_t)GoLog_CpuCount();
+	snprintf(options.folder, sizeof options.folder, "./");
+
+	for (i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-width") == 0 && i + 1 < argc)
+		{
+			options.width = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-length") == 0 && i + 1 < argc)
+		{
+			options.length = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc)
+		{
+			options.iterations = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-folder") == 0 && i + 1 < argc)
+		{
+			size_t length = strlen(argv[++i]);
+			int separator = length > 0 && (argv[i][length - 1] == '/' || argv[i][length - 1] == '\\');
+			snprintf(options.folder, sizeof options.folder, "%s%s", argv[i], separator ? "" : "/");
+		}
+		else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+		{
+			options.threads = (uint32_t)atoi(argv[++i]);
+		}
+	}
+
+	if (argc >= 2 && options.width > 0 && options.length > 0 && options.iterations > 0 && options.threads > 0)
+	{
+		for (benchIdx = 0; benchIdx < sizeof(benchmarks) / sizeof(benchmarks[0]); benchIdx++)
+		{
+			if (strcmp(argv[1], benchmarks[benchIdx].name) == 0)
+			{
+				printf("%s: %u x %u surface, %u iterations, CPU SIMD level %s\n\n", argv[1],
+					options.width, options.length, options.iterations, GoLogSimd_Name(Bench_CpuSimdLevel()));
+				return benchmarks[benchIdx].func(&options) == 0 ? 0 : 1;
+			}
+		}
+	}
+
+	printf("Usage: %s <benchmark> [-width W] [-length L] [-iterations N] [-folder F] [-threads T]\n", argv[0]);
+	printf("Benchmarks:");
+	for (benchIdx = 0; benchIdx < sizeof(benchmarks) / sizeof(benchmarks[0]); benchIdx++)
+	{
+		printf(" %s", benchmarks[benchIdx].name);
+	}
+	printf("\n");
+	return 1;
+}
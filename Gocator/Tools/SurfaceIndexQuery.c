@@ -0,0 +1,200 @@
+/*
+* SurfaceIndexQuery.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Find logged surfaces by time in a time stamp index (SurfaceIndex.h),
+* e.g. to align Gocator surfaces with frames from other cameras. The index is
+* binary searched; the surface files are not opened.
+*
+* Usage: SurfaceIndexQuery [-host | -wall | -capture] <index file> [<time> [<end time>]]
+*
+* With one time, the surface closest to it is printed; with two, all surfaces
+* from time to end time (inclusive). Without times, the first and last surface
+* and the number of surfaces are printed.
+*
+* Sensor time stamps start over when the sensor restarts, so a sensor time can
+* match surfaces in each segment between restarts: the closest surface of all
+* segments is printed, and the surfaces within the range in every segment.
+*
+* Times are sensor time stamps in us by default, host monotonic receive times
+* in ns with -host, or host wall clock receive times (UTC) with -wall, given as
+* 2018-05-04T10:15:30.250 or as ms since 1970-01-01. With -capture, the wall
+* clock time of the sensor time stamp from the clock model (ClockModel.h) is
+* searched instead, given as 2018-05-04T10:15:30.250123456 or as ns since
+* 1970-01-01; this is the time to use for aligning with other cameras.
+*
+* The summary statistics of each surface (SurfaceStats.h) are printed as
+* well: the valid fraction and the minimum, maximum, mean and standard
+* deviation of the valid heights.
+*/
+
+#include "../GoLogPlatform.h"
+#include "../SurfaceIndex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Parse time argument. Returns 0 on success.
+static int ParseTime(const char *text, SurfaceIndexKey key, uint64_t *time)
+{
+	GoLogWallTime wallTime;
+	char fraction[16] = "";
+	uint64_t fractionNs = 0;
+	char *end;
+	int digits;
+	int i;
+
+	memset(&wallTime, 0, sizeof(wallTime));
+	if ((key == SURFACEINDEX_KEY_WALL || key == SURFACEINDEX_KEY_CAPTURE) &&
+		sscanf(text, "%d-%d-%dT%d:%d:%d.%9[0-9]", &wallTime.year, &wallTime.month, &wallTime.day,
+			&wallTime.hour, &wallTime.minute, &wallTime.second, fraction) >= 6)
+	{
+		digits = (int)strlen(fraction);
+		// Decimals of the second, up to ns
+		for (i = 0; i < 9; i++)
+		{
+			fractionNs = fractionNs * 10 + (i < digits ? (uint64_t)(fraction[i] - '0') : 0);
+		}
+		*time = SurfaceIndex_WallTimeMs(&wallTime);
+		*time = (key == SURFACEINDEX_KEY_CAPTURE) ? *time * 1000000u + fractionNs : *time + fractionNs / 1000000u;
+		return 0;
+	}
+	*time = strtoull(text, &end, 10);
+	return (end == text || *end != 0) ? -1 : 0;
+}
+
+static void PrintEntry(const SurfaceIndexEntry *entry)
+{
+	GoLogWallTime wallTime;
+	GoLogWallTime captureTime;
+
+	SurfaceIndex_WallTime(entry->wallTimeMs, &wallTime);
+	SurfaceIndex_WallTime(entry->captureWallNs / 1000000u, &captureTime);
+	printf("%8u %16llu %20llu %04d-%02d-%02dT%02d:%02d:%02d.%03d %04d-%02d-%02dT%02d:%02d:%02d.%09u %6u x %-6u %6.1f %9.3f %9.3f %9.3f %8.3f %s @ %llu\n",
+		entry->count, (unsigned long long)entry->timeStamp, (unsigned long long)entry->hostNs,
+		wallTime.year, wallTime.month, wallTime.day, wallTime.hour, wallTime.minute, wallTime.second, wallTime.millisecond,
+		captureTime.year, captureTime.month, captureTime.day, captureTime.hour, captureTime.minute, captureTime.second,
+		(unsigned int)(entry->captureWallNs % 1000000000u),
+		entry->surfaceWidth, entry->surfaceLength, 100.0 * entry->validFraction, entry->zMin, entry->zMax, entry->zMean,
+		entry->zStdDev, entry->fileName, (unsigned long long)entry->fileOffset);
+}
+
+static void PrintHeading(void)
+{
+	printf("%8s %16s %20s %-23s %-29s %15s %6s %9s %9s %9s %8s %s\n", "surface", "time stamp [us]", "host time [ns]",
+		"wall time (UTC)", "capture time (UTC)", "size", "valid%", "zMin [mm]", "zMax [mm]", "zMean[mm]", "zStd[mm]", "file @ offset");
+}
+
+int main(int argc, char **argv)
+{
+	SurfaceIndexKey key = SURFACEINDEX_KEY_SENSOR;
+	SurfaceIndex index;
+	const char *path = NULL;
+	uint64_t times[2];
+	int timeCount = 0;
+	uint64_t first;
+	uint64_t count;
+	uint64_t i;
+	int argi;
+
+	for (argi = 1; argi < argc; argi++)
+	{
+		if (strcmp(argv[argi], "-host") == 0)
+		{
+			key = SURFACEINDEX_KEY_HOST;
+		}
+		else if (strcmp(argv[argi], "-wall") == 0)
+		{
+			key = SURFACEINDEX_KEY_WALL;
+		}
+		else if (strcmp(argv[argi], "-capture") == 0)
+		{
+			key = SURFACEINDEX_KEY_CAPTURE;
+		}
+		else if (path == NULL)
+		{
+			path = argv[argi];
+		}
+		else if (timeCount < 2 && ParseTime(argv[argi], key, &times[timeCount]) == 0)
+		{
+			timeCount++;
+		}
+		else
+		{
+			path = NULL;
+			break;
+		}
+	}
+	if (path == NULL)
+	{
+		printf("Usage: %s [-host | -wall | -capture] <index file> [<time> [<end time>]]\n", argv[0]);
+		printf("  Times are sensor time stamps [us], host monotonic receive times [ns] (-host),\n");
+		printf("  wall clock receive times (UTC) as 2018-05-04T10:15:30.250 or ms since 1970 (-wall),\n");
+		printf("  or capture times (UTC) as 2018-05-04T10:15:30.250123456 or ns since 1970 (-capture)\n");
+		return 1;
+	}
+
+	if (SurfaceIndex_Open(&index, path) != 0)
+	{
+		printf("Error opening index %s\n", path);
+		return 1;
+	}
+
+	if (timeCount == 0)
+	{
+		printf("%s: %llu surfaces\n", path, (unsigned long long)index.entryCount);
+		if (SurfaceIndex_SegmentCount(&index) > 1)
+		{
+			printf("Sensor restarted %u times: sensor time stamps start over in %u segments\n",
+				SurfaceIndex_SegmentCount(&index) - 1, SurfaceIndex_SegmentCount(&index));
+		}
+		if (index.entryCount > 0)
+		{
+			PrintHeading();
+			PrintEntry(SurfaceIndex_Entry(&index, 0));
+			PrintEntry(SurfaceIndex_Entry(&index, index.entryCount - 1));
+		}
+	}
+	else if (timeCount == 1)
+	{
+		int64_t nearest = SurfaceIndex_Nearest(&index, key, times[0]);
+
+		if (nearest >= 0)
+		{
+			PrintHeading();
+			PrintEntry(SurfaceIndex_Entry(&index, (uint64_t)nearest));
+		}
+	}
+	else if (key == SURFACEINDEX_KEY_SENSOR)
+	{
+		uint64_t total = 0;
+		uint32_t segment;
+
+		// The range in every segment between sensor restarts
+		PrintHeading();
+		for (segment = 0; segment < SurfaceIndex_SegmentCount(&index); segment++)
+		{
+			count = SurfaceIndex_SegmentRange(&index, segment, times[0], times[1], &first);
+			for (i = first; i < first + count; i++)
+			{
+				PrintEntry(SurfaceIndex_Entry(&index, i));
+			}
+			total += count;
+		}
+		printf("%llu surfaces\n", (unsigned long long)total);
+	}
+	else
+	{
+		count = SurfaceIndex_Range(&index, key, times[0], times[1], &first);
+		PrintHeading();
+		for (i = first; i < first + count; i++)
+		{
+			PrintEntry(SurfaceIndex_Entry(&index, i));
+		}
+		printf("%llu surfaces\n", (unsigned long long)count);
+	}
+
+	SurfaceIndex_Close(&index);
+	return 0;
+}
@@ -0,0 +1,816 @@
+/*
+* SurfaceReplay.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Replay a logged session through the capture pipeline, to benchmark
+* codecs and sinks on real data and to find the rate at which the pipeline
+* saturates, without a sensor.
+*
+* Usage: SurfaceReplay <input folder> <output folder> [-speed X | -fast | -sweep] [-repeat N]
+*        [-count N] [-memory MB] [-measurements <file>] [-container] [-pyramid] [-crop] [-tiles <size>]
+*        [-compress] [-compress-threads <n>] [-checksum] [-uring] [-direct] [-pool <buffers>] [-hugepages]
+*
+* All surfaces in the input folder (separate surface files of any version and
+* session containers, see SurfaceReader.h) are first decoded into memory, up
+* to -count surfaces or -memory MB, so that reading them does not load the
+* pipeline being measured. Cropped surfaces are expanded to the full sensor
+* surface again. Each surface is then handed to the pipeline the way the
+* logger's data callback does it: frame monitor, clock model, a buffer from
+* the pool, copy with summary statistics, submit to the writer thread
+* (SurfaceCapture.h, the same code as the logger), and the measurements that
+* followed it. The writer, sinks and options are those of the logger, and the
+* output (surfaces, index, measurement log, stats file) is written to the
+* output folder. Surfaces keep their recorded frame index (stored in session
+* containers; for surface files the surface number in the file name is used),
+* so that surfaces lost or dropped while logging show up as lost in the
+* replay too.
+*
+* Surfaces are replayed at their recorded sensor time stamps (-speed 1,
+* default), at a fixed multiple of real time (-speed X), or as fast as the
+* pipeline takes them (-fast; the replay then waits for free buffers instead
+* of dropping surfaces, and the rate achieved is the throughput of the
+* pipeline). With -sweep the session is replayed at -speed, 2x, 4x, ... each
+* into its own subfolder, until surfaces are dropped or written at less than
+* 90% of the replay rate, to find where the pipeline saturates. -repeat replays the loaded surfaces N times in a row,
+* with continuing time stamps.
+*
+* Measurements are read from a measurement text file (Surface number;
+* Measurement ID; Measurement value, as written by earlier loggers and by
+* Tools/MeasurementToCsv) or a binary measurement log (MeasurementLog.h), and
+* added after the surface with their surface number; the loaded surfaces are
+* numbered from 1 in recorded order.
+*/
+
+#include "../GoLogPlatform.h"
+#include "../SurfaceFormat.h"
+#include "../SurfaceReader.h"
+#include "../SurfaceWriter.h"
+#include "../SurfaceCapture.h"
+#include "../SurfaceContainer.h"
+#include "../SurfaceUringSink.h"
+#include "../SurfaceCodec.h"
+#include "../MeasurementLog.h"
+#include "../PipelineStats.h"
+#include "../FrameMonitor.h"
+#include "../ClockModel.h"
+#include "../SurfaceIndex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_MEMORY_MB		2048	// Default limit of the decoded surfaces held in memory
+#define REPLAY_MAX_SPEED		1024.0	// Fastest speed tried by -sweep
+#define REPLAY_KEEPUP			0.9		// Fraction of the replay rate the pipeline must write to keep up
+#define REPLAY_STATSINTERVAL	10		// Seconds between reports in the stats file
+
+typedef struct
+{
+	SurfaceRecord header;				// Recorded header fields (data and payload not used)
+	int16_t *data;						// Full surface, decoded
+	uint64_t offsetUs;					// Sensor time from the first surface
+	uint64_t frameIndex;				// Recorded frame index (surface number if not recorded)
+}ReplaySurface;
+
+typedef struct
+{
+	uint32_t count;						// Number of the surface the measurement follows
+	uint32_t id;
+	double value;
+	uint8_t decision;
+	uint64_t timeStamp;
+}ReplayMeasurement;
+
+// Recorded session, in memory
+typedef struct
+{
+	ReplaySurface *surfaces;
+	uint32_t surfaceCount;
+	uint64_t passUs;					// Sensor time of one pass, including the interval before the next pass
+	uint64_t passFrames;				// Frame indices of one pass, including the step to the next pass
+	uint64_t bytes;						// Samples of all surfaces, in bytes
+	ReplayMeasurement *measurements;	// In surface number order
+	size_t measurementCount;
+}ReplaySession;
+
+typedef struct
+{
+	const char *inputFolder;
+	char outputFolder[1024];			// With trailing path separator
+	const char *measurementPath;
+	double speed;
+	int fast;
+	int sweep;
+	uint32_t repeat;
+	uint32_t maxCount;
+	uint64_t maxBytes;
+	SurfaceWriterOptions writer;		// Pipeline options, as set by the logger
+	int container;
+	int direct;
+	int uring;
+}ReplayOptions;
+
+// Pipeline of one replay - as the DataContext of the logger
+typedef struct
+{
+	SurfaceWriter writer;
+	PipelineStats pipelineStats;
+	FrameMonitor frameMonitor;
+	ClockModel clockModel;
+	MeasurementLog measLog;
+	SurfaceIndexWriter index;
+	FILE *statsFile;
+	SurfaceCapture capture;
+	uint64_t timeStamp;
+}ReplayContext;
+
+typedef struct
+{
+	double seconds;						// From the first surface until all surfaces were written
+	uint64_t replayed;					// Surfaces handed to the pipeline
+	SurfaceWriterStats writer;
+}ReplayResult;
+
+// Expand a cropped surface to the full sensor surface, with invalid samples outside the crop box
+static int Replay_Uncrop(const SurfaceRecord *record, const int16_t *cropped, int16_t *full)
+{
+	size_t count = (size_t)record->fullWidth * record->fullLength;
+	uint32_t row;
+	size_t i;
+
+	for (i = 0; i < count; i++)
+	{
+		full[i] = INVALID_RANGE_16BIT;
+	}
+	if ((uint64_t)record->cropColumn + record->surfaceWidth > record->fullWidth ||
+		(uint64_t)record->cropRow + record->surfaceLength > record->fullLength)
+	{
+		return -1;
+	}
+	for (row = 0; row < record->surfaceLength; row++)
+	{
+		memcpy(full + (size_t)(record->cropRow + row) * record->fullWidth + record->cropColumn,
+			cropped + (size_t)row * record->surfaceWidth, record->surfaceWidth * sizeof(int16_t));
+	}
+	return 0;
+}
+
+// Frame index of a surface for the frame monitor: the recorded one in session containers, otherwise the surface
+// number in the file name (xxx_<surface number>_GocatorSurface.bin), which also counts the surfaces dropped by the logger
+static uint64_t Replay_FrameIndex(const SurfaceRecord *record, const char *path)
+{
+	size_t pathLength = strlen(path);
+	size_t suffixLength = strlen(DATAFILENAMESUFFIX);
+	size_t digits = 0;
+
+	if (pathLength < suffixLength + 1 || strcmp(path + pathLength - suffixLength, DATAFILENAMESUFFIX) != 0)
+	{
+		return record->frameIndex;
+	}
+	pathLength -= suffixLength + 1;						// Before _GocatorSurface.bin
+	while (digits < pathLength && path[pathLength - digits - 1] >= '0' && path[pathLength - digits - 1] <= '9')
+	{
+		digits++;
+	}
+	return (digits > 0) ? strtoull(path + pathLength - digits, NULL, 10) : record->frameIndex;
+}
+
+// Decode surfaces of the input folder into memory, and schedule them by time stamp. Returns 0 on success.
+static int Replay_LoadSurfaces(ReplaySession *session, const ReplayOptions *options)
+{
+	SurfaceBatch batch;
+	SurfaceRecord record;
+	const char *path;
+	uint32_t capacity = 0;
+	uint64_t intervalUs = 0;
+	uint64_t frameSpan;
+	uint32_t i;
+
+	if (SurfaceBatch_Open(&batch, options->inputFolder) != 0)
+	{
+		printf("Error opening folder %s\n", options->inputFolder);
+		return -1;
+	}
+	while (session->surfaceCount < options->maxCount && SurfaceBatch_Next(&batch, &record, &path))
+	{
+		ReplaySurface *surface;
+		uint32_t width = record.fullWidth ? record.fullWidth : record.surfaceWidth;
+		uint32_t length = record.fullWidth ? record.fullLength : record.surfaceLength;
+		size_t size = (size_t)width * length * sizeof(int16_t);
+		int16_t *decoded;
+		int result;
+
+		if (session->bytes + size > options->maxBytes)
+		{
+			printf("Memory limit reached - %u surfaces loaded\n", session->surfaceCount);
+			break;
+		}
+		if (session->surfaceCount == capacity)
+		{
+			ReplaySurface *surfaces = realloc(session->surfaces, (capacity * 2 + 64) * sizeof(ReplaySurface));
+
+			if (surfaces == NULL)
+			{
+				break;
+			}
+			session->surfaces = surfaces;
+			capacity = capacity * 2 + 64;
+		}
+		surface = &session->surfaces[session->surfaceCount];
+		if ((surface->data = malloc(size + sizeof(int16_t))) == NULL)
+		{
+			printf("Out of memory - %u surfaces loaded\n", session->surfaceCount);
+			break;
+		}
+
+		// Cropped surfaces are decoded into a temporary buffer, then placed in the full surface
+		decoded = record.fullWidth ? malloc((size_t)record.surfaceWidth * record.surfaceLength * sizeof(int16_t) + sizeof(int16_t)) : surface->data;
+		result = (decoded == NULL) ? -1 : SurfaceFile_Decode(&record, decoded);
+		if (result == 0 && record.fullWidth)
+		{
+			result = Replay_Uncrop(&record, decoded, surface->data);
+		}
+		if (decoded != surface->data)
+		{
+			free(decoded);
+		}
+		if (result != 0)
+		{
+			printf("Skipping surface in %s that could not be decoded\n", path);
+			free(surface->data);
+			continue;
+		}
+
+		surface->frameIndex = Replay_FrameIndex(&record, path);
+		surface->header = record;
+		surface->header.surfaceWidth = width;
+		surface->header.surfaceLength = length;
+		surface->header.cropColumn = 0;
+		surface->header.cropRow = 0;
+		surface->header.fullWidth = 0;
+		surface->header.fullLength = 0;
+		surface->header.tileWidth = 0;
+		surface->header.tileLength = 0;
+		surface->header.codec = SURFACECODEC_RAW;
+		surface->header.payload = NULL;
+		surface->header.pyramid = NULL;
+		session->bytes += size;
+		session->surfaceCount++;
+	}
+	SurfaceBatch_Close(&batch);
+
+	if (session->surfaceCount == 0)
+	{
+		printf("No surfaces found in %s\n", options->inputFolder);
+		return -1;
+	}
+
+	// Recorded intervals; the frame rate is used where the time stamps do not increase
+	for (i = 0; i < session->surfaceCount; i++)
+	{
+		ReplaySurface *surface = &session->surfaces[i];
+		uint64_t frameUs = surface->header.frameRate > 0.0 ? (uint64_t)(1.0e6 / surface->header.frameRate) : 0;
+
+		if (i == 0)
+		{
+			surface->offsetUs = 0;
+			continue;
+		}
+		intervalUs = (surface->header.timeStamp > surface[-1].header.timeStamp) ?
+			surface->header.timeStamp - surface[-1].header.timeStamp : frameUs;
+		surface->offsetUs = surface[-1].offsetUs + intervalUs;
+	}
+	session->passUs = session->surfaces[session->surfaceCount - 1].offsetUs +
+		(session->surfaceCount > 1 ? session->surfaces[session->surfaceCount - 1].offsetUs / (session->surfaceCount - 1) : intervalUs);
+
+	// Repeated passes continue the frame indices, with the mean step between passes
+	frameSpan = (session->surfaces[session->surfaceCount - 1].frameIndex > session->surfaces[0].frameIndex) ?
+		session->surfaces[session->surfaceCount - 1].frameIndex - session->surfaces[0].frameIndex : 0;
+	session->passFrames = (frameSpan > 0) ? frameSpan + frameSpan / (session->surfaceCount - 1) : session->surfaceCount;
+	return 0;
+}
+
+// Parse a measurement text file or binary measurement log. Returns 0 on success.
+static int Replay_LoadMeasurements(ReplaySession *session, const char *path)
+{
+	GoLogMappedFile map;
+	size_t capacity = 0;
+
+	if (GoLog_MapFile(&map, path) != 0)
+	{
+		printf("Error opening file %s\n", path);
+		return -1;
+	}
+
+	if (map.size >= MEASLOGHEADERSIZE && memcmp(map.data, MEASLOGHEADERTEXT, HEADERTEXTSIZE) == 0)
+	{
+		MeasurementBlock block;
+		uint64_t offset = MEASLOGHEADERSIZE;
+		uint64_t blockSize;
+		uint32_t i;
+
+		while ((blockSize = MeasurementLog_ParseBlock(map.data + offset, map.size - offset, &block)) > 0)
+		{
+			ReplayMeasurement *measurements = realloc(session->measurements,
+				(session->measurementCount + block.entryCount) * sizeof(ReplayMeasurement));
+
+			if (measurements == NULL)
+			{
+				break;
+			}
+			session->measurements = measurements;
+			for (i = 0; i < block.entryCount; i++)
+			{
+				ReplayMeasurement *measurement = &session->measurements[session->measurementCount++];
+
+				measurement->count = block.counts[i];
+				measurement->id = block.ids[i];
+				measurement->value = block.values[i];
+				measurement->decision = block.decisions[i];
+				measurement->timeStamp = block.timeStamps[i];
+			}
+			offset += blockSize;
+		}
+	}
+	else
+	{
+		// Text file: "count; id; value" lines (with decision and time stamp with -extended), after a heading
+		const char *text = (const char *)map.data;
+		const char *end = text + map.size;
+
+		while (text < end)
+		{
+			const char *lineEnd = memchr(text, '\n', (size_t)(end - text));
+			char line[256];
+			unsigned int count;
+			unsigned int id;
+			unsigned int decision = 0;
+			unsigned long long timeStamp = 0;
+			double value;
+			size_t length;
+
+			lineEnd = (lineEnd != NULL) ? lineEnd : end;
+			length = (size_t)(lineEnd - text) < sizeof(line) - 1 ? (size_t)(lineEnd - text) : sizeof(line) - 1;
+			memcpy(line, text, length);
+			line[length] = 0;
+			text = lineEnd + 1;
+
+			if (sscanf(line, "%u ;%u ;%lf ;%u ;%llu", &count, &id, &value, &decision, &timeStamp) < 3)
+			{
+				continue;
+			}
+			if (session->measurementCount == capacity)
+			{
+				ReplayMeasurement *measurements = realloc(session->measurements, (capacity * 2 + 1024) * sizeof(ReplayMeasurement));
+
+				if (measurements == NULL)
+				{
+					break;
+				}
+				session->measurements = measurements;
+				capacity = capacity * 2 + 1024;
+			}
+			session->measurements[session->measurementCount].count = count;
+			session->measurements[session->measurementCount].id = id;
+			session->measurements[session->measurementCount].value = value;
+			session->measurements[session->measurementCount].decision = (uint8_t)decision;
+			session->measurements[session->measurementCount].timeStamp = timeStamp;
+			session->measurementCount++;
+		}
+	}
+	GoLog_UnmapFile(&map);
+	return 0;
+}
+
+// Open the surface output, measurement log, stats file and index in folder, and start the writer. Returns 0 on success.
+static int Replay_OpenPipeline(ReplayContext *context, const ReplayOptions *options, const char *folder)
+{
+	SurfaceWriterOptions writerOptions = options->writer;
+	SurfaceContainerOptions containerOptions;
+	SurfaceSink *sink;
+	GoLogWallTime now;
+	char fileName[1280];
+
+	GoLog_WallTime(&now);
+	FrameMonitor_Init(&context->frameMonitor, 0.0);
+	ClockModel_Init(&context->clockModel);
+	SurfaceCapture_Init(&context->capture, &context->writer, &context->frameMonitor, &context->clockModel,
+		&context->pipelineStats);
+
+	snprintf(fileName, sizeof fileName, "%s%04d-%02d-%02d_%02d%02d%02d_%s", folder, now.year, now.month, now.day,
+		now.hour, now.minute, now.second, MEASLOGFILENAMESUFFIX);
+	if (MeasurementLog_Open(&context->measLog, fileName) != 0)
+	{
+		return -1;
+	}
+	snprintf(fileName, sizeof fileName, "%s%04d-%02d-%02d_%02d%02d%02d_%s", folder, now.year, now.month, now.day,
+		now.hour, now.minute, now.second, "GocatorStats.txt");
+	if ((context->statsFile = fopen(fileName, "w")) == NULL)
+	{
+		printf("Error opening file %s\n", fileName);
+		MeasurementLog_Close(&context->measLog);
+		return -1;
+	}
+	snprintf(fileName, sizeof fileName, "%s%04d-%02d-%02d_%02d%02d%02d_%s", folder, now.year, now.month, now.day,
+		now.hour, now.minute, now.second, INDEXFILENAMESUFFIX);
+	if (SurfaceIndexWriter_Open(&context->index, fileName) != 0)
+	{
+		fclose(context->statsFile);
+		MeasurementLog_Close(&context->measLog);
+		return -1;
+	}
+
+	memset(&containerOptions, 0, sizeof(containerOptions));
+	if (options->container)
+	{
+		sink = SurfaceContainer_Open(folder, &containerOptions);
+	}
+	else if (options->direct)
+	{
+		sink = SurfaceFileSink_OpenDirect(folder);
+	}
+	else if (options->uring && (sink = SurfaceUringSink_Open(folder, URINGSINKDEPTH)) != NULL)
+	{
+		if (writerOptions.poolBuffers == 0)
+		{
+			writerOptions.poolBuffers = WRITERQUEUESIZE + 2 + URINGSINKDEPTH;
+		}
+	}
+	else
+	{
+		sink = SurfaceFileSink_Open(folder);
+	}
+	if (sink == NULL)
+	{
+		printf("Error opening surface output\n");
+		SurfaceIndexWriter_Close(&context->index);
+		fclose(context->statsFile);
+		MeasurementLog_Close(&context->measLog);
+		return -1;
+	}
+
+	writerOptions.pipelineStats = &context->pipelineStats;
+	writerOptions.statsFile = context->statsFile;
+	writerOptions.frameMonitor = &context->frameMonitor;
+	writerOptions.clockModel = &context->clockModel;
+	writerOptions.index = &context->index;
+	writerOptions.measurementLog = &context->measLog;
+	if (SurfaceWriter_Start(&context->writer, sink, &writerOptions) != 0)
+	{
+		printf("Error: SurfaceWriter_Start\n");
+		sink->close(sink);
+		SurfaceIndexWriter_Close(&context->index);
+		fclose(context->statsFile);
+		MeasurementLog_Close(&context->measLog);
+		return -1;
+	}
+	return 0;
+}
+
+static void Replay_ClosePipeline(ReplayContext *context)
+{
+	SurfaceWriterStats writerStats;
+
+	SurfaceWriter_Stop(&context->writer);
+	MeasurementLog_Close(&context->measLog);
+	if (SurfaceIndexWriter_Close(&context->index) != 0)
+	{
+		printf("WARNING: Error while writing time stamp index\n");
+	}
+	SurfaceWriter_GetStats(&context->writer, &writerStats);
+	fprintf(context->statsFile, "\nSession summary:\n");
+	FrameMonitor_Print(context->statsFile, &context->frameMonitor, writerStats.written);
+	ClockModel_Print(context->statsFile, &context->clockModel);
+	PipelineStats_Print(context->statsFile, &context->pipelineStats);
+	fclose(context->statsFile);
+}
+
+// Row of a replayed surface, for SurfaceCapture_Surface
+static const int16_t *Replay_Row(const void *source, uint32_t row)
+{
+	const ReplaySurface *surface = source;
+
+	return surface->data + (size_t)row * surface->header.surfaceWidth;
+}
+
+// Hand one surface to the pipeline, as the data callback of the logger does. Returns 0 if it was dropped.
+static int Replay_Surface(ReplayContext *context, const ReplaySurface *surface, uint64_t timeStamp, uint64_t frameIndex,
+	int wait)
+{
+	uint64_t callbackNs = GoLog_MonotonicNs();
+	SurfaceCaptureFrame frame;
+
+	context->timeStamp = timeStamp;
+	frame.timeStamp = timeStamp;
+	frame.frameIndex = frameIndex;
+	frame.surfaceWidth = surface->header.surfaceWidth;
+	frame.surfaceLength = surface->header.surfaceLength;
+	frame.xResolution = surface->header.xResolution;
+	frame.yResolution = surface->header.yResolution;
+	frame.zResolution = surface->header.zResolution;
+	frame.xOffset = surface->header.xOffset;
+	frame.yOffset = surface->header.yOffset;
+	frame.zOffset = surface->header.zOffset;
+	frame.frameRate = surface->header.frameRate;
+	frame.exposureTime = surface->header.exposureTime;
+	frame.rowAt = Replay_Row;
+	frame.source = surface;
+
+	// With wait (-fast), wait for the writer instead of dropping the surface
+	return SurfaceCapture_Surface(&context->capture, &frame, callbackNs, wait);
+}
+
+// Sleep until the monotonic clock reaches targetNs (the last ms is waited for by polling the clock)
+static void Replay_WaitUntil(uint64_t targetNs)
+{
+	uint64_t nowNs;
+
+	while ((nowNs = GoLog_MonotonicNs()) < targetNs)
+	{
+		if (targetNs - nowNs > 2000000)
+		{
+			GoLog_SleepMs((uint32_t)((targetNs - nowNs) / 1000000) - 1);
+		}
+	}
+}
+
+// Replay the session once at speed (0 = as fast as possible) into folder. Returns 0 on success.
+static int Replay_Run(const ReplaySession *session, const ReplayOptions *options, double speed, const char *folder,
+	ReplayResult *result)
+{
+	ReplayContext *context = calloc(1, sizeof(ReplayContext));
+	uint64_t measurementIdx;
+	uint64_t startNs;
+	uint32_t pass;
+	uint32_t i;
+
+	if (context == NULL || GoLog_MakeFolder(folder) != 0 || Replay_OpenPipeline(context, options, folder) != 0)
+	{
+		printf("Error opening output in %s\n", folder);
+		free(context);
+		return -1;
+	}
+
+	memset(result, 0, sizeof(*result));
+	startNs = GoLog_MonotonicNs();
+	for (pass = 0; pass < options->repeat; pass++)
+	{
+		measurementIdx = 0;
+		for (i = 0; i < session->surfaceCount; i++)
+		{
+			const ReplaySurface *surface = &session->surfaces[i];
+			uint64_t offsetUs = (uint64_t)pass * session->passUs + surface->offsetUs;
+			uint64_t callbackNs;
+
+			if (speed > 0.0)
+			{
+				Replay_WaitUntil(startNs + (uint64_t)(offsetUs * 1000.0 / speed));
+			}
+			callbackNs = GoLog_MonotonicNs();
+			Replay_Surface(context, surface, session->surfaces[0].header.timeStamp + offsetUs,
+				(uint64_t)pass * session->passFrames + surface->frameIndex, speed <= 0.0);
+			result->replayed++;
+
+			// Measurements that followed this surface (and those before the first surface)
+			while (measurementIdx < session->measurementCount && session->measurements[measurementIdx].count <= i + 1)
+			{
+				const ReplayMeasurement *measurement = &session->measurements[measurementIdx++];
+
+				MeasurementLog_Add(&context->measLog, context->capture.count, measurement->id, measurement->value,
+					measurement->decision, context->timeStamp);
+			}
+			PipelineStats_Record(&context->pipelineStats, PIPELINE_STAGE_CALLBACK, callbackNs, GoLog_MonotonicNs());
+		}
+	}
+
+	Replay_ClosePipeline(context);
+	result->seconds = (GoLog_MonotonicNs() - startNs) / 1.0e9;
+	SurfaceWriter_GetStats(&context->writer, &result->writer);
+	if (options->sweep == 0)
+	{
+		printf("\n");
+		PipelineStats_Print(stdout, &context->pipelineStats);
+	}
+	free(context);
+	return 0;
+}
+
+static void Replay_PrintResult(const ReplaySession *session, double speed, const ReplayResult *result)
+{
+	double surfaceMB = (double)session->bytes / session->surfaceCount / 1048576.0;
+	char speedText[32];
+
+	if (speed > 0.0)
+	{
+		snprintf(speedText, sizeof speedText, "%gx", speed);
+	}
+	else
+	{
+		snprintf(speedText, sizeof speedText, "fast");
+	}
+	printf("%-6s %8llu surfaces in %7.2f s: %8.1f surfaces/s, %8.1f MB/s written, dropped %llu, write errors %llu, queue high-water %u\n",
+		speedText, (unsigned long long)result->replayed, result->seconds, result->writer.written / result->seconds,
+		result->writer.written * surfaceMB / result->seconds, (unsigned long long)result->writer.dropped,
+		(unsigned long long)result->writer.writeErrors, result->writer.queueHighWater);
+}
+
+static int Replay_ParseOptions(int argc, char **argv, ReplayOptions *options)
+{
+	int i;
+
+	memset(options, 0, sizeof(*options));
+	options->speed = 1.0;
+	options->repeat = 1;
+	options->maxCount = UINT32_MAX;
+	options->maxBytes = (uint64_t)REPLAY_MEMORY_MB * 1048576u;
+	options->writer.queueCapacity = WRITERQUEUESIZE;
+	options->writer.codec = SURFACECODEC_RAW;
+	options->writer.statsIntervalSeconds = REPLAY_STATSINTERVAL;
+	options->writer.writerCpu = -1;
+	if (argc < 3)
+	{
+		return -1;
+	}
+	options->inputFolder = argv[1];
+	snprintf(options->outputFolder, sizeof options->outputFolder, "%s%s", argv[2],
+		(strlen(argv[2]) > 0 && (argv[2][strlen(argv[2]) - 1] == '/' || argv[2][strlen(argv[2]) - 1] == '\\')) ? "" : "/");
+
+	for (i = 3; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-speed") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0.0)
+		{
+			options->speed = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-fast") == 0)
+		{
+			options->fast = 1;
+		}
+		else if (strcmp(argv[i], "-sweep") == 0)
+		{
+			options->sweep = 1;
+		}
+		else if (strcmp(argv[i], "-repeat") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+		{
+			options->repeat = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-count") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+		{
+			options->maxCount = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-memory") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+		{
+			options->maxBytes = (uint64_t)atoi(argv[++i]) * 1048576u;
+		}
+		else if (strcmp(argv[i], "-measurements") == 0 && i + 1 < argc)
+		{
+			options->measurementPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-container") == 0)
+		{
+			options->container = 1;
+		}
+		else if (strcmp(argv[i], "-pyramid") == 0)
+		{
+			options->writer.pyramidLevels = 3;
+		}
+		else if (strcmp(argv[i], "-crop") == 0)
+		{
+			options->writer.crop = 1;
+		}
+		else if (strcmp(argv[i], "-tiles") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 16 && atoi(argv[i + 1]) <= 4096)
+		{
+			options->writer.tileSize = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-compress") == 0)
+		{
+			options->writer.codec = SURFACECODEC_MEDRICE;
+		}
+		else if (strcmp(argv[i], "-compress-threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 1 && atoi(argv[i + 1]) <= 64)
+		{
+			options->writer.encodeThreads = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-checksum") == 0)
+		{
+			options->writer.checksum = 1;
+		}
+		else if (strcmp(argv[i], "-uring") == 0)
+		{
+			options->uring = 1;
+		}
+		else if (strcmp(argv[i], "-direct") == 0)
+		{
+			options->direct = 1;
+		}
+		else if (strcmp(argv[i], "-pool") == 0 && i + 1 < argc)
+		{
+			options->writer.poolBuffers = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-hugepages") == 0)
+		{
+			options->writer.hugePages = 1;
+		}
+		else
+		{
+			return -1;
+		}
+	}
+	if (options->writer.pyramidLevels > 0 && !options->container)
+	{
+		printf("Note: -pyramid is only stored with -container\n");
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	ReplayOptions options;
+	ReplaySession session;
+	ReplayResult result;
+	uint32_t i;
+
+	if (Replay_ParseOptions(argc, argv, &options) != 0)
+	{
+		printf("Usage: %s <input folder> <output folder> [-speed X | -fast | -sweep] [-repeat N] [-count N] [-memory MB]\n", argv[0]);
+		printf("       [-measurements <file>] [-container] [-pyramid] [-crop] [-tiles <size>] [-compress] [-compress-threads <n>]\n");
+		printf("       [-checksum] [-uring] [-direct] [-pool <buffers>] [-hugepages]\n");
+		printf("  -speed          Replay at X times the recorded rate (default 1)\n");
+		printf("  -fast           Replay as fast as the pipeline takes the surfaces (waits instead of dropping)\n");
+		printf("  -sweep          Replay at -speed, then twice as fast, ... until the pipeline does not keep up\n");
+		printf("  -repeat         Replay the loaded surfaces N times\n");
+		printf("  -count, -memory Load at most N surfaces / MB of surface data (default %d MB)\n", REPLAY_MEMORY_MB);
+		printf("  -measurements   Measurement text file or binary measurement log to replay with the surfaces\n");
+		printf("  Other options as for the logger\n");
+		return 1;
+	}
+
+	memset(&session, 0, sizeof(session));
+	if (Replay_LoadSurfaces(&session, &options) != 0 ||
+		(options.measurementPath != NULL && Replay_LoadMeasurements(&session, options.measurementPath) != 0))
+	{
+		return 1;
+	}
+	printf("%u surfaces loaded (%.1f MB), %.2f s of recording, %llu measurements\n", session.surfaceCount,
+		session.bytes / 1048576.0, session.passUs / 1.0e6, (unsigned long long)session.measurementCount);
+
+	if (options.sweep)
+	{
+		double speed;
+		double lastSpeed = 0.0;
+		double lastRate = 0.0;
+
+		if (GoLog_MakeFolder(options.outputFolder) != 0)
+		{
+			printf("Error creating folder %s\n", options.outputFolder);
+			return 1;
+		}
+		for (speed = options.speed; speed <= REPLAY_MAX_SPEED; speed *= 2.0)
+		{
+			char folder[1280];
+
+			snprintf(folder, sizeof folder, "%sSpeed%g/", options.outputFolder, speed);
+			if (Replay_Run(&session, &options, speed, folder, &result) != 0)
+			{
+				return 1;
+			}
+			Replay_PrintResult(&session, speed, &result);
+
+			// Saturated if surfaces were dropped, or queued faster than they were written
+			if (result.writer.dropped > 0 || result.writer.writeErrors > 0 ||
+				result.writer.written / result.seconds < REPLAY_KEEPUP * result.replayed * speed * 1.0e6 / (options.repeat * session.passUs))
+			{
+				break;
+			}
+			lastSpeed = speed;
+			lastRate = result.writer.written / result.seconds;
+		}
+		if (lastSpeed == 0.0)
+		{
+			printf("Pipeline does not keep up already at %gx\n", options.speed);
+		}
+		else if (speed > REPLAY_MAX_SPEED)
+		{
+			printf("No surfaces dropped up to %gx (%.1f surfaces/s)\n", lastSpeed, lastRate);
+		}
+		else
+		{
+			printf("Pipeline keeps up at %gx (%.1f surfaces/s) and saturates at %gx\n", lastSpeed, lastRate, speed);
+		}
+	}
+	else
+	{
+		if (Replay_Run(&session, &options, options.fast ? 0.0 : options.speed, options.outputFolder, &result) != 0)
+		{
+			return 1;
+		}
+		printf("\n");
+		Replay_PrintResult(&session, options.fast ? 0.0 : options.speed, &result);
+	}
+
+	for (i = 0; i < session.surfaceCount; i++)
+	{
+		free(session.surfaces[i].data);
+	}
+	free(session.surfaces);
+	free(session.measurements);
+	return (result.writer.writeErrors > 0) ? 1 : 0;
+}
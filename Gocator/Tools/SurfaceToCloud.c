@@ -0,0 +1,264 @@
+/*
+* SurfaceToCloud.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Export logged surfaces as point clouds (SurfaceCloud.h) for tools
+* that read PLY, PCD or XYZ files, with the X, Y and Z of each valid sample in
+* mm (single precision):
+*
+*	X = XOffset + column * XResolution
+*	Y = YOffset + row * YResolution
+*	Z = ZOffset + height * ZResolution
+*
+* Usage: SurfaceToCloud [-ply | -pcd | -xyz] [-region <xMin> <xMax> <yMin> <yMax>] <surface file> [<surface file> ...]
+*
+* Each xxx.bin surface file is exported to xxx.ply (binary, the default),
+* xxx.pcd (binary) or xxx.xyz (text) in the same folder; the surfaces of a
+* session container to xxx_<surface number>.ply etc. With -region only the
+* samples with X and Y within the window (mm) are exported.
+*
+* The cloud is written row by row and never held in memory: raw surfaces are
+* read straight from the mapped file, coded and tiled surfaces are decoded to
+* 16 bit heights first (only the tiles of the region for tiled surfaces).
+* The number of points and the throughput (points/s and MB/s written) are
+* printed for each surface and in total.
+*/
+
+#include "../GoLogPlatform.h"
+#include "../SurfaceCloud.h"
+#include "../SurfaceReader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+	SurfaceCloudFormat format;
+	int useWindow;
+	double window[4];					// xMin, xMax, yMin, yMax (mm)
+	int16_t *heights;					// Decoded region of a coded surface
+	size_t heightsSize;					// Samples in heights
+	uint64_t surfaceCount;
+	uint64_t sampleCount;
+	uint64_t pointCount;
+	uint64_t bytesWritten;
+	uint64_t exportNs;
+}CloudExport;
+
+// Export the samples of region of record to outputName. Returns 0 on success.
+static int ExportSurface(CloudExport *cloud, const SurfaceRecord *record, const SurfaceRegion *region, const char *outputName)
+{
+	SurfaceCloudWriter writer;
+	const int16_t *rows;
+	size_t stride;
+	uint64_t pointCount = 0;
+	uint64_t startNs = GoLog_MonotonicNs();
+	uint64_t elapsedNs;
+	long fileSize;
+	FILE *fptr;
+	uint32_t row;
+	int result = 0;
+
+	if (record->data != NULL)
+	{
+		// Raw surface stored row by row: rows of the region straight from the mapped file
+		rows = record->data + (size_t)region->row * record->surfaceWidth + region->column;
+		stride = record->surfaceWidth;
+	}
+	else
+	{
+		size_t size = (size_t)region->width * region->length;
+
+		if (size > cloud->heightsSize)
+		{
+			free(cloud->heights);
+			cloud->heights = (int16_t *)malloc(size * sizeof(int16_t));
+			cloud->heightsSize = (cloud->heights != NULL) ? size : 0;
+			if (cloud->heights == NULL)
+			{
+				printf("Out of memory\n");
+				return -1;
+			}
+		}
+		if (SurfaceFile_DecodeRegion(record, region, cloud->heights, NULL) != 0)
+		{
+			printf("Error decoding surface %u\n", record->count);
+			return -1;
+		}
+		rows = cloud->heights;
+		stride = region->width;
+	}
+
+	for (row = 0; row < region->length; row++)
+	{
+		pointCount += SurfaceCloud_CountValid(rows + row * stride, region->width);
+	}
+
+	if ((fptr = fopen(outputName, "wb")) == NULL)
+	{
+		printf("Error opening file %s\n", outputName);
+		return -1;
+	}
+	if (SurfaceCloudWriter_Begin(&writer, fptr, cloud->format, pointCount, region->width) != 0)
+	{
+		printf("Error writing file %s\n", outputName);
+		fclose(fptr);
+		return -1;
+	}
+	for (row = 0; row < region->length && result == 0; row++)
+	{
+		result = SurfaceCloudWriter_Rows(&writer, record, rows + row * stride, region->width, 1,
+			record->cropColumn + region->column, record->cropRow + region->row + row);
+	}
+	if (SurfaceCloudWriter_End(&writer) != 0)
+	{
+		result = -1;
+	}
+	fileSize = ftell(fptr);
+	if (fclose(fptr) != 0 || result != 0)
+	{
+		printf("Error writing file %s\n", outputName);
+		return -1;
+	}
+	elapsedNs = GoLog_MonotonicNs() - startNs;
+
+	printf("Surface %u: %llu points (%.1f%% of %u x %u) written to %s, %.1f Mpoints/s\n", record->count,
+		(unsigned long long)pointCount, (region->width > 0) ? 100.0 * pointCount / ((double)region->width * region->length) : 0.0,
+		region->width, region->length, outputName, (elapsedNs > 0) ? pointCount * 1e3 / elapsedNs : 0.0);
+	cloud->surfaceCount++;
+	cloud->sampleCount += (uint64_t)region->width * region->length;
+	cloud->pointCount += pointCount;
+	cloud->bytesWritten += (fileSize > 0) ? (uint64_t)fileSize : 0;
+	cloud->exportNs += elapsedNs;
+	return 0;
+}
+
+// Export all surfaces of a surface file or session container. Returns number of errors.
+static int ExportFile(CloudExport *cloud, const char *inputName)
+{
+	SurfaceFile file;
+	SurfaceRecord record;
+	SurfaceRegion region;
+	char outputName[1280];
+	size_t nameLength = strlen(inputName);
+	int stemLength = (int)nameLength;
+	uint64_t count;
+	uint64_t i;
+	int errorCount = 0;
+
+	if (SurfaceFile_Open(&file, inputName) != 0)
+	{
+		printf("Error opening file %s\n", inputName);
+		return 1;
+	}
+	if (nameLength > 4 && strcmp(inputName + nameLength - 4, ".bin") == 0)
+	{
+		stemLength -= 4;
+	}
+
+	count = SurfaceFile_Count(&file);
+	for (i = 0; i < count; i++)
+	{
+		if (SurfaceFile_Surface(&file, i, &record) != 0)
+		{
+			printf("Error reading surface %llu of %s\n", (unsigned long long)i, inputName);
+			errorCount++;
+			continue;
+		}
+
+		if (cloud->useWindow)
+		{
+			SurfaceFile_Region(&record, cloud->window[0], cloud->window[1], cloud->window[2], cloud->window[3], &region);
+		}
+		else
+		{
+			region.column = 0;
+			region.row = 0;
+			region.width = record.surfaceWidth;
+			region.length = record.surfaceLength;
+		}
+		if (region.width == 0 || region.length == 0)
+		{
+			printf("Surface %u of %s: no samples in region\n", record.count, inputName);
+			continue;
+		}
+
+		if (file.isContainer)
+		{
+			snprintf(outputName, sizeof outputName, "%.*s_%u.%s", stemLength, inputName, record.count,
+				SurfaceCloud_Extension(cloud->format));
+		}
+		else
+		{
+			snprintf(outputName, sizeof outputName, "%.*s.%s", stemLength, inputName, SurfaceCloud_Extension(cloud->format));
+		}
+		if (ExportSurface(cloud, &record, &region, outputName) != 0)
+		{
+			errorCount++;
+		}
+	}
+
+	SurfaceFile_Close(&file);
+	return errorCount;
+}
+
+int main(int argc, char **argv)
+{
+	CloudExport cloud;
+	int fileCount = 0;
+	int errorCount = 0;
+	int i;
+
+	memset(&cloud, 0, sizeof(cloud));
+	cloud.format = SURFACECLOUD_PLY;
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-ply") == 0)
+		{
+			cloud.format = SURFACECLOUD_PLY;
+		}
+		else if (strcmp(argv[i], "-pcd") == 0)
+		{
+			cloud.format = SURFACECLOUD_PCD;
+		}
+		else if (strcmp(argv[i], "-xyz") == 0)
+		{
+			cloud.format = SURFACECLOUD_XYZ;
+		}
+		else if (strcmp(argv[i], "-region") == 0 && i + 4 < argc)
+		{
+			cloud.useWindow = 1;
+			cloud.window[0] = atof(argv[++i]);
+			cloud.window[1] = atof(argv[++i]);
+			cloud.window[2] = atof(argv[++i]);
+			cloud.window[3] = atof(argv[++i]);
+		}
+		else
+		{
+			fileCount++;
+			errorCount += ExportFile(&cloud, argv[i]);
+		}
+	}
+
+	if (fileCount == 0)
+	{
+		printf("Usage: %s [-ply | -pcd | -xyz] [-region <xMin> <xMax> <yMin> <yMax>] <surface file> [<surface file> ...]\n", argv[0]);
+		printf("  Exports the valid samples of each surface as X Y Z points (mm) to a binary PLY (default),\n");
+		printf("  binary PCD or XYZ text file next to the surface file; -region exports only a window in X and Y (mm)\n");
+		return 1;
+	}
+
+	if (cloud.surfaceCount > 0)
+	{
+		double seconds = cloud.exportNs / 1e9;
+
+		printf("%llu surfaces, %llu points (%.1f%% of %llu samples) in %.3f s: %.1f Mpoints/s, %.1f MB/s\n",
+			(unsigned long long)cloud.surfaceCount, (unsigned long long)cloud.pointCount,
+			(cloud.sampleCount > 0) ? 100.0 * cloud.pointCount / cloud.sampleCount : 0.0,
+			(unsigned long long)cloud.sampleCount, seconds, (seconds > 0) ? cloud.pointCount / seconds / 1e6 : 0.0,
+			(seconds > 0) ? cloud.bytesWritten / seconds / 1e6 : 0.0);
+	}
+	free(cloud.heights);
+	return errorCount > 0 ? 1 : 0;
+}
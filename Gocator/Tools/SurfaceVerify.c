@@ -0,0 +1,482 @@
+/*
+* SurfaceVerify.c
+*
+* Licensed under The MIT License.
+*
+* Purpose: Check the integrity of a logged session - separate surface files
+* and session containers - and report damaged or incomplete surfaces.
+*
+* Usage: SurfaceVerify <folder> [-threads <n>] [-quiet]
+*
+* The surface files and containers of the folder and its subfolders (the
+* Sensor<serial> folders of sessions logged from several sensors) are checked.
+* Every file is opened and every surface header parsed, which finds files and
+* records that were cut short (e.g. by power loss while logging) and, for
+* files written with -checksum (VER0006), headers that do not match their
+* checksum. The payload chunks of checksummed surfaces are then checked
+* against their CRC32C checksums (SurfaceChecksum.h) on n threads (default:
+* all CPUs) with a work-stealing pool (TaskPool.h), one task per chunk, so
+* that a session is read at the speed of the disk and long surfaces in
+* containers are shared out as well as many small files. The overview levels
+* stored after checksummed surfaces in containers (-pyramid) are checked
+* against their own checksums, one task per level. Files are checked
+* VERIFY_GROUPFILES at a time, so that only those are mapped at once.
+*
+* Containers without index and footer (not closed, see SurfaceContainer.h)
+* are damaged files; their complete records are still checked, and any bytes
+* after the last complete record are reported as an incomplete record.
+*
+* Surfaces without checksums (files before VER0006) are reported as
+* complete if their header and size are consistent. The exit code is 1 if
+* any file or surface is damaged or incomplete, or if no surface files are
+* found.
+*/
+
+#include "../GoLogPlatform.h"
+#include "../SurfaceReader.h"
+#include "../SurfaceContainer.h"
+#include "../SurfaceChecksum.h"
+#include "../TaskPool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VERIFY_GROUPFILES		256		// Files mapped and checked at a time
+#define VERIFY_MAXTHREADS		64
+#define VERIFY_PATHSIZE			1280
+
+// Surface files and containers to check
+typedef struct
+{
+	char **paths;						// In folder and file name order
+	uint64_t count;
+	uint64_t capacity;
+}VerifyFileList;
+
+// A checksummed surface of the current group
+typedef struct
+{
+	SurfaceRecord record;
+	uint32_t fileIdx;					// In the current group
+	uint64_t surfaceIdx;				// In its file
+	SurfacePyramidLevel levels[PYRAMID_MAXLEVELS];	// Overview levels stored after the surface
+	uint32_t levelCount;
+	uint32_t badLevels;					// Overview levels that could not be read
+}VerifySurface;
+
+// One payload chunk or overview level of a checksummed surface
+typedef struct
+{
+	const VerifySurface *surface;
+	uint32_t chunk;						// Payload chunk, or overview level chunk - checksumChunkCount
+	int bad;							// Set by the worker that checked the chunk
+}VerifyTask;
+
+typedef struct
+{
+	SurfaceFile files[VERIFY_GROUPFILES];
+	int fileOpen[VERIFY_GROUPFILES];
+	VerifySurface *surfaces;			// Checksummed surfaces of the group
+	uint64_t surfaceCapacity;
+	uint64_t surfaceCount;
+	VerifyTask *tasks;
+	uint64_t taskCapacity;
+	uint32_t taskCount;
+}VerifyGroup;
+
+typedef struct
+{
+	uint64_t files;
+	uint64_t badFiles;					// Files that could not be opened as a surface file or container, or containers without index
+	uint64_t surfaces;
+	uint64_t checksummed;				// Surfaces with checksums, all chunks checked
+	uint64_t unchecked;					// Surfaces without checksums, header and size consistent
+	uint64_t badRecords;				// Surfaces with an incomplete record or damaged header
+	uint64_t levels;					// Overview levels checked against checksums
+	uint64_t badSurfaces;				// Surfaces with at least one chunk or overview level that does not match its checksum
+	uint64_t badChunks;
+	uint64_t badLevels;
+	uint64_t bytes;						// Payload and overview level bytes checked
+}VerifyCounts;
+
+static void Verify_ChunkTask(void *context, uint32_t task, uint32_t worker)
+{
+	VerifyTask *verifyTask = &((VerifyTask *)context)[task];
+	const VerifySurface *surface = verifyTask->surface;
+	const SurfacePyramidLevel *level;
+
+	(void)worker;
+	if (verifyTask->chunk < surface->record.checksumChunkCount)
+	{
+		verifyTask->bad = SurfaceChecksum_VerifyChunk(&surface->record, verifyTask->chunk) != 0;
+	}
+	else
+	{
+		level = &surface->levels[verifyTask->chunk - surface->record.checksumChunkCount];
+		verifyTask->bad = SurfaceChecksum_Level(level) != level->checksum;
+	}
+}
+
+static int Verify_HasSuffix(const char *name, const char *suffix)
+{
+	size_t nameLength = strlen(name);
+	size_t suffixLength = strlen(suffix);
+	return nameLength >= suffixLength && strcmp(name + nameLength - suffixLength, suffix) == 0;
+}
+
+// Grow an array to hold count elements of size bytes. Returns 0 on success.
+static int Verify_Reserve(void **array, uint64_t *capacity, uint64_t count, size_t size)
+{
+	void *grown;
+
+	if (count <= *capacity)
+	{
+		return 0;
+	}
+	if ((grown = realloc(*array, (size_t)(count * 2) * size)) == NULL)
+	{
+		return -1;
+	}
+	*array = grown;
+	*capacity = count * 2;
+	return 0;
+}
+
+// Add the surface files and containers in folder and its subfolders to list. Returns 0 on success.
+static int Verify_Discover(VerifyFileList *list, const char *folder)
+{
+	char path[VERIFY_PATHSIZE];
+	const char *separator = (strlen(folder) > 0 && (folder[strlen(folder) - 1] == '/' || folder[strlen(folder) - 1] == '\\')) ? "" : "/";
+	char **names;
+	int nameCount;
+	int result = 0;
+	int i;
+
+	if ((nameCount = GoLog_ListFiles(folder, ".bin", &names)) < 0)
+	{
+		printf("Error reading folder %s\n", folder);
+		return -1;
+	}
+	for (i = 0; i < nameCount && result == 0; i++)
+	{
+		if (!Verify_HasSuffix(names[i], DATAFILENAMESUFFIX) && !Verify_HasSuffix(names[i], SESSIONFILENAMESUFFIX))
+		{
+			continue;
+		}
+		snprintf(path, sizeof path, "%s%s%s", folder, separator, names[i]);
+		if (Verify_Reserve((void **)&list->paths, &list->capacity, list->count + 1, sizeof(char *)) != 0 ||
+			(list->paths[list->count] = malloc(strlen(path) + 1)) == NULL)
+		{
+			result = -1;
+			break;
+		}
+		strcpy(list->paths[list->count++], path);
+	}
+	GoLog_FreeFileList(names, nameCount);
+
+	if (result != 0 || (nameCount = GoLog_ListFolders(folder, &names)) < 0)
+	{
+		return -1;
+	}
+	for (i = 0; i < nameCount && result == 0; i++)
+	{
+		snprintf(path, sizeof path, "%s%s%s", folder, separator, names[i]);
+		result = Verify_Discover(list, path);
+	}
+	GoLog_FreeFileList(names, nameCount);
+	return result;
+}
+
+static void Verify_FreeFileList(VerifyFileList *list)
+{
+	uint64_t i;
+
+	for (i = 0; i < list->count; i++)
+	{
+		free(list->paths[i]);
+	}
+	free(list->paths);
+}
+
+// Parse all surfaces of the open files of group, and make a task for each chunk of the checksummed ones.
+// The surfaces must not move once tasks point to them, so all are stored before the tasks are made.
+static int Verify_Collect(VerifyGroup *group, uint32_t fileCount, char **paths, VerifyCounts *counts, int quiet)
+{
+	SurfaceRecord record;
+	VerifySurface *stored;
+	uint64_t storedIdx;
+	uint32_t fileIdx;
+	uint64_t surfaceIdx;
+	uint32_t levelCount;
+	uint32_t level;
+	uint32_t chunk;
+
+	group->surfaceCount = 0;
+	for (fileIdx = 0; fileIdx < fileCount; fileIdx++)
+	{
+		if (!group->fileOpen[fileIdx])
+		{
+			continue;
+		}
+		for (surfaceIdx = 0; surfaceIdx < SurfaceFile_Count(&group->files[fileIdx]); surfaceIdx++)
+		{
+			counts->surfaces++;
+			if (SurfaceFile_Surface(&group->files[fileIdx], surfaceIdx, &record) != 0)
+			{
+				counts->badRecords++;
+				if (!quiet)
+				{
+					printf("DAMAGED: %s surface %llu - incomplete record or header checksum mismatch\n", paths[fileIdx],
+						(unsigned long long)surfaceIdx);
+				}
+				continue;
+			}
+			if (record.checksumChunkSize == 0)
+			{
+				counts->unchecked++;
+				continue;
+			}
+			if (Verify_Reserve((void **)&group->surfaces, &group->surfaceCapacity, group->surfaceCount + 1, sizeof(VerifySurface)) != 0)
+			{
+				return -1;
+			}
+			stored = &group->surfaces[group->surfaceCount++];
+			stored->record = record;
+			stored->fileIdx = fileIdx;
+			stored->surfaceIdx = surfaceIdx;
+			stored->levelCount = 0;
+			stored->badLevels = 0;
+			counts->checksummed++;
+			counts->bytes += record.payloadSize;
+
+			// Overview levels, with the level headers checked by reading them
+			levelCount = SurfaceFile_PyramidLevels(&group->files[fileIdx], surfaceIdx);
+			for (level = 0; level < levelCount; level++)
+			{
+				SurfacePyramidLevel *pyramidLevel = &stored->levels[stored->levelCount];
+
+				if (level >= PYRAMID_MAXLEVELS ||
+					SurfaceFile_Pyramid(&group->files[fileIdx], surfaceIdx, level, pyramidLevel) != 0)
+				{
+					stored->badLevels++;
+					if (!quiet)
+					{
+						printf("DAMAGED: %s surface %llu - overview level %u incomplete or damaged\n", paths[fileIdx],
+							(unsigned long long)surfaceIdx, level);
+					}
+					continue;
+				}
+				stored->levelCount++;
+				counts->levels++;
+				counts->bytes += (uint64_t)pyramidLevel->width * pyramidLevel->length * sizeof(int16_t);
+			}
+		}
+	}
+
+	// One task per chunk and overview level
+	group->taskCount = 0;
+	for (storedIdx = 0; storedIdx < group->surfaceCount; storedIdx++)
+	{
+		uint32_t taskCount;
+
+		stored = &group->surfaces[storedIdx];
+		taskCount = stored->record.checksumChunkCount + stored->levelCount;
+		if (Verify_Reserve((void **)&group->tasks, &group->taskCapacity,
+			(uint64_t)group->taskCount + taskCount, sizeof(VerifyTask)) != 0)
+		{
+			return -1;
+		}
+		for (chunk = 0; chunk < taskCount; chunk++)
+		{
+			VerifyTask *task = &group->tasks[group->taskCount++];
+
+			task->surface = stored;
+			task->chunk = chunk;
+			task->bad = 0;
+		}
+	}
+	return 0;
+}
+
+// Count and report the results of the tasks of group, surface by surface (the tasks are in surface order)
+static void Verify_Report(const VerifyGroup *group, char **paths, VerifyCounts *counts, int quiet)
+{
+	uint32_t taskIdx = 0;
+	uint64_t storedIdx;
+
+	for (storedIdx = 0; storedIdx < group->surfaceCount; storedIdx++)
+	{
+		const VerifySurface *surface = &group->surfaces[storedIdx];
+		uint32_t badChunks = 0;
+		uint32_t badLevels = surface->badLevels;
+
+		for (; taskIdx < group->taskCount && group->tasks[taskIdx].surface == surface; taskIdx++)
+		{
+			const VerifyTask *task = &group->tasks[taskIdx];
+			uint64_t first = (uint64_t)task->chunk * surface->record.checksumChunkSize;
+			uint64_t end = first + surface->record.checksumChunkSize;
+
+			if (!task->bad)
+			{
+				continue;
+			}
+			if (task->chunk >= surface->record.checksumChunkCount)
+			{
+				badLevels++;
+				if (!quiet)
+				{
+					printf("DAMAGED: %s surface %llu - overview level %ux does not match its checksum\n",
+						paths[surface->fileIdx], (unsigned long long)surface->surfaceIdx,
+						surface->levels[task->chunk - surface->record.checksumChunkCount].factor);
+				}
+				continue;
+			}
+			badChunks++;
+			if (!quiet)
+			{
+				printf("DAMAGED: %s surface %llu - payload bytes %llu to %llu do not match their checksum\n",
+					paths[surface->fileIdx], (unsigned long long)surface->surfaceIdx, (unsigned long long)first,
+					(unsigned long long)(end < surface->record.payloadSize ? end : surface->record.payloadSize) - 1);
+			}
+		}
+		counts->badChunks += badChunks;
+		counts->badLevels += badLevels;
+		counts->badSurfaces += (badChunks > 0 || badLevels > 0);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	VerifyGroup *group;
+	VerifyCounts counts;
+	TaskPool pool;
+	VerifyFileList list;
+	char *paths[VERIFY_GROUPFILES];
+	uint32_t threads = (uint32_t)GoLog_CpuCount();
+	uint64_t startNs;
+	uint64_t listIdx = 0;
+	double seconds;
+	int quiet = 0;
+	int i;
+
+	if (argc < 2)
+	{
+		printf("Usage: %s <folder> [-threads <n>] [-quiet]\n", argv[0]);
+		printf("  -threads        Threads checking the surface data (default: number of CPUs, up to %d)\n", VERIFY_MAXTHREADS);
+		printf("  -quiet          Print the summary only\n");
+		return 1;
+	}
+	for (i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 1)
+		{
+			threads = (uint32_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-quiet") == 0)
+		{
+			quiet = 1;
+		}
+		else
+		{
+			printf("Unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	threads = (threads < 1) ? 1 : (threads > VERIFY_MAXTHREADS ? VERIFY_MAXTHREADS : threads);
+
+	memset(&list, 0, sizeof(list));
+	if (Verify_Discover(&list, argv[1]) != 0)
+	{
+		Verify_FreeFileList(&list);
+		return 1;
+	}
+	if (list.count == 0)
+	{
+		printf("No surface files or session containers found in %s\n", argv[1]);
+		Verify_FreeFileList(&list);
+		return 1;
+	}
+	if ((group = calloc(1, sizeof(VerifyGroup))) == NULL || TaskPool_Start(&pool, threads) != 0)
+	{
+		printf("Error starting %u threads\n", threads);
+		Verify_FreeFileList(&list);
+		free(group);
+		return 1;
+	}
+	memset(&counts, 0, sizeof(counts));
+
+	startNs = GoLog_MonotonicNs();
+	while (listIdx < list.count)
+	{
+		uint32_t fileCount = 0;
+		uint32_t fileIdx;
+
+		// Next group of surface files and containers
+		for (; listIdx < list.count && fileCount < VERIFY_GROUPFILES; listIdx++)
+		{
+			paths[fileCount] = list.paths[listIdx];
+			counts.files++;
+			group->fileOpen[fileCount] = (SurfaceFile_Open(&group->files[fileCount], paths[fileCount]) == 0);
+			if (!group->fileOpen[fileCount])
+			{
+				counts.badFiles++;
+				if (!quiet)
+				{
+					printf("DAMAGED: %s - not a complete surface file or container\n", paths[fileCount]);
+				}
+			}
+			else if (group->files[fileCount].isContainer && group->files[fileCount].indexEntries == NULL)
+			{
+				// Readers fall back to the complete records, but the container was not closed
+				counts.badFiles++;
+				counts.badRecords += (group->files[fileCount].trailingBytes > 0);
+				if (!quiet)
+				{
+					printf("DAMAGED: %s - no index and footer (container not closed)\n", paths[fileCount]);
+					if (group->files[fileCount].trailingBytes > 0)
+					{
+						printf("DAMAGED: %s - incomplete record, %llu bytes after the last complete record\n", paths[fileCount],
+							(unsigned long long)group->files[fileCount].trailingBytes);
+					}
+				}
+			}
+			fileCount++;
+		}
+
+		if (Verify_Collect(group, fileCount, paths, &counts, quiet) != 0)
+		{
+			printf("Out of memory\n");
+			listIdx = list.count;
+		}
+		else
+		{
+			TaskPool_Run(&pool, group->taskCount, Verify_ChunkTask, group->tasks);
+			Verify_Report(group, paths, &counts, quiet);
+		}
+
+		for (fileIdx = 0; fileIdx < fileCount; fileIdx++)
+		{
+			if (group->fileOpen[fileIdx])
+			{
+				SurfaceFile_Close(&group->files[fileIdx]);
+			}
+		}
+	}
+	seconds = (GoLog_MonotonicNs() - startNs) / 1.0e9;
+
+	printf("%llu files, %llu surfaces: %llu checked against checksums (%llu overview levels), %llu without checksums (header and size only)\n",
+		(unsigned long long)counts.files, (unsigned long long)counts.surfaces, (unsigned long long)counts.checksummed,
+		(unsigned long long)counts.levels, (unsigned long long)counts.unchecked);
+	printf("Damaged: %llu files, %llu records, %llu surfaces (%llu chunks, %llu overview levels)\n",
+		(unsigned long long)counts.badFiles, (unsigned long long)counts.badRecords, (unsigned long long)counts.badSurfaces,
+		(unsigned long long)counts.badChunks, (unsigned long long)counts.badLevels);
+	printf("%.1f MB checked in %.2f s (%.0f MB/s, %u threads)\n", counts.bytes / 1048576.0, seconds,
+		seconds > 0.0 ? counts.bytes / 1048576.0 / seconds : 0.0, threads);
+
+	TaskPool_Stop(&pool);
+	Verify_FreeFileList(&list);
+	free(group->surfaces);
+	free(group->tasks);
+	free(group);
+	return (counts.badFiles > 0 || counts.badRecords > 0 || counts.badSurfaces > 0) ? 1 : 0;
+}